@@ -0,0 +1,357 @@
+#include "Annotation.h"
+#include "CsvWriter.h"
+#include "IntervalIndex.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+// Splits a line at tabs
+static std::vector<std::string> splitTabs(const std::string& line)
+{
+	std::vector<std::string> fields;
+	std::stringstream ss(line);
+	std::string field;
+	while (std::getline(ss, field, '\t'))
+	{
+		fields.push_back(field);
+	}
+	return fields;
+}
+
+// Gets the value of a key=value attribute of a GFF3 attribute column, or an empty string
+static std::string gffAttribute(const std::string& attributes, const std::string& key)
+{
+	std::stringstream ss(attributes);
+	std::string pair;
+	while (std::getline(ss, pair, ';'))
+	{
+		if (pair.size() > key.size() && pair.compare(0, key.size(), key) == 0 && pair[key.size()] == '=')
+		{
+			return pair.substr(key.size() + 1);
+		}
+	}
+	return "";
+}
+
+// Gets the value of a key "value"; attribute of a GTF attribute column, or an empty string
+static std::string gtfAttribute(const std::string& attributes, const std::string& key)
+{
+	std::stringstream ss(attributes);
+	std::string pair;
+	while (std::getline(ss, pair, ';'))
+	{
+		size_t begin = pair.find_first_not_of(' ');
+		if (begin == std::string::npos || pair.compare(begin, key.size(), key) != 0
+			|| begin + key.size() >= pair.size() || pair[begin + key.size()] != ' ')
+		{
+			continue;
+		}
+		std::string value = pair.substr(pair.find_first_not_of(' ', begin + key.size()));
+		if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+		{
+			value = value.substr(1, value.size() - 2);
+		}
+		return value;
+	}
+	return "";
+}
+
+// Parses a whole field as an unsigned coordinate
+static bool parseCoordinate(const std::string& field, uint64_t& value)
+{
+	auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+	return error == std::errc() && end == field.data() + field.size() && !field.empty();
+}
+
+// Reports a malformed line of an annotation file
+[[noreturn]] static void invalidAnnotationLine(const std::string& filename, uint64_t lineNumber, const std::string& reason)
+{
+	throw std::invalid_argument("Invalid line " + std::to_string(lineNumber) + " in " + filename + ": " + reason);
+}
+
+/// <summary>
+/// Loads a BED file (chrom, start, end[, name, ...]); track, browser and comment lines are skipped.
+/// </summary>
+/// <param name="filename">Path to the BED file.</param>
+/// <param name="chrom">Only features on this sequence are kept; empty keeps all.</param>
+/// <returns>The features in file order.</returns>
+std::vector<AnnotationFeature> loadBedFile(const std::string& filename, const std::string& chrom)
+{
+	std::vector<AnnotationFeature> features;
+	std::ifstream file(filename);
+	if (!file.is_open())
+	{
+		std::cerr << "Error: Could not open the file " << filename << std::endl;
+		return features;
+	}
+
+	std::string line;
+	uint64_t lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		++lineNumber;
+		if (!line.empty() && line.back() == '\r')
+		{
+			line.pop_back();
+		}
+		if (line.empty() || line[0] == '#' || line.rfind("track", 0) == 0 || line.rfind("browser", 0) == 0)
+		{
+			continue;
+		}
+
+		auto fields = splitTabs(line);
+		if (fields.size() < 3)
+		{
+			invalidAnnotationLine(filename, lineNumber, "expected chrom, start and end separated by tabs");
+		}
+		uint64_t start = 0, end = 0;
+		if (!parseCoordinate(fields[1], start) || !parseCoordinate(fields[2], end) || end < start)
+		{
+			invalidAnnotationLine(filename, lineNumber, "start and end must be numbers with start <= end");
+		}
+		if (!chrom.empty() && fields[0] != chrom)
+		{
+			continue;
+		}
+
+		features.push_back({ fields[0], start, end, fields.size() > 3 ? fields[3] : "", "region" });
+	}
+	return features;
+}
+
+// Loads the feature lines shared by GFF3 and GTF; only the attribute syntax differs
+static std::vector<AnnotationFeature> loadGffFeatures(const std::string& filename, const std::string& chrom, bool gtf)
+{
+	std::vector<AnnotationFeature> features;
+	std::ifstream file(filename);
+	if (!file.is_open())
+	{
+		std::cerr << "Error: Could not open the file " << filename << std::endl;
+		return features;
+	}
+
+	std::string line;
+	uint64_t lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		++lineNumber;
+		if (!line.empty() && line.back() == '\r')
+		{
+			line.pop_back();
+		}
+		if (line.empty() || line[0] == '#')
+		{
+			// The ##FASTA directive ends the feature section
+			if (line.rfind("##FASTA", 0) == 0) break;
+			continue;
+		}
+
+		auto fields = splitTabs(line);
+		if (fields.size() < 9)
+		{
+			invalidAnnotationLine(filename, lineNumber, "expected 9 columns separated by tabs");
+		}
+		uint64_t start = 0, end = 0;
+		if (!parseCoordinate(fields[3], start) || !parseCoordinate(fields[4], end) || start < 1 || end < start)
+		{
+			invalidAnnotationLine(filename, lineNumber, "start and end must be numbers with 1 <= start <= end");
+		}
+		if (!chrom.empty() && fields[0] != chrom)
+		{
+			continue;
+		}
+
+		std::string name;
+		if (gtf)
+		{
+			name = gtfAttribute(fields[8], "gene_name");
+			if (name.empty()) name = gtfAttribute(fields[8], "gene_id");
+			if (name.empty()) name = gtfAttribute(fields[8], "transcript_id");
+		}
+		else
+		{
+			name = gffAttribute(fields[8], "Name");
+			if (name.empty()) name = gffAttribute(fields[8], "gene_name");
+			if (name.empty()) name = gffAttribute(fields[8], "ID");
+		}
+
+		features.push_back({ fields[0], start - 1, end, name, fields[2] });
+	}
+	return features;
+}
+
+/// <summary>
+/// Loads a GFF3 file. Coordinates are converted from 1-based inclusive to 0-based half-open and
+/// the name is taken from the Name, gene_name or ID attribute.
+/// </summary>
+/// <param name="filename">Path to the GFF3 file.</param>
+/// <param name="chrom">Only features on this sequence are kept; empty keeps all.</param>
+/// <returns>The features in file order.</returns>
+std::vector<AnnotationFeature> loadGff3File(const std::string& filename, const std::string& chrom)
+{
+	return loadGffFeatures(filename, chrom, false);
+}
+
+/// <summary>
+/// Loads a GTF file. Coordinates are converted like GFF3 and the name is taken from the
+/// gene_name, gene_id or transcript_id attribute (key "value"; syntax).
+/// </summary>
+/// <param name="filename">Path to the GTF file.</param>
+/// <param name="chrom">Only features on this sequence are kept; empty keeps all.</param>
+/// <returns>The features in file order.</returns>
+std::vector<AnnotationFeature> loadGtfFile(const std::string& filename, const std::string& chrom)
+{
+	return loadGffFeatures(filename, chrom, true);
+}
+
+/// <summary>
+/// Loads a BED, GFF3 or GTF file, chosen by extension (.gff or .gff3 mean GFF3, .gtf GTF; anything else BED).
+/// </summary>
+/// <param name="filename">Path to the annotation file.</param>
+/// <param name="chrom">Only features on this sequence are kept; empty keeps all.</param>
+/// <returns>The features in file order.</returns>
+std::vector<AnnotationFeature> loadAnnotationFile(const std::string& filename, const std::string& chrom)
+{
+	std::string extension = fs::path(filename).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	if (extension == ".gtf")
+	{
+		return loadGtfFile(filename, chrom);
+	}
+	if (extension == ".gff" || extension == ".gff3")
+	{
+		return loadGff3File(filename, chrom);
+	}
+	return loadBedFile(filename, chrom);
+}
+
+/// <summary>
+/// Intersects every feature with the segments and isochores through static interval indexes.
+/// Features are queried in parallel batches.
+/// </summary>
+/// <param name="features">Annotation features.</param>
+/// <param name="segments">Hidden repeat segments (start, end, cost, best word).</param>
+/// <param name="isochores">Isochore intervals; may be empty.</param>
+/// <returns>One result per feature, in the same order.</returns>
+std::vector<FeatureAnnotation> annotateFeatures(
+	const std::vector<AnnotationFeature>& features,
+	const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments,
+	const std::vector<Isochore>& isochores)
+{
+	std::vector<std::pair<uint64_t, uint64_t>> segmentIntervals;
+	segmentIntervals.reserve(segments.size());
+	for (const auto& segment : segments)
+	{
+		segmentIntervals.emplace_back(std::get<0>(segment), std::get<1>(segment));
+	}
+	std::vector<std::pair<uint64_t, uint64_t>> isochoreIntervals;
+	isochoreIntervals.reserve(isochores.size());
+	for (const auto& isochore : isochores)
+	{
+		isochoreIntervals.emplace_back(isochore.start, isochore.end);
+	}
+
+	IntervalIndex segmentIndex = buildIntervalIndex(segmentIntervals);
+	IntervalIndex isochoreIndex = buildIntervalIndex(isochoreIntervals);
+
+	std::vector<FeatureAnnotation> annotations(features.size());
+	const size_t featuresPerBatch = 1024;
+	ParallelFor((features.size() + featuresPerBatch - 1) / featuresPerBatch, [&](size_t batch)
+		{
+			std::vector<size_t> hits;
+			size_t last = std::min(features.size(), (batch + 1) * featuresPerBatch);
+			for (size_t f = batch * featuresPerBatch; f < last; ++f)
+			{
+				const AnnotationFeature& feature = features[f];
+				FeatureAnnotation& result = annotations[f];
+
+				hits.clear();
+				segmentIndex.query(feature.start, feature.end, hits);
+				uint64_t topOverlap = 0;
+				size_t topId = 0;
+				for (size_t hit : hits)
+				{
+					const IndexedInterval& segment = segmentIndex.intervals[hit];
+					uint64_t overlap = std::min(feature.end, segment.end) - std::max(feature.start, segment.start);
+					result.coveredBases += overlap;
+					// Ties go to the segment first in input order, so the result does not depend on the tree walk
+					if (overlap > topOverlap || (overlap == topOverlap && segment.id < topId))
+					{
+						topOverlap = overlap;
+						topId = segment.id;
+					}
+				}
+				result.segmentCount = hits.size();
+				if (!hits.empty())
+				{
+					result.topWord = std::get<3>(segments[topId]);
+					result.topCost = std::get<2>(segments[topId]);
+				}
+
+				hits.clear();
+				isochoreIndex.query(feature.start, feature.end, hits);
+				topOverlap = 0;
+				topId = 0;
+				for (size_t hit : hits)
+				{
+					const IndexedInterval& isochore = isochoreIndex.intervals[hit];
+					uint64_t overlap = std::min(feature.end, isochore.end) - std::max(feature.start, isochore.start);
+					if (overlap > topOverlap || (overlap == topOverlap && isochore.id < topId))
+					{
+						topOverlap = overlap;
+						topId = isochore.id;
+					}
+				}
+				if (!hits.empty())
+				{
+					result.family = isochores[topId].family;
+					result.isochoreGc = isochores[topId].gc_content;
+				}
+			}
+		});
+
+	return annotations;
+}
+
+/// <summary>
+/// Saves the features with their hidden repeats and isochore class to a CSV file.
+/// </summary>
+/// <param name="features">Annotation features.</param>
+/// <param name="annotations">Results of annotateFeatures, in the same order.</param>
+/// <param name="filename">Path to the output CSV file.</param>
+void saveFeatureAnnotationsToCsv(const std::vector<AnnotationFeature>& features,
+	const std::vector<FeatureAnnotation>& annotations, const std::string& filename)
+{
+	CsvWriter csvFile(filename);
+	if (!csvFile.is_open())
+	{
+		std::cerr << "Error: Could not open the file " << filename << std::endl;
+		return;
+	}
+
+	csvFile << "Chrom,Start,End,Name,Type,Segments,Covered_Bases,Top_Word,Top_Cost,Isochore_Family,Isochore_GC\n";
+	for (size_t i = 0; i < features.size(); ++i)
+	{
+		const AnnotationFeature& feature = features[i];
+		const FeatureAnnotation& result = annotations[i];
+		csvFile << feature.chrom << ","
+			<< feature.start << ","
+			<< feature.end << ","
+			<< feature.name << ","
+			<< feature.type << ","
+			<< result.segmentCount << ","
+			<< result.coveredBases << ","
+			<< result.topWord << ","
+			<< result.topCost << ","
+			<< isochoreFamilyName(result.family) << ","
+			<< result.isochoreGc << "\n";
+	}
+
+	csvFile.close();
+	std::cout << "Feature annotations saved to " << filename << std::endl;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "Isochore.h"
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+/// <summary>
+/// A feature of an external annotation file, in 0-based half-open coordinates.
+/// </summary>
+struct AnnotationFeature
+{
+	std::string chrom;
+	uint64_t start;
+	uint64_t end;
+	std::string name;
+	std::string type; // GFF3 or GTF feature type, or "region" for BED
+};
+
+/// <summary>
+/// Hidden repeats and isochore class found for one annotation feature.
+/// </summary>
+struct FeatureAnnotation
+{
+	size_t segmentCount = 0;       // Segments overlapping the feature
+	uint64_t coveredBases = 0;     // Feature bases covered by those segments
+	std::string topWord;           // Best word of the segment covering most of the feature
+	double topCost = 0.0;          // Cost of that segment
+	IsochoreFamily family = IsochoreFamily::Unclassified; // Family of the isochore covering most of the feature
+	double isochoreGc = 0.0;       // GC content of that isochore
+};
+
+/// <summary>
+/// Loads a BED file (chrom, start, end[, name, ...]); track, browser and comment lines are skipped.
+/// A malformed line throws std::invalid_argument naming its line number.
+/// </summary>
+/// <param name="filename">Path to the BED file.</param>
+/// <param name="chrom">Only features on this sequence are kept; empty keeps all.</param>
+/// <returns>The features in file order.</returns>
+std::vector<AnnotationFeature> loadBedFile(const std::string& filename, const std::string& chrom = "");
+
+/// <summary>
+/// Loads a GFF3 file. Coordinates are converted from 1-based inclusive to 0-based half-open and
+/// the name is taken from the Name, gene_name or ID attribute. A malformed line, or a start
+/// below 1, throws std::invalid_argument naming its line number.
+/// </summary>
+/// <param name="filename">Path to the GFF3 file.</param>
+/// <param name="chrom">Only features on this sequence are kept; empty keeps all.</param>
+/// <returns>The features in file order.</returns>
+std::vector<AnnotationFeature> loadGff3File(const std::string& filename, const std::string& chrom = "");
+
+/// <summary>
+/// Loads a GTF file. Coordinates are converted like GFF3 and the name is taken from the
+/// gene_name, gene_id or transcript_id attribute (key "value"; syntax).
+/// </summary>
+/// <param name="filename">Path to the GTF file.</param>
+/// <param name="chrom">Only features on this sequence are kept; empty keeps all.</param>
+/// <returns>The features in file order.</returns>
+std::vector<AnnotationFeature> loadGtfFile(const std::string& filename, const std::string& chrom = "");
+
+/// <summary>
+/// Loads a BED, GFF3 or GTF file, chosen by extension (.gff or .gff3 mean GFF3, .gtf GTF; anything else BED).
+/// </summary>
+/// <param name="filename">Path to the annotation file.</param>
+/// <param name="chrom">Only features on this sequence are kept; empty keeps all.</param>
+/// <returns>The features in file order.</returns>
+std::vector<AnnotationFeature> loadAnnotationFile(const std::string& filename, const std::string& chrom = "");
+
+/// <summary>
+/// Intersects every feature with the segments and isochores through static interval indexes.
+/// Features are queried in parallel batches.
+/// </summary>
+/// <param name="features">Annotation features.</param>
+/// <param name="segments">Hidden repeat segments (start, end, cost, best word).</param>
+/// <param name="isochores">Isochore intervals; may be empty.</param>
+/// <returns>One result per feature, in the same order.</returns>
+std::vector<FeatureAnnotation> annotateFeatures(
+	const std::vector<AnnotationFeature>& features,
+	const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments,
+	const std::vector<Isochore>& isochores);
+
+/// <summary>
+/// Saves the features with their hidden repeats and isochore class to a CSV file.
+/// </summary>
+/// <param name="features">Annotation features.</param>
+/// <param name="annotations">Results of annotateFeatures, in the same order.</param>
+/// <param name="filename">Path to the output CSV file.</param>
+void saveFeatureAnnotationsToCsv(const std::vector<AnnotationFeature>& features,
+	const std::vector<FeatureAnnotation>& annotations, const std::string& filename);
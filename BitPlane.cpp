@@ -0,0 +1,107 @@
+#include "BitPlane.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+// Plane index of every character: 0 A, 1 C, 2 G, 3 T, 4 unknown
+static const std::array<uint8_t, 256> PlaneOfBase = []
+	{
+		std::array<uint8_t, 256> table{};
+		table.fill(4);
+		table['A'] = 0;
+		table['C'] = 1;
+		table['G'] = 2;
+		table['T'] = 3;
+		return table;
+	}();
+
+/// <summary>
+/// Counts all bases of [start, end) in one fused pass over the five planes.
+/// </summary>
+/// <param name="start">First position (inclusive).</param>
+/// <param name="end">Last position (exclusive).</param>
+/// <returns>The base counts of the range.</returns>
+BaseComposition BitPlaneSequence::count(uint64_t start, uint64_t end) const
+{
+	BaseComposition result;
+	end = std::min(end, length);
+	if (start >= end)
+	{
+		return result;
+	}
+
+	uint64_t firstWord = start >> 6;
+	uint64_t lastWord = (end - 1) >> 6;
+	uint64_t firstBits = ~uint64_t{ 0 } << (start & 63);
+	uint64_t lastBits = ~uint64_t{ 0 } >> (63 - ((end - 1) & 63));
+	const uint64_t* aWords = a.data();
+	const uint64_t* cWords = c.data();
+	const uint64_t* gWords = g.data();
+	const uint64_t* tWords = t.data();
+	const uint64_t* nWords = n.data();
+
+	for (uint64_t word = firstWord; word <= lastWord; ++word)
+	{
+		uint64_t bits = ~uint64_t{ 0 };
+		if (word == firstWord)
+		{
+			bits &= firstBits;
+		}
+		if (word == lastWord)
+		{
+			bits &= lastBits;
+		}
+
+		result.a += std::popcount(aWords[word] & bits);
+		result.c += std::popcount(cWords[word] & bits);
+		result.g += std::popcount(gWords[word] & bits);
+		result.t += std::popcount(tWords[word] & bits);
+		result.unknown += std::popcount(nWords[word] & bits);
+	}
+	return result;
+}
+
+/// <summary>
+/// Builds the bitplanes of a sequence. Blocks of the sequence are packed in parallel.
+/// </summary>
+/// <param name="sequence">The DNA sequence.</param>
+/// <returns>The bitplane representation of the sequence.</returns>
+BitPlaneSequence buildBitPlanes(std::string_view sequence)
+{
+	BitPlaneSequence planes;
+	planes.length = sequence.size();
+	uint64_t words = (planes.length + 63) / 64;
+	planes.a.assignZeros(words);
+	planes.c.assignZeros(words);
+	planes.g.assignZeros(words);
+	planes.t.assignZeros(words);
+	planes.n.assignZeros(words);
+
+	std::array<uint64_t*, 5> target = { planes.a.data(), planes.c.data(), planes.g.data(), planes.t.data(), planes.n.data() };
+
+	// Every block covers whole words, so blocks never write to the same word
+	const uint64_t wordsPerBlock = 1 << 14;
+	uint64_t blocks = (words + wordsPerBlock - 1) / wordsPerBlock;
+	ParallelFor(blocks, [&](size_t block)
+		{
+			uint64_t lastWord = std::min<uint64_t>(words, (block + 1) * wordsPerBlock);
+			for (uint64_t word = block * wordsPerBlock; word < lastWord; ++word)
+			{
+				std::array<uint64_t, 5> bits{};
+				uint64_t first = word * 64;
+				uint64_t last = std::min<uint64_t>(planes.length, first + 64);
+				for (uint64_t i = first; i < last; ++i)
+				{
+					bits[PlaneOfBase[static_cast<unsigned char>(sequence[i])]] |= uint64_t{ 1 } << (i - first);
+				}
+				for (int plane = 0; plane < 5; ++plane)
+				{
+					target[plane][word] = bits[plane];
+				}
+			}
+		});
+
+	return planes;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "WordArray.h"
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+/// <summary>
+/// Base counts of a range of the sequence, as returned by the fused bitplane kernel.
+/// Unknown bases are everything that is not an uppercase A, C, G or T, the same rule as isUnknownBase.
+/// </summary>
+struct BaseComposition
+{
+	uint64_t a = 0;
+	uint64_t c = 0;
+	uint64_t g = 0;
+	uint64_t t = 0;
+	uint64_t unknown = 0;
+
+	uint64_t gc() const { return g + c; }
+	uint64_t ga() const { return g + a; }
+	uint64_t valid() const { return a + c + g + t; }
+
+	/// <summary>
+	/// GC skew (G - C) / (G + C), 0 when the range has no G or C.
+	/// </summary>
+	double gcSkew() const { return (g + c) > 0 ? (static_cast<double>(g) - static_cast<double>(c)) / (g + c) : 0.0; }
+
+	/// <summary>
+	/// AT skew (A - T) / (A + T), 0 when the range has no A or T.
+	/// </summary>
+	double atSkew() const { return (a + t) > 0 ? (static_cast<double>(a) - static_cast<double>(t)) / (a + t) : 0.0; }
+
+	BaseComposition& operator+=(const BaseComposition& other)
+	{
+		a += other.a; c += other.c; g += other.g; t += other.t; unknown += other.unknown;
+		return *this;
+	}
+
+	BaseComposition& operator-=(const BaseComposition& other)
+	{
+		a -= other.a; c -= other.c; g -= other.g; t -= other.t; unknown -= other.unknown;
+		return *this;
+	}
+};
+
+/// <summary>
+/// The sequence stored as five bitplanes, one bit per base for each of A, C, G, T and N (unknown).
+/// Bit i % 64 of word i / 64 of a plane is set when base i is that letter, so the composition of
+/// 64 bases is five popcounts.
+/// </summary>
+struct BitPlaneSequence
+{
+	WordArray a;
+	WordArray c;
+	WordArray g;
+	WordArray t;
+	WordArray n;
+	uint64_t length = 0; // Number of bases
+
+	/// <summary>
+	/// Counts all bases of [start, end) in one fused pass over the five planes.
+	/// </summary>
+	/// <param name="start">First position (inclusive).</param>
+	/// <param name="end">Last position (exclusive).</param>
+	/// <returns>The base counts of the range.</returns>
+	BaseComposition count(uint64_t start, uint64_t end) const;
+};
+
+/// <summary>
+/// Builds the bitplanes of a sequence. Blocks of the sequence are packed in parallel.
+/// </summary>
+/// <param name="sequence">The DNA sequence.</param>
+/// <returns>The bitplane representation of the sequence.</returns>
+BitPlaneSequence buildBitPlanes(std::string_view sequence);
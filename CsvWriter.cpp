@@ -0,0 +1,201 @@
+#include "CsvWriter.h"
+#include "Trace.h"
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+static std::atomic<int> defaultPrecision{ CSV_DEFAULT_PRECISION };
+
+/// <summary>
+/// Sets the precision new CsvWriter instances start with.
+/// </summary>
+/// <param name="precision">Significant digits up to CSV_MAX_PRECISION, or 0 for the shortest text that reads back to the same double.</param>
+void setDefaultCsvPrecision(int precision)
+{
+	defaultPrecision = precision;
+}
+
+/// <summary>
+/// Gets the precision new CsvWriter instances start with.
+/// </summary>
+int defaultCsvPrecision()
+{
+	return defaultPrecision;
+}
+
+/// <summary>
+/// Formats a double the way std::ostream does with the given precision (printf "%.*g" in the C
+/// locale), or as the shortest round-trip text when precision is 0.
+/// </summary>
+/// <param name="first">Start of the output range.</param>
+/// <param name="last">End of the output range; 32 characters are always enough.</param>
+/// <param name="value">Value to format.</param>
+/// <param name="precision">Significant digits, or 0 for the shortest round-trip text.</param>
+/// <returns>One past the last character written.</returns>
+char* formatCsvDouble(char* first, char* last, double value, int precision)
+{
+	auto result = (precision > 0)
+		? std::to_chars(first, last, value, std::chars_format::general, precision)
+		: std::to_chars(first, last, value);
+	return result.ptr;
+}
+
+/// <summary>
+/// Appends a double to a text buffer, formatted by formatCsvDouble.
+/// </summary>
+/// <param name="out">Buffer to append to.</param>
+/// <param name="value">Value to format.</param>
+/// <param name="precision">Significant digits, or 0 for the shortest round-trip text.</param>
+void appendCsvDouble(std::string& out, double value, int precision)
+{
+	char buf[32];
+	out.append(buf, formatCsvDouble(buf, buf + sizeof(buf), value, precision));
+}
+
+/// <summary>
+/// Opens the file (in text mode, like std::ofstream) and starts the writer thread.
+/// </summary>
+/// <param name="filename">Path of the output file.</param>
+/// <param name="precision">Significant digits of doubles, or 0 for the shortest round-trip text.</param>
+CsvWriter::CsvWriter(const std::string& filename, int precision)
+	: file(filename), precision(precision)
+{
+	for (size_t i = 0; i < BUFFER_COUNT; ++i)
+	{
+		buffers.push_back(static_cast<char*>(::operator new(BUFFER_SIZE, std::align_val_t{ BUFFER_ALIGNMENT })));
+	}
+	current = buffers[0];
+	freeBuffers.assign(buffers.begin() + 1, buffers.end());
+
+	if (file.is_open())
+	{
+		writer = std::thread(&CsvWriter::writerLoop, this);
+	}
+	else
+	{
+		failed = true;
+	}
+}
+
+/// <summary>
+/// Flushes the remaining text and closes the file.
+/// </summary>
+CsvWriter::~CsvWriter()
+{
+	close();
+	for (char* buffer : buffers)
+	{
+		::operator delete(buffer, std::align_val_t{ BUFFER_ALIGNMENT });
+	}
+}
+
+/// <summary>
+/// Writes everything formatted so far, waits for the writer thread and closes the file.
+/// </summary>
+/// <returns>True when the file opened and every write succeeded.</returns>
+bool CsvWriter::close()
+{
+	if (!writer.joinable())
+	{
+		return !failed;
+	}
+
+	if (used > 0)
+	{
+		submit();
+	}
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		closing = true;
+	}
+	changed.notify_all();
+	writer.join();
+
+	file.close();
+	return !failed;
+}
+
+CsvWriter& CsvWriter::operator<<(std::string_view text)
+{
+	// Long text is split across buffers
+	while (!text.empty())
+	{
+		reserve(1);
+		size_t count = std::min(text.size(), BUFFER_SIZE - used);
+		std::memcpy(current + used, text.data(), count);
+		used += count;
+		text.remove_prefix(count);
+	}
+	return *this;
+}
+
+CsvWriter& CsvWriter::operator<<(char c)
+{
+	reserve(1);
+	current[used++] = c;
+	return *this;
+}
+
+CsvWriter& CsvWriter::operator<<(double value)
+{
+	reserve(32);
+	used = formatCsvDouble(current + used, current + BUFFER_SIZE, value, precision) - current;
+	return *this;
+}
+
+/// <summary>
+/// Queues the current buffer for the writer thread and takes a free one, waiting when all
+/// buffers are queued so a slow disk bounds the memory in use.
+/// </summary>
+void CsvWriter::submit()
+{
+	if (!writer.joinable())
+	{
+		// The file did not open or is closed; drop the text like std::ofstream does
+		used = 0;
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(mtx);
+	fullBuffers.emplace_back(current, used);
+	changed.notify_all();
+	changed.wait(lock, [&]() { return !freeBuffers.empty(); });
+	current = freeBuffers.back();
+	freeBuffers.pop_back();
+	used = 0;
+}
+
+/// <summary>
+/// Writes queued buffers to the file in order until the writer is closed.
+/// </summary>
+void CsvWriter::writerLoop()
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	while (true)
+	{
+		changed.wait(lock, [&]() { return !fullBuffers.empty() || closing; });
+		if (fullBuffers.empty())
+		{
+			return;
+		}
+
+		auto [buffer, size] = fullBuffers.front();
+		fullBuffers.erase(fullBuffers.begin());
+		lock.unlock();
+
+		file.write(buffer, size);
+		TRACE_COUNT(BytesWritten, size);
+		bool ok = static_cast<bool>(file);
+
+		lock.lock();
+		if (!ok && !failed)
+		{
+			failed = true;
+			std::cerr << "Error: Writing the CSV output failed." << std::endl;
+		}
+		freeBuffers.push_back(buffer);
+		changed.notify_all();
+	}
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include <charconv>
+#include <concepts>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+// Significant digits of doubles, the same as the default precision of std::ostream
+const int CSV_DEFAULT_PRECISION = 6;
+
+// Most significant digits a double needs to read back exactly; more only adds noise digits
+const int CSV_MAX_PRECISION = 17;
+
+/// <summary>
+/// Sets the precision new CsvWriter instances start with.
+/// </summary>
+/// <param name="precision">Significant digits up to CSV_MAX_PRECISION, or 0 for the shortest text that reads back to the same double.</param>
+void setDefaultCsvPrecision(int precision);
+
+/// <summary>
+/// Gets the precision new CsvWriter instances start with.
+/// </summary>
+int defaultCsvPrecision();
+
+/// <summary>
+/// Formats a double the way std::ostream does with the given precision (printf "%.*g" in the C
+/// locale), or as the shortest round-trip text when precision is 0.
+/// </summary>
+/// <param name="first">Start of the output range.</param>
+/// <param name="last">End of the output range; 32 characters are always enough.</param>
+/// <param name="value">Value to format.</param>
+/// <param name="precision">Significant digits, or 0 for the shortest round-trip text.</param>
+/// <returns>One past the last character written.</returns>
+char* formatCsvDouble(char* first, char* last, double value, int precision);
+
+/// <summary>
+/// Appends a double to a text buffer, formatted by formatCsvDouble.
+/// </summary>
+/// <param name="out">Buffer to append to.</param>
+/// <param name="value">Value to format.</param>
+/// <param name="precision">Significant digits, or 0 for the shortest round-trip text.</param>
+void appendCsvDouble(std::string& out, double value, int precision = CSV_DEFAULT_PRECISION);
+
+/// <summary>
+/// Appends an integer to a text buffer.
+/// </summary>
+/// <param name="out">Buffer to append to.</param>
+/// <param name="value">Value to format.</param>
+template <std::integral T>
+void appendCsvInteger(std::string& out, T value)
+{
+	char buf[24];
+	auto result = std::to_chars(buf, buf + sizeof(buf), value);
+	out.append(buf, result.ptr);
+}
+
+/// <summary>
+/// Buffered text writer for the CSV savers. Values are formatted with std::to_chars into large
+/// aligned buffers, and full buffers are written to the file by a background thread while the
+/// caller keeps formatting. With the default precision the output is byte-for-byte what the same
+/// sequence of std::ofstream insertions writes, so the savers can switch without changing files.
+/// </summary>
+class CsvWriter
+{
+public:
+	/// <summary>
+	/// Opens the file (in text mode, like std::ofstream) and starts the writer thread.
+	/// </summary>
+	/// <param name="filename">Path of the output file.</param>
+	/// <param name="precision">Significant digits of doubles, or 0 for the shortest round-trip text.</param>
+	explicit CsvWriter(const std::string& filename, int precision = defaultCsvPrecision());
+
+	/// <summary>
+	/// Flushes the remaining text and closes the file.
+	/// </summary>
+	~CsvWriter();
+
+	CsvWriter(const CsvWriter&) = delete;
+	CsvWriter& operator=(const CsvWriter&) = delete;
+
+	bool is_open() const { return file.is_open(); }
+
+	/// <summary>
+	/// Writes everything formatted so far, waits for the writer thread and closes the file.
+	/// </summary>
+	/// <returns>True when the file opened and every write succeeded.</returns>
+	bool close();
+
+	void setPrecision(int digits) { precision = digits; }
+
+	CsvWriter& operator<<(std::string_view text);
+	CsvWriter& operator<<(const char* text) { return *this << std::string_view(text); }
+	CsvWriter& operator<<(const std::string& text) { return *this << std::string_view(text); }
+	CsvWriter& operator<<(char c);
+	CsvWriter& operator<<(double value);
+
+	template <std::integral T>
+	CsvWriter& operator<<(T value)
+	{
+		reserve(24);
+		auto result = std::to_chars(current + used, current + BUFFER_SIZE, value);
+		used = result.ptr - current;
+		return *this;
+	}
+
+private:
+	static const size_t BUFFER_SIZE = size_t{ 1 } << 20;
+	static const size_t BUFFER_COUNT = 4;
+	static const size_t BUFFER_ALIGNMENT = 4096;
+
+	// Makes room for at least count more characters, handing the current buffer to the writer when needed
+	void reserve(size_t count)
+	{
+		if (used + count > BUFFER_SIZE)
+		{
+			submit();
+		}
+	}
+
+	void submit();
+	void writerLoop();
+
+	std::ofstream file;
+	int precision;
+	char* current = nullptr; // Buffer being filled by the caller (a scratch buffer when the file is not open)
+	size_t used = 0;         // Characters in the current buffer
+
+	std::vector<char*> buffers;                          // Every buffer owned by the writer
+	std::vector<char*> freeBuffers;                      // Buffers ready to be filled
+	std::vector<std::pair<char*, size_t>> fullBuffers;   // Buffers waiting to be written, in order
+	bool closing = false;
+	bool failed = false;                                 // The file did not open or a write failed
+	std::mutex mtx;
+	std::condition_variable changed;
+	std::thread writer;
+};
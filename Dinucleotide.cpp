@@ -0,0 +1,231 @@
+#include "Dinucleotide.h"
+#include "CsvWriter.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+
+// Base code of every character
+static const std::array<uint8_t, 256> BASE_CODE = []
+	{
+		std::array<uint8_t, 256> table;
+		table.fill(DINUCLEOTIDE_UNKNOWN_BASE);
+		table['A'] = 0;
+		table['C'] = 1;
+		table['G'] = 2;
+		table['T'] = 3;
+		return table;
+	}();
+
+// Pair slot of every two consecutive characters, indexed by (first << 8) | second
+static const std::array<uint8_t, 65536> PAIR_CODE = []
+	{
+		std::array<uint8_t, 65536> table;
+		for (int first = 0; first < 256; ++first)
+		{
+			for (int second = 0; second < 256; ++second)
+			{
+				uint8_t x = BASE_CODE[first];
+				uint8_t y = BASE_CODE[second];
+				table[(first << 8) | second] = (x == DINUCLEOTIDE_UNKNOWN_BASE || y == DINUCLEOTIDE_UNKNOWN_BASE)
+					? DINUCLEOTIDE_UNKNOWN_PAIR
+					: static_cast<uint8_t>(x * 4 + y);
+			}
+		}
+		return table;
+	}();
+
+// Adds (delta = 1) or removes (delta = -1 as unsigned) bases and pairs; the counters wrap back exactly
+static void updateCounts(DinucleotideCounts& counts, std::string_view sequence, uint64_t delta,
+	uint64_t baseStart, uint64_t baseEnd, uint64_t pairStart, uint64_t pairEnd)
+{
+	const unsigned char* s = reinterpret_cast<const unsigned char*>(sequence.data());
+	for (uint64_t i = baseStart; i < baseEnd; ++i)
+	{
+		counts.bases[BASE_CODE[s[i]]] += delta;
+	}
+	for (uint64_t i = pairStart; i < pairEnd; ++i)
+	{
+		counts.pairs[PAIR_CODE[(s[i] << 8) | s[i + 1]]] += delta;
+	}
+}
+
+uint64_t DinucleotideCounts::validPairs() const
+{
+	uint64_t total = 0;
+	for (int pair = 0; pair < 16; ++pair)
+	{
+		total += pairs[pair];
+	}
+	return total;
+}
+
+double DinucleotideCounts::cpgObservedExpected() const
+{
+	double expected = static_cast<double>(bases[1]) * static_cast<double>(bases[2]);
+	return expected > 0 ? cpg() * static_cast<double>(validBases()) / expected : 0.0;
+}
+
+double DinucleotideCounts::gcSkew() const
+{
+	uint64_t g = bases[2];
+	uint64_t c = bases[1];
+	return (g + c) > 0 ? (static_cast<double>(g) - static_cast<double>(c)) / (g + c) : 0.0;
+}
+
+double DinucleotideCounts::relativeAbundance(int pair) const
+{
+	// f(XY) / (f(X) f(Y)) = count(XY) * N^2 / (pairs * count(X) * count(Y))
+	double n = static_cast<double>(validBases());
+	double expected = static_cast<double>(validPairs()) * bases[pair / 4] * bases[pair % 4];
+	return expected > 0 ? pairs[pair] * n * n / expected : 0.0;
+}
+
+void DinucleotideCounts::add(std::string_view sequence, uint64_t baseStart, uint64_t baseEnd, uint64_t pairStart, uint64_t pairEnd)
+{
+	updateCounts(*this, sequence, 1, baseStart, baseEnd, pairStart, pairEnd);
+}
+
+void DinucleotideCounts::remove(std::string_view sequence, uint64_t baseStart, uint64_t baseEnd, uint64_t pairStart, uint64_t pairEnd)
+{
+	updateCounts(*this, sequence, ~uint64_t{ 0 }, baseStart, baseEnd, pairStart, pairEnd);
+}
+
+/// <summary>
+/// Name of a dinucleotide index, e.g. "CG" for 4 * 1 + 2.
+/// </summary>
+std::string dinucleotideName(int pair)
+{
+	const char bases[] = "ACGT";
+	return { bases[pair / 4], bases[pair % 4] };
+}
+
+/// <summary>
+/// Counts the bases and the pairs lying completely inside [start, end).
+/// </summary>
+/// <param name="sequence">The DNA sequence.</param>
+/// <param name="start">First position (inclusive).</param>
+/// <param name="end">Last position (exclusive).</param>
+/// <returns>The counts of the range.</returns>
+DinucleotideCounts countDinucleotides(std::string_view sequence, uint64_t start, uint64_t end)
+{
+	DinucleotideCounts counts;
+	if (end > start)
+	{
+		counts.add(sequence, start, end, start, end - 1);
+	}
+	return counts;
+}
+
+// A run of consecutive windows inside one contig, counted by one task
+struct DinucleotideChunk
+{
+	uint64_t firstWindow; // Start of the first window of the chunk
+	uint64_t windowCount; // Number of windows in the chunk
+};
+
+/// <summary>
+/// Slides a window over the contigs, keeping all 16 dinucleotide counts up to date incrementally,
+/// and writes one CSV row per window with the CpG observed/expected ratio, the GC skew and the
+/// relative abundance of every dinucleotide. Chunks of windows are counted in parallel and
+/// written in sequence order.
+/// </summary>
+/// <param name="sequence">The DNA sequence.</param>
+/// <param name="contigs">Ranges to scan, in sequence order; windows never cross a range end.</param>
+/// <param name="windowSize">Size of the sliding window.</param>
+/// <param name="stepSize">Step size to slide the window.</param>
+/// <param name="filename">Path to the output CSV file.</param>
+/// <returns>Number of windows written.</returns>
+uint64_t scanDinucleotides(std::string_view sequence, const std::vector<SequenceInterval>& contigs,
+	uint64_t windowSize, uint64_t stepSize, const std::string& filename)
+{
+	CsvWriter outfile(filename);
+	if (!outfile.is_open())
+	{
+		std::cerr << "Error: Could not open the file " << filename << std::endl;
+		return 0;
+	}
+
+	outfile << "Start,End,Valid_Bases,CpG_Count,CpG_OE,GC_Skew";
+	for (int pair = 0; pair < 16; ++pair)
+	{
+		outfile << ",Rho_" << dinucleotideName(pair);
+	}
+	outfile << "\n";
+
+	if (windowSize < 2 || stepSize == 0)
+	{
+		std::cerr << "Error: Dinucleotide windows need at least 2 bases and a positive step" << std::endl;
+		return 0;
+	}
+
+	// Same chunking as the GC window scan: recounting the first window of a chunk stays negligible
+	const uint64_t chunkBases = std::max<uint64_t>(uint64_t{ 1 } << 22, 8 * windowSize);
+	const uint64_t windowsPerChunk = std::max<uint64_t>(1, chunkBases / stepSize);
+
+	std::vector<DinucleotideChunk> chunks;
+	uint64_t totalWindows = 0;
+	for (const auto& contig : contigs)
+	{
+		if (contig.end - contig.start < windowSize)
+		{
+			continue;
+		}
+
+		uint64_t windowCount = (contig.end - contig.start - windowSize) / stepSize + 1;
+		totalWindows += windowCount;
+		for (uint64_t first = 0; first < windowCount; first += windowsPerChunk)
+		{
+			chunks.push_back({ contig.start + first * stepSize, std::min(windowsPerChunk, windowCount - first) });
+		}
+	}
+
+	const int precision = defaultCsvPrecision();
+	ParallelOrderedWrite(chunks.size(), [&](size_t i, std::string& out)
+		{
+			const DinucleotideChunk& chunk = chunks[i];
+			DinucleotideCounts counts = countDinucleotides(sequence, chunk.firstWindow, chunk.firstWindow + windowSize);
+
+			out.reserve(chunk.windowCount * 160);
+			uint64_t pos = chunk.firstWindow;
+			for (uint64_t w = 0; w < chunk.windowCount; ++w, pos += stepSize)
+			{
+				if (w != 0 && stepSize < windowSize)
+				{
+					// Bases [pos - step, pos) and the pairs starting there leave, the same number enter on the right
+					counts.remove(sequence, pos - stepSize, pos, pos - stepSize, pos);
+					counts.add(sequence, pos + windowSize - stepSize, pos + windowSize,
+						pos + windowSize - stepSize - 1, pos + windowSize - 1);
+				}
+				else if (w != 0)
+				{
+					counts = countDinucleotides(sequence, pos, pos + windowSize);
+				}
+
+				appendCsvInteger(out, pos);
+				out += ',';
+				appendCsvInteger(out, pos + windowSize);
+				out += ',';
+				appendCsvInteger(out, counts.validBases());
+				out += ',';
+				appendCsvInteger(out, counts.cpg());
+				out += ',';
+				appendCsvDouble(out, counts.cpgObservedExpected(), precision);
+				out += ',';
+				appendCsvDouble(out, counts.gcSkew(), precision);
+				for (int pair = 0; pair < 16; ++pair)
+				{
+					out += ',';
+					appendCsvDouble(out, counts.relativeAbundance(pair), precision);
+				}
+				out += '\n';
+			}
+		}, [&](size_t, const std::string& buffer)
+		{
+			outfile << buffer;
+		});
+
+	outfile.close();
+	return totalWindows;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "File_DNA.h"
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+// Code of a base in the composition tables: A, C, G, T, and 4 for every other character
+const int DINUCLEOTIDE_UNKNOWN_BASE = 4;
+// Index of the slot counting pairs with an unknown base
+const int DINUCLEOTIDE_UNKNOWN_PAIR = 16;
+// Indexes of the two GC dinucleotides
+const int DINUCLEOTIDE_CG = 1 * 4 + 2;
+const int DINUCLEOTIDE_GC = 2 * 4 + 1;
+
+/// <summary>
+/// Base and dinucleotide counts of a window. Pair XY is counted at index 4 * code(X) + code(Y)
+/// with A, C, G, T = 0..3. Every base and pair is counted through a table lookup into a slot,
+/// unknown ones included, so the counting loops have no branches.
+/// Like isUnknownBase, only uppercase A, C, G and T are known bases.
+/// </summary>
+struct DinucleotideCounts
+{
+	uint64_t bases[5] = {};  // A, C, G, T, unknown
+	uint64_t pairs[17] = {}; // 16 dinucleotides, then pairs with an unknown base
+
+	uint64_t validBases() const { return bases[0] + bases[1] + bases[2] + bases[3]; }
+	uint64_t validPairs() const;
+	uint64_t cpg() const { return pairs[DINUCLEOTIDE_CG]; }
+
+	/// <summary>
+	/// CpG observed/expected ratio CG * N / (C * G) over the N valid bases, 0 without C or G.
+	/// </summary>
+	double cpgObservedExpected() const;
+
+	/// <summary>
+	/// GC skew (G - C) / (G + C), 0 when the window has no G or C.
+	/// </summary>
+	double gcSkew() const;
+
+	/// <summary>
+	/// Relative abundance f(XY) / (f(X) f(Y)) of a dinucleotide, 0 when a frequency is 0.
+	/// </summary>
+	/// <param name="pair">Dinucleotide index 4 * code(X) + code(Y).</param>
+	double relativeAbundance(int pair) const;
+
+	/// <summary>
+	/// Adds the bases of [baseStart, baseEnd) and the pairs starting at positions [pairStart, pairEnd).
+	/// The caller makes sure the pair starting at pairEnd - 1 lies inside the sequence.
+	/// </summary>
+	void add(std::string_view sequence, uint64_t baseStart, uint64_t baseEnd, uint64_t pairStart, uint64_t pairEnd);
+
+	/// <summary>
+	/// Removes bases and pairs previously added with add.
+	/// </summary>
+	void remove(std::string_view sequence, uint64_t baseStart, uint64_t baseEnd, uint64_t pairStart, uint64_t pairEnd);
+};
+
+/// <summary>
+/// Name of a dinucleotide index, e.g. "CG" for 4 * 1 + 2.
+/// </summary>
+std::string dinucleotideName(int pair);
+
+/// <summary>
+/// Counts the bases and the pairs lying completely inside [start, end).
+/// </summary>
+/// <param name="sequence">The DNA sequence.</param>
+/// <param name="start">First position (inclusive).</param>
+/// <param name="end">Last position (exclusive).</param>
+/// <returns>The counts of the range.</returns>
+DinucleotideCounts countDinucleotides(std::string_view sequence, uint64_t start, uint64_t end);
+
+/// <summary>
+/// Slides a window over the contigs, keeping all 16 dinucleotide counts up to date incrementally,
+/// and writes one CSV row per window with the CpG observed/expected ratio, the GC skew and the
+/// relative abundance of every dinucleotide. Chunks of windows are counted in parallel and
+/// written in sequence order.
+/// </summary>
+/// <param name="sequence">The DNA sequence.</param>
+/// <param name="contigs">Ranges to scan, in sequence order; windows never cross a range end.</param>
+/// <param name="windowSize">Size of the sliding window.</param>
+/// <param name="stepSize">Step size to slide the window.</param>
+/// <param name="filename">Path to the output CSV file.</param>
+/// <returns>Number of windows written.</returns>
+uint64_t scanDinucleotides(std::string_view sequence, const std::vector<SequenceInterval>& contigs,
+	uint64_t windowSize, uint64_t stepSize, const std::string& filename);
@@ -1,13 +1,18 @@
 #include "File_DNA.h"
+#include "CsvWriter.h"
+#include "Trace.h"
 
+#include <filesystem>
+#include <system_error>
 #include <vector>
 
 /// <summary>
 /// Loads a DNA sequence from a GenBank file.
 /// </summary>
 /// <param name="filePath">Path to the GenBank file.</param>
+/// <param name="softMask">Optional; receives one bit per base marking lowercase (soft-masked) bases.</param>
 /// <returns>The extracted DNA sequence as a string.</returns>
-string load_gen_bank_file(const string& filePath)
+string load_gen_bank_file(const string& filePath, SoftMask* softMask)
 {
 	ifstream file(filePath);
 	if (!file.is_open())
@@ -38,6 +43,10 @@ string load_gen_bank_file(const string& filePath)
 				{
 					if (isalpha(c))
 					{
+						if (softMask != nullptr)
+						{
+							softMask->push_back(islower(static_cast<unsigned char>(c)) != 0);
+						}
 						sequence += static_cast<char>(toupper(c));
 					}
 				}
@@ -49,6 +58,23 @@ string load_gen_bank_file(const string& filePath)
 	return sequence;
 }
 
+/// <summary>
+/// Extends the last run of N or starts a new one at the given position.
+/// </summary>
+/// <param name="nRuns">Runs of N collected so far.</param>
+/// <param name="position">Position of the N in the sequence.</param>
+static void record_n_base(std::vector<SequenceInterval>& nRuns, uint64_t position)
+{
+	if (!nRuns.empty() && nRuns.back().end == position)
+	{
+		nRuns.back().end++;
+	}
+	else
+	{
+		nRuns.push_back({ position, position + 1 });
+	}
+}
+
 /// <summary>
 /// Loads a DNA sequence from a FASTA file.
 /// </summary>
@@ -56,6 +82,21 @@ string load_gen_bank_file(const string& filePath)
 /// <returns>The extracted DNA sequence as a string.</returns>
 std::string load_fasta_file(const std::string& filename)
 {
+	std::vector<SequenceInterval> nRuns;
+	return load_fasta_file(filename, nRuns);
+}
+
+/// <summary>
+/// Loads a DNA sequence from a FASTA file and records every run of N while parsing.
+/// </summary>
+/// <param name="filename">Path to the FASTA file.</param>
+/// <param name="nRuns">Receives the runs of N (assembly gaps) in sequence order.</param>
+/// <param name="softMask">Optional; receives one bit per base marking lowercase (soft-masked) bases.</param>
+/// <returns>The extracted DNA sequence as a string.</returns>
+std::string load_fasta_file(const std::string& filename, std::vector<SequenceInterval>& nRuns, SoftMask* softMask)
+{
+	TRACE_SCOPE("load FASTA");
+	nRuns.clear();
 	std::ifstream fasta_file(filename);
 	std::string sequence;
 
@@ -79,6 +120,14 @@ std::string load_fasta_file(const std::string& filename)
 			//{
 				if (isalpha(c))
 				{
+					if (c == 'N' || c == 'n')
+					{
+						record_n_base(nRuns, sequence.size());
+					}
+					if (softMask != nullptr)
+					{
+						softMask->push_back(islower(static_cast<unsigned char>(c)) != 0);
+					}
 					sequence += static_cast<char>(toupper(c));
 				}
 			//}
@@ -290,6 +339,21 @@ std::string read_chromosome(const std::string& filename, const std::string& chro
 /// <returns>DNA sequence as a string.</returns>
 std::string read_chromosome_file(const std::string& filename)
 {
+	std::vector<SequenceInterval> nRuns;
+	return read_chromosome_file(filename, nRuns);
+}
+
+/// <summary>
+/// Reads a chromosome from a file and records every run of N while parsing.
+/// </summary>
+/// <param name="filename">Path to the file.</param>
+/// <param name="nRuns">Receives the runs of N (assembly gaps) in sequence order.</param>
+/// <param name="softMask">Optional; receives one bit per base marking lowercase bases. The sequence is uppercased either way.</param>
+/// <returns>DNA sequence as a string.</returns>
+std::string read_chromosome_file(const std::string& filename, std::vector<SequenceInterval>& nRuns, SoftMask* softMask)
+{
+	TRACE_SCOPE("load chromosome");
+	nRuns.clear();
 	std::ifstream file(filename);
 	if (!file) 
 	{
@@ -307,6 +371,19 @@ std::string read_chromosome_file(const std::string& filename)
 			first_line = false;  // Skip the header line
 			continue;
 		}
+		for (size_t i = 0; i < line.size(); ++i)
+		{
+			if (line[i] == 'N' || line[i] == 'n')
+			{
+				record_n_base(nRuns, sequence.size() + i);
+			}
+			// Keep the soft-masking in the mask, if asked, and hand uppercase bases to the analysis like load_fasta_file
+			if (softMask != nullptr)
+			{
+				softMask->push_back(islower(static_cast<unsigned char>(line[i])) != 0);
+			}
+			line[i] = static_cast<char>(toupper(static_cast<unsigned char>(line[i])));
+		}
 		sequence += line;  // Append sequence
 	}
 
@@ -314,3 +391,96 @@ std::string read_chromosome_file(const std::string& filename)
 
 	return sequence;
 }
+
+/// <summary>
+/// Splits a sequence into the contigs that lie between assembly gaps.
+/// </summary>
+/// <param name="nRuns">Runs of N in sequence order.</param>
+/// <param name="sequenceLength">Length of the whole sequence.</param>
+/// <param name="minGapLength">Shorter runs of N are kept inside their contig.</param>
+/// <returns>The contigs in sequence order.</returns>
+std::vector<SequenceInterval> find_acgt_contigs(const std::vector<SequenceInterval>& nRuns, uint64_t sequenceLength, uint64_t minGapLength)
+{
+	std::vector<SequenceInterval> contigs;
+	uint64_t contigStart = 0;
+
+	for (const auto& gap : find_assembly_gaps(nRuns, minGapLength))
+	{
+		if (gap.start > contigStart)
+		{
+			contigs.push_back({ contigStart, gap.start });
+		}
+		contigStart = gap.end;
+	}
+
+	if (contigStart < sequenceLength)
+	{
+		contigs.push_back({ contigStart, sequenceLength });
+	}
+
+	return contigs;
+}
+
+/// <summary>
+/// Keeps only the runs of N that are long enough to count as assembly gaps.
+/// </summary>
+/// <param name="nRuns">Runs of N in sequence order.</param>
+/// <param name="minGapLength">Minimum length of a gap.</param>
+/// <returns>The gaps in sequence order.</returns>
+std::vector<SequenceInterval> find_assembly_gaps(const std::vector<SequenceInterval>& nRuns, uint64_t minGapLength)
+{
+	std::vector<SequenceInterval> gaps;
+	for (const auto& run : nRuns)
+	{
+		if (run.end - run.start >= minGapLength)
+		{
+			gaps.push_back(run);
+		}
+	}
+	return gaps;
+}
+
+/// <summary>
+/// Saves assembly gaps to a CSV file.
+/// </summary>
+/// <param name="filename">Path to the output file.</param>
+/// <param name="gaps">Gap intervals.</param>
+void save_gaps_to_csv(const std::string& filename, const std::vector<SequenceInterval>& gaps)
+{
+	TRACE_SCOPE("save gaps");
+	CsvWriter csvFile(filename);
+	if (!csvFile.is_open())
+	{
+		std::cerr << "Error: Could not open the file " << filename << std::endl;
+		return;
+	}
+
+	csvFile << "Start,End,Length\n";
+	for (const auto& gap : gaps)
+	{
+		csvFile << gap.start << "," << gap.end << "," << (gap.end - gap.start) << "\n";
+	}
+
+	csvFile.close();
+	std::cout << "Gaps saved to " << filename << std::endl;
+}
+
+/// <summary>
+/// Reads the size and last write time of a file; files derived from it store them to notice
+/// when it was replaced or edited.
+/// </summary>
+/// <param name="path">Path of the file.</param>
+/// <param name="size">Receives the size in bytes.</param>
+/// <param name="time">Receives the last write time.</param>
+/// <returns>False when the file cannot be read.</returns>
+bool readSourceIdentity(const std::string& path, uint64_t& size, int64_t& time)
+{
+	std::error_code error;
+	size = std::filesystem::file_size(path, error);
+	if (error)
+	{
+		return false;
+	}
+	time = static_cast<int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+	return !error;
+}
@@ -4,6 +4,9 @@
 #include <string>
 #include <thread>
 #include <mutex>
+#include <vector>
+#include <cstdint>
+#include "SoftMask.h"
 
 using namespace std;
 
@@ -12,12 +15,23 @@ using namespace std;
 #pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
 #endif
 
+// Half-open interval [start, end) of positions in a loaded sequence
+struct SequenceInterval
+{
+	uint64_t start;
+	uint64_t end;
+};
+
+// Shortest run of N that is treated as an assembly gap by default
+const uint64_t DEFAULT_MIN_GAP_LENGTH = 10;
+
 /// <summary>
 /// Loads a DNA sequence from a GenBank file.
 /// </summary>
 /// <param name="filePath">Path to the GenBank file.</param>
+/// <param name="softMask">Optional; receives one bit per base marking lowercase (soft-masked) bases.</param>
 /// <returns>The extracted DNA sequence as a string.</returns>
-string load_gen_bank_file(const string& filePath);
+string load_gen_bank_file(const string& filePath, SoftMask* softMask = nullptr);
 
 /// <summary>
 /// Loads a DNA sequence from a FASTA file.
@@ -26,6 +40,15 @@ string load_gen_bank_file(const string& filePath);
 /// <returns>The extracted DNA sequence as a string.</returns>
 std::string load_fasta_file(const std::string& filename);
 
+/// <summary>
+/// Loads a DNA sequence from a FASTA file and records every run of N while parsing.
+/// </summary>
+/// <param name="filename">Path to the FASTA file.</param>
+/// <param name="nRuns">Receives the runs of N (assembly gaps) in sequence order.</param>
+/// <param name="softMask">Optional; receives one bit per base marking lowercase (soft-masked) bases.</param>
+/// <returns>The extracted DNA sequence as a string.</returns>
+std::string load_fasta_file(const std::string& filename, std::vector<SequenceInterval>& nRuns, SoftMask* softMask = nullptr);
+
 /// <summary>
 /// Saves DNA sequence data to a file.
 /// </summary>
@@ -68,5 +91,48 @@ std::string read_chromosome(const std::string& filename, const std::string& chro
 /// <returns>DNA sequence as a string.</returns>
 std::string read_chromosome_file(const std::string& filename);
 
+/// <summary>
+/// Reads a chromosome from a file and records every run of N while parsing.
+/// </summary>
+/// <param name="filename">Path to the file.</param>
+/// <param name="nRuns">Receives the runs of N (assembly gaps) in sequence order.</param>
+/// <param name="softMask">Optional; receives one bit per base marking lowercase bases. The sequence is uppercased either way.</param>
+/// <returns>DNA sequence as a string.</returns>
+std::string read_chromosome_file(const std::string& filename, std::vector<SequenceInterval>& nRuns, SoftMask* softMask = nullptr);
+
+/// <summary>
+/// Splits a sequence into the contigs that lie between assembly gaps.
+/// </summary>
+/// <param name="nRuns">Runs of N in sequence order.</param>
+/// <param name="sequenceLength">Length of the whole sequence.</param>
+/// <param name="minGapLength">Shorter runs of N are kept inside their contig.</param>
+/// <returns>The contigs in sequence order.</returns>
+std::vector<SequenceInterval> find_acgt_contigs(const std::vector<SequenceInterval>& nRuns, uint64_t sequenceLength, uint64_t minGapLength);
+
+/// <summary>
+/// Keeps only the runs of N that are long enough to count as assembly gaps.
+/// </summary>
+/// <param name="nRuns">Runs of N in sequence order.</param>
+/// <param name="minGapLength">Minimum length of a gap.</param>
+/// <returns>The gaps in sequence order.</returns>
+std::vector<SequenceInterval> find_assembly_gaps(const std::vector<SequenceInterval>& nRuns, uint64_t minGapLength);
+
+/// <summary>
+/// Saves assembly gaps to a CSV file.
+/// </summary>
+/// <param name="filename">Path to the output file.</param>
+/// <param name="gaps">Gap intervals.</param>
+void save_gaps_to_csv(const std::string& filename, const std::vector<SequenceInterval>& gaps);
+
+/// <summary>
+/// Reads the size and last write time of a file; files derived from it store them to notice
+/// when it was replaced or edited.
+/// </summary>
+/// <param name="path">Path of the file.</param>
+/// <param name="size">Receives the size in bytes.</param>
+/// <param name="time">Receives the last write time.</param>
+/// <returns>False when the file cannot be read.</returns>
+bool readSourceIdentity(const std::string& path, uint64_t& size, int64_t& time);
+
 
 
@@ -0,0 +1,262 @@
+#include "GcPyramid.h"
+#include "BitPlane.h"
+#include "GcRankIndex.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+// Identifies the file format; bump the digit when the layout changes
+static const char GcPyramidMagic[8] = { 'G', 'C', 'P', 'Y', 'R', '1', '\0', '\0' };
+
+/// <summary>
+/// Computes every zoom level of the GC track in one pass over the sequence and writes them to a
+/// compact binary file: a header, a directory with the offset of each level, then fixed-size bins.
+/// The finest bins are computed in parallel; every coarser level is folded from the one below.
+/// The pipeline fills a GcPyramidBuilder from its GC window scan instead.
+/// </summary>
+/// <param name="sequence">The DNA sequence.</param>
+/// <param name="binSizes">Bases per bin of each level, finest first; each must be a multiple of the previous one.</param>
+/// <param name="filename">Path of the pyramid file.</param>
+/// <returns>True when the file was written.</returns>
+bool writeGcPyramid(std::string_view sequence, const std::vector<uint64_t>& binSizes, const std::string& filename)
+{
+	try
+	{
+		GcPyramidBuilder pyramid(sequence.size(), binSizes);
+
+		// A side output, so it yields to the main stages
+		ParallelFor(pyramid.finestBinCount(), [&](size_t bin)
+			{
+				pyramid.countFinestBins(bin, bin + 1, sequence);
+			}, TaskPriority::Low);
+		return pyramid.write(filename);
+	}
+	catch (const std::invalid_argument& e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
+		return false;
+	}
+}
+
+GcPyramidBuilder::GcPyramidBuilder(uint64_t sequenceLength, const std::vector<uint64_t>& binSizes)
+	: length(sequenceLength), binSizes(binSizes)
+{
+	if (binSizes.empty())
+	{
+		throw std::invalid_argument("GC pyramid needs at least one level.");
+	}
+	for (size_t level = 0; level < binSizes.size(); ++level)
+	{
+		if (binSizes[level] == 0 || (level > 0 && binSizes[level] % binSizes[level - 1] != 0))
+		{
+			throw std::invalid_argument("GC pyramid bin sizes must each be a multiple of the previous one.");
+		}
+	}
+	finest.resize((length + binSizes[0] - 1) / binSizes[0]);
+}
+
+/// <summary>
+/// Counts the finest bins [firstBin, lastBin) tile by tile, from the rank index when given,
+/// else from the bitplanes when given, else from the sequence.
+/// </summary>
+void GcPyramidBuilder::countFinestBins(size_t firstBin, size_t lastBin, std::string_view sequence, const BitPlaneSequence* planes, const GcRankIndex* index)
+{
+	uint64_t binSize = binSizes[0];
+	for (size_t bin = firstBin; bin < std::min(lastBin, finest.size()); ++bin)
+	{
+		GcPyramidAccumulator& total = finest[bin];
+		total = GcPyramidAccumulator();
+		uint64_t binEnd = std::min<uint64_t>(length, (bin + 1) * binSize);
+		for (uint64_t tile = bin * binSize; tile < binEnd; tile += GC_PYRAMID_TILE_SIZE)
+		{
+			uint64_t tileEnd = std::min<uint64_t>(binEnd, tile + GC_PYRAMID_TILE_SIZE);
+			uint64_t gc = 0, valid = 0;
+			if (index)
+			{
+				gc = index->gc(tile, tileEnd);
+				valid = index->valid(tile, tileEnd);
+			}
+			else if (planes)
+			{
+				BaseComposition counts = planes->count(tile, tileEnd);
+				gc = counts.gc();
+				valid = (tileEnd - tile) - counts.unknown;
+			}
+			else
+			{
+				for (uint64_t i = tile; i < tileEnd; ++i)
+				{
+					char base = sequence[i];
+					gc += (base == 'G' || base == 'C');
+					valid += (base == 'A' || base == 'C' || base == 'G' || base == 'T');
+				}
+			}
+			if (valid > 0)
+			{
+				float value = static_cast<float>(gc * 100.0 / valid);
+				total.addRange(value, value);
+			}
+			total.gc += gc;
+			total.valid += valid;
+		}
+	}
+}
+
+/// <summary>
+/// Folds the coarser levels from the finest one and writes the pyramid file: a header, a
+/// directory with the offset of each level, then fixed-size bins.
+/// </summary>
+/// <param name="filename">Path of the pyramid file.</param>
+/// <returns>True when the file was written.</returns>
+bool GcPyramidBuilder::write(const std::string& filename) const
+{
+	std::vector<std::vector<GcPyramidAccumulator>> levels(binSizes.size());
+	levels[0] = finest;
+
+	// Coarser levels fold the bins of the level below
+	for (size_t level = 1; level < binSizes.size(); ++level)
+	{
+		uint64_t factor = binSizes[level] / binSizes[level - 1];
+		const auto& children = levels[level - 1];
+		levels[level].resize((children.size() + factor - 1) / factor);
+		for (size_t child = 0; child < children.size(); ++child)
+		{
+			GcPyramidAccumulator& total = levels[level][child / factor];
+			if (children[child].any)
+			{
+				GcPyramidBin summary = children[child].bin();
+				total.addRange(summary.min, summary.max);
+			}
+			total.gc += children[child].gc;
+			total.valid += children[child].valid;
+		}
+	}
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Error: Unable to create file " << filename << std::endl;
+		return false;
+	}
+
+	uint64_t levelCount = binSizes.size();
+	file.write(GcPyramidMagic, sizeof(GcPyramidMagic));
+	file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+	file.write(reinterpret_cast<const char*>(&levelCount), sizeof(levelCount));
+
+	uint64_t offset = sizeof(GcPyramidMagic) + 2 * sizeof(uint64_t) + levelCount * sizeof(GcPyramidLevel);
+	for (size_t level = 0; level < levelCount; ++level)
+	{
+		GcPyramidLevel entry{ binSizes[level], levels[level].size(), offset };
+		file.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+		offset += entry.binCount * sizeof(GcPyramidBin);
+	}
+
+	for (const auto& level : levels)
+	{
+		std::vector<GcPyramidBin> bins;
+		bins.reserve(level.size());
+		for (const auto& total : level)
+		{
+			bins.push_back(total.bin());
+		}
+		file.write(reinterpret_cast<const char*>(bins.data()), bins.size() * sizeof(GcPyramidBin));
+	}
+	return static_cast<bool>(file);
+}
+
+/// <summary>
+/// Opens a pyramid file and reads its header and level directory.
+/// </summary>
+/// <param name="filename">Path of the pyramid file.</param>
+/// <param name="pyramid">Receives the header and directory.</param>
+/// <returns>True when the file is a valid pyramid.</returns>
+bool openGcPyramid(const std::string& filename, GcPyramidFile& pyramid)
+{
+	std::ifstream file(filename, std::ios::binary);
+	char magic[sizeof(GcPyramidMagic)];
+	if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, GcPyramidMagic, sizeof(magic)) != 0)
+	{
+		std::cerr << "Error: " << filename << " is not a GC pyramid file" << std::endl;
+		return false;
+	}
+
+	GcPyramidFile opened;
+	opened.filename = filename;
+	uint64_t levelCount = 0;
+	file.read(reinterpret_cast<char*>(&opened.sequenceLength), sizeof(opened.sequenceLength));
+	file.read(reinterpret_cast<char*>(&levelCount), sizeof(levelCount));
+	if (!file || levelCount > 64)
+	{
+		return false;
+	}
+
+	opened.levels.resize(levelCount);
+	file.read(reinterpret_cast<char*>(opened.levels.data()), levelCount * sizeof(GcPyramidLevel));
+	if (!file)
+	{
+		return false;
+	}
+
+	pyramid = std::move(opened);
+	return true;
+}
+
+/// <summary>
+/// Picks the coarsest level whose bins are not wider than the requested resolution.
+/// </summary>
+/// <param name="pyramid">The opened pyramid.</param>
+/// <param name="basesPerPixel">Bases covered by one pixel of the viewer.</param>
+/// <returns>Index of the level to read.</returns>
+size_t chooseGcPyramidLevel(const GcPyramidFile& pyramid, uint64_t basesPerPixel)
+{
+	size_t chosen = 0;
+	for (size_t level = 0; level < pyramid.levels.size(); ++level)
+	{
+		if (pyramid.levels[level].binSize <= basesPerPixel)
+		{
+			chosen = level;
+		}
+	}
+	return chosen;
+}
+
+/// <summary>
+/// Reads the bins of one level that overlap [start, end) with a single seek.
+/// </summary>
+/// <param name="pyramid">The opened pyramid.</param>
+/// <param name="level">Index of the level.</param>
+/// <param name="start">First position (inclusive).</param>
+/// <param name="end">Last position (exclusive).</param>
+/// <returns>The bins in sequence order; bin i starts at (first bin + i) * binSize.</returns>
+std::vector<GcPyramidBin> readGcPyramidRegion(const GcPyramidFile& pyramid, size_t level, uint64_t start, uint64_t end)
+{
+	std::vector<GcPyramidBin> bins;
+	if (level >= pyramid.levels.size() || start >= end)
+	{
+		return bins;
+	}
+
+	const GcPyramidLevel& entry = pyramid.levels[level];
+	uint64_t firstBin = start / entry.binSize;
+	uint64_t lastBin = std::min<uint64_t>(entry.binCount, (end + entry.binSize - 1) / entry.binSize);
+	if (firstBin >= lastBin)
+	{
+		return bins;
+	}
+
+	std::ifstream file(pyramid.filename, std::ios::binary);
+	file.seekg(entry.offset + firstBin * sizeof(GcPyramidBin));
+	bins.resize(lastBin - firstBin);
+	file.read(reinterpret_cast<char*>(bins.data()), bins.size() * sizeof(GcPyramidBin));
+	if (!file)
+	{
+		std::cerr << "Error: Unable to read " << pyramid.filename << std::endl;
+		bins.clear();
+	}
+	return bins;
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+struct BitPlaneSequence;
+struct GcRankIndex;
+
+// Default zoom levels of the GC pyramid, finest first
+const std::vector<uint64_t> DEFAULT_GC_PYRAMID_BIN_SIZES = { 1000, 10000, 100000, 1000000 };
+
+// Name of the pyramid file in the output folder
+const std::string GC_PYRAMID_FILE = "gc_pyramid.bin";
+
+// Resolution of the min/max of the finest level
+const uint64_t GC_PYRAMID_TILE_SIZE = 100;
+
+/// <summary>
+/// Summary of one bin of a zoom level. The mean is the GC percentage over the valid bases of the
+/// bin; min and max are the extreme GC percentages of the tiles below it (100-base tiles for the
+/// finest level, the bins of the previous level above that). Bins without valid bases are all zero.
+/// </summary>
+struct GcPyramidBin
+{
+	float mean;
+	float min;
+	float max;
+	uint32_t validBases;
+};
+
+/// <summary>
+/// Running totals of a bin while the levels are counted and folded.
+/// </summary>
+struct GcPyramidAccumulator
+{
+	uint64_t gc = 0;
+	uint64_t valid = 0;
+	float min = 0.0f;
+	float max = 0.0f;
+	bool any = false; // True once a tile or child bin with valid bases was added
+
+	void addRange(float minValue, float maxValue)
+	{
+		min = any ? std::min(min, minValue) : minValue;
+		max = any ? std::max(max, maxValue) : maxValue;
+		any = true;
+	}
+
+	GcPyramidBin bin() const
+	{
+		float mean = valid > 0 ? static_cast<float>(gc * 100.0 / valid) : 0.0f;
+		return { mean, any ? min : 0.0f, any ? max : 0.0f, static_cast<uint32_t>(valid) };
+	}
+};
+
+/// <summary>
+/// One zoom level as stored in the directory of a pyramid file.
+/// </summary>
+struct GcPyramidLevel
+{
+	uint64_t binSize;  // Bases per bin
+	uint64_t binCount; // Number of bins, the last one may be partial
+	uint64_t offset;   // File offset of the first bin
+};
+
+/// <summary>
+/// Header and level directory of an opened pyramid file. Regions are read with readGcPyramidRegion.
+/// </summary>
+struct GcPyramidFile
+{
+	std::string filename;
+	uint64_t sequenceLength = 0;
+	std::vector<GcPyramidLevel> levels;
+};
+
+/// <summary>
+/// GC pyramid being built. The finest bins are counted by their callers, every bin exactly once
+/// and from any thread, e.g. by the tasks of the sliding window GC scan for the stretch each task
+/// owns; write then folds the coarser levels and saves the file.
+/// </summary>
+class GcPyramidBuilder
+{
+public:
+	/// <param name="sequenceLength">Length of the sequence the pyramid covers.</param>
+	/// <param name="binSizes">Bases per bin of each level, finest first; each must be a multiple of the previous one.</param>
+	/// <exception cref="std::invalid_argument">The bin sizes are empty or not multiples of each other.</exception>
+	GcPyramidBuilder(uint64_t sequenceLength, const std::vector<uint64_t>& binSizes);
+
+	uint64_t finestBinSize() const { return binSizes.front(); }
+	size_t finestBinCount() const { return finest.size(); }
+
+	/// <summary>
+	/// Counts the finest bins [firstBin, lastBin) tile by tile, from the rank index when given,
+	/// else from the bitplanes when given, else from the sequence.
+	/// </summary>
+	void countFinestBins(size_t firstBin, size_t lastBin, std::string_view sequence, const BitPlaneSequence* planes = nullptr, const GcRankIndex* index = nullptr);
+
+	/// <summary>
+	/// Folds the coarser levels from the finest one and writes the pyramid file: a header, a
+	/// directory with the offset of each level, then fixed-size bins.
+	/// </summary>
+	/// <param name="filename">Path of the pyramid file.</param>
+	/// <returns>True when the file was written.</returns>
+	bool write(const std::string& filename) const;
+
+private:
+	uint64_t length;
+	std::vector<uint64_t> binSizes;
+	std::vector<GcPyramidAccumulator> finest;
+};
+
+/// <summary>
+/// Computes every zoom level of the GC track in one pass over the sequence and writes them to a
+/// compact binary file: a header, a directory with the offset of each level, then fixed-size bins.
+/// The finest bins are computed in parallel; every coarser level is folded from the one below.
+/// The pipeline fills a GcPyramidBuilder from its GC window scan instead.
+/// </summary>
+/// <param name="sequence">The DNA sequence.</param>
+/// <param name="binSizes">Bases per bin of each level, finest first; each must be a multiple of the previous one.</param>
+/// <param name="filename">Path of the pyramid file.</param>
+/// <returns>True when the file was written.</returns>
+bool writeGcPyramid(std::string_view sequence, const std::vector<uint64_t>& binSizes, const std::string& filename);
+
+/// <summary>
+/// Opens a pyramid file and reads its header and level directory.
+/// </summary>
+/// <param name="filename">Path of the pyramid file.</param>
+/// <param name="pyramid">Receives the header and directory.</param>
+/// <returns>True when the file is a valid pyramid.</returns>
+bool openGcPyramid(const std::string& filename, GcPyramidFile& pyramid);
+
+/// <summary>
+/// Picks the coarsest level whose bins are not wider than the requested resolution.
+/// </summary>
+/// <param name="pyramid">The opened pyramid.</param>
+/// <param name="basesPerPixel">Bases covered by one pixel of the viewer.</param>
+/// <returns>Index of the level to read.</returns>
+size_t chooseGcPyramidLevel(const GcPyramidFile& pyramid, uint64_t basesPerPixel);
+
+/// <summary>
+/// Reads the bins of one level that overlap [start, end) with a single seek.
+/// </summary>
+/// <param name="pyramid">The opened pyramid.</param>
+/// <param name="level">Index of the level.</param>
+/// <param name="start">First position (inclusive).</param>
+/// <param name="end">Last position (exclusive).</param>
+/// <returns>The bins in sequence order; bin i starts at (first bin + i) * binSize.</returns>
+std::vector<GcPyramidBin> readGcPyramidRegion(const GcPyramidFile& pyramid, size_t level, uint64_t start, uint64_t end);
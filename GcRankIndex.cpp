@@ -0,0 +1,292 @@
+#include "GcRankIndex.h"
+#include "Parallel.h"
+#include "File_DNA.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+// Identifies the file format; bump the digit when the layout changes
+static const char GcRankIndexMagic[8] = { 'G', 'C', 'R', 'A', 'N', 'K', '3', '\0' };
+
+namespace fs = std::filesystem;
+
+const uint64_t WORDS_PER_BLOCK = GC_RANK_BLOCK_SIZE / 64;
+
+/// <summary>
+/// Counts the set bits of a bit vector before a position.
+/// </summary>
+/// <param name="bits">Bit vector of the index.</param>
+/// <param name="samples">Sampled counts of the same bit vector.</param>
+/// <param name="pos">Position, at most the sequence length.</param>
+/// <returns>Number of set bits in [0, pos).</returns>
+uint64_t GcRankIndex::rank(const WordArray& bits, const WordArray& samples, uint64_t pos)
+{
+	uint64_t block = pos / GC_RANK_BLOCK_SIZE;
+	uint64_t lastWord = pos >> 6;
+	const uint64_t* words = bits.data();
+	uint64_t total = samples[block];
+	for (uint64_t word = block * WORDS_PER_BLOCK; word < lastWord; ++word)
+	{
+		total += std::popcount(words[word]);
+	}
+	if (pos & 63)
+	{
+		total += std::popcount(words[lastWord] & ~(~uint64_t{ 0 } << (pos & 63)));
+	}
+	return total;
+}
+
+/// <summary>
+/// Builds the rank index of a sequence. Blocks are filled in parallel and the samples are summed afterwards.
+/// </summary>
+/// <param name="sequence">The DNA sequence.</param>
+/// <returns>The rank index of the sequence.</returns>
+GcRankIndex buildGcRankIndex(std::string_view sequence)
+{
+	GcRankIndex index;
+	index.length = sequence.size();
+	uint64_t words = (index.length + 63) / 64;
+	uint64_t blocks = index.length / GC_RANK_BLOCK_SIZE + 1;
+	index.gcBits.assignZeros(words);
+	index.gaBits.assignZeros(words);
+	index.unknownBits.assignZeros(words);
+	index.gcSamples.assignZeros(blocks + 1);
+	index.gaSamples.assignZeros(blocks + 1);
+	index.unknownSamples.assignZeros(blocks + 1);
+
+	// Fill the bits and count every block on its own, then turn the counts into prefix sums
+	const uint64_t blocksPerTask = 1 << 11;
+	ParallelFor((blocks + blocksPerTask - 1) / blocksPerTask, [&](size_t task)
+		{
+			uint64_t lastBlock = std::min<uint64_t>(blocks, (task + 1) * blocksPerTask);
+			for (uint64_t block = task * blocksPerTask; block < lastBlock; ++block)
+			{
+				uint64_t lastWord = std::min<uint64_t>(words, (block + 1) * WORDS_PER_BLOCK);
+				for (uint64_t word = block * WORDS_PER_BLOCK; word < lastWord; ++word)
+				{
+					uint64_t gc = 0, ga = 0, unknown = 0;
+					uint64_t first = word * 64;
+					uint64_t last = std::min<uint64_t>(index.length, first + 64);
+					for (uint64_t i = first; i < last; ++i)
+					{
+						char base = sequence[i];
+						uint64_t bit = uint64_t{ 1 } << (i - first);
+						gc |= (base == 'G' || base == 'C') ? bit : 0;
+						ga |= (base == 'G' || base == 'A') ? bit : 0;
+						unknown |= (base != 'A' && base != 'C' && base != 'G' && base != 'T') ? bit : 0;
+					}
+					index.gcBits[word] = gc;
+					index.gaBits[word] = ga;
+					index.unknownBits[word] = unknown;
+					index.gcSamples[block + 1] += std::popcount(gc);
+					index.gaSamples[block + 1] += std::popcount(ga);
+					index.unknownSamples[block + 1] += std::popcount(unknown);
+				}
+			}
+		});
+
+	for (uint64_t block = 1; block <= blocks; ++block)
+	{
+		index.gcSamples[block] += index.gcSamples[block - 1];
+		index.gaSamples[block] += index.gaSamples[block - 1];
+		index.unknownSamples[block] += index.unknownSamples[block - 1];
+	}
+	return index;
+}
+
+/// <summary>
+/// Digest of a sequence stored with its saved index. Chunks are hashed in parallel and combined in
+/// order, so a sequence loaded another way (other loader, other case handling) never reuses the index.
+/// </summary>
+static uint64_t sequenceDigest(std::string_view sequence)
+{
+	const uint64_t chunkSize = 1 << 22;
+	uint64_t chunks = (sequence.size() + chunkSize - 1) / chunkSize;
+	std::vector<uint64_t> chunkDigests(chunks);
+	ParallelFor(chunks, [&](size_t chunk)
+		{
+			uint64_t first = chunk * chunkSize;
+			uint64_t last = std::min<uint64_t>(sequence.size(), first + chunkSize);
+			uint64_t hash = 0x9E3779B97F4A7C15ull ^ (last - first);
+			uint64_t i = first;
+			for (; i + 8 <= last; i += 8)
+			{
+				uint64_t word;
+				std::memcpy(&word, sequence.data() + i, sizeof(word));
+				hash = (hash ^ word) * 0xBF58476D1CE4E5B9ull;
+				hash ^= hash >> 31;
+			}
+			for (; i < last; ++i)
+			{
+				hash = (hash ^ static_cast<unsigned char>(sequence[i])) * 0x94D049BB133111EBull;
+			}
+			chunkDigests[chunk] = hash;
+		});
+
+	uint64_t digest = sequence.size();
+	for (uint64_t chunkDigest : chunkDigests)
+	{
+		digest = (digest ^ chunkDigest) * 0x100000001B3ull;
+		digest ^= digest >> 29;
+	}
+	return digest;
+}
+
+// Writes the index file for a sequence with the given digest
+static bool writeGcRankIndex(const GcRankIndex& index, uint64_t digest, const std::string& filename, const std::string& sourcePath)
+{
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+	if (!readSourceIdentity(sourcePath, sourceSize, sourceTime))
+	{
+		std::cerr << "Error: Unable to read " << sourcePath << "; the GC rank index is not saved" << std::endl;
+		return false;
+	}
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Error: Unable to create file " << filename << std::endl;
+		return false;
+	}
+
+	file.write(GcRankIndexMagic, sizeof(GcRankIndexMagic));
+	file.write(reinterpret_cast<const char*>(&sourceSize), sizeof(sourceSize));
+	file.write(reinterpret_cast<const char*>(&sourceTime), sizeof(sourceTime));
+	file.write(reinterpret_cast<const char*>(&index.length), sizeof(index.length));
+	file.write(reinterpret_cast<const char*>(&digest), sizeof(digest));
+	for (const auto* vector : { &index.gcBits, &index.gaBits, &index.unknownBits,
+		&index.gcSamples, &index.gaSamples, &index.unknownSamples })
+	{
+		file.write(reinterpret_cast<const char*>(vector->data()), vector->size() * sizeof(uint64_t));
+	}
+	return static_cast<bool>(file);
+}
+
+// Reads the index file if it was made from the current source and for a sequence of this length and digest
+static bool readGcRankIndex(const std::string& filename, uint64_t length, uint64_t digest, GcRankIndex& index, const std::string& sourcePath)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	char magic[sizeof(GcRankIndexMagic)];
+	file.read(magic, sizeof(magic));
+	if (!file || std::memcmp(magic, GcRankIndexMagic, sizeof(magic)) != 0)
+	{
+		return false;
+	}
+
+	// An edited or replaced source can keep its length, so the length alone does not tell
+	uint64_t storedSize = 0, sourceSize = 0, storedLength = 0, storedDigest = 0;
+	int64_t storedTime = 0, sourceTime = 0;
+	file.read(reinterpret_cast<char*>(&storedSize), sizeof(storedSize));
+	file.read(reinterpret_cast<char*>(&storedTime), sizeof(storedTime));
+	file.read(reinterpret_cast<char*>(&storedLength), sizeof(storedLength));
+	file.read(reinterpret_cast<char*>(&storedDigest), sizeof(storedDigest));
+	if (!file || !readSourceIdentity(sourcePath, sourceSize, sourceTime) || storedSize != sourceSize || storedTime != sourceTime
+		|| storedLength != length || storedDigest != digest)
+	{
+		return false;
+	}
+
+	// The vectors are only sized once the file is known to hold all of them
+	uint64_t words = (length + 63) / 64;
+	uint64_t samples = length / GC_RANK_BLOCK_SIZE + 2;
+	uint64_t headerSize = sizeof(GcRankIndexMagic) + 4 * sizeof(uint64_t);
+	std::error_code error;
+	uint64_t fileSize = fs::file_size(filename, error);
+	if (error || fileSize != headerSize + 3 * (words + samples) * sizeof(uint64_t))
+	{
+		return false;
+	}
+
+	// Zeroed in parallel first, so the pages are placed before the read fills them
+	GcRankIndex loaded;
+	loaded.length = length;
+	loaded.gcBits.assignZeros(words);
+	loaded.gaBits.assignZeros(words);
+	loaded.unknownBits.assignZeros(words);
+	loaded.gcSamples.assignZeros(samples);
+	loaded.gaSamples.assignZeros(samples);
+	loaded.unknownSamples.assignZeros(samples);
+	for (auto* vector : { &loaded.gcBits, &loaded.gaBits, &loaded.unknownBits,
+		&loaded.gcSamples, &loaded.gaSamples, &loaded.unknownSamples })
+	{
+		file.read(reinterpret_cast<char*>(vector->data()), vector->size() * sizeof(uint64_t));
+	}
+	if (!file)
+	{
+		return false;
+	}
+
+	index = std::move(loaded);
+	return true;
+}
+
+/// <summary>
+/// Saves the rank index to a binary file (host byte order) so later runs can load it instead of
+/// scanning the genome again. The size and last write time of the source file and the length and
+/// digest of the indexed sequence are stored with it.
+/// </summary>
+/// <param name="index">The index to save.</param>
+/// <param name="sequence">The indexed sequence.</param>
+/// <param name="filename">Path of the index file.</param>
+/// <param name="sourcePath">FASTA file the indexed sequence was loaded from.</param>
+/// <returns>True when the file was written.</returns>
+bool saveGcRankIndex(const GcRankIndex& index, std::string_view sequence, const std::string& filename, const std::string& sourcePath)
+{
+	return writeGcRankIndex(index, sequenceDigest(sequence), filename, sourcePath);
+}
+
+/// <summary>
+/// Loads a rank index written by saveGcRankIndex, if it was made from the current source file
+/// and for this sequence.
+/// </summary>
+/// <param name="filename">Path of the index file.</param>
+/// <param name="sequence">The sequence the index is for.</param>
+/// <param name="index">Receives the loaded index.</param>
+/// <param name="sourcePath">FASTA file the sequence is loaded from.</param>
+/// <returns>True when the file exists, is a complete index, matches the size and last write time of
+/// the source and was made for a sequence of the same length and digest.</returns>
+bool loadGcRankIndex(const std::string& filename, std::string_view sequence, GcRankIndex& index, const std::string& sourcePath)
+{
+	return readGcRankIndex(filename, sequence.size(), sequenceDigest(sequence), index, sourcePath);
+}
+
+/// <summary>
+/// Loads the rank index of a sequence from a file, or builds and saves it when the file is
+/// missing, was made from another version of the source file or for another sequence, e.g. one
+/// loaded in the other input mode or with other case handling.
+/// </summary>
+/// <param name="sequence">The DNA sequence.</param>
+/// <param name="filename">Path of the index file.</param>
+/// <param name="sourcePath">FASTA file the sequence was loaded from.</param>
+/// <returns>The rank index of the sequence.</returns>
+GcRankIndex loadOrBuildGcRankIndex(std::string_view sequence, const std::string& filename, const std::string& sourcePath)
+{
+	GcRankIndex index;
+	uint64_t digest = sequenceDigest(sequence);
+	if (readGcRankIndex(filename, sequence.size(), digest, index, sourcePath))
+	{
+		std::cout << "GC rank index loaded from: " << filename << std::endl;
+		return index;
+	}
+	if (std::ifstream(filename))
+	{
+		std::cout << "GC rank index " << filename << " does not match " << sourcePath << "; rebuilding it" << std::endl;
+	}
+
+	index = buildGcRankIndex(sequence);
+	if (writeGcRankIndex(index, digest, filename, sourcePath))
+	{
+		std::cout << "GC rank index saved to: " << filename << std::endl;
+	}
+	return index;
+}
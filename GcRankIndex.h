@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "WordArray.h"
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+// Bases covered by one sampled cumulative count (8 words of 64 bits)
+const uint64_t GC_RANK_BLOCK_SIZE = 512;
+
+/// <summary>
+/// Rank index over the GC, GA (purine) and unknown bits of a sequence. Every bit vector keeps the
+/// cumulative count sampled at the start of each block of 512 bases; the count of any prefix is
+/// the sample plus at most eight popcounts, so the composition of any [start, end) is constant
+/// time. Each bit vector takes 1/8 of the sequence size and the samples add under 5% on top.
+/// </summary>
+struct GcRankIndex
+{
+	uint64_t length = 0;      // Number of bases
+	WordArray gcBits;         // G or C
+	WordArray gaBits;         // G or A
+	WordArray unknownBits;    // Not an uppercase A, C, G or T (same rule as isUnknownBase)
+	WordArray gcSamples;      // Set bits of gcBits before every block, plus the total
+	WordArray gaSamples;      // Set bits of gaBits before every block, plus the total
+	WordArray unknownSamples; // Set bits of unknownBits before every block, plus the total
+
+	uint64_t gc(uint64_t start, uint64_t end) const { return rank(gcBits, gcSamples, end) - rank(gcBits, gcSamples, start); }
+	uint64_t ga(uint64_t start, uint64_t end) const { return rank(gaBits, gaSamples, end) - rank(gaBits, gaSamples, start); }
+	uint64_t unknown(uint64_t start, uint64_t end) const { return rank(unknownBits, unknownSamples, end) - rank(unknownBits, unknownSamples, start); }
+	uint64_t valid(uint64_t start, uint64_t end) const { return (end - start) - unknown(start, end); }
+
+	/// <summary>
+	/// Counts the set bits of a bit vector before a position.
+	/// </summary>
+	/// <param name="bits">Bit vector of the index.</param>
+	/// <param name="samples">Sampled counts of the same bit vector.</param>
+	/// <param name="pos">Position, at most the sequence length.</param>
+	/// <returns>Number of set bits in [0, pos).</returns>
+	static uint64_t rank(const WordArray& bits, const WordArray& samples, uint64_t pos);
+};
+
+/// <summary>
+/// Builds the rank index of a sequence. Blocks are filled in parallel and the samples are summed afterwards.
+/// </summary>
+/// <param name="sequence">The DNA sequence.</param>
+/// <returns>The rank index of the sequence.</returns>
+GcRankIndex buildGcRankIndex(std::string_view sequence);
+
+/// <summary>
+/// Saves the rank index to a binary file (host byte order) so later runs can load it instead of
+/// scanning the genome again. The size and last write time of the source file and the length and
+/// digest of the indexed sequence are stored with it.
+/// </summary>
+/// <param name="index">The index to save.</param>
+/// <param name="sequence">The indexed sequence.</param>
+/// <param name="filename">Path of the index file.</param>
+/// <param name="sourcePath">FASTA file the indexed sequence was loaded from.</param>
+/// <returns>True when the file was written.</returns>
+bool saveGcRankIndex(const GcRankIndex& index, std::string_view sequence, const std::string& filename, const std::string& sourcePath);
+
+/// <summary>
+/// Loads a rank index written by saveGcRankIndex, if it was made from the current source file
+/// and for this sequence.
+/// </summary>
+/// <param name="filename">Path of the index file.</param>
+/// <param name="sequence">The sequence the index is for.</param>
+/// <param name="index">Receives the loaded index.</param>
+/// <param name="sourcePath">FASTA file the sequence is loaded from.</param>
+/// <returns>True when the file exists, is a complete index, matches the size and last write time of
+/// the source and was made for a sequence of the same length and digest.</returns>
+bool loadGcRankIndex(const std::string& filename, std::string_view sequence, GcRankIndex& index, const std::string& sourcePath);
+
+/// <summary>
+/// Loads the rank index of a sequence from a file, or builds and saves it when the file is
+/// missing, was made from another version of the source file or for another sequence, e.g. one
+/// loaded in the other input mode or with other case handling.
+/// </summary>
+/// <param name="sequence">The DNA sequence.</param>
+/// <param name="filename">Path of the index file.</param>
+/// <param name="sourcePath">FASTA file the sequence was loaded from.</param>
+/// <returns>The rank index of the sequence.</returns>
+GcRankIndex loadOrBuildGcRankIndex(std::string_view sequence, const std::string& filename, const std::string& sourcePath);
@@ -0,0 +1,415 @@
+#include "GenomeImage.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// Identifies the file format; bump the digit when the layout changes
+static const char GenomeImageMagic[8] = { 'D', 'N', 'A', 'I', 'M', 'G', '1', '\0' };
+
+// Bits of GenomeImageHeader::flags
+const uint32_t IMAGE_HAS_SOFT_MASK = 1;
+const uint32_t IMAGE_HAS_BIT_PLANES = 2;
+const uint32_t IMAGE_HAS_GC_INDEX = 4;
+
+// First bytes of an image; the sections follow at the offsets, each aligned to GENOME_IMAGE_ALIGNMENT
+struct GenomeImageHeader
+{
+	char magic[8];
+	uint64_t sourceSize;     // Size of the source file the image was made from
+	int64_t sourceTime;      // Last write time of the source file
+	uint32_t loader;         // GenomeImageLoader of the sequence
+	uint32_t flags;          // IMAGE_HAS_* sections present
+	uint64_t length;         // Bases of the sequence
+	uint64_t nRunCount;      // Runs of N, stored as start/end pairs
+	uint64_t nRunsOffset;
+	uint64_t sequenceOffset;
+	uint64_t softMaskOffset; // Soft-mask words
+	uint64_t planesOffset;   // A, C, G, T and N planes, one after the other
+	uint64_t gcIndexOffset;  // GC, GA and unknown bits, then their samples
+	uint64_t totalSize;      // Size of the whole image file
+};
+
+static uint64_t alignImageOffset(uint64_t offset)
+{
+	return (offset + GENOME_IMAGE_ALIGNMENT - 1) / GENOME_IMAGE_ALIGNMENT * GENOME_IMAGE_ALIGNMENT;
+}
+
+// Words of one bit vector of a sequence
+static uint64_t bitVectorWords(uint64_t length)
+{
+	return (length + 63) / 64;
+}
+
+// Sampled counts of one bit vector of a GC rank index
+static uint64_t rankSampleCount(uint64_t length)
+{
+	return length / GC_RANK_BLOCK_SIZE + 2;
+}
+
+// Fills in the section offsets and total size from the length, run count and flags
+static void layoutGenomeImage(GenomeImageHeader& header)
+{
+	uint64_t vectorBytes = bitVectorWords(header.length) * sizeof(uint64_t);
+	uint64_t sampleBytes = rankSampleCount(header.length) * sizeof(uint64_t);
+
+	uint64_t offset = alignImageOffset(sizeof(GenomeImageHeader));
+	header.nRunsOffset = offset;
+	offset = alignImageOffset(offset + header.nRunCount * 2 * sizeof(uint64_t));
+	header.sequenceOffset = offset;
+	offset = alignImageOffset(offset + header.length);
+	header.softMaskOffset = offset;
+	offset = alignImageOffset(offset + ((header.flags & IMAGE_HAS_SOFT_MASK) ? vectorBytes : 0));
+	header.planesOffset = offset;
+	offset = alignImageOffset(offset + ((header.flags & IMAGE_HAS_BIT_PLANES) ? 5 * vectorBytes : 0));
+	header.gcIndexOffset = offset;
+	offset = alignImageOffset(offset + ((header.flags & IMAGE_HAS_GC_INDEX) ? 3 * vectorBytes + 3 * sampleBytes : 0));
+	header.totalSize = offset;
+}
+
+static uint32_t imageFlags(const GenomeImageContents& contents)
+{
+	return (contents.softMask ? IMAGE_HAS_SOFT_MASK : 0)
+		| (contents.bitPlanes ? IMAGE_HAS_BIT_PLANES : 0)
+		| (contents.gcIndex ? IMAGE_HAS_GC_INDEX : 0);
+}
+
+// Writes bytes at an offset past the current end of the file, zero-filling the gap
+static void writeImageSection(std::ofstream& file, uint64_t& position, uint64_t offset, const void* data, uint64_t bytes)
+{
+	static const char zeros[GENOME_IMAGE_ALIGNMENT] = {};
+	while (position < offset)
+	{
+		uint64_t padding = std::min<uint64_t>(offset - position, sizeof(zeros));
+		file.write(zeros, padding);
+		position += padding;
+	}
+	file.write(static_cast<const char*>(data), bytes);
+	position += bytes;
+}
+
+/// <summary>
+/// Writes a genome image. The image is written to a temporary file next to imagePath and renamed
+/// over it, so processes attaching at the same time see either the old image or the complete new one.
+/// </summary>
+/// <param name="imagePath">Path of the image, e.g. under /dev/shm.</param>
+/// <param name="sourcePath">File the sequence was loaded from; its size and time are recorded to detect stale images.</param>
+/// <param name="contents">Loader of the sequence and the indexes passed below.</param>
+/// <param name="sequence">The loaded sequence.</param>
+/// <param name="nRuns">Runs of N of the sequence.</param>
+/// <param name="softMask">Soft-mask of the sequence; required when contents.softMask is set.</param>
+/// <param name="planes">Bitplanes of the sequence; required when contents.bitPlanes is set.</param>
+/// <param name="gcIndex">GC rank index of the sequence; required when contents.gcIndex is set.</param>
+/// <returns>True when the image was published.</returns>
+bool publishGenomeImage(const std::string& imagePath, const std::string& sourcePath, const GenomeImageContents& contents,
+	std::string_view sequence, const std::vector<SequenceInterval>& nRuns,
+	const SoftMask* softMask, const BitPlaneSequence* planes, const GcRankIndex* gcIndex)
+{
+	uint64_t length = sequence.size();
+	if ((contents.softMask && (softMask == nullptr || softMask->length != length))
+		|| (contents.bitPlanes && (planes == nullptr || planes->length != length))
+		|| (contents.gcIndex && (gcIndex == nullptr || gcIndex->length != length)))
+	{
+		std::cerr << "Error: Genome image indexes do not match the sequence" << std::endl;
+		return false;
+	}
+
+	GenomeImageHeader header{};
+	std::memcpy(header.magic, GenomeImageMagic, sizeof(GenomeImageMagic));
+	if (!readSourceIdentity(sourcePath, header.sourceSize, header.sourceTime))
+	{
+		std::cerr << "Error: Unable to read file " << sourcePath << std::endl;
+		return false;
+	}
+	header.loader = static_cast<uint32_t>(contents.loader);
+	header.flags = imageFlags(contents);
+	header.length = length;
+	header.nRunCount = nRuns.size();
+	layoutGenomeImage(header);
+
+	std::string temporaryPath = imagePath + ".tmp";
+	std::ofstream file(temporaryPath, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Error: Unable to create file " << temporaryPath << std::endl;
+		return false;
+	}
+
+	uint64_t position = 0;
+	uint64_t vectorBytes = bitVectorWords(length) * sizeof(uint64_t);
+	uint64_t sampleBytes = rankSampleCount(length) * sizeof(uint64_t);
+	writeImageSection(file, position, 0, &header, sizeof(header));
+
+	std::vector<uint64_t> runs;
+	runs.reserve(nRuns.size() * 2);
+	for (const auto& run : nRuns)
+	{
+		runs.push_back(run.start);
+		runs.push_back(run.end);
+	}
+	writeImageSection(file, position, header.nRunsOffset, runs.data(), runs.size() * sizeof(uint64_t));
+	writeImageSection(file, position, header.sequenceOffset, sequence.data(), length);
+
+	if (contents.softMask)
+	{
+		writeImageSection(file, position, header.softMaskOffset, softMask->bits.data(), vectorBytes);
+	}
+	if (contents.bitPlanes)
+	{
+		uint64_t offset = header.planesOffset;
+		for (const auto* plane : { &planes->a, &planes->c, &planes->g, &planes->t, &planes->n })
+		{
+			writeImageSection(file, position, offset, plane->data(), vectorBytes);
+			offset += vectorBytes;
+		}
+	}
+	if (contents.gcIndex)
+	{
+		uint64_t offset = header.gcIndexOffset;
+		for (const auto* bits : { &gcIndex->gcBits, &gcIndex->gaBits, &gcIndex->unknownBits })
+		{
+			writeImageSection(file, position, offset, bits->data(), vectorBytes);
+			offset += vectorBytes;
+		}
+		for (const auto* samples : { &gcIndex->gcSamples, &gcIndex->gaSamples, &gcIndex->unknownSamples })
+		{
+			writeImageSection(file, position, offset, samples->data(), sampleBytes);
+			offset += sampleBytes;
+		}
+	}
+	writeImageSection(file, position, header.totalSize, nullptr, 0);
+
+	file.close();
+	std::error_code error;
+	if (!file)
+	{
+		std::cerr << "Error: Unable to write file " << temporaryPath << std::endl;
+		fs::remove(temporaryPath, error);
+		return false;
+	}
+
+	fs::rename(temporaryPath, imagePath, error);
+	if (error)
+	{
+		std::cerr << "Error: Unable to replace " << imagePath << ": " << error.message() << std::endl;
+		fs::remove(temporaryPath, error);
+		return false;
+	}
+	return true;
+}
+
+GenomeImage::~GenomeImage()
+{
+#ifndef _WIN32
+	if (mapping != nullptr)
+	{
+		munmap(mapping, mappedSize);
+	}
+#endif
+}
+
+/// <summary>
+/// Maps a genome image read-only.
+/// </summary>
+/// <param name="imagePath">Path of the image.</param>
+/// <param name="sourcePath">File the image must have been made from; an image of an older version of it is refused.</param>
+/// <returns>The attached image, or null when it is missing, incomplete or stale.</returns>
+std::unique_ptr<GenomeImage> attachGenomeImage(const std::string& imagePath, const std::string& sourcePath)
+{
+#ifdef _WIN32
+	(void)imagePath;
+	(void)sourcePath;
+	std::cerr << "Error: Genome images need mmap, which this build does not support." << std::endl;
+	return nullptr;
+#else
+	int fd = open(imagePath.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return nullptr;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || static_cast<uint64_t>(info.st_size) < sizeof(GenomeImageHeader))
+	{
+		close(fd);
+		return nullptr;
+	}
+
+	// The mapping keeps the file alive after it is closed, and after it is replaced by a newer image
+	void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+	{
+		return nullptr;
+	}
+
+	std::unique_ptr<GenomeImage> image(new GenomeImage());
+	image->mapping = mapping;
+	image->mappedSize = static_cast<uint64_t>(info.st_size);
+
+	GenomeImageHeader header;
+	std::memcpy(&header, mapping, sizeof(header));
+	GenomeImageHeader expected = header;
+	layoutGenomeImage(expected);
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+	if (std::memcmp(header.magic, GenomeImageMagic, sizeof(GenomeImageMagic)) != 0
+		|| header.loader > static_cast<uint32_t>(GenomeImageLoader::Chromosome)
+		|| std::memcmp(&header, &expected, sizeof(header)) != 0
+		|| header.totalSize != image->mappedSize
+		|| !readSourceIdentity(sourcePath, sourceSize, sourceTime)
+		|| header.sourceSize != sourceSize || header.sourceTime != sourceTime)
+	{
+		return nullptr;
+	}
+
+	const char* base = static_cast<const char*>(mapping);
+	auto words = [&](uint64_t offset) { return reinterpret_cast<const uint64_t*>(base + offset); };
+	uint64_t length = header.length;
+	uint64_t vectorWords = bitVectorWords(length);
+	uint64_t sampleWords = rankSampleCount(length);
+
+	image->imageContents.loader = static_cast<GenomeImageLoader>(header.loader);
+	image->imageContents.softMask = (header.flags & IMAGE_HAS_SOFT_MASK) != 0;
+	image->imageContents.bitPlanes = (header.flags & IMAGE_HAS_BIT_PLANES) != 0;
+	image->imageContents.gcIndex = (header.flags & IMAGE_HAS_GC_INDEX) != 0;
+	image->sequenceView = std::string_view(base + header.sequenceOffset, length);
+
+	const uint64_t* runs = words(header.nRunsOffset);
+	image->gaps.reserve(header.nRunCount);
+	for (uint64_t i = 0; i < header.nRunCount; ++i)
+	{
+		image->gaps.push_back({ runs[2 * i], runs[2 * i + 1] });
+	}
+
+	if (image->imageContents.softMask)
+	{
+		image->mask.bits = WordArray::borrow(words(header.softMaskOffset), vectorWords);
+		image->mask.length = length;
+	}
+	if (image->imageContents.bitPlanes)
+	{
+		const uint64_t* planes = words(header.planesOffset);
+		BitPlaneSequence& bitPlanes = image->bitPlanes;
+		bitPlanes.a = WordArray::borrow(planes, vectorWords);
+		bitPlanes.c = WordArray::borrow(planes + vectorWords, vectorWords);
+		bitPlanes.g = WordArray::borrow(planes + 2 * vectorWords, vectorWords);
+		bitPlanes.t = WordArray::borrow(planes + 3 * vectorWords, vectorWords);
+		bitPlanes.n = WordArray::borrow(planes + 4 * vectorWords, vectorWords);
+		bitPlanes.length = length;
+	}
+	if (image->imageContents.gcIndex)
+	{
+		const uint64_t* index = words(header.gcIndexOffset);
+		GcRankIndex& rankIndex = image->rankIndex;
+		rankIndex.gcBits = WordArray::borrow(index, vectorWords);
+		rankIndex.gaBits = WordArray::borrow(index + vectorWords, vectorWords);
+		rankIndex.unknownBits = WordArray::borrow(index + 2 * vectorWords, vectorWords);
+		rankIndex.gcSamples = WordArray::borrow(index + 3 * vectorWords, sampleWords);
+		rankIndex.gaSamples = WordArray::borrow(index + 3 * vectorWords + sampleWords, sampleWords);
+		rankIndex.unknownSamples = WordArray::borrow(index + 3 * vectorWords + 2 * sampleWords, sampleWords);
+		rankIndex.length = length;
+	}
+	return image;
+#endif
+}
+
+// True when an image was made by the same loader and holds every index that is asked for
+static bool imageProvides(const GenomeImageContents& image, const GenomeImageContents& wanted)
+{
+	return image.loader == wanted.loader && image.softMask == wanted.softMask
+		&& (image.bitPlanes || !wanted.bitPlanes) && (image.gcIndex || !wanted.gcIndex);
+}
+
+// Loads the source and builds what an image holds, then publishes it
+static bool buildGenomeImage(const std::string& imagePath, const std::string& sourcePath, const GenomeImageContents& contents)
+{
+	std::vector<SequenceInterval> nRuns;
+	SoftMask softMask;
+	std::string sequence = (contents.loader == GenomeImageLoader::Chromosome)
+		? read_chromosome_file(sourcePath, nRuns, contents.softMask ? &softMask : nullptr)
+		: load_fasta_file(sourcePath, nRuns, contents.softMask ? &softMask : nullptr);
+	if (sequence.empty())
+	{
+		return false;
+	}
+
+	BitPlaneSequence planes;
+	if (contents.bitPlanes)
+	{
+		planes = buildBitPlanes(sequence);
+	}
+	GcRankIndex gcIndex;
+	if (contents.gcIndex)
+	{
+		gcIndex = buildGcRankIndex(sequence);
+	}
+	return publishGenomeImage(imagePath, sourcePath, contents, sequence, nRuns, &softMask, &planes, &gcIndex);
+}
+
+/// <summary>
+/// Attaches the image of a genome, first publishing it when it is missing, stale, made by another
+/// loader or lacking a requested index. Publishing loads the source and builds the indexes once,
+/// under a lock file, while other processes asking for the same image wait and then attach to it.
+/// A republished image keeps the indexes of the one it replaces.
+/// </summary>
+/// <param name="imagePath">Path of the image.</param>
+/// <param name="sourcePath">FASTA or chromosome file of the genome.</param>
+/// <param name="contents">Loader and indexes the caller needs.</param>
+/// <returns>The attached image, or null when it could not be published or mapped.</returns>
+std::unique_ptr<GenomeImage> openGenomeImage(const std::string& imagePath, const std::string& sourcePath, const GenomeImageContents& contents)
+{
+	auto image = attachGenomeImage(imagePath, sourcePath);
+	if (image && imageProvides(image->contents(), contents))
+	{
+		return image;
+	}
+
+#ifdef _WIN32
+	return nullptr;
+#else
+	// One process builds the image while the others wait here, then find it published
+	std::string lockPath = imagePath + ".lock";
+	int lockFd = open(lockPath.c_str(), O_RDWR | O_CREAT, 0666);
+	if (lockFd >= 0)
+	{
+		flock(lockFd, LOCK_EX);
+	}
+
+	image = attachGenomeImage(imagePath, sourcePath);
+	if (!image || !imageProvides(image->contents(), contents))
+	{
+		GenomeImageContents publish = contents;
+		if (image && image->contents().loader == contents.loader && image->contents().softMask == contents.softMask)
+		{
+			publish.bitPlanes = publish.bitPlanes || image->contents().bitPlanes;
+			publish.gcIndex = publish.gcIndex || image->contents().gcIndex;
+		}
+		image.reset();
+
+		std::cout << "Publishing genome image: " << imagePath << std::endl;
+		if (buildGenomeImage(imagePath, sourcePath, publish))
+		{
+			image = attachGenomeImage(imagePath, sourcePath);
+		}
+	}
+
+	if (lockFd >= 0)
+	{
+		flock(lockFd, LOCK_UN);
+		close(lockFd);
+	}
+	return image;
+#endif
+}
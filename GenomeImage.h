@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "File_DNA.h"
+#include "BitPlane.h"
+#include "GcRankIndex.h"
+#include "SoftMask.h"
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+// Sections of an image start on this boundary, so mapped word arrays are aligned like allocated ones
+const uint64_t GENOME_IMAGE_ALIGNMENT = 64;
+
+// Loader that read the sequence of an image; without soft-masking the chromosome loader keeps lowercase bases
+enum class GenomeImageLoader : uint32_t
+{
+	Fasta = 0,
+	Chromosome = 1
+};
+
+// What an image is made from and what it holds besides the sequence and its runs of N
+struct GenomeImageContents
+{
+	GenomeImageLoader loader = GenomeImageLoader::Fasta;
+	bool softMask = false;  // Soft-mask bits; the loader then uppercased the sequence
+	bool bitPlanes = false; // Bitplanes of the sequence
+	bool gcIndex = false;   // GC rank index of the sequence
+};
+
+/// <summary>
+/// A prepared genome mapped read-only from an image file: the loaded sequence, its runs of N and
+/// the indexes it was published with. Every process attached to the same file shares its pages,
+/// so N concurrent jobs on one genome hold one copy of it. Images in /dev/shm stay in memory
+/// between jobs; images elsewhere are paged in from the file cache.
+/// </summary>
+class GenomeImage
+{
+public:
+	~GenomeImage();
+
+	GenomeImage(const GenomeImage&) = delete;
+	GenomeImage& operator=(const GenomeImage&) = delete;
+
+	std::string_view sequence() const { return sequenceView; }
+	const std::vector<SequenceInterval>& nRuns() const { return gaps; }
+	const GenomeImageContents& contents() const { return imageContents; }
+	uint64_t size() const { return mappedSize; }
+
+	// Indexes of the image; their word arrays borrow the mapped pages. Null when the image has none.
+	const SoftMask* softMask() const { return imageContents.softMask ? &mask : nullptr; }
+	const BitPlaneSequence* planes() const { return imageContents.bitPlanes ? &bitPlanes : nullptr; }
+	const GcRankIndex* gcIndex() const { return imageContents.gcIndex ? &rankIndex : nullptr; }
+
+private:
+	GenomeImage() = default;
+	friend std::unique_ptr<GenomeImage> attachGenomeImage(const std::string& imagePath, const std::string& sourcePath);
+
+	void* mapping = nullptr;
+	uint64_t mappedSize = 0;
+	std::string_view sequenceView;
+	std::vector<SequenceInterval> gaps;
+	GenomeImageContents imageContents;
+	SoftMask mask;
+	BitPlaneSequence bitPlanes;
+	GcRankIndex rankIndex;
+};
+
+/// <summary>
+/// Writes a genome image. The image is written to a temporary file next to imagePath and renamed
+/// over it, so processes attaching at the same time see either the old image or the complete new one.
+/// </summary>
+/// <param name="imagePath">Path of the image, e.g. under /dev/shm.</param>
+/// <param name="sourcePath">File the sequence was loaded from; its size and time are recorded to detect stale images.</param>
+/// <param name="contents">Loader of the sequence and the indexes passed below.</param>
+/// <param name="sequence">The loaded sequence.</param>
+/// <param name="nRuns">Runs of N of the sequence.</param>
+/// <param name="softMask">Soft-mask of the sequence; required when contents.softMask is set.</param>
+/// <param name="planes">Bitplanes of the sequence; required when contents.bitPlanes is set.</param>
+/// <param name="gcIndex">GC rank index of the sequence; required when contents.gcIndex is set.</param>
+/// <returns>True when the image was published.</returns>
+bool publishGenomeImage(const std::string& imagePath, const std::string& sourcePath, const GenomeImageContents& contents,
+	std::string_view sequence, const std::vector<SequenceInterval>& nRuns,
+	const SoftMask* softMask, const BitPlaneSequence* planes, const GcRankIndex* gcIndex);
+
+/// <summary>
+/// Maps a genome image read-only.
+/// </summary>
+/// <param name="imagePath">Path of the image.</param>
+/// <param name="sourcePath">File the image must have been made from; an image of an older version of it is refused.</param>
+/// <returns>The attached image, or null when it is missing, incomplete or stale.</returns>
+std::unique_ptr<GenomeImage> attachGenomeImage(const std::string& imagePath, const std::string& sourcePath);
+
+/// <summary>
+/// Attaches the image of a genome, first publishing it when it is missing, stale, made by another
+/// loader or lacking a requested index. Publishing loads the source and builds the indexes once,
+/// under a lock file, while other processes asking for the same image wait and then attach to it.
+/// A republished image keeps the indexes of the one it replaces.
+/// </summary>
+/// <param name="imagePath">Path of the image.</param>
+/// <param name="sourcePath">FASTA or chromosome file of the genome.</param>
+/// <param name="contents">Loader and indexes the caller needs.</param>
+/// <returns>The attached image, or null when it could not be published or mapped.</returns>
+std::unique_ptr<GenomeImage> openGenomeImage(const std::string& imagePath, const std::string& sourcePath, const GenomeImageContents& contents);
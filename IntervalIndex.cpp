@@ -0,0 +1,121 @@
+#include "IntervalIndex.h"
+
+#include <algorithm>
+
+// Subtrees at or below this level are scanned linearly instead of descended
+const int LINEAR_SCAN_LEVEL = 3;
+
+/// <summary>
+/// Builds the index of a set of half-open intervals.
+/// </summary>
+/// <param name="intervals">The (start, end) pairs; their positions become the ids.</param>
+/// <returns>The interval index.</returns>
+IntervalIndex buildIntervalIndex(const std::vector<std::pair<uint64_t, uint64_t>>& intervals)
+{
+	IntervalIndex index;
+	auto& a = index.intervals;
+	a.reserve(intervals.size());
+	for (size_t i = 0; i < intervals.size(); ++i)
+	{
+		a.push_back({ intervals[i].first, intervals[i].second, intervals[i].second, i });
+	}
+	std::sort(a.begin(), a.end(), [](const IndexedInterval& x, const IndexedInterval& y)
+		{
+			return x.start < y.start || (x.start == y.start && x.id < y.id);
+		});
+
+	size_t n = a.size();
+	if (n == 0)
+	{
+		return index;
+	}
+
+	// Leaves (even positions) cover themselves; every level above folds its two children. The
+	// rightmost path may point past the array, so the largest end seen on it stands in for them.
+	size_t lastNode = 0;
+	uint64_t lastMax = 0;
+	for (size_t i = 0; i < n; i += 2)
+	{
+		lastNode = i;
+		lastMax = a[i].maxEnd = a[i].end;
+	}
+
+	int level = 1;
+	for (; (size_t{ 1 } << level) <= n; ++level)
+	{
+		size_t half = size_t{ 1 } << (level - 1);
+		for (size_t i = (half << 1) - 1; i < n; i += half << 2)
+		{
+			uint64_t leftMax = a[i - half].maxEnd;
+			uint64_t rightMax = (i + half < n) ? a[i + half].maxEnd : lastMax;
+			a[i].maxEnd = std::max({ a[i].end, leftMax, rightMax });
+		}
+		lastNode = ((lastNode >> level) & 1) ? lastNode - half : lastNode + half;
+		if (lastNode < n)
+		{
+			lastMax = std::max(lastMax, a[lastNode].maxEnd);
+		}
+	}
+	index.maxLevel = level - 1;
+	return index;
+}
+
+/// <summary>
+/// Finds every interval overlapping [start, end).
+/// </summary>
+/// <param name="start">Query start.</param>
+/// <param name="end">Query end (exclusive).</param>
+/// <param name="hits">Receives the positions in intervals of the overlapping intervals (appended, in no particular order).</param>
+void IntervalIndex::query(uint64_t start, uint64_t end, std::vector<size_t>& hits) const
+{
+	struct Frame
+	{
+		size_t node;
+		int level;
+		bool leftDone;
+	};
+
+	size_t n = intervals.size();
+	if (n == 0)
+	{
+		return;
+	}
+
+	Frame stack[128]; // At most two frames per level are pending
+	int top = 0;
+	stack[top++] = { (size_t{ 1 } << maxLevel) - 1, maxLevel, false };
+	while (top > 0)
+	{
+		Frame frame = stack[--top];
+		if (frame.level <= LINEAR_SCAN_LEVEL)
+		{
+			size_t first = frame.node >> frame.level << frame.level;
+			size_t last = std::min(n, first + (size_t{ 1 } << (frame.level + 1)) - 1);
+			for (size_t i = first; i < last && intervals[i].start < end; ++i)
+			{
+				if (start < intervals[i].end)
+				{
+					hits.push_back(i);
+				}
+			}
+		}
+		else if (!frame.leftDone)
+		{
+			// Revisit this node after its left subtree, which only matters if it reaches the query
+			size_t left = frame.node - (size_t{ 1 } << (frame.level - 1));
+			stack[top++] = { frame.node, frame.level, true };
+			if (left >= n || intervals[left].maxEnd > start)
+			{
+				stack[top++] = { left, frame.level - 1, false };
+			}
+		}
+		else if (frame.node < n && intervals[frame.node].start < end)
+		{
+			if (start < intervals[frame.node].end)
+			{
+				hits.push_back(frame.node);
+			}
+			stack[top++] = { frame.node + (size_t{ 1 } << (frame.level - 1)), frame.level - 1, false };
+		}
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+/// <summary>
+/// One interval of an IntervalIndex, stored in start order.
+/// </summary>
+struct IndexedInterval
+{
+	uint64_t start;
+	uint64_t end;    // Exclusive
+	uint64_t maxEnd; // Largest end in the implicit subtree rooted at this interval
+	size_t id;       // Position of the interval in the input
+};
+
+/// <summary>
+/// Static interval index laid out as an implicit binary search tree over a start-sorted array
+/// (node i sits at the level given by its trailing one bits, as in cgranges). There are no
+/// pointers, queries walk a contiguous array, and small subtrees are scanned linearly, so it is
+/// cache-friendly and builds in one sort and one pass.
+/// </summary>
+struct IntervalIndex
+{
+	std::vector<IndexedInterval> intervals;
+	int maxLevel = -1;
+
+	/// <summary>
+	/// Finds every interval overlapping [start, end).
+	/// </summary>
+	/// <param name="start">Query start.</param>
+	/// <param name="end">Query end (exclusive).</param>
+	/// <param name="hits">Receives the positions in intervals of the overlapping intervals (appended, in no particular order).</param>
+	void query(uint64_t start, uint64_t end, std::vector<size_t>& hits) const;
+};
+
+/// <summary>
+/// Builds the index of a set of half-open intervals.
+/// </summary>
+/// <param name="intervals">The (start, end) pairs; their positions become the ids.</param>
+/// <returns>The interval index.</returns>
+IntervalIndex buildIntervalIndex(const std::vector<std::pair<uint64_t, uint64_t>>& intervals);
@@ -1,43 +1,20 @@
 #include "Isochore.h"
 
 #include "File_DNA.h"
-
-std::mutex isochoreMtx; // Mutex for thread safety
-uint64_t isochoreProgress = static_cast<uint64_t>(0.0);; // Shared progress variable
-bool isochoreRunning = true; // Control variable for the progress thread
-uint64_t isochoreTotalsize = 100;
-
-/// <summary>
-/// Function to update and display progress at regular intervals.
-/// </summary>
-static void updateProgress()
-{
-	auto startTime = std::chrono::high_resolution_clock::now(); // Start time
-
-	while (isochoreRunning)
-	{
-		std::this_thread::sleep_for(std::chrono::seconds(1)); // Update every second
-
-		// Lock the mutex to safely access the progress variable
-		std::lock_guard<std::mutex> lock(isochoreMtx);
-		double percentage = (static_cast<double>(isochoreProgress) / isochoreTotalsize) * 100;
-
-		// Calculate elapsed time
-		auto currentTime = std::chrono::high_resolution_clock::now();
-		std::chrono::duration<double> elapsed = currentTime - startTime;
-
-		// Convert elapsed time to hours, minutes, and seconds
-		int totalSeconds = static_cast<int>(elapsed.count());
-		int hours = totalSeconds / 3600;
-		int minutes = (totalSeconds % 3600) / 60;
-		int seconds = totalSeconds % 60;
-
-		// Output the current progress and elapsed time
-		std::cout << "\rProgress: " << std::fixed << std::setprecision(4)
-			<< percentage << "% completed. Elapsed time: "
-			<< hours << "h:" << minutes << "m:" << seconds << "s." << std::flush;
-	}
-}
+#include "Parallel.h"
+#include "CsvWriter.h"
+#include "IsochoreBoundaries.h"
+#include "Dinucleotide.h"
+#include "GcPyramid.h"
+#include "Trace.h"
+#include "Progress.h"
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
 
 /// <summary>
 /// Calculates whether a base is G or C.
@@ -69,6 +46,38 @@ int isUnknownBase(char base)
 	return (base != 'A' && base != 'T' && base != 'G' && base != 'C');
 }
 
+/// <summary>
+/// Classifies a GC percentage into its isochore family.
+/// </summary>
+/// <param name="gcContent">GC content in percent.</param>
+/// <returns>The family whose GC range contains the value.</returns>
+IsochoreFamily classifyIsochoreFamily(double gcContent)
+{
+	if (gcContent < 37.0) return IsochoreFamily::L1;
+	if (gcContent < 41.0) return IsochoreFamily::L2;
+	if (gcContent < 46.0) return IsochoreFamily::H1;
+	if (gcContent <= 53.0) return IsochoreFamily::H2;
+	return IsochoreFamily::H3;
+}
+
+/// <summary>
+/// Gets the name of an isochore family ("L1" .. "H3", or "-" when unclassified).
+/// </summary>
+/// <param name="family">The family.</param>
+/// <returns>The short family name.</returns>
+const char* isochoreFamilyName(IsochoreFamily family)
+{
+	switch (family)
+	{
+	case IsochoreFamily::L1: return "L1";
+	case IsochoreFamily::L2: return "L2";
+	case IsochoreFamily::H1: return "H1";
+	case IsochoreFamily::H2: return "H2";
+	case IsochoreFamily::H3: return "H3";
+	default: return "-";
+	}
+}
+
 /// <summary>
 /// Detects isochores in a genome sequence using a sliding window approach.
 /// </summary>
@@ -76,88 +85,300 @@ int isUnknownBase(char base)
 /// <param name="OutputFolder">Folder to save output files.</param>
 /// <param name="windowSize">Size of the sliding window.</param>
 /// <param name="stepSize">Step size to slide the window.</param>
-void detect_isochores_optimized(const std::string& genomeSequence, const std::string& OutputFolder, uint64_t windowSize, uint64_t stepSize)
+/// <param name="scan">Optional bitplanes, rank index and boundary detector used by the scan.</param>
+void detect_isochores_optimized(std::string_view genomeSequence, const std::string& OutputFolder, uint64_t windowSize, uint64_t stepSize,
+	const IsochoreScanOptions& scan)
 {
-	std::string fileName = (fs::path(OutputFolder) /
-		("isochores_output_" + std::to_string(windowSize) + "_" + std::to_string(stepSize) + ".csv")).string();
+	detect_isochores_in_contigs(genomeSequence, { SequenceInterval{ 0, genomeSequence.size() } }, OutputFolder, windowSize, stepSize, scan);
+}
 
-	std::ofstream outfile(fileName);
-	outfile << "Start,End,GC_Content\n";
+/// <summary>
+/// Runs the isochore detection over the whole sequence; detect_isochores_in_contigs reports its progress.
+/// </summary>
+/// <param name="genomeSequence">The DNA sequence to analyze.</param>
+/// <param name="outputFolder">Folder to save output files.</param>
+/// <param name="windowSize">Size of the sliding window.</param>
+/// <param name="stepSize">Step size to slide the window.</param>
+/// <param name="scan">Optional bitplanes, rank index and boundary detector used by the scan.</param>
+void runIsochoreDetection(std::string_view genomeSequence,
+	const std::string& outputFolder,
+	uint64_t windowSize, uint64_t stepSize, const IsochoreScanOptions& scan)
+{
+	detect_isochores_optimized(genomeSequence, outputFolder, windowSize, stepSize, scan);
+}
 
-	uint64_t genomeSize = genomeSequence.size();
-	isochoreTotalsize = genomeSize;
-	// Initialize GC content for the first window
-	int gcCount = 0;
-	int unknownCount = 0;
+// A run of consecutive windows inside one contig, formatted by one task
+struct IsochoreChunk
+{
+	SequenceInterval contig; // Contig the windows belong to
+	uint64_t firstWindow;    // Start of the first window of the chunk
+	uint64_t windowCount;    // Number of windows in the chunk
+};
 
-	// Initialize GC content and unknown characters for the first window
-	for (uint64_t i = 0; i < windowSize; i++)
+/// <summary>
+/// Formats a chunk of sliding GC windows into a text buffer, one CSV line per window, with the
+/// same values and number formatting as the serial scan. The first window of the chunk is
+/// counted from scratch, so chunks are independent of each other.
+/// </summary>
+/// <param name="genomeSequence">The full DNA sequence.</param>
+/// <param name="scan">Optional bitplanes and rank index to count with.</param>
+/// <param name="chunk">Windows to format.</param>
+/// <param name="windowSize">Size of the sliding window.</param>
+/// <param name="stepSize">Step size to slide the window.</param>
+/// <param name="out">Buffer receiving the CSV lines.</param>
+/// <param name="windows">When not null, receives the GC value and validity of every window.</param>
+/// <param name="progress">Receives the bases scanned.</param>
+static void appendIsochoreWindows(std::string_view genomeSequence, const IsochoreScanOptions& scan,
+	const IsochoreChunk& chunk, uint64_t windowSize, uint64_t stepSize, std::string& out,
+	std::vector<std::pair<double, bool>>* windows, ProgressReporter& progress)
+{
+	TRACE_SCOPE_VALUE("isochore chunk", chunk.firstWindow);
+	const BitPlaneSequence* planes = scan.planes;
+	const GcRankIndex* index = scan.index;
+	const int precision = defaultCsvPrecision();
+	uint64_t gcCount = 0;
+	uint64_t unknownCount = 0;
+	BaseComposition window;
+	// The index answers every window on its own; the other two paths count the first window and slide
+	if (!index && planes)
 	{
-		gcCount += calculateBaseGC(genomeSequence[i]);
-		unknownCount += isUnknownBase(genomeSequence[i]);
+		window = planes->count(chunk.firstWindow, chunk.firstWindow + windowSize);
 	}
-
-	// Only normalize by valid bases (exclude unknown characters)
-	double gcPercentage = (unknownCount < static_cast<int>(windowSize))
-		? (gcCount / static_cast<double>(windowSize - unknownCount)) * 100.0
-		: 0.0;
-
-	outfile << 0 << "," << windowSize << "," << gcPercentage << "\n";
-
-	for (uint64_t pos = stepSize; pos + windowSize <= genomeSize; pos += stepSize)
+	else if (!index)
 	{
-		// Subtract the base exiting the left side of the window
-		for (uint64_t i = pos - stepSize; i < pos; i++)
+		for (uint64_t i = chunk.firstWindow; i < chunk.firstWindow + windowSize; i++)
 		{
-			gcCount -= calculateBaseGC(genomeSequence[i]);
-			unknownCount -= isUnknownBase(genomeSequence[i]);
+			gcCount += calculateBaseGC(genomeSequence[i]);
+			unknownCount += isUnknownBase(genomeSequence[i]);
 		}
+	}
 
-		// Add the base entering the right side of the window
-		for (uint64_t i = pos + windowSize - stepSize; i < pos + windowSize; i++)
+	out.reserve(chunk.windowCount * 32);
+	uint64_t pos = chunk.firstWindow;
+	for (uint64_t w = 0; w < chunk.windowCount; ++w, pos += stepSize)
+	{
+		if (index)
 		{
-			gcCount += calculateBaseGC(genomeSequence[i]);
-			unknownCount += isUnknownBase(genomeSequence[i]);
+			gcCount = index->gc(pos, pos + windowSize);
+			unknownCount = index->unknown(pos, pos + windowSize);
+		}
+		else if (w != 0 && planes)
+		{
+			if (stepSize < windowSize)
+			{
+				window -= planes->count(pos - stepSize, pos);
+				window += planes->count(pos + windowSize - stepSize, pos + windowSize);
+			}
+			else
+			{
+				window = planes->count(pos, pos + windowSize);
+			}
+		}
+		else if (w != 0)
+		{
+			// Subtract the bases exiting the left side and add those entering the right side
+			for (uint64_t i = pos - stepSize; i < pos; i++)
+			{
+				gcCount -= calculateBaseGC(genomeSequence[i]);
+				unknownCount -= isUnknownBase(genomeSequence[i]);
+			}
+			for (uint64_t i = pos + windowSize - stepSize; i < pos + windowSize; i++)
+			{
+				gcCount += calculateBaseGC(genomeSequence[i]);
+				unknownCount += isUnknownBase(genomeSequence[i]);
+			}
+		}
+		if (planes && !index)
+		{
+			gcCount = window.gc();
+			unknownCount = window.unknown;
 		}
 
 		// Normalize only over valid bases (exclude unknown characters)
-		double gcContentPercentage = (unknownCount < windowSize)
-			? (gcCount / (double)(windowSize - unknownCount)) * 100.0
+		double gcPercentage = (unknownCount < windowSize)
+			? (gcCount / static_cast<double>(windowSize - unknownCount)) * 100.0
 			: 0.0;
 
-		outfile << pos << "," << (pos + windowSize) << "," << gcContentPercentage << "\n";
+		appendCsvInteger(out, pos);
+		out += ',';
+		appendCsvInteger(out, pos + windowSize);
+		out += ',';
+		appendCsvDouble(out, gcPercentage, precision);
+		out += '\n';
 
-		// Optionally update progress here
-		if (pos % (STEP_SIZE * 1000) == 0)
+		if (windows)
 		{
-			std::lock_guard<std::mutex> lock(isochoreMtx);
-			isochoreProgress = pos;
-			isochoreTotalsize = genomeSize;
+			windows->emplace_back(gcPercentage, unknownCount < windowSize);
 		}
 	}
 
+	progress.add(chunk.windowCount * stepSize);
+}
+
+/// <summary>
+/// Detects isochore windows only inside the given contigs. The windows are cut into chunks that
+/// are formatted in parallel and written in sequence order by a writer thread; the output is
+/// identical to a serial scan of each contig.
+/// </summary>
+/// <param name="genomeSequence">The DNA sequence to analyze.</param>
+/// <param name="contigs">Contigs to scan, in sequence order.</param>
+/// <param name="OutputFolder">Folder to save output files.</param>
+/// <param name="windowSize">Size of the sliding window.</param>
+/// <param name="stepSize">Step size to slide the window.</param>
+/// <param name="scan">Optional bitplanes, rank index and boundary detector used by the scan.</param>
+void detect_isochores_in_contigs(std::string_view genomeSequence, const std::vector<SequenceInterval>& contigs,
+	const std::string& OutputFolder, uint64_t windowSize, uint64_t stepSize, const IsochoreScanOptions& scan)
+{
+	TRACE_SCOPE("isochore detection");
+	std::string fileName = (fs::path(OutputFolder) /
+		("isochores_output_" + std::to_string(windowSize) + "_" + std::to_string(stepSize) + ".csv")).string();
+
+	CsvWriter outfile(fileName);
+	outfile << "Start,End,GC_Content\n";
+
+	// Enough windows per chunk that recounting the first window stays negligible
+	const uint64_t chunkBases = std::max<uint64_t>(uint64_t{ 1 } << 22, 8 * windowSize);
+	const uint64_t windowsPerChunk = std::max<uint64_t>(1, chunkBases / stepSize);
+
+	std::vector<IsochoreChunk> chunks;
+	uint64_t totalWindows = 0;
+	for (const auto& contig : contigs)
+	{
+		if (contig.end - contig.start < windowSize)
+		{
+			continue;
+		}
+
+		uint64_t windowCount = (contig.end - contig.start - windowSize) / stepSize + 1;
+		totalWindows += windowCount;
+		for (uint64_t first = 0; first < windowCount; first += windowsPerChunk)
+		{
+			chunks.push_back({ contig, contig.start + first * stepSize, std::min(windowsPerChunk, windowCount - first) });
+		}
+	}
+
+	ProgressReporter progress(totalWindows * stepSize);
+
+	// The boundary detector consumes the windows of every chunk right after the chunk is written
+	bool keepWindows = scan.boundaries || scan.onWindow;
+	std::vector<std::vector<std::pair<double, bool>>> chunkWindows(keepWindows ? chunks.size() : 0);
+
+	// Each task also counts the finest pyramid bins from the one holding the start of its chunk up
+	// to the one holding the start of the next chunk, while those bases are in its cache. The first
+	// and last tasks take the ends of the sequence, so every bin is counted exactly once.
+	auto pyramidBin = [&](size_t i)
+		{
+			return i == 0 ? 0 : i == chunks.size() ? scan.pyramid->finestBinCount()
+				: static_cast<size_t>(chunks[i].firstWindow / scan.pyramid->finestBinSize());
+		};
+	if (scan.pyramid && chunks.empty())
+	{
+		scan.pyramid->countFinestBins(0, scan.pyramid->finestBinCount(), genomeSequence, scan.planes, scan.index);
+	}
+
+	ParallelOrderedWrite(chunks.size(), [&](size_t i, std::string& buffer)
+		{
+			appendIsochoreWindows(genomeSequence, scan, chunks[i], windowSize, stepSize, buffer,
+				keepWindows ? &chunkWindows[i] : nullptr, progress);
+			if (scan.pyramid)
+			{
+				scan.pyramid->countFinestBins(pyramidBin(i), pyramidBin(i + 1), genomeSequence, scan.planes, scan.index);
+			}
+		}, [&](size_t i, const std::string& buffer)
+		{
+			outfile << buffer;
+			if (keepWindows)
+			{
+				for (size_t w = 0; w < chunkWindows[i].size(); ++w)
+				{
+					uint64_t pos = chunks[i].firstWindow + w * stepSize;
+					if (scan.boundaries)
+					{
+						scan.boundaries->addWindow(pos, pos + windowSize, chunkWindows[i][w].first, chunkWindows[i][w].second);
+					}
+					if (scan.onWindow)
+					{
+						scan.onWindow(pos, pos + windowSize, chunkWindows[i][w].first, chunkWindows[i][w].second);
+					}
+				}
+				std::vector<std::pair<double, bool>>().swap(chunkWindows[i]);
+			}
+		});
+
 	outfile.close();
 }
 
 /// <summary>
-/// Runs the isochore detection in a separate thread and tracks progress.
+/// Runs the contig-aware isochore detection; detect_isochores_in_contigs reports its progress.
 /// </summary>
 /// <param name="genomeSequence">The DNA sequence to analyze.</param>
+/// <param name="contigs">Contigs to scan, in sequence order.</param>
 /// <param name="outputFolder">Folder to save output files.</param>
 /// <param name="windowSize">Size of the sliding window.</param>
 /// <param name="stepSize">Step size to slide the window.</param>
-void runIsochoreDetection(const std::string& genomeSequence,
+/// <param name="scan">Optional bitplanes, rank index and boundary detector used by the scan.</param>
+void runIsochoreDetectionInContigs(std::string_view genomeSequence,
+	const std::vector<SequenceInterval>& contigs,
 	const std::string& outputFolder,
-	uint64_t windowSize, uint64_t stepSize)
+	uint64_t windowSize, uint64_t stepSize, const IsochoreScanOptions& scan)
 {
-	// Start progress thread
-	std::thread progressThread(updateProgress);
+	detect_isochores_in_contigs(genomeSequence, contigs, outputFolder, windowSize, stepSize, scan);
+}
 
-	detect_isochores_optimized(genomeSequence, outputFolder, windowSize, stepSize);
+/// <summary>
+/// Adds the GC and GA content of its range to one segment, as mergeSegmentsWithGCContent does.
+/// </summary>
+/// <param name="sequence">The full DNA sequence as a string.</param>
+/// <param name="segment">The segment (start, end, cost, best word).</param>
+/// <param name="planes">Bitplanes of the sequence, or nullptr to count the characters directly.</param>
+/// <param name="index">GC rank index of the sequence, or nullptr; takes precedence over planes.</param>
+/// <returns>The segment with its GC and GA percentages.</returns>
+std::tuple<uint64_t, uint64_t, double, std::string, double, double> segmentWithGCContent(
+	std::string_view sequence,
+	const std::tuple<uint64_t, uint64_t, double, std::string>& segment,
+	const BitPlaneSequence* planes, const GcRankIndex* index)
+{
+	uint64_t start = std::get<0>(segment);
+	uint64_t end = std::get<1>(segment);
+	double cost = std::get<2>(segment);
+	std::string bestWord = std::get<3>(segment);
+	int gcCount = 0;
+	int gaCount = 0;
+	int unknownCount = 0;
+	uint64_t windowSize = end - start;
+	if (index)
+	{
+		gcCount = static_cast<int>(index->gc(start, end));
+		gaCount = static_cast<int>(index->ga(start, end));
+		unknownCount = static_cast<int>(index->unknown(start, end));
+	}
+	else if (planes)
+	{
+		// One fused popcount pass gives all counts of the segment
+		BaseComposition composition = planes->count(start, end);
+		gcCount = static_cast<int>(composition.gc());
+		gaCount = static_cast<int>(composition.ga());
+		unknownCount = static_cast<int>(composition.unknown);
+	}
+	else
+	{
+		for (uint64_t i = start; i < end; i++)
+		{
+			gcCount += calculateBaseGC(sequence[i]);
+			gaCount += calculateBaseGA(sequence[i]);
+			unknownCount += isUnknownBase(sequence[i]);
+		}
+	}
 
-	// Stop progress thread
-	isochoreRunning = false;
-	progressThread.join();
+	double gcPercentage = (unknownCount < static_cast<int>(windowSize))
+		? (gcCount / static_cast<double>(windowSize - unknownCount)) * 100.0
+		: 0.0;
+
+	double gaPercentage = (unknownCount < static_cast<int>(windowSize))
+		? (gaCount / static_cast<double>(windowSize - unknownCount)) * 100.0
+		: 0.0;
+
+	return { start, end, cost, bestWord, gcPercentage, gaPercentage };
 }
 
 /// <summary>
@@ -165,46 +386,163 @@ void runIsochoreDetection(const std::string& genomeSequence,
 /// </summary>
 /// <param name="sequence">The full DNA sequence as a string.</param>
 /// <param name="segments">Vector of segments (start, end, cost, best word).</param>
+/// <param name="planes">Bitplanes of the sequence, or nullptr to count the characters directly.</param>
+/// <param name="index">GC rank index of the sequence, or nullptr; answers every window in constant time and takes precedence over planes.</param>
 /// <returns>
 /// A new vector containing segments with an additional GC content field.
 /// </returns>
 std::vector<std::tuple<uint64_t, uint64_t, double, std::string, double, double>> mergeSegmentsWithGCContent(
-	const std::string& sequence,
-	const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments)
+	std::string_view sequence,
+	const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments,
+	const BitPlaneSequence* planes, const GcRankIndex* index)
 {
+	TRACE_SCOPE("GC annotation");
 	std::vector<std::tuple<uint64_t, uint64_t, double, std::string, double, double>> result;
+	result.reserve(segments.size());
 
 	for (const auto& seg : segments) 
 	{
-		uint64_t start = std::get<0>(seg);
-		uint64_t end = std::get<1>(seg);
-		double cost = std::get<2>(seg);
-		std::string bestWord = std::get<3>(seg);
-		int gcCount = 0;
-		int gaCount = 0;
-		int unknownCount = 0;
-		uint64_t windowSize = end - start;
-		// Initialize GC content and unknown characters for the first window
-		for (uint64_t i = start; i < end; i++)
+		result.push_back(segmentWithGCContent(sequence, seg, planes, index));
+	}
+
+	return result;
+}
+
+// Writes one overlap record as a CSV row
+static void writeOverlapRow(CsvWriter& file, const Overlap& o)
+{
+	file << o.isochore_start << ","
+		<< o.isochore_end << ","
+		<< o.isochore_gc << ","
+		<< o.segment_start << ","
+		<< o.segment_end << ","
+		<< o.segment_cost << ","
+		<< o.best_word << ","
+		<< o.overlap_length << "\n";
+}
+
+/// <summary>
+/// Finds the overlaps between isochores and segments with a sweep-line merge join in
+/// O(I + S + overlaps) for sorted inputs. Chunks of isochores are joined in parallel; the records
+/// and statistics come out in the same order and with the same values as comparing every
+/// isochore with every segment: isochores in input order, then segments in input order.
+/// Unsorted inputs are sorted by index first.
+/// </summary>
+/// <param name="isochores">Isochore intervals.</param>
+/// <param name="segments">Segments (start, end, cost, best word).</param>
+/// <param name="statistics">Receives the overlap statistics.</param>
+/// <returns>One record per overlapping isochore and segment pair.</returns>
+std::vector<Overlap> findIsochoreSegmentOverlap(
+	const std::vector<Isochore>& isochores,
+	const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments,
+	OverlapStatistics& statistics)
+{
+	TRACE_SCOPE("overlap");
+	statistics = OverlapStatistics();
+	statistics.totalIsochores = static_cast<int>(isochores.size());
+
+	// Sweep order of both inputs; the identity when they are already sorted by start
+	std::vector<size_t> isochoreOrder(isochores.size());
+	std::vector<size_t> segmentOrder(segments.size());
+	std::iota(isochoreOrder.begin(), isochoreOrder.end(), size_t{ 0 });
+	std::iota(segmentOrder.begin(), segmentOrder.end(), size_t{ 0 });
+	auto isochoreBefore = [&](size_t a, size_t b) { return isochores[a].start < isochores[b].start; };
+	auto segmentBefore = [&](size_t a, size_t b) { return std::get<0>(segments[a]) < std::get<0>(segments[b]); };
+	bool isochoresSorted = std::is_sorted(isochoreOrder.begin(), isochoreOrder.end(), isochoreBefore);
+	bool segmentsSorted = std::is_sorted(segmentOrder.begin(), segmentOrder.end(), segmentBefore);
+	if (!isochoresSorted)
+	{
+		std::stable_sort(isochoreOrder.begin(), isochoreOrder.end(), isochoreBefore);
+	}
+	if (!segmentsSorted)
+	{
+		std::stable_sort(segmentOrder.begin(), segmentOrder.end(), segmentBefore);
+	}
+
+	// Running maximum of the segment ends: every segment before the first position whose
+	// maximum passes an isochore start ends before that isochore
+	std::vector<uint64_t> maxEnd(segments.size());
+	for (size_t k = 0; k < segmentOrder.size(); ++k)
+	{
+		maxEnd[k] = std::max(k > 0 ? maxEnd[k - 1] : 0, std::get<1>(segments[segmentOrder[k]]));
+	}
+
+	const size_t isochoresPerChunk = 4096;
+	size_t chunkCount = (isochores.size() + isochoresPerChunk - 1) / isochoresPerChunk;
+	std::vector<std::vector<std::pair<size_t, size_t>>> chunkPairs(chunkCount); // (isochore, segment)
+
+	ParallelFor(chunkCount, [&](size_t chunk)
 		{
-			gcCount += calculateBaseGC(sequence[i]);
-			gaCount+= calculateBaseGA(sequence[i]);
-			unknownCount += isUnknownBase(sequence[i]);
-		}
+			size_t first = chunk * isochoresPerChunk;
+			size_t last = std::min(isochores.size(), first + isochoresPerChunk);
+			auto& pairs = chunkPairs[chunk];
 
-		double gcPercentage = (unknownCount < static_cast<int>(windowSize))
-			? (gcCount / static_cast<double>(windowSize - unknownCount)) * 100.0
-			: 0.0;
+			uint64_t firstStart = isochores[isochoreOrder[first]].start;
+			size_t candidate = std::partition_point(maxEnd.begin(), maxEnd.end(),
+				[&](uint64_t end) { return end <= firstStart; }) - maxEnd.begin();
 
-		double gaPercentage = (unknownCount < static_cast<int>(windowSize))
-			? (gaCount / static_cast<double>(windowSize - unknownCount)) * 100.0
-			: 0.0;
+			for (size_t i = first; i < last; ++i)
+			{
+				const Isochore& iso = isochores[isochoreOrder[i]];
+				while (candidate < maxEnd.size() && maxEnd[candidate] <= iso.start)
+				{
+					++candidate;
+				}
+
+				size_t firstPair = pairs.size();
+				for (size_t k = candidate; k < segmentOrder.size() && std::get<0>(segments[segmentOrder[k]]) < iso.end; ++k)
+				{
+					if (std::get<1>(segments[segmentOrder[k]]) > iso.start)
+					{
+						pairs.emplace_back(isochoreOrder[i], segmentOrder[k]);
+					}
+				}
+				if (!segmentsSorted)
+				{
+					std::sort(pairs.begin() + firstPair, pairs.end());
+				}
+			}
+		});
 
-		// Add to result
-		result.emplace_back(start, end, cost, bestWord, gcPercentage, gaPercentage);
+	std::vector<std::pair<size_t, size_t>> pairs;
+	for (auto& chunk : chunkPairs)
+	{
+		pairs.insert(pairs.end(), chunk.begin(), chunk.end());
+		std::vector<std::pair<size_t, size_t>>().swap(chunk);
+	}
+	if (!isochoresSorted)
+	{
+		std::stable_sort(pairs.begin(), pairs.end(),
+			[](const auto& a, const auto& b) { return a.first < b.first; });
 	}
 
-	return result;
+	// Records and statistics in output order, so the sums match the nested loops exactly
+	std::vector<Overlap> overlaps;
+	overlaps.reserve(pairs.size());
+	for (size_t p = 0; p < pairs.size(); ++p)
+	{
+		const Isochore& iso = isochores[pairs[p].first];
+		const auto& [seg_start, seg_end, seg_cost, best_word] = segments[pairs[p].second];
+
+		bool firstOfIsochore = (p == 0 || pairs[p - 1].first != pairs[p].first);
+		bool lastOfIsochore = (p + 1 == pairs.size() || pairs[p + 1].first != pairs[p].first);
+		if (firstOfIsochore && lastOfIsochore)
+		{
+			statistics.singleSegmentIsochores++;
+			statistics.singleSegmentGCSum += iso.gc_content;
+		}
+
+		uint64_t overlapStart = std::max<uint64_t>(iso.start, seg_start);
+		uint64_t overlapEnd = std::min<uint64_t>(iso.end, seg_end);
+		overlaps.push_back({
+			iso.start, iso.end, iso.gc_content,
+			seg_start, seg_end, seg_cost,
+			best_word, overlapEnd - overlapStart
+			});
+		statistics.addOverlap(seg_cost, best_word);
+	}
+
+	return overlaps;
 }
 
 // Function to find overlap between isochores and segments
@@ -218,63 +556,218 @@ std::vector<Overlap> findIsochoreSegmentOverlap(
 	double& minCost,
 	std::map<std::string, int>& wordFrequency)
 {
-	std::vector<Overlap> overlaps;
-	singleSegmentIsochores = 0;
-	singleSegmentGCSum = 0;
-	totalCostSum = 0;
-	maxCost = -1;
-	minCost = 1e9;
+	OverlapStatistics statistics;
+	auto overlaps = findIsochoreSegmentOverlap(isochores, segments, statistics);
+
+	singleSegmentIsochores = statistics.singleSegmentIsochores;
+	singleSegmentGCSum = statistics.singleSegmentGCSum;
+	totalCostSum = statistics.totalCostSum;
+	maxCost = statistics.maxCost;
+	minCost = statistics.minCost;
+	for (const auto& [word, count] : statistics.topWords(statistics.wordCounts.distinct() + statistics.otherWords.size()))
+	{
+		wordFrequency[word] += static_cast<int>(count);
+	}
+	return overlaps;
+}
+
+// Reads the next "Start,End,GC_Content[,...]" row of an isochore file
+static bool readIsochoreRow(std::istream& file, Isochore& iso)
+{
+	string line;
+	if (!getline(file, line) || line.empty())
+	{
+		return false;
+	}
+
+	stringstream ss(line);
+	string field;
+	getline(ss, field, ',');
+	iso.start = stoull(field);
+	getline(ss, field, ',');
+	iso.end = stoull(field);
+	getline(ss, field, ',');
+	iso.gc_content = stod(field);
+	return true;
+}
+
+// Reads the next "Start,End,Length,Cost,Best Word" row of a segment file
+static bool readSegmentRow(std::istream& file, std::tuple<uint64_t, uint64_t, double, std::string>& segment)
+{
+	string line;
+	if (!getline(file, line) || line.empty())
+	{
+		return false;
+	}
+
+	stringstream ss(line);
+	string field;
+	getline(ss, field, ',');
+	std::get<0>(segment) = stoull(field);
+	getline(ss, field, ',');
+	std::get<1>(segment) = stoull(field);
+	getline(ss, field, ','); // Length
+	getline(ss, field, ',');
+	std::get<2>(segment) = stod(field);
+	getline(ss, std::get<3>(segment));
+	return true;
+}
+
+/// <summary>
+/// Streaming form of the sweep-line join for inputs too large to load. Both files must be
+/// sorted by start; only the segments that can still reach the current isochore are kept in
+/// memory. The overlaps are written to a CSV file in the same format and order as
+/// saveOverlapsToCSV writes the result of findIsochoreSegmentOverlap. The statistics match too
+/// when the inputs were saved with --precision=0; rounded costs can move the averages.
+/// </summary>
+/// <param name="isochoreFile">Isochore CSV (Start,End,GC_Content,...), sorted by start.</param>
+/// <param name="segmentFile">Segment CSV (Start,End,Length,Cost,Best Word), sorted by start.</param>
+/// <param name="overlapFile">Path of the overlap CSV to write.</param>
+/// <returns>The overlap statistics.</returns>
+OverlapStatistics streamIsochoreSegmentOverlap(const std::string& isochoreFile, const std::string& segmentFile, const std::string& overlapFile)
+{
+	std::ifstream isochoreInput(isochoreFile);
+	std::ifstream segmentInput(segmentFile);
+	if (!isochoreInput.is_open() || !segmentInput.is_open())
+	{
+		throw std::runtime_error("Unable to open file: " + (isochoreInput.is_open() ? segmentFile : isochoreFile));
+	}
+
+	CsvWriter file(overlapFile);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("Unable to create file: " + overlapFile);
+	}
+	file << "Isochore Start,Isochore End,Isochore GC,Segment Start,Segment End,Segment Cost,Best Word,Overlap Length\n";
+
+	string header;
+	getline(isochoreInput, header);
+	getline(segmentInput, header);
 
-	for (const auto& iso : isochores) {
-		// Find overlapping segments
-		std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> overlappingSegments;
-		for (const auto& seg : segments)
+	OverlapStatistics statistics;
+	std::deque<std::tuple<uint64_t, uint64_t, double, std::string>> active; // Segments read but not yet passed
+	bool segmentsDone = false;
+	uint64_t lastSegmentStart = 0;
+	uint64_t lastIsochoreStart = 0;
+
+	Isochore iso;
+	while (readIsochoreRow(isochoreInput, iso))
+	{
+		if (iso.start < lastIsochoreStart)
 		{
-			uint64_t seg_start = get<0>(seg);
-			uint64_t seg_end = get<1>(seg);
+			throw std::runtime_error("Isochores are not sorted by start: " + isochoreFile);
+		}
+		lastIsochoreStart = iso.start;
+		statistics.totalIsochores++;
+
+		// Segments ending before this isochore cannot reach any later one either
+		while (!active.empty() && std::get<1>(active.front()) <= iso.start)
+		{
+			active.pop_front();
+		}
 
-			if (seg_start < iso.end && seg_end > iso.start)
+		// Read until a segment starts at or after the isochore end
+		while (!segmentsDone && (active.empty() || std::get<0>(active.back()) < iso.end))
+		{
+			std::tuple<uint64_t, uint64_t, double, std::string> segment;
+			if (!readSegmentRow(segmentInput, segment))
+			{
+				segmentsDone = true;
+				break;
+			}
+			if (std::get<0>(segment) < lastSegmentStart)
+			{
+				throw std::runtime_error("Segments are not sorted by start: " + segmentFile);
+			}
+			lastSegmentStart = std::get<0>(segment);
+			if (std::get<1>(segment) > iso.start)
 			{
-				overlappingSegments.push_back(seg);
+				active.push_back(std::move(segment));
 			}
 		}
 
-		// If exactly one segment creates this isochore
-		if (overlappingSegments.size() == 1)
+		size_t overlapCount = 0;
+		for (const auto& [seg_start, seg_end, seg_cost, best_word] : active)
 		{
-			singleSegmentIsochores++;
-			singleSegmentGCSum += iso.gc_content;
+			if (seg_start >= iso.end)
+			{
+				break;
+			}
+			if (seg_end <= iso.start)
+			{
+				continue;
+			}
+
+			uint64_t overlapStart = std::max<uint64_t>(iso.start, seg_start);
+			uint64_t overlapEnd = std::min<uint64_t>(iso.end, seg_end);
+			writeOverlapRow(file, { iso.start, iso.end, iso.gc_content, seg_start, seg_end, seg_cost, best_word, overlapEnd - overlapStart });
+			statistics.addOverlap(seg_cost, best_word);
+			++overlapCount;
 		}
 
-		// Add all overlaps to result
-		for (const auto& seg : overlappingSegments)
+		if (overlapCount == 1)
 		{
-			uint64_t seg_start = get<0>(seg);
-			uint64_t seg_end = get<1>(seg);
-			double seg_cost = get<2>(seg);
-			std::string best_word = get<3>(seg);
-
-			uint64_t overlapStart = std::max(iso.start, seg_start);
-			uint64_t overlapEnd = std::min(iso.end, seg_end);
-			uint64_t overlapLength = overlapEnd - overlapStart;
+			statistics.singleSegmentIsochores++;
+			statistics.singleSegmentGCSum += iso.gc_content;
+		}
+	}
 
-			overlaps.push_back({
-				iso.start, iso.end, iso.gc_content,
-				seg_start, seg_end, seg_cost,
-				best_word, overlapLength
-				});
+	file.close();
+	cout << "Overlaps saved to " << overlapFile << "\n";
+	return statistics;
+}
 
-			// Track cost stats
-			totalCostSum += seg_cost;
-			maxCost = std::max(maxCost, seg_cost);
-			minCost = std::min(minCost, seg_cost);
+/// <summary>
+/// Saves overlap statistics with saveStatisticsToFile, deriving the averages and the most frequent word,
+/// followed by the OVERLAP_TOP_WORDS most frequent best words.
+/// </summary>
+/// <param name="filename">Path of the statistics file.</param>
+/// <param name="statistics">The statistics of an overlap join.</param>
+void saveOverlapStatistics(const std::string& filename, const OverlapStatistics& statistics)
+{
+	TRACE_SCOPE("save overlap statistics");
+	auto topWords = statistics.topWords(OVERLAP_TOP_WORDS);
+	std::string mostFrequentWord = topWords.empty() ? "" : topWords[0].first;
+	int mostFrequentCount = topWords.empty() ? 0 : static_cast<int>(topWords[0].second);
+
+	double avgGC = statistics.singleSegmentIsochores > 0 ? statistics.singleSegmentGCSum / statistics.singleSegmentIsochores : 0.0;
+	double avgCost = statistics.overlapCount > 0 ? statistics.totalCostSum / statistics.overlapCount : 0.0;
+	saveStatisticsToFile(filename, statistics.totalIsochores, statistics.singleSegmentIsochores, avgGC, avgCost,
+		statistics.maxCost, statistics.minCost, mostFrequentWord, mostFrequentCount);
+
+	std::ofstream file(filename, std::ios::app);
+	file << "Top " << OVERLAP_TOP_WORDS << " Best Words:\n";
+	for (const auto& [word, count] : topWords)
+	{
+		file << "  " << word << ": " << count << "\n";
+	}
+}
 
-			// Track best word frequency
-			wordFrequency[best_word]++;
-		}
+/// <summary>
+/// The n most frequent best words, by decreasing count and then alphabetically.
+/// </summary>
+std::vector<std::pair<std::string, uint64_t>> OverlapStatistics::topWords(size_t n) const
+{
+	// The top n of the union is within the top n of the counter plus the few other words
+	std::vector<std::pair<std::string, uint64_t>> words;
+	for (const auto& [code, count] : wordCounts.top(n))
+	{
+		words.emplace_back(KmerCounter::decode(code, wordCounts.k()), count);
+	}
+	for (const auto& [word, count] : otherWords)
+	{
+		words.emplace_back(word, count);
 	}
 
-	return overlaps;
+	std::sort(words.begin(), words.end(), [](const auto& a, const auto& b)
+		{
+			return a.second != b.second ? a.second > b.second : a.first < b.first;
+		});
+	if (words.size() > n)
+	{
+		words.resize(n);
+	}
+	return words;
 }
 
 /// <summary>
@@ -291,7 +784,7 @@ void saveIsochoresToCsv(std::vector<Isochore> isochores, size_t window_size, dou
 		+ std::to_string(gc_threshold) + ".csv";
 
 
-	std::ofstream csv_file(fileName);
+	CsvWriter csv_file(fileName);
 	if (csv_file.is_open())
 	{
 		csv_file << "Start,End,GC_Content\n"; // CSV header
@@ -354,7 +847,8 @@ vector<Isochore> loadIsochores(const string& filename)
 // ---- 2. Save Overlaps to CSV ----
 void saveOverlapsToCSV(const string& filename, const vector<Overlap>& overlaps)
 {
-	ofstream file(filename);
+	TRACE_SCOPE("save overlaps");
+	CsvWriter file(filename);
 
 	if (!file.is_open())
 	{
@@ -367,14 +861,7 @@ void saveOverlapsToCSV(const string& filename, const vector<Overlap>& overlaps)
 
 	// Write data
 	for (const auto& o : overlaps) {
-		file << o.isochore_start << ","
-			<< o.isochore_end << ","
-			<< o.isochore_gc << ","
-			<< o.segment_start << ","
-			<< o.segment_end << ","
-			<< o.segment_cost << ","
-			<< o.best_word << ","
-			<< o.overlap_length << "\n";
+		writeOverlapRow(file, o);
 	}
 
 	file.close();
@@ -457,49 +944,32 @@ int calculateGCContent(const char* arr, uint64_t pos, uint64_t windowSize)
 	return  gcCount;
 }
 
-// Function to calculate GC and CG pairs in a given sequence
-std::pair<double, size_t> calculate_gc_pairs(const std::string& sequence)
-{
-	size_t gc_count = 0; // Count of GC and CG pairs
-	size_t total_pairs = 0; // Total pairs in the sequence
-
-	for (size_t i = 0; i < sequence.length() - 1; ++i)
-	{
-		if ((sequence[i] == 'G' && sequence[i + 1] == 'C') ||
-			(sequence[i] == 'C' && sequence[i + 1] == 'G'))
-		{
-			gc_count++;
-		}
-		total_pairs++;
-	}
-
-	return { static_cast<double>(gc_count), total_pairs };
-}
-
 std::vector<Isochore> detect_isochores(const std::string& dna_sequence, size_t window_size, double gc_threshold)
 {
 	std::vector<Isochore> isochores;
 	size_t length = dna_sequence.length();
-	std::thread progressThread(updateProgress);
-
-
-	// Initialize GC pairs count for the first window
-	auto [gc_count, total_pairs] = calculate_gc_pairs(dna_sequence.substr(0, window_size));
+	if (window_size == 0 || window_size > length)
+	{
+		return isochores; // No full window to score
+	}
+	ProgressReporter progress(length - window_size);
 
 
+	// Count the pairs of the first window, then slide one base at a time
+	DinucleotideCounts counts = countDinucleotides(dna_sequence, 0, window_size);
+	double total_pairs = static_cast<double>(window_size - 1); // Total pairs in the window
 
 	for (size_t i = 0; i <= length - window_size; ++i)
 	{
-		// Update progress every 1000 iterations to reduce mutex locking
+		// Update progress every 1000 iterations
 		if (i % 1000 == 0)
 		{
-			std::lock_guard<std::mutex> lock(isochoreMtx);
-			isochoreProgress = i; // Update progress
-			isochoreTotalsize = length - window_size;
+			progress.set(i); // Update progress
 		}
 
 
 		// Calculate GC content for the current window
+		uint64_t gc_count = counts.pairs[DINUCLEOTIDE_CG] + counts.pairs[DINUCLEOTIDE_GC];
 		double gc_content = (total_pairs > 0) ? (gc_count / total_pairs) : 0.0;
 
 
@@ -517,35 +987,20 @@ std::vector<Isochore> detect_isochores(const std::string& dna_sequence, size_t w
 			}
 		}
 
-		// Slide the window: update GC pairs count
+		// Slide the window: the pair at i leaves, the pair ending at i + window_size enters
 		if (i + window_size < length) // Ensure we don't go out of bounds
 		{
-			// Remove the pair going out of the window
-			if (dna_sequence[i] == 'G' && dna_sequence[i + 1] == 'C')
-				gc_count--;
-			else if (dna_sequence[i] == 'C' && dna_sequence[i + 1] == 'G')
-				gc_count--;
-
-			// Add the new pair coming into the window
-			if (dna_sequence[i + window_size - 1] == 'G' && dna_sequence[i + window_size] == 'C')
-				gc_count++;
-			else if (dna_sequence[i + window_size - 1] == 'C' && dna_sequence[i + window_size] == 'G')
-				gc_count++;
-
-			// Update total pairs (only if the window is valid)
-			total_pairs = window_size - 1; // Total pairs in the window
+			counts.remove(dna_sequence, 0, 0, i, i + 1);
+			counts.add(dna_sequence, 0, 0, i + window_size - 1, i + window_size);
 		}
 	}
 
-	// Stop the progress thread
-	isochoreRunning = false;
-	progressThread.join(); // Wait for the progress thread to finish
 	return isochores;
 }
 
 void detect_isochores(const std::string& genomeSequence, const std::string& OutputFolder)
 {
-	std::thread progressThread(updateProgress);
+	ProgressReporter progress(genomeSequence.size());
 	int gcContentCount = calculateGCContent(genomeSequence.c_str(), 0, WINDOW_SIZE);
 
 	std::string fileName = OutputFolder + "isochores_"
@@ -564,12 +1019,10 @@ void detect_isochores(const std::string& genomeSequence, const std::string& Outp
 		int gcContent = (gcContentCount * 100) / WINDOW_SIZE;
 
 
-		// Update progress every 1000 iterations to reduce mutex locking
+		// Update progress every 1000 iterations
 		if (i % 1000 == 0)
 		{
-			std::lock_guard<std::mutex> lock(isochoreMtx);
-			isochoreProgress = i; // Update progress
-			isochoreTotalsize = genomeSequence.size();
+			progress.set(i); // Update progress
 		}
 
 		//part of the C++ standard library and cross-platform
@@ -578,16 +1031,13 @@ void detect_isochores(const std::string& genomeSequence, const std::string& Outp
 		csv_file << buf;
 
 	}
-	// Stop the progress thread
-	isochoreRunning = false;
-	progressThread.join(); // Wait for the progress thread to finish
 }
 
 // Function to detect isochores
 std::vector<Isochore> detect_isochores(const std::string& genomeSequence)
 {
 	std::vector<Isochore> isochores;
-	std::thread progressThread(updateProgress);
+	ProgressReporter progress(genomeSequence.size());
 	int gcContentCount = calculateGCContent(genomeSequence.c_str(), 0, WINDOW_SIZE);
 	int gcContent = (gcContentCount * 100) / WINDOW_SIZE;
 	Isochore iso;
@@ -612,12 +1062,10 @@ std::vector<Isochore> detect_isochores(const std::string& genomeSequence)
 		gcContent = (gcContentCount * 100) / WINDOW_SIZE;
 
 
-		// Update progress every 1000 iterations to reduce mutex locking
+		// Update progress every 1000 iterations
 		if (i % 1000 == 0)
 		{
-			std::lock_guard<std::mutex> lock(isochoreMtx);
-			isochoreProgress = i; // Update progress
-			isochoreTotalsize = genomeSequence.size();
+			progress.set(i); // Update progress
 		}
 
 		// part of the C++ standard library and cross-platform
@@ -625,9 +1073,6 @@ std::vector<Isochore> detect_isochores(const std::string& genomeSequence)
 		csv_file << buf;
 
 	}
-	// Stop the progress thread
-	isochoreRunning = false;
-	progressThread.join(); // Wait for the progress thread to finish
 	return isochores;
 }
 
@@ -649,67 +1094,163 @@ double calculateGCContent2(const std::string& sequence)
 	return totalCount > 0 ? (gcCount * 100.0 / totalCount) : 0.0;
 }
 
-// Function to process FASTA file and compute GC content
+// Function to process FASTA file and compute GC content of consecutive windows
 void processFASTA2(const std::string& filename, int windowSize, const std::string& outputCSV) {
-	std::ifstream file(filename);
-	std::ofstream outputFile(outputCSV);
-
-	if (!file.is_open() || !outputFile.is_open()) {
-		std::cerr << "Error opening file!" << std::endl;
-		return;
-	}
+	streamGcWindows(filename, windowSize, windowSize, outputCSV);
+}
 
-	std::string line, sequence = "";
-	long long position = 0;
-	isochoreTotalsize = 0;
+// Ring buffer flags of a streamed base
+const uint8_t STREAM_BASE_GC = 1;
+const uint8_t STREAM_BASE_UNKNOWN = 2;
 
-	// Compute total genome size
-	while (getline(file, line)) {
-		if (!line.empty() && line[0] != '>') { // Ignore headers
-			isochoreTotalsize += line.size();
-		}
+/// <summary>
+/// Scans the GC content of sliding windows over every record of a (multi-)FASTA file in a single
+/// streaming pass. Only a ring buffer of one window is held in memory, coordinates restart at 0
+/// for every record and progress is measured in bytes of the file. Bases are read the way
+/// load_fasta_file reads them: characters other than letters are skipped, lowercase bases count as
+/// their uppercase base, and letters other than A, C, G and T are unknown. GC is normalized over
+/// the valid bases of the window, as in the window scan.
+/// </summary>
+/// <param name="filename">Path to the FASTA file.</param>
+/// <param name="windowSize">Size of the sliding window.</param>
+/// <param name="stepSize">Step size to slide the window.</param>
+/// <param name="outputCSV">CSV file receiving one row (record, start, end, GC) per window.</param>
+/// <returns>Number of windows written, or 0 when a file could not be opened.</returns>
+uint64_t streamGcWindows(const std::string& filename, uint64_t windowSize, uint64_t stepSize, const std::string& outputCSV)
+{
+	if (windowSize == 0 || stepSize == 0)
+	{
+		std::cerr << "Error: Window and step size must be positive" << std::endl;
+		return 0;
 	}
-	file.clear();
-	file.seekg(0, std::ios::beg); // Reset file pointer
-
-	// Write CSV Header
-	outputFile << "Position,GC_Content\n";
 
-	// Start progress tracking thread
-	std::thread progressThread(updateProgress);
-
-	while (getline(file, line)) {
-		if (line.empty()) continue;
-		if (line[0] == '>') continue; // Skip header
-
-		sequence += line; // Append sequence data
+	std::ifstream file(filename, std::ios::binary);
+	CsvWriter outputFile(outputCSV);
+	if (!file.is_open() || !outputFile.is_open()) {
+		std::cerr << "Error opening file!" << std::endl;
+		return 0;
+	}
 
-		while (sequence.size() >= static_cast<size_t>(windowSize))
+	// Flags of every letter; other characters are skipped before the lookup
+	static const std::array<uint8_t, 256> baseFlags = []
 		{
-			std::string window = sequence.substr(0, windowSize);
-			double gcContent = calculateGCContent(window);
-
-			outputFile << position << "," << gcContent << "\n";
-
-			position += windowSize;
+			std::array<uint8_t, 256> flags;
+			flags.fill(STREAM_BASE_UNKNOWN);
+			for (char base : { 'A', 'T', 'a', 't' }) flags[static_cast<unsigned char>(base)] = 0;
+			for (char base : { 'G', 'C', 'g', 'c' }) flags[static_cast<unsigned char>(base)] = STREAM_BASE_GC;
+			return flags;
+		}();
+
+	std::error_code error;
+	uint64_t fileSize = fs::file_size(filename, error);
+	ProgressReporter progress((error || fileSize == 0) ? 1 : fileSize);
+
+	outputFile << "Record,Start,End,GC_Content\n";
+
+	const int precision = defaultCsvPrecision();
+	std::vector<uint8_t> ring(windowSize);
+	std::vector<char> block(1 << 20);
+	std::string record;            // Name of the current record
+	std::string line;              // Formatted row
+	bool atLineStart = true;
+	bool inHeader = false;
+	bool nameComplete = false;
+	uint64_t position = 0;         // Bases of the current record read so far
+	size_t ringPos = 0;            // Ring slot of the next base
+	uint64_t nextWindowEnd = windowSize;
+	uint64_t gcCount = 0;
+	uint64_t unknownCount = 0;
+	uint64_t windowCount = 0;
+
+	while (file)
+	{
+		file.read(block.data(), block.size());
+		std::streamsize bytes = file.gcount();
+		for (std::streamsize i = 0; i < bytes; ++i)
+		{
+			char c = block[i];
+			if (c == '\n' || c == '\r')
+			{
+				atLineStart = true;
+				inHeader = false;
+				continue;
+			}
+			if (atLineStart && c == '>')
+			{
+				// A new record restarts the coordinates and the window
+				inHeader = true;
+				nameComplete = false;
+				record.clear();
+				position = 0;
+				ringPos = 0;
+				nextWindowEnd = windowSize;
+				gcCount = 0;
+				unknownCount = 0;
+				atLineStart = false;
+				continue;
+			}
+			atLineStart = false;
+			if (inHeader)
+			{
+				// The record name ends at the first whitespace of the header
+				if (std::isspace(static_cast<unsigned char>(c)))
+				{
+					nameComplete = true;
+				}
+				else if (!nameComplete)
+				{
+					record += c;
+				}
+				continue;
+			}
+			if (!std::isalpha(static_cast<unsigned char>(c)))
+			{
+				continue; // Skipped like load_fasta_file skips them, so positions match a loaded sequence
+			}
 
-			// Update progress
+			// Once the window is full, the base leaving it is in the slot the new base takes
+			uint8_t flags = baseFlags[static_cast<unsigned char>(c)];
+			if (position >= windowSize)
 			{
-				std::lock_guard<std::mutex> lock(isochoreMtx);
-				isochoreProgress += windowSize;
+				gcCount -= ring[ringPos] & STREAM_BASE_GC;
+				unknownCount -= (ring[ringPos] & STREAM_BASE_UNKNOWN) >> 1;
 			}
+			ring[ringPos] = flags;
+			gcCount += flags & STREAM_BASE_GC;
+			unknownCount += (flags & STREAM_BASE_UNKNOWN) >> 1;
+			ringPos = (ringPos + 1 == windowSize) ? 0 : ringPos + 1;
+			++position;
 
-			sequence = sequence.substr(windowSize);
+			if (position == nextWindowEnd)
+			{
+				double gcPercentage = (unknownCount < windowSize)
+					? (gcCount / static_cast<double>(windowSize - unknownCount)) * 100.0
+					: 0.0;
+
+				line.clear();
+				line += record;
+				line += ',';
+				appendCsvInteger(line, position - windowSize);
+				line += ',';
+				appendCsvInteger(line, position);
+				line += ',';
+				appendCsvDouble(line, gcPercentage, precision);
+				line += '\n';
+				outputFile << line;
+
+				nextWindowEnd += stepSize;
+				++windowCount;
+			}
 		}
+
+		progress.add(static_cast<uint64_t>(bytes));
 	}
 
-	// Stop progress thread
-	isochoreRunning = false;
-	progressThread.join();
+	progress.stop();
 
-	file.close();
 	outputFile.close();
 	std::cout << "\nProcessing complete! Output saved in " << outputCSV << std::endl;
+	return windowCount;
 }
 
 // Function to process the DNA sequence
@@ -722,13 +1263,12 @@ void processSequence(const std::string& sequence, int windowSize, const std::str
 	}
 
 	long long position = 0;
-	isochoreTotalsize = sequence.size(); // Set total size for progress tracking
 
 	// Write CSV Header
 	outputFile << "Position,GC_Content\n";
 
-	// Start progress tracking thread
-	std::thread progressThread(updateProgress);
+	// Start progress tracking
+	ProgressReporter progress(sequence.size());
 
 	for (size_t i = 0; i + windowSize <= sequence.size(); i += windowSize) {
 		std::string window = sequence.substr(i, windowSize);
@@ -738,15 +1278,10 @@ void processSequence(const std::string& sequence, int windowSize, const std::str
 		position += windowSize;
 
 		// Update progress
-		{
-			std::lock_guard<std::mutex> lock(isochoreMtx);
-			isochoreProgress = position;
-		}
+		progress.set(position);
 	}
 
-	// Stop progress thread
-	isochoreRunning = false;
-	progressThread.join();
+	progress.stop();
 
 	outputFile.close();
 	std::cout << "\nProcessing complete! Output saved in " << outputCSV << std::endl;
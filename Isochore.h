@@ -2,15 +2,22 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <iomanip>
 #include <mutex>
 #include <cinttypes>
 #include <filesystem>
+#include <functional>
 #include <map>
+#include <algorithm>
 #include <thread>
 #include <chrono> 
 #include <cstdio>
+#include "File_DNA.h"
+#include "BitPlane.h"
+#include "GcRankIndex.h"
+#include "KmerCounter.h"
 using namespace std;
 namespace fs = std::filesystem;
 
@@ -19,13 +26,54 @@ namespace fs = std::filesystem;
 #pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
 #endif
 
+// Isochore families by GC content: L1 < 37%, L2 37-41%, H1 41-46%, H2 46-53%, H3 > 53%
+enum class IsochoreFamily
+{
+    Unclassified,
+    L1,
+    L2,
+    H1,
+    H2,
+    H3
+};
+
 struct Isochore
 {
     size_t start;
     size_t end;
     double gc_content;
+    IsochoreFamily family = IsochoreFamily::Unclassified;
 };
 
+class IsochoreBoundaryDetector;
+class GcPyramidBuilder;
+
+/// <summary>
+/// Optional inputs and consumers of the sliding window GC scan.
+/// </summary>
+struct IsochoreScanOptions
+{
+    const BitPlaneSequence* planes = nullptr;        // Count windows with popcount on bitplanes
+    const GcRankIndex* index = nullptr;              // Answer every window from the rank index; takes precedence over planes
+    IsochoreBoundaryDetector* boundaries = nullptr;  // Receives every window in sequence order
+    std::function<void(uint64_t, uint64_t, double, bool)> onWindow = nullptr; // Also receives every window in sequence order (start, end, GC, valid)
+    GcPyramidBuilder* pyramid = nullptr;             // Receives the finest bins, counted by the task that scans them
+};
+
+/// <summary>
+/// Classifies a GC percentage into its isochore family.
+/// </summary>
+/// <param name="gcContent">GC content in percent.</param>
+/// <returns>The family whose GC range contains the value.</returns>
+IsochoreFamily classifyIsochoreFamily(double gcContent);
+
+/// <summary>
+/// Gets the name of an isochore family ("L1" .. "H3", or "-" when unclassified).
+/// </summary>
+/// <param name="family">The family.</param>
+/// <returns>The short family name.</returns>
+const char* isochoreFamilyName(IsochoreFamily family);
+
 // Struct for Overlap Result
 struct Overlap
 {
@@ -51,7 +99,9 @@ const uint64_t STEP_SIZE = 10;     // ~1kb steps for precise boundaries detectio
 /// <param name="OutputFolder">Folder to save output files.</param>
 /// <param name="windowSize">Size of the sliding window.</param>
 /// <param name="stepSize">Step size to slide the window.</param>
-void detect_isochores_optimized(const std::string& genomeSequence, const std::string& OutputFolder, uint64_t windowSize, uint64_t stepSize);
+/// <param name="scan">Optional bitplanes, rank index and boundary detector used by the scan.</param>
+void detect_isochores_optimized(std::string_view genomeSequence, const std::string& OutputFolder, uint64_t windowSize, uint64_t stepSize,
+	const IsochoreScanOptions& scan = {});
 
 /// <summary>
 /// Runs the isochore detection in a separate thread and tracks progress.
@@ -60,9 +110,38 @@ void detect_isochores_optimized(const std::string& genomeSequence, const std::st
 /// <param name="outputFolder">Folder to save output files.</param>
 /// <param name="windowSize">Size of the sliding window.</param>
 /// <param name="stepSize">Step size to slide the window.</param>
-void runIsochoreDetection(const std::string& genomeSequence,
+/// <param name="scan">Optional bitplanes, rank index and boundary detector used by the scan.</param>
+void runIsochoreDetection(std::string_view genomeSequence,
     const std::string& outputFolder,
-    uint64_t windowSize, uint64_t stepSize);
+    uint64_t windowSize, uint64_t stepSize, const IsochoreScanOptions& scan = {});
+
+/// <summary>
+/// Detects isochore windows only inside the given contigs. The windows are cut into chunks that
+/// are formatted in parallel and written in sequence order by a writer thread; the output is
+/// identical to a serial scan of each contig.
+/// </summary>
+/// <param name="genomeSequence">The DNA sequence to analyze.</param>
+/// <param name="contigs">Contigs to scan, in sequence order.</param>
+/// <param name="OutputFolder">Folder to save output files.</param>
+/// <param name="windowSize">Size of the sliding window.</param>
+/// <param name="stepSize">Step size to slide the window.</param>
+/// <param name="scan">Optional bitplanes, rank index and boundary detector used by the scan.</param>
+void detect_isochores_in_contigs(std::string_view genomeSequence, const std::vector<SequenceInterval>& contigs,
+	const std::string& OutputFolder, uint64_t windowSize, uint64_t stepSize, const IsochoreScanOptions& scan = {});
+
+/// <summary>
+/// Runs the contig-aware isochore detection and tracks progress.
+/// </summary>
+/// <param name="genomeSequence">The DNA sequence to analyze.</param>
+/// <param name="contigs">Contigs to scan, in sequence order.</param>
+/// <param name="outputFolder">Folder to save output files.</param>
+/// <param name="windowSize">Size of the sliding window.</param>
+/// <param name="stepSize">Step size to slide the window.</param>
+/// <param name="scan">Optional bitplanes, rank index and boundary detector used by the scan.</param>
+void runIsochoreDetectionInContigs(std::string_view genomeSequence,
+	const std::vector<SequenceInterval>& contigs,
+	const std::string& outputFolder,
+	uint64_t windowSize, uint64_t stepSize, const IsochoreScanOptions& scan = {});
 
 /// <summary>
 /// Saves isochores to a CSV file.
@@ -80,17 +159,33 @@ void saveIsochoresToCsv(std::vector<Isochore> isochores, size_t window_size, dou
 vector<Isochore> loadIsochores(const string& filename);
 
 
+/// <summary>
+/// Adds the GC and GA content of its range to one segment, as mergeSegmentsWithGCContent does.
+/// </summary>
+/// <param name="sequence">The full DNA sequence as a string.</param>
+/// <param name="segment">The segment (start, end, cost, best word).</param>
+/// <param name="planes">Bitplanes of the sequence, or nullptr to count the characters directly.</param>
+/// <param name="index">GC rank index of the sequence, or nullptr; takes precedence over planes.</param>
+/// <returns>The segment with its GC and GA percentages.</returns>
+std::tuple<uint64_t, uint64_t, double, std::string, double, double> segmentWithGCContent(
+    std::string_view sequence,
+    const std::tuple<uint64_t, uint64_t, double, std::string>& segment,
+    const BitPlaneSequence* planes = nullptr, const GcRankIndex* index = nullptr);
+
 /// <summary>
 /// Merges segments with GC content calculated from the DNA sequence.
 /// </summary>
 /// <param name="sequence">The full DNA sequence as a string.</param>
 /// <param name="segments">Vector of segments (start, end, cost, best word).</param>
+/// <param name="planes">Bitplanes of the sequence, or nullptr to count the characters directly.</param>
+/// <param name="index">GC rank index of the sequence, or nullptr; answers every window in constant time and takes precedence over planes.</param>
 /// <returns>
 /// A new vector containing segments with an additional GC content field.
 /// </returns>
 std::vector<std::tuple<uint64_t, uint64_t, double, std::string, double, double>> mergeSegmentsWithGCContent(
-    const std::string& sequence,
-    const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments);
+    std::string_view sequence,
+    const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments,
+    const BitPlaneSequence* planes = nullptr, const GcRankIndex* index = nullptr);
 
 //Development section
 std::vector<Isochore> detect_isochores(const std::string& dna_sequence, size_t window_size, double gc_threshold);
@@ -101,10 +196,103 @@ std::vector<Isochore> detect_isochores(const std::string& genomeSequence);
 
 void processFASTA2(const std::string& filename, int windowSize, const std::string& outputCSV);
 
+/// <summary>
+/// Scans the GC content of sliding windows over every record of a (multi-)FASTA file in a single
+/// streaming pass. Only a ring buffer of one window is held in memory, coordinates restart at 0
+/// for every record and progress is measured in bytes of the file. Bases are read the way
+/// load_fasta_file reads them: characters other than letters are skipped, lowercase bases count as
+/// their uppercase base, and letters other than A, C, G and T are unknown. GC is normalized over
+/// the valid bases of the window, as in the window scan.
+/// </summary>
+/// <param name="filename">Path to the FASTA file.</param>
+/// <param name="windowSize">Size of the sliding window.</param>
+/// <param name="stepSize">Step size to slide the window.</param>
+/// <param name="outputCSV">CSV file receiving one row (record, start, end, GC) per window.</param>
+/// <returns>Number of windows written, or 0 when a file could not be opened.</returns>
+uint64_t streamGcWindows(const std::string& filename, uint64_t windowSize, uint64_t stepSize, const std::string& outputCSV);
+
 void processSequence(const std::string& sequence, int windowSize, const std::string& outputCSV);
 
 void detect_isochores(const std::string& genomeSequence, const std::string& OutputFolder);
 
+/// <summary>
+/// Statistics of an isochore and segment overlap join.
+/// </summary>
+struct OverlapStatistics
+{
+    int totalIsochores = 0;
+    int singleSegmentIsochores = 0; // Isochores overlapped by exactly one segment
+    double singleSegmentGCSum = 0;  // GC content summed over those isochores
+    double totalCostSum = 0;        // Segment cost summed over all overlaps
+    double maxCost = -1;
+    double minCost = 1e9;
+    uint64_t overlapCount = 0;
+    KmerCounter wordCounts;                  // Best word of every overlap, by 2-bit code
+    std::map<std::string, int> otherWords;   // Best words the counter cannot hold (other length or non-ACGT)
+
+    void addOverlap(double cost, const std::string& bestWord)
+    {
+        totalCostSum += cost;
+        maxCost = std::max(maxCost, cost);
+        minCost = std::min(minCost, cost);
+        // The first word fixes k; every segment of a run has the same word size
+        if (wordCounts.k() == 0 && !bestWord.empty() && bestWord.size() <= KMER_MAX_K)
+        {
+            wordCounts = KmerCounter(static_cast<int>(bestWord.size()));
+        }
+        if (!wordCounts.add(bestWord))
+        {
+            otherWords[bestWord]++;
+        }
+        overlapCount++;
+    }
+
+    /// <summary>
+    /// The n most frequent best words, by decreasing count and then alphabetically.
+    /// </summary>
+    std::vector<std::pair<std::string, uint64_t>> topWords(size_t n) const;
+};
+
+/// <summary>
+/// Finds the overlaps between isochores and segments with a sweep-line merge join in
+/// O(I + S + overlaps) for sorted inputs. Chunks of isochores are joined in parallel; the records
+/// and statistics come out in the same order and with the same values as comparing every
+/// isochore with every segment: isochores in input order, then segments in input order.
+/// Unsorted inputs are sorted by index first.
+/// </summary>
+/// <param name="isochores">Isochore intervals.</param>
+/// <param name="segments">Segments (start, end, cost, best word).</param>
+/// <param name="statistics">Receives the overlap statistics.</param>
+/// <returns>One record per overlapping isochore and segment pair.</returns>
+std::vector<Overlap> findIsochoreSegmentOverlap(
+    const std::vector<Isochore>& isochores,
+    const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments,
+    OverlapStatistics& statistics);
+
+/// <summary>
+/// Streaming form of the sweep-line join for inputs too large to load. Both files must be
+/// sorted by start; only the segments that can still reach the current isochore are kept in
+/// memory. The overlaps are written to a CSV file in the same format and order as
+/// saveOverlapsToCSV writes the result of findIsochoreSegmentOverlap. The statistics match too
+/// when the inputs were saved with --precision=0; rounded costs can move the averages.
+/// </summary>
+/// <param name="isochoreFile">Isochore CSV (Start,End,GC_Content,...), sorted by start.</param>
+/// <param name="segmentFile">Segment CSV (Start,End,Length,Cost,Best Word), sorted by start.</param>
+/// <param name="overlapFile">Path of the overlap CSV to write.</param>
+/// <returns>The overlap statistics.</returns>
+OverlapStatistics streamIsochoreSegmentOverlap(const std::string& isochoreFile, const std::string& segmentFile, const std::string& overlapFile);
+
+// Number of best words listed at the end of the overlap statistics
+const size_t OVERLAP_TOP_WORDS = 10;
+
+/// <summary>
+/// Saves overlap statistics with saveStatisticsToFile, deriving the averages and the most frequent word,
+/// followed by the OVERLAP_TOP_WORDS most frequent best words.
+/// </summary>
+/// <param name="filename">Path of the statistics file.</param>
+/// <param name="statistics">The statistics of an overlap join.</param>
+void saveOverlapStatistics(const std::string& filename, const OverlapStatistics& statistics);
+
 std::vector<Overlap> findIsochoreSegmentOverlap(
     const std::vector<Isochore>& isochores,
     const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments,
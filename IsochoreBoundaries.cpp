@@ -0,0 +1,167 @@
+#include "IsochoreBoundaries.h"
+#include "CsvWriter.h"
+#include "Trace.h"
+
+/// <summary>
+/// Creates a detector for windows of the given step.
+/// </summary>
+/// <param name="stepSize">Distance between consecutive window starts; a larger jump is treated as a gap.</param>
+/// <param name="minLength">Shortest isochore in bases.</param>
+/// <param name="hysteresis">GC percentage points a window may lie outside the current family before it counts as a change.</param>
+IsochoreBoundaryDetector::IsochoreBoundaryDetector(uint64_t stepSize, uint64_t minLength, double hysteresis)
+	: stepSize(stepSize), minLength(minLength), hysteresis(hysteresis)
+{
+}
+
+/// <summary>
+/// Consumes the next window of the scan.
+/// </summary>
+/// <param name="start">Window start.</param>
+/// <param name="end">Window end (exclusive).</param>
+/// <param name="gcContent">GC content of the window in percent.</param>
+/// <param name="valid">False when the window has no valid bases; it ends the current isochore like a gap.</param>
+void IsochoreBoundaryDetector::addWindow(uint64_t start, uint64_t end, double gcContent, bool valid)
+{
+	if (open && (!valid || start != lastStart + stepSize))
+	{
+		close(lastEnd);
+	}
+	lastStart = start;
+	lastEnd = end;
+	if (!valid)
+	{
+		return;
+	}
+
+	if (!open)
+	{
+		open = true;
+		isochoreStart = start;
+		gcSum = gcContent;
+		windowCount = 1;
+		return;
+	}
+
+	// Inside the band when [gc - h, gc + h] touches the range of the current family
+	IsochoreFamily family = classifyIsochoreFamily(gcSum / windowCount);
+	bool inside = classifyIsochoreFamily(gcContent - hysteresis) <= family
+		&& family <= classifyIsochoreFamily(gcContent + hysteresis);
+
+	if (inside)
+	{
+		// A short excursion belongs to the current isochore
+		if (pending)
+		{
+			gcSum += candidateGcSum;
+			windowCount += candidateWindowCount;
+			pending = false;
+		}
+		gcSum += gcContent;
+		++windowCount;
+		return;
+	}
+
+	if (!pending)
+	{
+		pending = true;
+		candidateStart = start;
+		candidateGcSum = 0.0;
+		candidateWindowCount = 0;
+	}
+	candidateGcSum += gcContent;
+	++candidateWindowCount;
+
+	if (end - candidateStart < minLength)
+	{
+		return;
+	}
+
+	if (candidateStart - isochoreStart < minLength)
+	{
+		// The current isochore is still too short to stand alone, so it absorbs the change
+		gcSum += candidateGcSum;
+		windowCount += candidateWindowCount;
+	}
+	else
+	{
+		emit(isochoreStart, candidateStart, gcSum, windowCount);
+		isochoreStart = candidateStart;
+		gcSum = candidateGcSum;
+		windowCount = candidateWindowCount;
+	}
+	pending = false;
+}
+
+/// <summary>
+/// Closes the last isochore and returns all of them, in sequence order. End positions are exclusive.
+/// </summary>
+/// <returns>The detected isochores with their mean window GC and family.</returns>
+std::vector<Isochore> IsochoreBoundaryDetector::finish()
+{
+	if (open)
+	{
+		close(lastEnd);
+	}
+	isochoreWindowCounts.clear();
+	return std::move(isochores);
+}
+
+// Ends the current isochore at the given position, pending windows included
+void IsochoreBoundaryDetector::close(uint64_t end)
+{
+	if (pending)
+	{
+		gcSum += candidateGcSum;
+		windowCount += candidateWindowCount;
+		pending = false;
+	}
+	emit(isochoreStart, end, gcSum, windowCount);
+	open = false;
+}
+
+// Appends an isochore, merging a short one into the previous isochore when they touch
+void IsochoreBoundaryDetector::emit(uint64_t start, uint64_t end, double sum, uint64_t count)
+{
+	if (end - start < minLength && !isochores.empty() && isochores.back().end == start)
+	{
+		Isochore& previous = isochores.back();
+		uint64_t previousCount = isochoreWindowCounts.back();
+		previous.gc_content = (previous.gc_content * previousCount + sum) / (previousCount + count);
+		previous.family = classifyIsochoreFamily(previous.gc_content);
+		previous.end = end;
+		isochoreWindowCounts.back() += count;
+		return;
+	}
+
+	double gcContent = sum / count;
+	isochores.push_back({ start, end, gcContent, classifyIsochoreFamily(gcContent) });
+	isochoreWindowCounts.push_back(count);
+}
+
+/// <summary>
+/// Saves isochore intervals with their families to a CSV file.
+/// </summary>
+/// <param name="isochores">The isochores.</param>
+/// <param name="filename">Path to the output CSV file.</param>
+void saveIsochoreIntervalsToCsv(const std::vector<Isochore>& isochores, const std::string& filename)
+{
+	TRACE_SCOPE("save isochore intervals");
+	CsvWriter csvFile(filename);
+	if (!csvFile.is_open())
+	{
+		std::cerr << "Error: Could not open the file " << filename << std::endl;
+		return;
+	}
+
+	csvFile << "Start,End,GC_Content,Family\n";
+	for (const auto& isochore : isochores)
+	{
+		csvFile << isochore.start << ","
+			<< isochore.end << ","
+			<< isochore.gc_content << ","
+			<< isochoreFamilyName(isochore.family) << "\n";
+	}
+
+	csvFile.close();
+	std::cout << "Isochores saved to " << filename << std::endl;
+}
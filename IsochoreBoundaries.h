@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Isochore.h"
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+// Isochores are regions of at least 300 kb with homogeneous GC content
+const uint64_t DEFAULT_MIN_ISOCHORE_LENGTH = 300000;
+const double DEFAULT_ISOCHORE_HYSTERESIS = 1.0; // GC percentage points
+
+/// <summary>
+/// Streaming change-point detector that turns the sliding window GC values into homogeneous
+/// isochore intervals. Windows are fed in sequence order as the scan produces them. A window
+/// whose GC lies more than the hysteresis outside the family range of the current isochore
+/// starts a candidate boundary. The boundary is only accepted once the deviating windows
+/// cover the minimum length, and a window back inside the band folds the candidate into the
+/// current isochore. Isochores therefore flip only on sustained changes and are never shorter
+/// than the minimum length, except where a gap or the end of the sequence cuts them.
+/// </summary>
+class IsochoreBoundaryDetector
+{
+public:
+	/// <summary>
+	/// Creates a detector for windows of the given step.
+	/// </summary>
+	/// <param name="stepSize">Distance between consecutive window starts; a larger jump is treated as a gap.</param>
+	/// <param name="minLength">Shortest isochore in bases.</param>
+	/// <param name="hysteresis">GC percentage points a window may lie outside the current family before it counts as a change.</param>
+	IsochoreBoundaryDetector(uint64_t stepSize, uint64_t minLength = DEFAULT_MIN_ISOCHORE_LENGTH,
+		double hysteresis = DEFAULT_ISOCHORE_HYSTERESIS);
+
+	/// <summary>
+	/// Consumes the next window of the scan.
+	/// </summary>
+	/// <param name="start">Window start.</param>
+	/// <param name="end">Window end (exclusive).</param>
+	/// <param name="gcContent">GC content of the window in percent.</param>
+	/// <param name="valid">False when the window has no valid bases; it ends the current isochore like a gap.</param>
+	void addWindow(uint64_t start, uint64_t end, double gcContent, bool valid);
+
+	/// <summary>
+	/// Closes the last isochore and returns all of them, in sequence order. End positions are exclusive.
+	/// </summary>
+	/// <returns>The detected isochores with their mean window GC and family.</returns>
+	std::vector<Isochore> finish();
+
+private:
+	void close(uint64_t end);
+	void emit(uint64_t start, uint64_t end, double sum, uint64_t count);
+
+	uint64_t stepSize;
+	uint64_t minLength;
+	double hysteresis;
+
+	bool open = false;           // An isochore is being extended
+	uint64_t isochoreStart = 0;  // Start of the current isochore
+	double gcSum = 0.0;          // Sum of the window GC values of the current isochore
+	uint64_t windowCount = 0;
+
+	bool pending = false;        // Windows outside the band are collecting as a candidate
+	uint64_t candidateStart = 0;
+	double candidateGcSum = 0.0;
+	uint64_t candidateWindowCount = 0;
+
+	uint64_t lastStart = 0;      // Start of the previous window
+	uint64_t lastEnd = 0;        // End of the previous window
+
+	std::vector<Isochore> isochores;
+	std::vector<uint64_t> isochoreWindowCounts; // Windows behind every emitted isochore, for merging short tails
+};
+
+/// <summary>
+/// Saves isochore intervals with their families to a CSV file.
+/// </summary>
+/// <param name="isochores">The isochores.</param>
+/// <param name="filename">Path to the output CSV file.</param>
+void saveIsochoreIntervalsToCsv(const std::vector<Isochore>& isochores, const std::string& filename);
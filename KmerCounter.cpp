@@ -0,0 +1,342 @@
+#include "KmerCounter.h"
+#include "CsvWriter.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <iostream>
+#include <stdexcept>
+
+// 2-bit code of every character, 4 for anything but uppercase A, C, G and T
+static const std::array<uint8_t, 256> KMER_BASE_CODE = []
+	{
+		std::array<uint8_t, 256> table;
+		table.fill(4);
+		table['A'] = 0;
+		table['C'] = 1;
+		table['G'] = 2;
+		table['T'] = 3;
+		return table;
+	}();
+
+// Open addressing tables start at this many slots and double when 70% full
+const size_t KMER_INITIAL_SLOTS = 1024;
+
+KmerCounter::KmerCounter(int k) : wordSize(k)
+{
+	if (k < 0 || k > KMER_MAX_K)
+	{
+		throw std::invalid_argument("k-mer size must be between 0 and " + std::to_string(KMER_MAX_K));
+	}
+	if (k > 0 && k <= KMER_DIRECT_MAX_K)
+	{
+		direct.assign(size_t{ 1 } << (2 * k), 0);
+	}
+	else if (k > 0)
+	{
+		keys.assign(KMER_INITIAL_SLOTS, EMPTY_KEY);
+		values.assign(KMER_INITIAL_SLOTS, 0);
+		slotShift = 64 - std::countr_zero(KMER_INITIAL_SLOTS);
+	}
+}
+
+bool KmerCounter::encode(std::string_view word, uint64_t& code)
+{
+	if (word.size() > KMER_MAX_K)
+	{
+		return false;
+	}
+	code = 0;
+	for (char c : word)
+	{
+		uint8_t base = KMER_BASE_CODE[static_cast<unsigned char>(c)];
+		if (base > 3)
+		{
+			return false;
+		}
+		code = (code << 2) | base;
+	}
+	return true;
+}
+
+std::string KmerCounter::decode(uint64_t code, int k)
+{
+	std::string word(k, 'A');
+	for (int i = k - 1; i >= 0; --i, code >>= 2)
+	{
+		word[i] = "ACGT"[code & 3];
+	}
+	return word;
+}
+
+// Fibonacci hashing spreads consecutive codes over the table; the top bits of the product are the
+// best mixed, so the slot is taken from them
+size_t KmerCounter::slotOf(uint64_t code) const
+{
+	size_t mask = keys.size() - 1;
+	size_t slot = static_cast<size_t>((code * 0x9E3779B97F4A7C15ull) >> slotShift);
+	while (keys[slot] != EMPTY_KEY && keys[slot] != code)
+	{
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+void KmerCounter::grow()
+{
+	std::vector<uint64_t> oldKeys = std::move(keys);
+	std::vector<uint64_t> oldValues = std::move(values);
+	keys.assign(oldKeys.size() * 2, EMPTY_KEY);
+	values.assign(oldValues.size() * 2, 0);
+	--slotShift;
+	for (size_t i = 0; i < oldKeys.size(); ++i)
+	{
+		if (oldKeys[i] != EMPTY_KEY)
+		{
+			size_t slot = slotOf(oldKeys[i]);
+			keys[slot] = oldKeys[i];
+			values[slot] = oldValues[i];
+		}
+	}
+}
+
+void KmerCounter::add(uint64_t code, uint64_t count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+	totalCount += count;
+	if (!direct.empty())
+	{
+		distinctCount += (direct[code] == 0);
+		direct[code] += count;
+		return;
+	}
+	if (code == EMPTY_KEY)
+	{
+		distinctCount += (emptyKeyCount == 0);
+		emptyKeyCount += count;
+		return;
+	}
+
+	size_t slot = slotOf(code);
+	if (keys[slot] == EMPTY_KEY)
+	{
+		if ((distinctCount + 1) * 10 > keys.size() * 7)
+		{
+			grow();
+			slot = slotOf(code);
+		}
+		keys[slot] = code;
+		++distinctCount;
+	}
+	values[slot] += count;
+}
+
+bool KmerCounter::add(std::string_view word, uint64_t count)
+{
+	uint64_t code;
+	if (static_cast<int>(word.size()) != wordSize || wordSize == 0 || !encode(word, code))
+	{
+		return false;
+	}
+	add(code, count);
+	return true;
+}
+
+uint64_t KmerCounter::count(uint64_t code) const
+{
+	if (!direct.empty())
+	{
+		return code < direct.size() ? direct[code] : 0;
+	}
+	if (code == EMPTY_KEY)
+	{
+		return emptyKeyCount;
+	}
+	if (keys.empty())
+	{
+		return 0;
+	}
+	size_t slot = slotOf(code);
+	return keys[slot] == code ? values[slot] : 0;
+}
+
+void KmerCounter::addSequence(std::string_view sequence, uint64_t start, uint64_t end)
+{
+	if (wordSize == 0)
+	{
+		return;
+	}
+	const uint64_t mask = (wordSize == KMER_MAX_K) ? ~uint64_t{ 0 } : ((uint64_t{ 1 } << (2 * wordSize)) - 1);
+	uint64_t code = 0;
+	int run = 0; // Valid bases ending at the current position, capped at k
+	for (uint64_t i = start; i < end; ++i)
+	{
+		uint8_t base = KMER_BASE_CODE[static_cast<unsigned char>(sequence[i])];
+		if (base > 3)
+		{
+			run = 0;
+			continue;
+		}
+		code = ((code << 2) | base) & mask;
+		if (run < wordSize)
+		{
+			++run;
+		}
+		if (run == wordSize)
+		{
+			add(code);
+		}
+	}
+}
+
+void KmerCounter::merge(const KmerCounter& other)
+{
+	if (other.wordSize != wordSize)
+	{
+		throw std::invalid_argument("Cannot merge k-mer counters of different k");
+	}
+	for (size_t code = 0; code < other.direct.size(); ++code)
+	{
+		add(code, other.direct[code]);
+	}
+	for (size_t i = 0; i < other.keys.size(); ++i)
+	{
+		if (other.keys[i] != EMPTY_KEY)
+		{
+			add(other.keys[i], other.values[i]);
+		}
+	}
+	add(EMPTY_KEY, other.emptyKeyCount);
+}
+
+std::vector<std::pair<uint64_t, uint64_t>> KmerCounter::entries() const
+{
+	std::vector<std::pair<uint64_t, uint64_t>> result;
+	result.reserve(distinctCount);
+	for (size_t code = 0; code < direct.size(); ++code)
+	{
+		if (direct[code] != 0)
+		{
+			result.emplace_back(code, direct[code]);
+		}
+	}
+	for (size_t i = 0; i < keys.size(); ++i)
+	{
+		if (keys[i] != EMPTY_KEY)
+		{
+			result.emplace_back(keys[i], values[i]);
+		}
+	}
+	if (emptyKeyCount != 0)
+	{
+		result.emplace_back(EMPTY_KEY, emptyKeyCount);
+	}
+	if (direct.empty())
+	{
+		std::sort(result.begin(), result.end());
+	}
+	return result;
+}
+
+std::vector<std::pair<uint64_t, uint64_t>> KmerCounter::top(size_t n) const
+{
+	auto result = entries();
+	auto byCount = [](const auto& a, const auto& b)
+		{
+			return a.second != b.second ? a.second > b.second : a.first < b.first;
+		};
+	n = std::min(n, result.size());
+	std::partial_sort(result.begin(), result.begin() + n, result.end(), byCount);
+	result.resize(n);
+	return result;
+}
+
+/// <summary>
+/// Counts the k-mers of the given ranges genome-wide. Every pool thread fills its own table
+/// from an interleaved share of the blocks, and the tables are merged pairwise in parallel.
+/// </summary>
+/// <param name="sequence">The DNA sequence.</param>
+/// <param name="ranges">Ranges to count in; k-mers never cross a range end.</param>
+/// <param name="k">Word size, 1..KMER_MAX_K.</param>
+/// <returns>The merged counts.</returns>
+KmerCounter countKmers(std::string_view sequence, const std::vector<SequenceInterval>& ranges, int k)
+{
+	if (k < 1)
+	{
+		throw std::invalid_argument("k-mer size must be at least 1");
+	}
+
+	// Blocks overlap by k - 1 bases so that every k-mer is counted by exactly one block
+	const uint64_t blockBases = uint64_t{ 1 } << 22;
+	std::vector<SequenceInterval> blocks;
+	for (const auto& range : ranges)
+	{
+		for (uint64_t start = range.start; start < range.end; start += blockBases)
+		{
+			blocks.push_back({ start, std::min(range.end, start + blockBases + k - 1) });
+		}
+	}
+
+	size_t tableCount = std::max<size_t>(1, std::min<size_t>(globalThreadPool().threadCount(), blocks.size()));
+	std::vector<KmerCounter> tables;
+	tables.reserve(tableCount);
+	for (size_t t = 0; t < tableCount; ++t)
+	{
+		tables.emplace_back(k);
+	}
+
+	ParallelFor(tableCount, [&](size_t t)
+		{
+			for (size_t b = t; b < blocks.size(); b += tableCount)
+			{
+				tables[t].addSequence(sequence, blocks[b].start, blocks[b].end);
+			}
+		});
+
+	// Tree reduction: at every round table i absorbs table i + step
+	for (size_t step = 1; step < tableCount; step *= 2)
+	{
+		ParallelFor((tableCount + 2 * step - 1) / (2 * step), [&](size_t pair)
+			{
+				size_t target = pair * 2 * step;
+				if (target + step < tableCount)
+				{
+					tables[target].merge(tables[target + step]);
+					tables[target + step] = KmerCounter(k);
+				}
+			});
+	}
+
+	return std::move(tables[0]);
+}
+
+/// <summary>
+/// Saves the n most frequent k-mers to a CSV file (Word,Count,Frequency).
+/// </summary>
+/// <param name="counter">The counts.</param>
+/// <param name="n">Number of rows.</param>
+/// <param name="filename">Path to the output CSV file.</param>
+void saveTopKmersToCsv(const KmerCounter& counter, size_t n, const std::string& filename)
+{
+	CsvWriter csvFile(filename);
+	if (!csvFile.is_open())
+	{
+		std::cerr << "Error: Could not open the file " << filename << std::endl;
+		return;
+	}
+
+	csvFile << "Word,Count,Frequency\n";
+	for (const auto& [code, count] : counter.top(n))
+	{
+		csvFile << KmerCounter::decode(code, counter.k()) << ","
+			<< count << ","
+			<< (counter.total() > 0 ? static_cast<double>(count) / counter.total() : 0.0) << "\n";
+	}
+
+	csvFile.close();
+	std::cout << "Top k-mers saved to " << filename << std::endl;
+}
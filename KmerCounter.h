@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "File_DNA.h"
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+// Largest k counted in a direct-indexed array of 4^k counters (8 MiB); larger k use open addressing
+const int KMER_DIRECT_MAX_K = 10;
+// Largest k that fits a 2-bit packed code
+const int KMER_MAX_K = 32;
+
+/// <summary>
+/// Counts k-mers keyed by their 2-bit packed code (A, C, G, T = 0..3, first base in the highest
+/// bits), so codes sort like the words themselves. Small k index a flat array directly; larger k
+/// use an open addressing table with linear probing. Counting never allocates a string.
+/// </summary>
+class KmerCounter
+{
+public:
+	/// <summary>
+	/// Creates an empty counter; k = 0 means the word size is not known yet.
+	/// </summary>
+	/// <param name="k">Word size, 0..KMER_MAX_K.</param>
+	explicit KmerCounter(int k = 0);
+
+	int k() const { return wordSize; }
+
+	/// <summary>
+	/// Packs an uppercase A/C/G/T word into its code.
+	/// </summary>
+	/// <param name="word">The word, at most KMER_MAX_K bases.</param>
+	/// <param name="code">Receives the code.</param>
+	/// <returns>False when the word is too long or has another character.</returns>
+	static bool encode(std::string_view word, uint64_t& code);
+
+	/// <summary>
+	/// Unpacks a code into its word of k bases.
+	/// </summary>
+	static std::string decode(uint64_t code, int k);
+
+	void add(uint64_t code, uint64_t count = 1);
+
+	/// <summary>
+	/// Counts a word of k bases.
+	/// </summary>
+	/// <returns>False (and nothing counted) when the word cannot be encoded or has another length.</returns>
+	bool add(std::string_view word, uint64_t count = 1);
+
+	uint64_t count(uint64_t code) const;
+
+	/// <summary>
+	/// Counts every k-mer of [start, end) made of A, C, G and T with a rolling code.
+	/// </summary>
+	void addSequence(std::string_view sequence, uint64_t start, uint64_t end);
+
+	/// <summary>
+	/// Adds the counts of another counter with the same k.
+	/// </summary>
+	void merge(const KmerCounter& other);
+
+	uint64_t distinct() const { return distinctCount; }
+	uint64_t total() const { return totalCount; }
+
+	/// <summary>
+	/// The n most frequent codes with their counts, by decreasing count and then increasing code.
+	/// </summary>
+	std::vector<std::pair<uint64_t, uint64_t>> top(size_t n) const;
+
+	/// <summary>
+	/// Every counted code with its count, in increasing code order.
+	/// </summary>
+	std::vector<std::pair<uint64_t, uint64_t>> entries() const;
+
+private:
+	static constexpr uint64_t EMPTY_KEY = ~uint64_t{ 0 }; // Free slot; only the k = 32 poly-T code equals it
+
+	size_t slotOf(uint64_t code) const;
+	void grow();
+
+	int wordSize;
+	uint64_t distinctCount = 0;
+	uint64_t totalCount = 0;
+	std::vector<uint64_t> direct;   // 4^k counters when k <= KMER_DIRECT_MAX_K
+	std::vector<uint64_t> keys;     // Open addressing keys (EMPTY_KEY = free slot)
+	std::vector<uint64_t> values;   // Counts of the keys
+	uint64_t emptyKeyCount = 0;     // Count of the code equal to EMPTY_KEY, kept outside the table
+	int slotShift = 64;             // 64 - log2 of the table size; a slot is the top bits of the hashed code
+};
+
+/// <summary>
+/// Counts the k-mers of the given ranges genome-wide. Every pool thread fills its own table
+/// from an interleaved share of the blocks, and the tables are merged pairwise in parallel.
+/// </summary>
+/// <param name="sequence">The DNA sequence.</param>
+/// <param name="ranges">Ranges to count in; k-mers never cross a range end.</param>
+/// <param name="k">Word size, 1..KMER_MAX_K.</param>
+/// <returns>The merged counts.</returns>
+KmerCounter countKmers(std::string_view sequence, const std::vector<SequenceInterval>& ranges, int k);
+
+/// <summary>
+/// Saves the n most frequent k-mers to a CSV file (Word,Count,Frequency).
+/// </summary>
+/// <param name="counter">The counts.</param>
+/// <param name="n">Number of rows.</param>
+/// <param name="filename">Path to the output CSV file.</param>
+void saveTopKmersToCsv(const KmerCounter& counter, size_t n, const std::string& filename);
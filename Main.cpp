@@ -1,18 +1,83 @@
 #include <iostream> // Required for std::cout and std::cerr
 #include <string>   // Required for std::string
 #include <cstdlib>  // Required for std::atoi
+#include <optional> // Required for std::optional
 #include "File_DNA.h"
 
 #include "Isochore.h"
 #include "Segment.h"
+#include "Spectrum.h"
+#include "GcPyramid.h"
+#include "CsvWriter.h"
+#include "IsochoreBoundaries.h"
+#include "Annotation.h"
+#include "Dinucleotide.h"
+#include "KmerCounter.h"
+#include "ThreadPool.h"
+#include "Pipeline.h"
+#include "SyntheticGenome.h"
+#include "Server.h"
+#include "GenomeImage.h"
+#include "Shard.h"
+#include "MemoryPlacement.h"
+#include "Trace.h"
+#include "Progress.h"
+#include "Tests.h"
 
 // Default values for optional parameters
 const uint64_t DEFAULT_WINDOW_SIZE = 10000; // Recommended: 50-100 kb
 const uint64_t DEFAULT_STEP_SIZE = 10;      // Recommended: ~1 kb
 
+// Optional settings passed as --name=value flags
+struct PipelineOptions
+{
+	std::string engine = "greedy"; // Segmentation engine: 'greedy' or 'optimal'
+	std::optional<double> penalty; // Per-segment penalty of the optimal engine (unset = wordSize / 2)
+	int spectrumMaxWordSize = 0;   // When set, only the periodicity spectrum for word sizes 1..N is computed
+	bool pruneLookahead = false;   // Skip greedy lookahead candidates that cannot beat the best score
+	bool skipGaps = false;         // Process only the contigs between runs of N
+	uint64_t minGapLength = DEFAULT_MIN_GAP_LENGTH; // Shortest run of N treated as an assembly gap
+	bool softMask = false;         // Keep lowercase soft-masking and report the masked fraction of segments
+	bool bitPlanes = false;        // Count windows and segments on a bitplane copy of the sequence
+	bool gcIndex = false;          // Answer window and segment GC from a persisted GC rank index
+	std::string gcIndexPath;       // Index file (empty = next to the input file)
+	bool gcPyramid = false;        // Also write the multi-resolution binary GC track
+	bool isochores = false;        // Detect isochore intervals and families from the window scan
+	uint64_t minIsochoreLength = DEFAULT_MIN_ISOCHORE_LENGTH; // Shortest isochore in bases
+	double isochoreHysteresis = DEFAULT_ISOCHORE_HYSTERESIS;  // GC points a window may stray before a boundary starts
+	bool gcStream = false;         // Only stream GC windows over every record of the file, without loading it
+	bool dinucleotides = false;    // Also write CpG observed/expected, GC skew and dinucleotide abundance tracks
+	uint64_t dinucleotideWindowSize = 0; // Window of the dinucleotide tracks (0 = the GC window size)
+	uint64_t dinucleotideStepSize = 0;   // Step of the dinucleotide tracks (0 = the GC step size)
+	int kmerSize = 0;              // When set, also count all k-mers of this size genome-wide
+	size_t kmerTopCount = 100;     // Most frequent k-mers written to the k-mer CSV
+	std::string annotationPath;    // BED or GFF3 file whose features are annotated with repeats and isochores
+	std::string annotationChrom;   // Only features on this sequence are annotated (empty = all)
+	bool pipeline = false;         // Overlap the window stages, segmentation, merge and GC content stages
+	bool generate = false;         // Only write a synthetic genome with planted repeats to the file path
+	SyntheticGenomeSettings synthetic; // Background model and planted repeats of the synthetic genome
+	std::string truthPath;         // Planted repeats the merged segments are checked against (empty = none)
+	std::string serverSocket;      // Serve the genome files on this Unix-domain socket instead of running once
+	std::string overlapStreamFiles; // Only join a saved isochore file with a saved segment file ("ISOCHORES,SEGMENTS")
+	std::string gcPyramidRegion;   // Only print the saved GC pyramid bins of this region ("START-END[:BASES_PER_PIXEL]")
+	std::string genomeImagePath;   // Shared genome image to attach to, or to publish first (empty = load into this process)
+	size_t shardCount = 0;         // Only plan a sharded run of this many shards and write its manifest
+	std::string shardManifestPath; // Manifest of the sharded run this process runs a shard of, or merges
+	bool runShard = false;         // Run one shard of the manifest into its shard directory
+	size_t shardIndex = 0;         // Shard run by this process
+	std::vector<SequenceInterval> shardContigs; // Contigs of the shard run by this process
+	bool mergeShards = false;      // Merge the outputs of every shard of the manifest
+	std::string tracePath;         // Chrome trace JSON of the timed scopes and counters (empty = no trace)
+};
+
 // Function prototypes
-void processFullDna(const std::string& filePath, int minSegmentSize, int wordSize, int lookaheadSize, uint64_t windowSize, uint64_t stepSize, const std::string& outputPath);
-void processChromosome(const std::string& filePath, int minSegmentSize, int wordSize, int lookaheadSize, uint64_t windowSize, uint64_t stepSize, const std::string& outputPath);
+void processFullDna(const std::string& filePath, int minSegmentSize, int wordSize, int lookaheadSize, uint64_t windowSize, uint64_t stepSize, const std::string& outputPath, const PipelineOptions& options);
+void processChromosome(const std::string& filePath, int minSegmentSize, int wordSize, int lookaheadSize, uint64_t windowSize, uint64_t stepSize, const std::string& outputPath, const PipelineOptions& options);
+int planShards(const std::vector<std::string>& arguments, const std::string& filePath, const std::string& inputType, int minSegmentSize, int wordSize, int lookaheadSize, uint64_t windowSize, uint64_t stepSize, const std::string& outputPath, const PipelineOptions& options);
+int mergeShards(const ShardManifest& manifest, int minSegmentSize, int wordSize, int lookaheadSize, uint64_t windowSize, uint64_t stepSize, const std::string& outputPath, const std::string& inputType, const PipelineOptions& options);
+int runOverlapStream(const std::string& files, const std::string& outputPath);
+int runGcPyramidRegion(const std::string& region, const std::string& outputPath);
+bool checkAnnotationFile(const PipelineOptions& options);
 
 // ======================== Helper Functions ========================
 void clearInputBuffer()
@@ -73,11 +138,24 @@ uint64_t getValidatedUInt(const std::string& prompt, uint64_t defaultValue)
 	}
 }
 
+// Parses a base count with an optional k, M or G suffix, e.g. 250k or 3G
+uint64_t parseBaseCount(const std::string& value)
+{
+	size_t digits = 0;
+	double count = std::stod(value, &digits);
+	std::string suffix = value.substr(digits);
+	if (suffix == "k" || suffix == "K") count *= 1e3;
+	else if (suffix == "m" || suffix == "M") count *= 1e6;
+	else if (suffix == "g" || suffix == "G") count *= 1e9;
+	else if (!suffix.empty()) throw std::invalid_argument("Unknown base count suffix: " + value);
+	return static_cast<uint64_t>(count);
+}
+
 // ======================== Help Function ========================
 void printHelp(const std::string& programName)
 {
 	std::cout << "\nUsage: " << programName
-		<< " <file_path> <inputType> <minSegmentSize> <wordSize> <lookaheadSize> [windowSize] [stepSize] [outputPath]\n"
+		<< " <file_path> <inputType> <minSegmentSize> <wordSize> <lookaheadSize> [windowSize] [stepSize] [outputPath] [--options]\n"
 		<< "\nParameters:\n"
 		<< "  file_path       - Path to the input file (FASTA format)\n"
 		<< "  inputType       - Type of input ('fullDna' or 'chromosome')\n"
@@ -92,9 +170,105 @@ void printHelp(const std::string& programName)
 		<< "  " << programName << " input_chromosome.fasta chromosome 100 5 10 50000 1000 /output/folder\n"
 		<< "\nOptions:\n"
 		<< "  -h, --help      - Display this help message\n"
+		<< "  --engine=NAME   - Segmentation engine: 'greedy' (default) or 'optimal'\n"
+		<< "  --penalty=VALUE - Per-segment penalty for the optimal engine (default = wordSize / 2; must exceed wordSize / 4)\n"
+		<< "  --spectrum=N    - Only compute the periodicity spectrum for word sizes 1..N per window\n"
+		<< "  --prune-lookahead - Bound-and-prune the greedy lookahead loop (same segments, fewer evaluations)\n"
+		<< "  --skip-gaps     - Segment and scan only the contigs between runs of N, in parallel\n"
+		<< "  --min-gap=N     - Shortest run of N treated as a gap (default = " << DEFAULT_MIN_GAP_LENGTH << ")\n"
+		<< "  --soft-mask     - Keep lowercase soft-masking and add each segment's masked fraction\n"
+		<< "  --bitplanes     - Count GC windows and segment composition with popcount on bitplanes\n"
+		<< "  --gc-index[=PATH] - Load or build a GC rank index (default <file_path>.gcidx) and query it for GC\n"
+		<< "  --gc-pyramid    - Also write gc_pyramid.bin with 1 kb, 10 kb, 100 kb and 1 Mb GC zoom levels\n"
+		<< "  --gc-pyramid-region=START-END[:BPP] - Only print the bins of the saved gc_pyramid.bin over START-END at the\n"
+		<< "                    coarsest level not wider than BPP bases (default 1); the first parameter is its folder\n"
+		<< "  --isochores[=MINLEN] - Detect isochore intervals and L1/L2/H1/H2/H3 families (default MINLEN = " << DEFAULT_MIN_ISOCHORE_LENGTH << ")\n"
+		<< "  --isochore-hysteresis=H - GC points a window may stray from its family before a boundary (default = " << DEFAULT_ISOCHORE_HYSTERESIS << ")\n"
+		<< "  --gc-stream     - Only stream GC windows over every FASTA record in one pass, with per-record coordinates\n"
+		<< "  --dinucleotides[=W[:S]] - Also write CpG o/e, GC skew and dinucleotide abundance per window (default = windowSize:stepSize)\n"
+		<< "  --kmers=K[:N]   - Also count every k-mer of size K and write the N most frequent (default N = 100)\n"
+		<< "  --annotate=FILE - Report hidden repeats and isochore class for each feature of a BED, GFF3 or GTF file\n"
+		<< "  --annotate-chrom=NAME - Only annotate features on this sequence; required when the file has several sequences\n"
+		<< "  --threads=N     - Threads shared by all parallel stages (default = all hardware threads)\n"
+		<< "  --pipeline      - Run window stages beside segmentation, and merge and GC content on segments in flight\n"
+		<< "  --generate=LEN[:SEED] - Only write a synthetic genome of LEN bases (k/M/G suffixes) to file_path,\n"
+		<< "                    with its planted repeats in <file_path>.truth.csv\n"
+		<< "  --generate-records=N  - FASTA records of the synthetic genome (default = 1)\n"
+		<< "  --generate-repeats=R  - Planted repeats per Mb (default = " << SyntheticGenomeSettings().repeatsPerMb << ")\n"
+		<< "  --generate-mutation=M - Highest substitution rate of a planted repeat (default = " << SyntheticGenomeSettings().maxMutationRate << ")\n"
+		<< "  --generate-gaps=G     - N gaps per Mb (default = " << SyntheticGenomeSettings().gapsPerMb << ")\n"
+		<< "  --generate-mask=F     - Soft-masked fraction of the synthetic genome (default = 0)\n"
+		<< "  --truth=FILE    - Check the merged segments against the planted repeats of a synthetic genome\n"
+		<< "  --overlap-stream=ISOCHORES,SEGMENTS - Only join a saved isochore interval CSV with a saved segment CSV,\n"
+		<< "                    streaming both; the first parameter is the output folder (default = .)\n"
+		<< "  --serve=SOCKET  - Keep the FASTA files given as parameters in memory and answer requests on a Unix socket\n"
+		<< "  --genome-image=PATH - Share the loaded genome and its indexes with other runs through an image file, e.g. in /dev/shm\n"
+		<< "  --huge-pages[=MODE] - Back the genome and its indexes with 'transparent' (default) or 'explicit' huge pages\n"
+		<< "  --numa[=POLICY] - Place the genome and its indexes 'interleave'd over NUMA nodes (default) or 'local' to the filling workers\n"
+		<< "  --shards=N      - Only split the contigs into N balanced shards and write <outputPath>/shards/manifest.tsv\n"
+		<< "  --run-shard=MANIFEST:K - Run shard K of a manifest into its shard directory, with the parameters of the manifest\n"
+		<< "  --merge-shards=MANIFEST - Merge the finished shards into the outputs of a single --skip-gaps run\n"
+		<< "  --no-progress   - Do not print the progress of the long stages\n"
+		<< "  --trace=FILE    - Save a Chrome/Perfetto trace of the stages and hot-path counters, and print a summary\n"
+		<< "  --self-test     - Only compare the fast paths with their reference implementations on generated sequences\n"
+		<< "  --precision=N   - Significant digits of decimal CSV values (0 to " << CSV_MAX_PRECISION << ", default = " << CSV_DEFAULT_PRECISION << ", 0 = shortest exact)\n"
 		<< std::endl;
 }
 
+/// <summary>
+/// Prints the trace summary and saves the trace when --trace was given; called on every path
+/// that returns after the trace started.
+/// </summary>
+void finishTrace(const PipelineOptions& options)
+{
+	if (!options.tracePath.empty())
+	{
+		printTraceSummary();
+		saveTrace(options.tracePath);
+	}
+}
+
+/// <summary>
+/// When the arguments run a shard or merge a sharded run, loads the manifest and puts the
+/// parameters it keeps in front of the flags given on the command line.
+/// </summary>
+/// <returns>False when the manifest could not be loaded.</returns>
+bool expandShardArguments(std::vector<std::string>& arguments, ShardManifest& manifest)
+{
+	std::string manifestPath;
+	for (const auto& arg : arguments)
+	{
+		if (arg.rfind("--run-shard=", 0) == 0)
+		{
+			manifestPath = arg.substr(12, arg.rfind(':') - 12);
+		}
+		else if (arg.rfind("--merge-shards=", 0) == 0)
+		{
+			manifestPath = arg.substr(15);
+		}
+	}
+	if (manifestPath.empty())
+	{
+		return true;
+	}
+	if (!loadShardManifest(manifestPath, manifest))
+	{
+		return false;
+	}
+
+	// Flags given here, e.g. --threads, are added to the ones of the manifest
+	std::vector<std::string> expanded = manifest.arguments;
+	for (const auto& arg : arguments)
+	{
+		if (arg.rfind("--", 0) == 0)
+		{
+			expanded.push_back(arg);
+		}
+	}
+	arguments = std::move(expanded);
+	return true;
+}
+
 // ======================== Main Function ========================
 int main(int argc, char** argv)
 {
@@ -113,24 +287,257 @@ int main(int argc, char** argv)
 		return 0;
 	}
 
+	// Compare the fast paths with their reference implementations
+	if (argc == 2 && std::string(argv[1]) == "--self-test") {
+		setProgressReporting(false);
+		return RunSelfTests(argv[0]) ? 0 : 1;
+	}
+
+	// A shard and the merge of a sharded run take their parameters from the manifest
+	std::vector<std::string> arguments(argv + 1, argv + argc);
+	ShardManifest manifest;
+	if (!expandShardArguments(arguments, manifest))
+	{
+		return 1;
+	}
+
+	// Separate --name=value flags from the positional parameters
+	PipelineOptions options;
+	std::vector<std::string> args;
+	for (const auto& arg : arguments)
+	{
+		if (arg.rfind("--", 0) != 0)
+		{
+			args.push_back(arg);
+			continue;
+		}
+
+		size_t separator = arg.find('=');
+		std::string name = arg.substr(2, separator == std::string::npos ? std::string::npos : separator - 2);
+		std::string value = (separator == std::string::npos) ? "" : arg.substr(separator + 1);
+
+		if (name == "help")
+		{
+			printHelp(argv[0]);
+			return 0;
+		}
+		else if (name == "engine") options.engine = value;
+		else if (name == "penalty") options.penalty = std::stod(value);
+		else if (name == "spectrum") options.spectrumMaxWordSize = std::atoi(value.c_str());
+		else if (name == "prune-lookahead") options.pruneLookahead = true;
+		else if (name == "skip-gaps") options.skipGaps = true;
+		else if (name == "min-gap") options.minGapLength = std::stoull(value);
+		else if (name == "soft-mask") options.softMask = true;
+		else if (name == "bitplanes") options.bitPlanes = true;
+		else if (name == "gc-pyramid") options.gcPyramid = true;
+		else if (name == "isochores")
+		{
+			options.isochores = true;
+			if (!value.empty()) options.minIsochoreLength = std::stoull(value);
+		}
+		else if (name == "isochore-hysteresis") options.isochoreHysteresis = std::stod(value);
+		else if (name == "gc-stream") options.gcStream = true;
+		else if (name == "dinucleotides")
+		{
+			options.dinucleotides = true;
+			if (!value.empty())
+			{
+				size_t colon = value.find(':');
+				options.dinucleotideWindowSize = std::stoull(value.substr(0, colon));
+				if (colon != std::string::npos) options.dinucleotideStepSize = std::stoull(value.substr(colon + 1));
+			}
+		}
+		else if (name == "kmers")
+		{
+			size_t colon = value.find(':');
+			std::string size = value.substr(0, colon);
+			size_t digits = 0;
+			try
+			{
+				options.kmerSize = std::stoi(size, &digits);
+			}
+			catch (const std::exception&)
+			{
+				options.kmerSize = 0;
+			}
+			if (digits != size.size() || options.kmerSize < 1 || options.kmerSize > KMER_MAX_K)
+			{
+				std::cerr << "Invalid value for --kmers (expected K[:N] with K from 1 to " << KMER_MAX_K << "): " << value << std::endl;
+				return 1;
+			}
+			if (colon != std::string::npos) options.kmerTopCount = std::stoull(value.substr(colon + 1));
+		}
+		else if (name == "annotate") options.annotationPath = value;
+		else if (name == "annotate-chrom") options.annotationChrom = value;
+		else if (name == "threads") setThreadPoolSize(std::stoull(value));
+		else if (name == "pipeline") options.pipeline = true;
+		else if (name == "generate")
+		{
+			options.generate = true;
+			size_t colon = value.find(':');
+			options.synthetic.length = parseBaseCount(value.substr(0, colon));
+			if (colon != std::string::npos) options.synthetic.seed = std::stoull(value.substr(colon + 1));
+		}
+		else if (name == "generate-records") options.synthetic.records = std::stoull(value);
+		else if (name == "generate-repeats") options.synthetic.repeatsPerMb = std::stod(value);
+		else if (name == "generate-mutation") options.synthetic.maxMutationRate = std::stod(value);
+		else if (name == "generate-gaps") options.synthetic.gapsPerMb = std::stod(value);
+		else if (name == "generate-mask") options.synthetic.softMaskFraction = std::stod(value);
+		else if (name == "truth") options.truthPath = value;
+		else if (name == "serve") options.serverSocket = value;
+		else if (name == "overlap-stream") options.overlapStreamFiles = value;
+		else if (name == "gc-pyramid-region") options.gcPyramidRegion = value;
+		else if (name == "genome-image") options.genomeImagePath = value;
+		else if (name == "trace") options.tracePath = value;
+		else if (name == "no-progress") setProgressReporting(false);
+		else if (name == "huge-pages" || name == "numa")
+		{
+			MemoryPlacement placement = memoryPlacement();
+			if (name == "huge-pages" && (value.empty() || value == "transparent")) placement.hugePages = HugePageMode::Transparent;
+			else if (name == "huge-pages" && value == "explicit") placement.hugePages = HugePageMode::Explicit;
+			else if (name == "numa" && (value.empty() || value == "interleave")) placement.numa = NumaPolicy::Interleave;
+			else if (name == "numa" && value == "local") placement.numa = NumaPolicy::Local;
+			else
+			{
+				std::cerr << "Invalid value for --" << name << ": " << value << std::endl;
+				return 1;
+			}
+			setMemoryPlacement(placement);
+		}
+		else if (name == "shards") options.shardCount = std::stoull(value);
+		else if (name == "run-shard")
+		{
+			size_t colon = value.rfind(':');
+			if (colon == std::string::npos)
+			{
+				std::cerr << "Invalid value for --run-shard (expected MANIFEST:K): " << value << std::endl;
+				return 1;
+			}
+			options.runShard = true;
+			options.shardManifestPath = value.substr(0, colon);
+			options.shardIndex = std::stoull(value.substr(colon + 1));
+		}
+		else if (name == "merge-shards")
+		{
+			options.mergeShards = true;
+			options.shardManifestPath = value;
+		}
+		else if (name == "precision")
+		{
+			size_t digits = 0;
+			int precision = -1;
+			try
+			{
+				precision = std::stoi(value, &digits);
+			}
+			catch (const std::exception&)
+			{
+				precision = -1;
+			}
+			if (digits != value.size() || precision < 0 || precision > CSV_MAX_PRECISION)
+			{
+				std::cerr << "Invalid value for --precision (expected 0 to " << CSV_MAX_PRECISION << "): " << value << std::endl;
+				return 1;
+			}
+			setDefaultCsvPrecision(precision);
+		}
+		else if (name == "gc-index")
+		{
+			options.gcIndex = true;
+			options.gcIndexPath = value;
+		}
+		else
+		{
+			std::cerr << "Unknown option: " << arg << std::endl;
+			printHelp(argv[0]);
+			return 1;
+		}
+	}
+
+	// Outputs that are not split by contig cannot be stitched from shards
+	bool sharded = options.shardCount > 0 || options.runShard || options.mergeShards;
+	if (sharded && (options.gcStream || options.spectrumMaxWordSize > 0 || options.gcPyramid || options.dinucleotides
+		|| options.kmerSize > 0 || options.generate || !options.serverSocket.empty() || !options.overlapStreamFiles.empty() || !options.gcPyramidRegion.empty()))
+	{
+		std::cerr << "Error: Sharded runs do not support --gc-stream, --spectrum, --gc-pyramid, --gc-pyramid-region, --dinucleotides, --kmers, --generate, --serve or --overlap-stream" << std::endl;
+		return 1;
+	}
+
+	// These modes return before the trace starts, so it would stay empty
+	if (!options.tracePath.empty() && (options.generate || !options.serverSocket.empty() || !options.overlapStreamFiles.empty()
+		|| !options.gcPyramidRegion.empty()))
+	{
+		std::cerr << "Error: --trace does not support --generate, --serve, --overlap-stream or --gc-pyramid-region" << std::endl;
+		return 1;
+	}
+
+	// Read the annotation file before the long stages, so a malformed or ambiguous file fails at once
+	if (!options.annotationPath.empty() && !checkAnnotationFile(options))
+	{
+		return 1;
+	}
+
+	// In server mode every parameter is a genome file to serve
+	if (!options.serverSocket.empty())
+	{
+		return runAnalysisServer(options.serverSocket, args);
+	}
+
+	// The streaming overlap join reads saved outputs instead of a genome
+	if (!options.overlapStreamFiles.empty())
+	{
+		return runOverlapStream(options.overlapStreamFiles, args.empty() ? "." : args[0]);
+	}
+
+	// The pyramid query reads a saved pyramid instead of a genome
+	if (!options.gcPyramidRegion.empty())
+	{
+		return runGcPyramidRegion(options.gcPyramidRegion, args.empty() ? "." : args[0]);
+	}
+
 	// Read provided parameters
-	if (argc >= 2) filePath = argv[1];
-	if (argc >= 3) inputType = argv[2];
-	if (argc >= 4) minSegmentSize = std::atoi(argv[3]);
-	if (argc >= 5) wordSize = std::atoi(argv[4]);
-	if (argc >= 6) lookaheadSize = std::atoi(argv[5]);
-	if (argc >= 7) windowSize = std::stoull(argv[6]); // Optional with default
-	if (argc >= 8) stepSize = std::stoull(argv[7]);   // Optional with default
-	if (argc == 9) outputPath = argv[8];              // Optional
+	size_t argCount = args.size();
+	if (argCount >= 1) filePath = args[0];
+	if (argCount >= 2) inputType = args[1];
+	if (argCount >= 3) minSegmentSize = std::atoi(args[2].c_str());
+	if (argCount >= 4) wordSize = std::atoi(args[3].c_str());
+	if (argCount >= 5) lookaheadSize = std::atoi(args[4].c_str());
+	if (argCount >= 6) windowSize = std::stoull(args[5]); // Optional with default
+	if (argCount >= 7) stepSize = std::stoull(args[6]);   // Optional with default
+	if (argCount == 8) outputPath = args[7];              // Optional
 
 	// Ask for missing required values
 	if (filePath.empty()) filePath = getValidatedString("Enter file path: ");
-	if (inputType != "fullDna" && inputType != "chromosome") {
+	if (options.generate)
+	{
+		std::cout << "\n=== Synthetic Genome ===\n";
+		std::cout << "File Path: " << filePath << std::endl;
+		std::cout << "Length: " << options.synthetic.length << std::endl;
+		std::cout << "Seed: " << options.synthetic.seed << std::endl;
+		generateSyntheticGenome(options.synthetic, filePath, filePath + ".truth.csv");
+		return 0;
+	}
+	if (!options.gcStream && inputType != "fullDna" && inputType != "chromosome") {
 		inputType = getValidatedString("Enter input type ('fullDna' or 'chromosome'): ");
 	}
-	if (minSegmentSize == 0) minSegmentSize = getValidatedInt("Enter minimum segment size: ");
-	if (wordSize == 0) wordSize = getValidatedInt("Enter word size: ");
-	if (lookaheadSize == 0) lookaheadSize = getValidatedInt("Enter lookahead size: ");
+	if (options.spectrumMaxWordSize == 0 && !options.gcStream)
+	{
+		if (minSegmentSize == 0) minSegmentSize = getValidatedInt("Enter minimum segment size: ");
+		if (wordSize == 0) wordSize = getValidatedInt("Enter word size: ");
+		if (lookaheadSize == 0) lookaheadSize = getValidatedInt("Enter lookahead size: ");
+	}
+	if (options.engine != "greedy" && options.engine != "optimal")
+	{
+		std::cerr << "Unknown segmentation engine: " << options.engine << std::endl;
+		return 1;
+	}
+	if (!options.penalty) options.penalty = wordSize / 2.0;
+	// Below wordSize / 4 every extra boundary pays for itself and the optimal engine cuts minimum-length segments
+	if (*options.penalty <= wordSize / 4.0)
+	{
+		std::cerr << "Error: --penalty must be greater than wordSize / 4 (" << wordSize / 4.0 << "), got " << *options.penalty << std::endl;
+		return 1;
+	}
 	if (outputPath.empty()) outputPath = getValidatedString("Enter output path (or press Enter to skip): ");
 
 	// Output the received parameters for verification
@@ -142,39 +549,671 @@ int main(int argc, char** argv)
 	std::cout << "Lookahead Size: " << lookaheadSize << std::endl;
 	std::cout << "Window Size: " << windowSize << std::endl;
 	std::cout << "Step Size: " << stepSize << std::endl;
+	std::cout << "Segmentation Engine: " << options.engine << std::endl;
+	if (!options.tracePath.empty())
+	{
+		startTrace();
+	}
+	if (memoryPlacementEnabled())
+	{
+		std::cout << "Memory Placement: " << describeMemoryPlacement() << std::endl;
+	}
+
+	if (options.shardCount > 0)
+	{
+		int result = planShards(arguments, filePath, inputType, minSegmentSize, wordSize, lookaheadSize, windowSize, stepSize, outputPath, options);
+		finishTrace(options);
+		return result;
+	}
+	if (options.mergeShards)
+	{
+		int result = mergeShards(manifest, minSegmentSize, wordSize, lookaheadSize, windowSize, stepSize, outputPath, inputType, options);
+		finishTrace(options);
+		return result;
+	}
+	if (options.runShard)
+	{
+		if (options.shardIndex >= manifest.shards.size())
+		{
+			std::cerr << "Error: Shard " << options.shardIndex << " does not exist; the manifest has " << manifest.shards.size() << " shards" << std::endl;
+			return 1;
+		}
+
+		// A shard writes into its own directory and is only marked done once every output is complete
+		options.skipGaps = true;
+		options.shardContigs = manifest.shards[options.shardIndex];
+		outputPath = shardDirectory(options.shardManifestPath, options.shardIndex);
+		fs::create_directories(outputPath);
+		fs::remove(fs::path(outputPath) / SHARD_DONE_FILE);
+	}
 
-	if (inputType == "fullDna")
+	if (options.gcStream)
 	{
-		processFullDna(filePath, minSegmentSize, wordSize, lookaheadSize, windowSize, stepSize, outputPath);
+		std::string streamFileName = (fs::path(outputPath) /
+			("gc_stream_" + std::to_string(windowSize) + "_" + std::to_string(stepSize) + ".csv")).string();
+		uint64_t windowCount = streamGcWindows(filePath, windowSize, stepSize, streamFileName);
+		std::cout << "Number of streamed GC windows is : " << windowCount << std::endl;
+	}
+	else if (inputType == "fullDna")
+	{
+		processFullDna(filePath, minSegmentSize, wordSize, lookaheadSize, windowSize, stepSize, outputPath, options);
 	}
 	else
 	{
-		processChromosome(filePath, minSegmentSize, wordSize, lookaheadSize, windowSize, stepSize, outputPath);
+		processChromosome(filePath, minSegmentSize, wordSize, lookaheadSize, windowSize, stepSize, outputPath, options);
+	}
+
+	finishTrace(options);
+
+	if (options.runShard && !markShardDone(outputPath, shardFingerprint(manifest, options.shardIndex)))
+	{
+		return 1;
 	}
 
 	return 0;
 }
 
 // ======================== Sample Processing Functions ========================
-void processFullDna(const std::string& filePath, int minSegmentSize, int wordSize, int lookaheadSize, uint64_t windowSize, uint64_t stepSize, const std::string& outputPath)
+
+/// <summary>
+/// Computes the periodicity spectrum of the sequence and prints the mean score of every period.
+/// </summary>
+void runPeriodicitySpectrum(std::string_view sequence, uint64_t windowSize, uint64_t stepSize, const std::string& outputPath, const PipelineOptions& options)
+{
+	std::string spectrumFileName = (fs::path(outputPath) /
+		("spectrum_output_" + std::to_string(options.spectrumMaxWordSize) + "_" + std::to_string(windowSize) + "_" + std::to_string(stepSize) + ".csv")).string();
+
+	std::cout << "Periodicity spectrum started for word sizes 1.." << options.spectrumMaxWordSize << std::endl;
+	auto meanScores = CalculatePeriodicitySpectrum(sequence, options.spectrumMaxWordSize, windowSize, stepSize, spectrumFileName);
+
+	for (size_t k = 0; k < meanScores.size(); ++k)
+	{
+		std::cout << "Word size " << (k + 1) << " mean score : " << meanScores[k] << std::endl;
+	}
+	std::cout << "Spectrum saved successfully!: " << spectrumFileName << std::endl;
+}
+
+void reportIsochores(const std::vector<Isochore>& isochores, uint64_t windowSize, uint64_t stepSize, const std::string& outputPath);
+
+/// <summary>
+/// Runs the sliding window GC scan and, when requested, detects isochore intervals from the
+/// windows as they are written and saves them with their families.
+/// </summary>
+/// <returns>The detected isochores, or an empty vector when detection is off.</returns>
+std::vector<Isochore> scanIsochores(std::string_view sequence, const std::vector<SequenceInterval>& contigs, uint64_t windowSize, uint64_t stepSize, const std::string& outputPath, IsochoreScanOptions scan, const PipelineOptions& options)
+{
+	IsochoreBoundaryDetector boundaries(stepSize, options.minIsochoreLength, options.isochoreHysteresis);
+
+	// A shard keeps its exact windows instead, so the merge detects isochores across shard boundaries
+	std::unique_ptr<ShardWindowWriter> shardWindows;
+	if (options.isochores && options.runShard)
+	{
+		shardWindows = std::make_unique<ShardWindowWriter>((fs::path(outputPath) / SHARD_WINDOWS_FILE).string());
+		scan.onWindow = [&shardWindows](uint64_t start, uint64_t end, double gcContent, bool valid)
+			{
+				shardWindows->add(start, end, gcContent, valid);
+			};
+	}
+	else if (options.isochores)
+	{
+		scan.boundaries = &boundaries;
+	}
+
+	if (options.skipGaps)
+	{
+		runIsochoreDetectionInContigs(sequence, contigs, outputPath, windowSize, stepSize, scan);
+	}
+	else
+	{
+		runIsochoreDetection(sequence, outputPath, windowSize, stepSize, scan);
+	}
+
+	if (shardWindows && !shardWindows->close())
+	{
+		throw std::runtime_error("Unable to save the GC windows of the shard.");
+	}
+	if (!options.isochores || options.runShard)
+	{
+		return {};
+	}
+
+	auto isochores = boundaries.finish();
+	reportIsochores(isochores, windowSize, stepSize, outputPath);
+	return isochores;
+}
+
+/// <summary>
+/// Prints the number of isochores of every family and saves the isochore intervals.
+/// </summary>
+void reportIsochores(const std::vector<Isochore>& isochores, uint64_t windowSize, uint64_t stepSize, const std::string& outputPath)
+{
+	std::map<std::string, size_t> familyCounts;
+	for (const auto& isochore : isochores)
+	{
+		++familyCounts[isochoreFamilyName(isochore.family)];
+	}
+
+	std::cout << "\nNumber of isochores is : " << isochores.size() << std::endl;
+	for (const auto& [family, count] : familyCounts)
+	{
+		std::cout << "  " << family << " : " << count << std::endl;
+	}
+
+	std::string isochoreFileName = (fs::path(outputPath) /
+		("isochore_intervals_" + std::to_string(windowSize) + "_" + std::to_string(stepSize) + ".csv")).string();
+	saveIsochoreIntervalsToCsv(isochores, isochoreFileName);
+}
+
+/// <summary>
+/// Joins the detected isochores with the merged segments and saves the overlaps and their statistics.
+/// </summary>
+void runOverlapStage(const std::vector<Isochore>& isochores, const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments, const std::string& outputPath, int minSegmentSize, int wordSize, int lookaheadSize)
+{
+	std::string suffix = std::to_string(minSegmentSize) + "_" + std::to_string(wordSize) + "_" + std::to_string(lookaheadSize);
+
+	OverlapStatistics statistics;
+	auto overlaps = findIsochoreSegmentOverlap(isochores, segments, statistics);
+	std::cout << "Number of isochore and segment overlaps is : " << overlaps.size() << std::endl;
+
+	saveOverlapsToCSV((fs::path(outputPath) / ("isochore_overlaps_" + suffix + ".csv")).string(), overlaps);
+	saveOverlapStatistics((fs::path(outputPath) / ("isochore_overlap_statistics_" + suffix + ".txt")).string(), statistics);
+}
+
+/// <summary>
+/// Joins an isochore interval file with a segment file saved by earlier runs, streaming both, and
+/// saves the overlaps and their statistics in the formats of runOverlapStage.
+/// </summary>
+/// <param name="files">The isochore file and the segment file, separated by a comma.</param>
+/// <param name="outputPath">Folder of the overlap and statistics files.</param>
+/// <returns>The process exit code.</returns>
+int runOverlapStream(const std::string& files, const std::string& outputPath)
+{
+	size_t comma = files.find(',');
+	if (comma == std::string::npos)
+	{
+		std::cerr << "Invalid value for --overlap-stream (expected ISOCHORES,SEGMENTS): " << files << std::endl;
+		return 1;
+	}
+	std::string isochoreFile = files.substr(0, comma);
+	std::string segmentFile = files.substr(comma + 1);
+
+	std::cout << "\n=== Streaming Overlap ===\n";
+	std::cout << "Isochores: " << isochoreFile << std::endl;
+	std::cout << "Segments: " << segmentFile << std::endl;
+	try
+	{
+		fs::create_directories(outputPath);
+		auto statistics = streamIsochoreSegmentOverlap(isochoreFile, segmentFile,
+			(fs::path(outputPath) / "isochore_overlaps_stream.csv").string());
+		std::cout << "Number of isochore and segment overlaps is : " << statistics.overlapCount << std::endl;
+		saveOverlapStatistics((fs::path(outputPath) / "isochore_overlap_statistics_stream.txt").string(), statistics);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+/// <summary>
+/// Writes the dinucleotide composition tracks of the sequence, or of its contigs when gaps are skipped.
+/// </summary>
+void runDinucleotideTracks(std::string_view sequence, const std::vector<SequenceInterval>& contigs, uint64_t windowSize, uint64_t stepSize, const std::string& outputPath, const PipelineOptions& options)
+{
+	uint64_t window = options.dinucleotideWindowSize ? options.dinucleotideWindowSize : windowSize;
+	uint64_t step = options.dinucleotideStepSize ? options.dinucleotideStepSize : stepSize;
+	std::string trackFileName = (fs::path(outputPath) /
+		("dinucleotide_output_" + std::to_string(window) + "_" + std::to_string(step) + ".csv")).string();
+
+	auto windowCount = scanDinucleotides(sequence,
+		contigs.empty() ? std::vector<SequenceInterval>{ { 0, sequence.size() } } : contigs,
+		window, step, trackFileName);
+	std::cout << "\nDinucleotide tracks of " << windowCount << " windows saved successfully!: " << trackFileName << std::endl;
+}
+
+/// <summary>
+/// Counts every k-mer of the sequence, or of its contigs when gaps are skipped, and saves the most frequent ones.
+/// </summary>
+void runKmerCounts(std::string_view sequence, const std::vector<SequenceInterval>& contigs, const std::string& outputPath, const PipelineOptions& options)
+{
+	auto counts = countKmers(sequence,
+		contigs.empty() ? std::vector<SequenceInterval>{ { 0, sequence.size() } } : contigs,
+		options.kmerSize);
+	std::cout << "\nNumber of " << options.kmerSize << "-mers is : " << counts.total()
+		<< " (" << counts.distinct() << " distinct)" << std::endl;
+
+	saveTopKmersToCsv(counts, options.kmerTopCount,
+		(fs::path(outputPath) / ("kmer_counts_" + std::to_string(options.kmerSize) + ".csv")).string());
+}
+
+/// <summary>
+/// Checks that the annotation file can be read and names one sequence. Features are matched to
+/// segments by position only, so features of several sequences need --annotate-chrom to pick the
+/// one the analysed sequence is.
+/// </summary>
+/// <returns>True when the annotation stage can run.</returns>
+bool checkAnnotationFile(const PipelineOptions& options)
+{
+	std::vector<AnnotationFeature> features;
+	try
+	{
+		features = loadAnnotationFile(options.annotationPath, options.annotationChrom);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
+		return false;
+	}
+
+	if (options.annotationChrom.empty())
+	{
+		for (const auto& feature : features)
+		{
+			if (feature.chrom != features.front().chrom)
+			{
+				std::cerr << "Error: " << options.annotationPath << " has features on several sequences (e.g. "
+					<< features.front().chrom << " and " << feature.chrom << "); choose one with --annotate-chrom=NAME" << std::endl;
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/// <summary>
+/// Annotates the features of a BED, GFF3 or GTF file with the overlapping segments and isochore class.
+/// </summary>
+void runAnnotationStage(const std::vector<Isochore>& isochores, const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments, const std::string& outputPath, const PipelineOptions& options)
 {
+	auto features = loadAnnotationFile(options.annotationPath, options.annotationChrom);
+	std::cout << "\nNumber of annotation features is : " << features.size() << std::endl;
+
+	auto annotations = annotateFeatures(features, segments, isochores);
+	saveFeatureAnnotationsToCsv(features, annotations, (fs::path(outputPath) / "feature_annotations.csv").string());
+}
+
+/// <summary>
+/// Checks the merged segments against the planted repeats of a synthetic genome and reports how many were found.
+/// </summary>
+void runTruthStage(const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments, const std::string& outputPath, int wordSize, const PipelineOptions& options)
+{
+	auto repeats = loadPlantedRepeats(options.truthPath);
+	auto matches = matchPlantedRepeats(repeats, segments, wordSize);
+
+	size_t detectable = 0;
+	size_t found = 0;
+	for (const auto& match : matches)
+	{
+		detectable += match.detectable;
+		found += match.found;
+	}
+	std::cout << "\nPlanted repeats found : " << found << " of " << detectable
+		<< " detectable with word size " << wordSize << " (" << repeats.size() << " planted)" << std::endl;
+
+	savePlantedRepeatMatchesToCsv(repeats, matches, (fs::path(outputPath) / "planted_repeat_matches.csv").string());
+}
+
+/// <summary>
+/// Writes the multi-resolution GC track, whose finest bins the GC window scan counted, for
+/// viewers that zoom out.
+/// </summary>
+void saveGcPyramid(const GcPyramidBuilder& pyramid, const std::string& outputPath)
+{
+	std::string pyramidFileName = (fs::path(outputPath) / GC_PYRAMID_FILE).string();
+	if (pyramid.write(pyramidFileName))
+	{
+		std::cout << "\nGC pyramid saved successfully!: " << pyramidFileName << std::endl;
+	}
+}
+
+/// <summary>
+/// Prints the bins of a saved GC pyramid that overlap a region, from the coarsest level whose
+/// bins are not wider than the requested bases per pixel.
+/// </summary>
+/// <param name="region">START-END[:BASES_PER_PIXEL] (default 1 base per pixel, the finest level).</param>
+/// <param name="outputPath">Folder holding gc_pyramid.bin.</param>
+/// <returns>The process exit code.</returns>
+int runGcPyramidRegion(const std::string& region, const std::string& outputPath)
+{
+	uint64_t start = 0, end = 0, basesPerPixel = 1;
+	size_t dash = region.find('-');
+	size_t colon = region.find(':');
+	try
+	{
+		if (dash == std::string::npos || (colon != std::string::npos && colon < dash))
+		{
+			throw std::invalid_argument(region);
+		}
+		start = std::stoull(region.substr(0, dash));
+		end = std::stoull(region.substr(dash + 1, colon == std::string::npos ? std::string::npos : colon - dash - 1));
+		if (colon != std::string::npos) basesPerPixel = std::stoull(region.substr(colon + 1));
+	}
+	catch (const std::exception&)
+	{
+		start = end = 0;
+	}
+	if (start >= end)
+	{
+		std::cerr << "Invalid value for --gc-pyramid-region (expected START-END[:BASES_PER_PIXEL] with START < END): " << region << std::endl;
+		return 1;
+	}
+
+	GcPyramidFile pyramid;
+	if (!openGcPyramid((fs::path(outputPath) / GC_PYRAMID_FILE).string(), pyramid))
+	{
+		return 1;
+	}
+	size_t level = chooseGcPyramidLevel(pyramid, basesPerPixel);
+	uint64_t binSize = pyramid.levels[level].binSize;
+	auto bins = readGcPyramidRegion(pyramid, level, start, end);
+
+	std::cout << "Start,End,GC_Mean,GC_Min,GC_Max,Valid_Bases\n";
+	uint64_t binStart = (start / binSize) * binSize;
+	for (const auto& bin : bins)
+	{
+		uint64_t binEnd = std::min(binStart + binSize, pyramid.sequenceLength);
+		std::cout << binStart << ',' << binEnd << ',' << bin.mean << ',' << bin.min << ',' << bin.max << ',' << bin.validBases << '\n';
+		binStart += binSize;
+	}
+	std::cout << std::flush;
+	return 0;
+}
+
+/// <summary>
+/// Splits the sequence into contigs at assembly gaps and saves the gaps to their own file.
+/// </summary>
+std::vector<SequenceInterval> prepareContigs(std::string_view sequence, const std::vector<SequenceInterval>& nRuns, const std::string& outputPath, const PipelineOptions& options)
+{
+	auto gaps = find_assembly_gaps(nRuns, options.minGapLength);
+	auto contigs = find_acgt_contigs(nRuns, sequence.size(), options.minGapLength);
+
+	uint64_t gapBases = 0;
+	for (const auto& gap : gaps)
+	{
+		gapBases += gap.end - gap.start;
+	}
+	std::cout << "Assembly gaps : " << gaps.size() << " (" << gapBases << " bases), contigs : " << contigs.size() << std::endl;
+
+	save_gaps_to_csv((fs::path(outputPath) / "gaps_output.csv").string(), gaps);
+	return contigs;
+}
+
+/// <summary>
+/// Collects the segmentation engine and its parameters selected by the options.
+/// </summary>
+SegmentationSettings segmentationSettings(int minSegmentSize, int wordSize, int lookaheadSize, const PipelineOptions& options)
+{
+	SegmentationSettings settings;
+	settings.minSegmentSize = minSegmentSize;
+	settings.wordSize = wordSize;
+	settings.lookaheadSize = lookaheadSize;
+	settings.optimal = (options.engine == "optimal");
+	settings.penalty = *options.penalty;
+	settings.pruneByBound = options.pruneLookahead;
+	return settings;
+}
+
+/// <summary>
+/// Runs the segmentation engine selected by the options and reports its penalized score.
+/// </summary>
+std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> segmentSequence(std::string_view sequence, const std::vector<SequenceInterval>& contigs, int minSegmentSize, int wordSize, int lookaheadSize, const PipelineOptions& options)
+{
+	TRACE_SCOPE("segmentation");
+	std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> segments;
+	if (options.skipGaps)
+	{
+		SegmentationSettings settings = segmentationSettings(minSegmentSize, wordSize, lookaheadSize, options);
+
+		LookaheadStats stats;
+		segments = SegmentContigs(sequence, contigs, settings, &stats);
+		if (options.pruneLookahead && !settings.optimal)
+		{
+			std::cout << "\nLookahead candidates evaluated : " << stats.evaluated
+				<< ", pruned by bound : " << stats.pruned << std::endl;
+		}
+	}
+	else if (options.engine == "optimal")
+	{
+		std::cout << "Optimal segmentation with penalty " << *options.penalty << std::endl;
+		segments = SegmentDNAOptimal(sequence, minSegmentSize, wordSize, *options.penalty);
+	}
+	else
+	{
+		LookaheadStats stats;
+		segments = SegmentDNACostAndWord(sequence, minSegmentSize, wordSize, lookaheadSize, options.pruneLookahead, &stats);
+		if (options.pruneLookahead)
+		{
+			std::cout << "\nLookahead candidates evaluated : " << stats.evaluated
+				<< ", pruned by bound : " << stats.pruned << std::endl;
+		}
+	}
+
+	std::cout << "\nPenalized segmentation score (penalty " << *options.penalty << ") : "
+		<< TotalSegmentationScore(segments, *options.penalty) << std::endl;
+	return segments;
+}
+
+/// <summary>
+/// Runs the window stages on their own thread while the segmentation pipeline segments the
+/// sequence, merges the segments and adds their GC content, then reports the penalized score.
+/// </summary>
+SegmentPipelineResult runPipelinedStages(std::string_view sequence, const std::vector<SequenceInterval>& contigs, int minSegmentSize, int wordSize, int lookaheadSize, const BitPlaneSequence* planes, const GcRankIndex* index, const PipelineOptions& options, const std::function<void()>& windowStages)
+{
+	TRACE_SCOPE("pipelined stages");
+	SegmentationSettings settings = segmentationSettings(minSegmentSize, wordSize, lookaheadSize, options);
+	if (!options.skipGaps && sequence.size() < static_cast<size_t>(minSegmentSize * wordSize))
+	{
+		throw std::invalid_argument("Sequence length must be at least the minimum segment size in words.");
+	}
+	if (!options.skipGaps && settings.optimal)
+	{
+		std::cout << "Optimal segmentation with penalty " << *options.penalty << std::endl;
+	}
+
+	// The window stages only read the sequence, so they do not wait for the segmentation. Their
+	// lines are held back and printed in one piece, so they do not interleave with the segmentation's.
+	routeConsoleOutput();
+	std::exception_ptr windowError;
+	std::thread windowThread([&]()
+		{
+			try
+			{
+				BufferedConsoleOutput windowOutput;
+				windowStages();
+			}
+			catch (...)
+			{
+				windowError = std::current_exception();
+			}
+		});
+
+	SegmentPipelineResult stages;
+	try
+	{
+		stages = runSegmentPipeline(sequence,
+			options.skipGaps ? contigs : std::vector<SequenceInterval>{ { 0, sequence.size() } },
+			settings, planes, index);
+	}
+	catch (...)
+	{
+		windowThread.join();
+		throw;
+	}
+	windowThread.join();
+	if (windowError)
+	{
+		std::rethrow_exception(windowError);
+	}
+
+	if (options.pruneLookahead && !settings.optimal)
+	{
+		std::cout << "\nLookahead candidates evaluated : " << stages.stats.evaluated
+			<< ", pruned by bound : " << stages.stats.pruned << std::endl;
+	}
+	std::cout << "\nPenalized segmentation score (penalty " << *options.penalty << ") : "
+		<< TotalSegmentationScore(stages.segments, *options.penalty) << std::endl;
+	return stages;
+}
+
+/// <summary>
+/// Runs the sliding window stages selected by the options: the GC scan with isochore detection,
+/// the GC pyramid, the dinucleotide tracks and the k-mer counts.
+/// </summary>
+/// <returns>The detected isochores, or an empty vector when detection is off.</returns>
+std::vector<Isochore> runWindowStages(std::string_view sequence, const std::vector<SequenceInterval>& contigs, uint64_t windowSize, uint64_t stepSize, const std::string& outputPath, IsochoreScanOptions scan, const PipelineOptions& options)
+{
+	std::cout << "Isochore Detection started : " << sequence.size() << std::endl;
+	std::cout << "Window size is : " << windowSize << std::endl;
+	std::cout << "Step size is : " << stepSize << std::endl;
+	// The pyramid's finest bins are counted by the tasks of the window scan
+	std::unique_ptr<GcPyramidBuilder> pyramid;
+	if (options.gcPyramid)
+	{
+		pyramid = std::make_unique<GcPyramidBuilder>(sequence.size(), DEFAULT_GC_PYRAMID_BIN_SIZES);
+		scan.pyramid = pyramid.get();
+	}
+	auto isochores = scanIsochores(sequence, contigs, windowSize, stepSize, outputPath, scan, options);
+	if (pyramid)
+	{
+		saveGcPyramid(*pyramid, outputPath);
+	}
+	if (options.dinucleotides)
+	{
+		runDinucleotideTracks(sequence, contigs, windowSize, stepSize, outputPath, options);
+	}
+	if (options.kmerSize > 0)
+	{
+		runKmerCounts(sequence, contigs, outputPath, options);
+	}
+	return isochores;
+}
+
+// Sequence of a run with its runs of N, soft-mask and indexes. They are loaded by this process,
+// or borrowed from a shared genome image when --genome-image is given.
+struct RunGenome
+{
+	std::string loaded;                 // Sequence read by this process (empty when an image is attached or it was placed)
+	PlacedSequence placed;              // Copy of the loaded sequence in placed memory, when placement is on
+	std::unique_ptr<GenomeImage> image; // Image the sequence and indexes are mapped from, or null
+	std::vector<SequenceInterval> nRuns;
+	SoftMask softMask;
+	BitPlaneSequence planes;
+	GcRankIndex gcIndex;
+
+	std::string_view sequence() const
+	{
+		return image ? image->sequence() : !placed.empty() ? placed.view() : std::string_view(loaded);
+	}
+};
+
+/// <summary>
+/// Loads the sequence and the indexes the options ask for, or attaches them from the genome image.
+/// </summary>
+RunGenome loadRunGenome(const std::string& filePath, GenomeImageLoader loader, const PipelineOptions& options)
+{
+	TRACE_SCOPE("load");
+	RunGenome genome;
+	if (!options.genomeImagePath.empty())
+	{
+		genome.image = openGenomeImage(options.genomeImagePath, filePath, { loader, options.softMask, options.bitPlanes, options.gcIndex });
+		if (genome.image)
+		{
+			std::cout << "Genome image attached: " << options.genomeImagePath << " (" << genome.image->size() << " bytes shared)" << std::endl;
+			genome.nRuns = genome.image->nRuns();
+
+			// The copies borrow the words of the mapped image
+			if (options.softMask) genome.softMask = *genome.image->softMask();
+			if (options.bitPlanes) genome.planes = *genome.image->planes();
+			if (options.gcIndex) genome.gcIndex = *genome.image->gcIndex();
+			return genome;
+		}
+		std::cerr << "Warning: Unable to attach genome image " << options.genomeImagePath << "; loading the genome into this process" << std::endl;
+	}
+
+	SoftMask* softMask = options.softMask ? &genome.softMask : nullptr;
+	genome.loaded = (loader == GenomeImageLoader::Chromosome)
+		? read_chromosome_file(filePath, genome.nRuns, softMask)
+		: load_fasta_file(filePath, genome.nRuns, softMask);
+
+	// The loader thread first touched every page of the loaded copy; the placed one is spread
+	if (memoryPlacementEnabled())
+	{
+		genome.placed = placeSequence(genome.loaded);
+		if (!genome.placed.empty())
+		{
+			std::string().swap(genome.loaded);
+		}
+	}
+	if (options.bitPlanes)
+	{
+		genome.planes = buildBitPlanes(genome.sequence());
+	}
+	if (options.gcIndex)
+	{
+		genome.gcIndex = loadOrBuildGcRankIndex(genome.sequence(), options.gcIndexPath.empty() ? filePath + ".gcidx" : options.gcIndexPath, filePath);
+	}
+	return genome;
+}
+
+void processFullDna(const std::string& filePath, int minSegmentSize, int wordSize, int lookaheadSize, uint64_t windowSize, uint64_t stepSize, const std::string& outputPath, const PipelineOptions& options)
+{
+	TRACE_SCOPE("processFullDna");
 	std::cout << "\n[Processing Full DNA] -> File: " << filePath << std::endl;
 	std::cout << "Output Path: " << (outputPath.empty() ? "Not provided" : outputPath) << std::endl;
 
-	string dnaSequence = load_fasta_file(filePath);
+	RunGenome genome = loadRunGenome(filePath, GenomeImageLoader::Fasta, options);
+	std::string_view dnaSequence = genome.sequence();
 
 	std::cout << "DNA loaded! Size of sequence is  : " << dnaSequence.size() << std::endl;
 
-	std::cout << "Isochore Detection started : " << dnaSequence.size() << std::endl;
-	std::cout << "Window size is : " << windowSize << std::endl;
-	std::cout << "Step size is : " << stepSize << std::endl;
-	runIsochoreDetection(dnaSequence, outputPath, windowSize, stepSize);
+	if (options.spectrumMaxWordSize > 0)
+	{
+		runPeriodicitySpectrum(dnaSequence, windowSize, stepSize, outputPath, options);
+		return;
+	}
+
+	std::vector<SequenceInterval> contigs;
+	if (options.skipGaps)
+	{
+		contigs = prepareContigs(dnaSequence, genome.nRuns, outputPath, options);
+	}
+	if (options.runShard)
+	{
+		contigs = options.shardContigs;
+	}
+
+	const BitPlaneSequence* planesOrNull = options.bitPlanes ? &genome.planes : nullptr;
+	const GcRankIndex* gcIndexOrNull = options.gcIndex ? &genome.gcIndex : nullptr;
+
+	std::vector<Isochore> isochores;
+	auto windowStages = [&]()
+	{
+		isochores = runWindowStages(dnaSequence, contigs, windowSize, stepSize, outputPath, { planesOrNull, gcIndexOrNull }, options);
+	};
+	if (!options.pipeline)
+	{
+		windowStages();
+	}
 
 	std::cout << "\nThe Word Size is  : " << wordSize << std::endl;
 	std::cout << "The Minimum Segment Size is  : " << minSegmentSize * wordSize << " nucleotides" << std::endl;
 	std::cout << "The lookahead Size is  : " << lookaheadSize * wordSize << " nucleotides" << std::endl;
 
-	auto segments = SegmentDNACostAndWord(dnaSequence, minSegmentSize, wordSize, lookaheadSize);
+	std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> segments;
+	std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> merged;
+	std::vector<std::tuple<uint64_t, uint64_t, double, std::string, double, double>> result;
+	if (options.pipeline)
+	{
+		auto stages = runPipelinedStages(dnaSequence, contigs, minSegmentSize, wordSize, lookaheadSize, planesOrNull, gcIndexOrNull, options, windowStages);
+		segments = std::move(stages.segments);
+		merged = std::move(stages.merged);
+		result = std::move(stages.withGc);
+	}
+	else
+	{
+		segments = segmentSequence(dnaSequence, contigs, minSegmentSize, wordSize, lookaheadSize, options);
+	}
 
 	std::string fileName = outputPath + "segments_output_"
 		+ std::to_string(minSegmentSize) + "_"
@@ -186,9 +1225,12 @@ void processFullDna(const std::string& filePath, int minSegmentSize, int wordSiz
 
 	std::cout << "Number of segments before merge is  : " << segments.size() << std::endl;
 
-	std::cout << "Merge Segments started " << std::endl;
+	if (!options.pipeline)
+	{
+		std::cout << "Merge Segments started " << std::endl;
 
-	auto merged = MergeSimilarSegments(segments, dnaSequence, wordSize);
+		merged = MergeSimilarSegments(segments, dnaSequence, wordSize);
+	}
 
 	std::cout << "Number of segments after merge is : " << merged.size() << std::endl;
 
@@ -201,37 +1243,111 @@ void processFullDna(const std::string& filePath, int minSegmentSize, int wordSiz
 
 	std::cout << "Merged Segments saved successfully!: " << mergedFileName << std::endl;
 
-	auto result = mergeSegmentsWithGCContent(dnaSequence, merged);
+	if (!options.pipeline)
+	{
+		result = mergeSegmentsWithGCContent(dnaSequence, merged, planesOrNull, gcIndexOrNull);
+	}
 
 	std::string resultFileName = (fs::path(outputPath) /
 		("segments_GcContent_output_" + std::to_string(minSegmentSize) + "_" + std::to_string(wordSize) + "_" + std::to_string(lookaheadSize) + ".csv")).string();
 
-	saveSegmentsGcContentToCsv(result, resultFileName);
+	if (options.softMask)
+	{
+		saveSegmentsGcContentToCsv(result, calculateMaskedFractions(genome.softMask, result), resultFileName);
+	}
+	else
+	{
+		saveSegmentsGcContentToCsv(result, resultFileName);
+	}
 
 	std::cout << "Merged Segments with GC Content saved successfully!: " << resultFileName << std::endl;
+
+	if (options.runShard)
+	{
+		// The overlap, annotation and truth stages need the segments of every shard, so the merge runs them
+		if (!saveShardSegments(merged, (fs::path(outputPath) / SHARD_SEGMENTS_FILE).string()))
+		{
+			throw std::runtime_error("Unable to save the merged segments of the shard.");
+		}
+		return;
+	}
+
+	if (options.isochores)
+	{
+		runOverlapStage(isochores, merged, outputPath, minSegmentSize, wordSize, lookaheadSize);
+	}
+
+	if (!options.annotationPath.empty())
+	{
+		runAnnotationStage(isochores, merged, outputPath, options);
+	}
+
+	if (!options.truthPath.empty())
+	{
+		runTruthStage(merged, outputPath, wordSize, options);
+	}
 }
 
-void processChromosome(const std::string& chromosomeFile, int minSegmentSize, int wordSize, int lookaheadSize, uint64_t windowSize, uint64_t stepSize, const std::string& outputPath)
+void processChromosome(const std::string& chromosomeFile, int minSegmentSize, int wordSize, int lookaheadSize, uint64_t windowSize, uint64_t stepSize, const std::string& outputPath, const PipelineOptions& options)
 {
+	TRACE_SCOPE("processChromosome");
 	std::cout << "\n[Processing Chromosome] -> File: " << chromosomeFile << std::endl;
 	std::cout << "Output Path: " << (outputPath.empty() ? "Not provided" : outputPath) << std::endl;
 
 	std::cout << "Loading of Chromosome Started from file : " << chromosomeFile << std::endl;
-	auto chromosome = read_chromosome_file(chromosomeFile);
+	RunGenome genome = loadRunGenome(chromosomeFile, GenomeImageLoader::Chromosome, options);
+	std::string_view chromosome = genome.sequence();
 
 	std::cout << "Chromosome loaded! Size of Chromosome is  : " << chromosome.size() << std::endl;
 
-	std::cout << "Isochore Detection started : " << chromosome.size() << std::endl;
-	std::cout << "Window size is : " << windowSize << std::endl;
-	std::cout << "Step size is : " << stepSize << std::endl;
-	runIsochoreDetection(chromosome, outputPath, windowSize, stepSize);
+	if (options.spectrumMaxWordSize > 0)
+	{
+		runPeriodicitySpectrum(chromosome, windowSize, stepSize, outputPath, options);
+		return;
+	}
+
+	std::vector<SequenceInterval> contigs;
+	if (options.skipGaps)
+	{
+		contigs = prepareContigs(chromosome, genome.nRuns, outputPath, options);
+	}
+	if (options.runShard)
+	{
+		contigs = options.shardContigs;
+	}
+
+	const BitPlaneSequence* planesOrNull = options.bitPlanes ? &genome.planes : nullptr;
+	const GcRankIndex* gcIndexOrNull = options.gcIndex ? &genome.gcIndex : nullptr;
+
+	std::vector<Isochore> isochores;
+	auto windowStages = [&]()
+	{
+		isochores = runWindowStages(chromosome, contigs, windowSize, stepSize, outputPath, { planesOrNull, gcIndexOrNull }, options);
+	};
+	if (!options.pipeline)
+	{
+		windowStages();
+	}
 
 
 	std::cout << "\nThe Word Size is  : " << wordSize << std::endl;
 	std::cout << "The Minimum Segment Size is  : " << minSegmentSize * wordSize << " nucleotides" << std::endl;
 	std::cout << "The lookahead Size is  : " << lookaheadSize * wordSize << " nucleotides" << std::endl;
 
-	auto segments = SegmentDNACostAndWord(chromosome, minSegmentSize, wordSize, lookaheadSize);
+	std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> segments;
+	std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> merged;
+	std::vector<std::tuple<uint64_t, uint64_t, double, std::string, double, double>> result;
+	if (options.pipeline)
+	{
+		auto stages = runPipelinedStages(chromosome, contigs, minSegmentSize, wordSize, lookaheadSize, planesOrNull, gcIndexOrNull, options, windowStages);
+		segments = std::move(stages.segments);
+		merged = std::move(stages.merged);
+		result = std::move(stages.withGc);
+	}
+	else
+	{
+		segments = segmentSequence(chromosome, contigs, minSegmentSize, wordSize, lookaheadSize, options);
+	}
 
 	std::string fileName = (fs::path(outputPath) /
 		("segments_output_" + std::to_string(minSegmentSize) + "_" + std::to_string(wordSize) + "_" + std::to_string(lookaheadSize) + ".csv")).string();
@@ -242,9 +1358,12 @@ void processChromosome(const std::string& chromosomeFile, int minSegmentSize, in
 
 	std::cout << "Number of segments before merge is  : " << segments.size() << std::endl;
 
-	std::cout << "Merge Segments started " << std::endl;
+	if (!options.pipeline)
+	{
+		std::cout << "Merge Segments started " << std::endl;
 
-	auto merged = MergeSimilarSegments(segments, chromosome, wordSize);
+		merged = MergeSimilarSegments(segments, chromosome, wordSize);
+	}
 
 	std::cout << "\nNumber of segments after merge is : " << merged.size() << std::endl;
 
@@ -255,13 +1374,224 @@ void processChromosome(const std::string& chromosomeFile, int minSegmentSize, in
 
 	std::cout << "Merged Segments saved successfully!: " << mergedFileName << std::endl;
 
-	auto result = mergeSegmentsWithGCContent(chromosome, merged);
+	if (!options.pipeline)
+	{
+		result = mergeSegmentsWithGCContent(chromosome, merged, planesOrNull, gcIndexOrNull);
+	}
 
 	std::string resultFileName = (fs::path(outputPath) /
 		("segments_GcContent_output_" + std::to_string(minSegmentSize) + "_" + std::to_string(wordSize) + "_" + std::to_string(lookaheadSize) + ".csv")).string();
 
-	saveSegmentsGcContentToCsv(result, resultFileName);
+	if (options.softMask)
+	{
+		saveSegmentsGcContentToCsv(result, calculateMaskedFractions(genome.softMask, result), resultFileName);
+	}
+	else
+	{
+		saveSegmentsGcContentToCsv(result, resultFileName);
+	}
 
 	std::cout << "Merged Segments with GC Content saved successfully!: " << resultFileName << std::endl;
+
+	if (options.runShard)
+	{
+		// The overlap, annotation and truth stages need the segments of every shard, so the merge runs them
+		if (!saveShardSegments(merged, (fs::path(outputPath) / SHARD_SEGMENTS_FILE).string()))
+		{
+			throw std::runtime_error("Unable to save the merged segments of the shard.");
+		}
+		return;
+	}
+
+	if (options.isochores)
+	{
+		runOverlapStage(isochores, merged, outputPath, minSegmentSize, wordSize, lookaheadSize);
+	}
+
+	if (!options.annotationPath.empty())
+	{
+		runAnnotationStage(isochores, merged, outputPath, options);
+	}
+
+	if (!options.truthPath.empty())
+	{
+		runTruthStage(merged, outputPath, wordSize, options);
+	}
 }
 
+
+/// <summary>
+/// Plans a sharded run: splits the contigs of the genome into shards of about the same number of
+/// bases and writes the manifest read by every shard and by the merge to <outputPath>/shards.
+/// </summary>
+/// <returns>Zero when the manifest was written.</returns>
+int planShards(const std::vector<std::string>& arguments, const std::string& filePath, const std::string& inputType, int minSegmentSize, int wordSize, int lookaheadSize, uint64_t windowSize, uint64_t stepSize, const std::string& outputPath, const PipelineOptions& options)
+{
+	TRACE_SCOPE("planShards");
+	std::cout << "\n[Planning Shards] -> File: " << filePath << std::endl;
+
+	// Bitplanes are only worth building here when they are published to the genome image for the shards
+	PipelineOptions planOptions = options;
+	planOptions.bitPlanes = options.bitPlanes && !options.genomeImagePath.empty();
+	RunGenome genome = loadRunGenome(filePath, inputType == "fullDna" ? GenomeImageLoader::Fasta : GenomeImageLoader::Chromosome, planOptions);
+	auto contigs = find_acgt_contigs(genome.nRuns, genome.sequence().size(), options.minGapLength);
+
+	ShardManifest manifest;
+	manifest.shards = partitionContigs(contigs, options.shardCount);
+	if (manifest.shards.empty())
+	{
+		std::cerr << "Error: The genome has no contigs to shard" << std::endl;
+		return 1;
+	}
+
+	// Shards may run from other directories or nodes, so the paths of the run are made absolute
+	std::string absoluteOutputPath = outputPath.empty() ? (fs::current_path() / "").string() : fs::absolute(outputPath).string();
+	manifest.arguments = { fs::absolute(filePath).string(), inputType,
+		std::to_string(minSegmentSize), std::to_string(wordSize), std::to_string(lookaheadSize),
+		std::to_string(windowSize), std::to_string(stepSize), absoluteOutputPath };
+	// The trace belongs to the planning run; every shard and the merge take their own --trace
+	// instead of all overwriting this one
+	for (const auto& arg : arguments)
+	{
+		if (arg.rfind("--", 0) == 0 && arg.rfind("--shards=", 0) != 0 && arg.rfind("--trace=", 0) != 0)
+		{
+			manifest.arguments.push_back(arg);
+		}
+	}
+	if (!options.skipGaps)
+	{
+		manifest.arguments.push_back("--skip-gaps");
+	}
+
+	fs::path shardsDirectory = fs::path(absoluteOutputPath) / "shards";
+	fs::create_directories(shardsDirectory);
+	std::string manifestPath = (shardsDirectory / "manifest.tsv").string();
+	size_t staleShards = removeShardDirectories(manifestPath);
+	if (staleShards > 0)
+	{
+		std::cout << "Removed the outputs of " << staleShards << " shards of an earlier plan" << std::endl;
+	}
+	if (!saveShardManifest(manifest, manifestPath))
+	{
+		return 1;
+	}
+
+	std::cout << "Contigs : " << contigs.size() << ", shards : " << manifest.shards.size() << std::endl;
+	for (size_t shard = 0; shard < manifest.shards.size(); ++shard)
+	{
+		uint64_t bases = 0;
+		for (const auto& contig : manifest.shards[shard])
+		{
+			bases += contig.end - contig.start;
+		}
+		std::cout << "  Shard " << shard << " : " << manifest.shards[shard].size() << " contigs, " << bases << " bases ("
+			<< manifest.shards[shard].front().start << "-" << manifest.shards[shard].back().end << ")" << std::endl;
+	}
+	std::cout << "Shard manifest saved successfully!: " << manifestPath << std::endl;
+	std::cout << "Run every shard with --run-shard=" << manifestPath << ":K (K = 0.." << manifest.shards.size() - 1
+		<< "), then merge them with --merge-shards=" << manifestPath << std::endl;
+	return 0;
+}
+
+/// <summary>
+/// Stitches the outputs of every shard into the files a single --skip-gaps run writes, detects the
+/// isochores from the replayed windows of all shards and runs the stages that need every segment.
+/// </summary>
+/// <returns>Zero when every shard had finished and the outputs were written.</returns>
+int mergeShards(const ShardManifest& manifest, int minSegmentSize, int wordSize, int lookaheadSize, uint64_t windowSize, uint64_t stepSize, const std::string& outputPath, const std::string& inputType, const PipelineOptions& options)
+{
+	TRACE_SCOPE("mergeShards");
+	std::cout << "\n[Merging Shards] -> Manifest: " << options.shardManifestPath << std::endl;
+
+	std::vector<std::string> directories;
+	std::string unfinished;
+	for (size_t shard = 0; shard < manifest.shards.size(); ++shard)
+	{
+		directories.push_back(shardDirectory(options.shardManifestPath, shard));
+		if (!isShardDone(directories.back(), shardFingerprint(manifest, shard)))
+		{
+			unfinished += (unfinished.empty() ? "" : ", ") + std::to_string(shard);
+		}
+	}
+	if (!unfinished.empty())
+	{
+		std::cerr << "Error: Shards not finished for this manifest: " << unfinished << std::endl;
+		return 1;
+	}
+
+	// Every output is the same file in each shard directory, concatenated in shard order
+	auto mergeCsv = [&](const std::string& name, const std::string& mergedFileName, bool firstShardOnly)
+	{
+		std::vector<std::string> inputs;
+		for (const auto& directory : directories)
+		{
+			inputs.push_back((fs::path(directory) / name).string());
+			if (firstShardOnly) break;
+		}
+		if (!concatenateShardCsv(inputs, mergedFileName))
+		{
+			return false;
+		}
+		std::cout << "Merged " << name << " saved successfully!: " << mergedFileName << std::endl;
+		return true;
+	};
+
+	// A full genome run names its segment files by appending to the output path
+	std::string suffix = std::to_string(minSegmentSize) + "_" + std::to_string(wordSize) + "_" + std::to_string(lookaheadSize);
+	std::string windowSuffix = std::to_string(windowSize) + "_" + std::to_string(stepSize);
+	auto segmentFileName = [&](const std::string& name)
+	{
+		return (inputType == "fullDna") ? outputPath + name : (fs::path(outputPath) / name).string();
+	};
+
+	// Every shard saves the gaps of the whole genome
+	if (!mergeCsv("gaps_output.csv", (fs::path(outputPath) / "gaps_output.csv").string(), true)
+		|| !mergeCsv("isochores_output_" + windowSuffix + ".csv", (fs::path(outputPath) / ("isochores_output_" + windowSuffix + ".csv")).string(), false)
+		|| !mergeCsv("segments_output_" + suffix + ".csv", segmentFileName("segments_output_" + suffix + ".csv"), false)
+		|| !mergeCsv("merged_segments_output_" + suffix + ".csv", segmentFileName("merged_segments_output_" + suffix + ".csv"), false)
+		|| !mergeCsv("segments_GcContent_output_" + suffix + ".csv", (fs::path(outputPath) / ("segments_GcContent_output_" + suffix + ".csv")).string(), false))
+	{
+		return 1;
+	}
+
+	std::vector<Isochore> isochores;
+	if (options.isochores)
+	{
+		IsochoreBoundaryDetector boundaries(stepSize, options.minIsochoreLength, options.isochoreHysteresis);
+		for (const auto& directory : directories)
+		{
+			if (!replayShardWindows((fs::path(directory) / SHARD_WINDOWS_FILE).string(), boundaries))
+			{
+				return 1;
+			}
+		}
+		isochores = boundaries.finish();
+		reportIsochores(isochores, windowSize, stepSize, outputPath);
+	}
+
+	std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> merged;
+	for (const auto& directory : directories)
+	{
+		if (!loadShardSegments((fs::path(directory) / SHARD_SEGMENTS_FILE).string(), merged))
+		{
+			return 1;
+		}
+	}
+	std::cout << "Number of segments after merge is : " << merged.size() << std::endl;
+
+	if (options.isochores)
+	{
+		runOverlapStage(isochores, merged, outputPath, minSegmentSize, wordSize, lookaheadSize);
+	}
+
+	if (!options.annotationPath.empty())
+	{
+		runAnnotationStage(isochores, merged, outputPath, options);
+	}
+
+	if (!options.truthPath.empty())
+	{
+		runTruthStage(merged, outputPath, wordSize, options);
+	}
+	return 0;
+}
@@ -0,0 +1,280 @@
+#include "MemoryPlacement.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+#include "Parallel.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#ifdef HAVE_LIBNUMA
+#include <numa.h>
+#endif
+
+static MemoryPlacement currentPlacement;
+
+// Size of every mapping made by allocatePlaced, by its address
+static std::mutex placedMtx;
+static std::unordered_map<void*, size_t> placedMappings;
+
+static size_t roundUpToHugePage(size_t bytes)
+{
+	return (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+}
+
+void setMemoryPlacement(const MemoryPlacement& placement)
+{
+	currentPlacement = placement;
+}
+
+const MemoryPlacement& memoryPlacement()
+{
+	return currentPlacement;
+}
+
+bool memoryPlacementEnabled()
+{
+	return currentPlacement.hugePages != HugePageMode::Off || currentPlacement.numa != NumaPolicy::Off;
+}
+
+/// <summary>
+/// Number of NUMA nodes with memory; 1 on single-node machines and in builds without libnuma.
+/// </summary>
+size_t numaNodeCount()
+{
+#ifdef HAVE_LIBNUMA
+	static const size_t nodes = (numa_available() < 0) ? 1 : static_cast<size_t>(std::max(1, numa_num_configured_nodes()));
+	return nodes;
+#else
+	return 1;
+#endif
+}
+
+/// <summary>
+/// Describes the placement in effect and what this machine and build make of it, e.g.
+/// "transparent huge pages, interleaved over 2 NUMA nodes".
+/// </summary>
+std::string describeMemoryPlacement()
+{
+	std::string description;
+	switch (currentPlacement.hugePages)
+	{
+	case HugePageMode::Off: description = "regular pages"; break;
+	case HugePageMode::Transparent: description = "transparent huge pages"; break;
+	case HugePageMode::Explicit: description = "explicit huge pages"; break;
+	}
+
+	// The kernel setting is shown as "always [madvise] never"; only [never] ignores the request
+	std::ifstream thp("/sys/kernel/mm/transparent_hugepage/enabled");
+	std::string thpSetting;
+	if (currentPlacement.hugePages == HugePageMode::Transparent && std::getline(thp, thpSetting)
+		&& thpSetting.find("[never]") != std::string::npos)
+	{
+		description += " (disabled by the kernel)";
+	}
+
+	size_t nodes = numaNodeCount();
+	if (currentPlacement.numa == NumaPolicy::Interleave)
+	{
+#ifdef HAVE_LIBNUMA
+		description += (nodes > 1) ? ", interleaved over " + std::to_string(nodes) + " NUMA nodes" : ", single NUMA node";
+#else
+		description += ", chunks spread by the workers filling them (interleaving needs libnuma)";
+#endif
+	}
+	else if (currentPlacement.numa == NumaPolicy::Local)
+	{
+		description += ", chunks on the node of the worker filling them";
+		if (nodes > 1)
+		{
+			description += " (" + std::to_string(nodes) + " NUMA nodes)";
+		}
+	}
+	return description;
+}
+
+/// <summary>
+/// Maps memory with the huge pages and the NUMA policy of the current placement. The pages are
+/// not touched, so they are only faulted in, and placed, by the threads that first write them.
+/// </summary>
+/// <param name="bytes">Size of the allocation.</param>
+/// <returns>The memory, or null when it could not be mapped.</returns>
+void* allocatePlaced(size_t bytes)
+{
+#ifdef _WIN32
+	// Large pages need a privilege on Windows; the heap serves every allocation there
+	(void)bytes;
+	return nullptr;
+#else
+	size_t size = roundUpToHugePage(std::max<size_t>(bytes, 1));
+	void* memory = nullptr;
+
+#ifdef MAP_HUGETLB
+	if (currentPlacement.hugePages == HugePageMode::Explicit)
+	{
+		memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (memory == MAP_FAILED)
+		{
+			memory = nullptr;
+			static std::once_flag warned;
+			std::call_once(warned, [size]()
+				{
+					std::cerr << "Warning: No free explicit huge pages for " << size << " bytes; using transparent huge pages" << std::endl;
+				});
+		}
+	}
+#endif
+
+	if (memory == nullptr)
+	{
+		// Map one huge page more and trim both ends, so the range starts on a huge page boundary
+		size_t padded = size + HUGE_PAGE_SIZE;
+		void* raw = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (raw == MAP_FAILED)
+		{
+			return nullptr;
+		}
+		uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+		uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+		size_t head = aligned - start;
+		if (head > 0)
+		{
+			munmap(raw, head);
+		}
+		if (padded - head > size)
+		{
+			munmap(reinterpret_cast<void*>(aligned + size), padded - head - size);
+		}
+		memory = reinterpret_cast<void*>(aligned);
+
+#ifdef MADV_HUGEPAGE
+		if (currentPlacement.hugePages != HugePageMode::Off)
+		{
+			madvise(memory, size, MADV_HUGEPAGE);
+		}
+#endif
+	}
+
+#ifdef HAVE_LIBNUMA
+	if (currentPlacement.numa == NumaPolicy::Interleave && numaNodeCount() > 1)
+	{
+		numa_interleave_memory(memory, size, numa_all_nodes_ptr);
+	}
+#endif
+
+	std::lock_guard<std::mutex> lock(placedMtx);
+	placedMappings[memory] = size;
+	return memory;
+#endif
+}
+
+/// <summary>
+/// Unmaps memory returned by allocatePlaced.
+/// </summary>
+/// <returns>False when the pointer was not returned by allocatePlaced.</returns>
+bool releasePlaced(void* memory)
+{
+	size_t size = 0;
+	{
+		std::lock_guard<std::mutex> lock(placedMtx);
+		auto mapping = placedMappings.find(memory);
+		if (mapping == placedMappings.end())
+		{
+			return false;
+		}
+		size = mapping->second;
+		placedMappings.erase(mapping);
+	}
+#ifndef _WIN32
+	munmap(memory, size);
+#endif
+	return true;
+}
+
+PlacedSequence::~PlacedSequence()
+{
+	if (memory != nullptr)
+	{
+		releasePlaced(memory);
+	}
+}
+
+PlacedSequence::PlacedSequence(PlacedSequence&& other) noexcept
+	: memory(other.memory), length(other.length)
+{
+	other.memory = nullptr;
+	other.length = 0;
+}
+
+PlacedSequence& PlacedSequence::operator=(PlacedSequence&& other) noexcept
+{
+	if (this != &other)
+	{
+		if (memory != nullptr)
+		{
+			releasePlaced(memory);
+		}
+		memory = other.memory;
+		length = other.length;
+		other.memory = nullptr;
+		other.length = 0;
+	}
+	return *this;
+}
+
+/// <summary>
+/// Copies a loaded sequence into placed memory. The copy runs as parallel chunks on the thread
+/// pool, so the pages are not all first touched by the loader thread: with NumaPolicy::Local each
+/// chunk lands on the node of the worker copying it, and without libnuma interleaving falls back
+/// to this spread.
+/// </summary>
+/// <param name="sequence">The loaded sequence.</param>
+/// <returns>The placed copy, or an empty one when the memory could not be mapped.</returns>
+/// <summary>
+/// Zeroes memory as parallel chunks of whole huge pages on the thread pool, so, like the copy of
+/// placeSequence, its pages are first touched by many workers: with NumaPolicy::Local each chunk
+/// lands on the node of the worker zeroing it.
+/// </summary>
+/// <param name="memory">First byte.</param>
+/// <param name="bytes">Number of bytes.</param>
+void zeroInParallel(void* memory, size_t bytes)
+{
+	char* first = static_cast<char*>(memory);
+	size_t chunks = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE;
+	ParallelFor(chunks, [&](size_t chunk)
+		{
+			size_t start = chunk * HUGE_PAGE_SIZE;
+			std::memset(first + start, 0, std::min(HUGE_PAGE_SIZE, bytes - start));
+		});
+}
+
+PlacedSequence placeSequence(std::string_view sequence)
+{
+	PlacedSequence placed;
+	if (sequence.empty())
+	{
+		return placed;
+	}
+	void* memory = allocatePlaced(sequence.size());
+	if (memory == nullptr)
+	{
+		return placed;
+	}
+	placed.memory = static_cast<char*>(memory);
+	placed.length = sequence.size();
+
+	// Chunks of whole huge pages, so every page is first touched by a single worker
+	size_t chunks = (sequence.size() + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE;
+	ParallelFor(chunks, [&](size_t chunk)
+		{
+			size_t start = chunk * HUGE_PAGE_SIZE;
+			size_t length = std::min(HUGE_PAGE_SIZE, sequence.size() - start);
+			std::memcpy(placed.memory + start, sequence.data() + start, length);
+		});
+	return placed;
+}
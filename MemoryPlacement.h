@@ -0,0 +1,182 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+// Allocations from this size on are placed; smaller ones come from the heap as usual
+const size_t PLACED_ALLOCATION_THRESHOLD = 4 << 20;
+
+// Page size of transparent and explicit huge pages; placed allocations are rounded up to it
+const size_t HUGE_PAGE_SIZE = 2 << 20;
+
+// Pages backing the placed allocations
+enum class HugePageMode
+{
+	Off,         // Regular pages
+	Transparent, // Ask the kernel to back the allocation with transparent huge pages (madvise)
+	Explicit     // Reserved huge pages (MAP_HUGETLB); transparent ones when none are free
+};
+
+// NUMA nodes the pages of placed allocations are put on
+enum class NumaPolicy
+{
+	Off,        // Kernel default: the node of the thread that first touches a page
+	Interleave, // Round robin over all nodes, for data every worker reads at random
+	Local       // Filled in parallel chunks, each on the node of the worker that fills it
+};
+
+// How the genome and its large index arrays are allocated
+struct MemoryPlacement
+{
+	HugePageMode hugePages = HugePageMode::Off;
+	NumaPolicy numa = NumaPolicy::Off;
+};
+
+/// <summary>
+/// Sets how later placed allocations are made. Memory placed before keeps its pages.
+/// </summary>
+void setMemoryPlacement(const MemoryPlacement& placement);
+
+/// <summary>
+/// The placement set by setMemoryPlacement.
+/// </summary>
+const MemoryPlacement& memoryPlacement();
+
+/// <summary>
+/// True when huge pages or a NUMA policy were asked for.
+/// </summary>
+bool memoryPlacementEnabled();
+
+/// <summary>
+/// Number of NUMA nodes with memory; 1 on single-node machines and in builds without libnuma.
+/// </summary>
+size_t numaNodeCount();
+
+/// <summary>
+/// Describes the placement in effect and what this machine and build make of it, e.g.
+/// "transparent huge pages, interleaved over 2 NUMA nodes".
+/// </summary>
+std::string describeMemoryPlacement();
+
+/// <summary>
+/// Maps memory with the huge pages and the NUMA policy of the current placement. The pages are
+/// not touched, so they are only faulted in, and placed, by the threads that first write them.
+/// </summary>
+/// <param name="bytes">Size of the allocation.</param>
+/// <returns>The memory, or null when it could not be mapped.</returns>
+void* allocatePlaced(size_t bytes);
+
+/// <summary>
+/// Unmaps memory returned by allocatePlaced.
+/// </summary>
+/// <returns>False when the pointer was not returned by allocatePlaced.</returns>
+bool releasePlaced(void* memory);
+
+/// <summary>
+/// Standard allocator that places large allocations and takes small ones from the heap, so the
+/// index word arrays get huge pages and NUMA placement without changing the code filling them.
+/// </summary>
+template <typename T>
+struct PlacedAllocator
+{
+	using value_type = T;
+
+	PlacedAllocator() = default;
+	template <typename U>
+	PlacedAllocator(const PlacedAllocator<U>&) {}
+
+	T* allocate(size_t count)
+	{
+		size_t bytes = count * sizeof(T);
+		if (bytes >= PLACED_ALLOCATION_THRESHOLD && memoryPlacementEnabled())
+		{
+			if (void* memory = allocatePlaced(bytes))
+			{
+				return static_cast<T*>(memory);
+			}
+		}
+		return static_cast<T*>(::operator new(bytes));
+	}
+
+	void deallocate(T* memory, size_t count)
+	{
+		if (count * sizeof(T) < PLACED_ALLOCATION_THRESHOLD || !releasePlaced(memory))
+		{
+			::operator delete(memory);
+		}
+	}
+
+	// Default-constructed elements of trivial types are left untouched, so growing an array does
+	// not first touch its pages on one thread; the code filling the array places them
+	template <typename U>
+	void construct(U* element) noexcept(std::is_nothrow_default_constructible_v<U>)
+	{
+		if constexpr (!std::is_trivially_default_constructible_v<U>)
+		{
+			::new (static_cast<void*>(element)) U();
+		}
+	}
+
+	template <typename U, typename... Args>
+	void construct(U* element, Args&&... args)
+	{
+		::new (static_cast<void*>(element)) U(std::forward<Args>(args)...);
+	}
+
+	template <typename U>
+	bool operator==(const PlacedAllocator<U>&) const { return true; }
+	template <typename U>
+	bool operator!=(const PlacedAllocator<U>&) const { return false; }
+};
+
+/// <summary>
+/// Zeroes memory as parallel chunks of whole huge pages on the thread pool, so, like the copy of
+/// placeSequence, its pages are first touched by many workers: with NumaPolicy::Local each chunk
+/// lands on the node of the worker zeroing it.
+/// </summary>
+/// <param name="memory">First byte.</param>
+/// <param name="bytes">Number of bytes.</param>
+void zeroInParallel(void* memory, size_t bytes);
+
+/// <summary>
+/// Read-only copy of a sequence in placed memory.
+/// </summary>
+class PlacedSequence
+{
+public:
+	PlacedSequence() = default;
+	~PlacedSequence();
+
+	PlacedSequence(PlacedSequence&& other) noexcept;
+	PlacedSequence& operator=(PlacedSequence&& other) noexcept;
+	PlacedSequence(const PlacedSequence&) = delete;
+	PlacedSequence& operator=(const PlacedSequence&) = delete;
+
+	bool empty() const { return length == 0; }
+	std::string_view view() const { return std::string_view(memory, length); }
+
+private:
+	friend PlacedSequence placeSequence(std::string_view sequence);
+
+	char* memory = nullptr;
+	size_t length = 0;
+};
+
+/// <summary>
+/// Copies a loaded sequence into placed memory. The copy runs as parallel chunks on the thread
+/// pool, so the pages are not all first touched by the loader thread: with NumaPolicy::Local each
+/// chunk lands on the node of the worker copying it, and without libnuma interleaving falls back
+/// to this spread.
+/// </summary>
+/// <param name="sequence">The loaded sequence.</param>
+/// <returns>The placed copy, or an empty one when the memory could not be mapped.</returns>
+PlacedSequence placeSequence(std::string_view sequence);
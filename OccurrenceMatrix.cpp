@@ -1,4 +1,5 @@
 # include "OccurrenceMatrix.h"
+#include "Trace.h"
 
 std::unordered_map<char, int> Precompute_DNATab = {
 	{'A', 0},
@@ -15,6 +16,7 @@ std::unordered_map<char, int> Precompute_DNATab = {
 /// <returns>A 4 x word_size matrix representing nucleotide occurrences.</returns>
 std::vector<std::vector<int>> GenerateOccurrenceMatrix(std::string_view sequence, int word_size)
 {
+	TRACE_COUNT(MatrixUpdates, sequence.size() / word_size);
 	// Initialize a 4 x word_size matrix with zeros
 	std::vector<std::vector<int>> matrix(4, std::vector<int>(word_size, 0));
 
@@ -137,6 +139,7 @@ vector<vector<int>> RemoveSequenceFromOccurrenceMatrix(const std::vector<std::ve
 /// <returns>A pair consisting of the total percentage sum and the representative word.</returns>
 std::pair<double, std::string> CalculatePercentageSumAndWord(const std::vector<std::vector<int>>& matrix)
 {
+	TRACE_COUNT(ScoreEvaluations, 1);
 	double totalSum = 0.0;           // Variable to store the total percentage sum
 	std::string representativeWord(matrix[0].size(), ' ');            // String to store the word with the best scores
 	int numColumns = static_cast<int>(matrix[0].size());// Number of columns (word size)
@@ -178,3 +181,92 @@ std::pair<double, std::string> CalculatePercentageSumAndWord(const std::vector<s
 	return { totalSum, representativeWord }; // Return both the total sum and the constructed word
 }
 
+
+
+/// <summary>
+/// Maps a nucleotide to its row in the occurrence matrix.
+/// </summary>
+/// <param name="nucleotide">The nucleotide character.</param>
+/// <returns>Row index (A=0, C=1, G=2, T=3) or -1 for any other character.</returns>
+static inline int NucleotideRow(char nucleotide)
+{
+	switch (nucleotide)
+	{
+	case 'A': return 0;
+	case 'C': return 1;
+	case 'G': return 2;
+	case 'T': return 3;
+	default: return -1;
+	}
+}
+
+/// <summary>
+/// Adds a single word to an occurrence matrix in place.
+/// </summary>
+/// <param name="matrix">The occurrence matrix to update.</param>
+/// <param name="word">The word to add (its length must match the matrix width).</param>
+void AddWordToOccurrenceMatrix(std::vector<std::vector<int>>& matrix, std::string_view word)
+{
+	TRACE_COUNT(MatrixUpdates, 1);
+	for (size_t j = 0; j < word.size(); ++j)
+	{
+		int row = NucleotideRow(word[j]);
+		if (row >= 0)
+		{
+			matrix[row][j]++;
+		}
+	}
+}
+
+/// <summary>
+/// Removes a single word from an occurrence matrix in place.
+/// </summary>
+/// <param name="matrix">The occurrence matrix to update.</param>
+/// <param name="word">The word to remove (its length must match the matrix width).</param>
+void RemoveWordFromOccurrenceMatrix(std::vector<std::vector<int>>& matrix, std::string_view word)
+{
+	TRACE_COUNT(MatrixUpdates, 1);
+	for (size_t j = 0; j < word.size(); ++j)
+	{
+		int row = NucleotideRow(word[j]);
+		if (row >= 0)
+		{
+			matrix[row][j]--;
+		}
+	}
+}
+
+/// <summary>
+/// Calculates the total percentage sum of the maximum nucleotide occurrences per column
+/// without building the representative word.
+/// </summary>
+/// <param name="matrix">The occurrence matrix.</param>
+/// <returns>The same total percentage sum as CalculatePercentageSumAndWord.</returns>
+double CalculatePercentageSum(const std::vector<std::vector<int>>& matrix)
+{
+	TRACE_COUNT(ScoreEvaluations, 1);
+	double totalSum = 0.0;
+	size_t numColumns = matrix[0].size();
+
+	for (size_t col = 0; col < numColumns; ++col)
+	{
+		int maxValue = 0;
+		int columnTotal = 0;
+		for (int row = 0; row < 4; ++row)
+		{
+			columnTotal += matrix[row][col];
+			if (matrix[row][col] > maxValue)
+			{
+				maxValue = matrix[row][col];
+			}
+		}
+
+		// Same accumulation order as CalculatePercentageSumAndWord so scores compare exactly
+		if (columnTotal > 0)
+		{
+			totalSum += static_cast<double>(maxValue) / columnTotal;
+		}
+	}
+
+	return totalSum;
+}
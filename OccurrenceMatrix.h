@@ -62,3 +62,25 @@ vector<vector<int>> RemoveSequenceFromOccurrenceMatrix(const std::vector<std::ve
 /// <param name="matrix">The occurrence matrix.</param>
 /// <returns>A pair consisting of the total percentage sum and the representative word.</returns>
 std::pair<double, std::string> CalculatePercentageSumAndWord(const std::vector<std::vector<int>>& matrix);
+
+/// <summary>
+/// Adds a single word to an occurrence matrix in place.
+/// </summary>
+/// <param name="matrix">The occurrence matrix to update.</param>
+/// <param name="word">The word to add (its length must match the matrix width).</param>
+void AddWordToOccurrenceMatrix(std::vector<std::vector<int>>& matrix, std::string_view word);
+
+/// <summary>
+/// Removes a single word from an occurrence matrix in place.
+/// </summary>
+/// <param name="matrix">The occurrence matrix to update.</param>
+/// <param name="word">The word to remove (its length must match the matrix width).</param>
+void RemoveWordFromOccurrenceMatrix(std::vector<std::vector<int>>& matrix, std::string_view word);
+
+/// <summary>
+/// Calculates the total percentage sum of the maximum nucleotide occurrences per column
+/// without building the representative word.
+/// </summary>
+/// <param name="matrix">The occurrence matrix.</param>
+/// <returns>The same total percentage sum as CalculatePercentageSumAndWord.</returns>
+double CalculatePercentageSum(const std::vector<std::vector<int>>& matrix);
@@ -0,0 +1,164 @@
+#include "Parallel.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Runs count independent tasks on the shared thread pool. Tasks are handed out one at a time,
+/// so uneven task sizes still keep every thread busy.
+/// </summary>
+/// <param name="count">Number of tasks.</param>
+/// <param name="task">Function called once with every task index in [0, count).</param>
+/// <param name="priority">Pool priority of the tasks.</param>
+void ParallelFor(size_t count, const std::function<void(size_t)>& task, TaskPriority priority)
+{
+	ThreadPool& pool = globalThreadPool();
+	size_t runnerCount = std::min(count, pool.threadCount());
+	std::atomic<size_t> nextTask{ 0 };
+
+	auto runner = [&]()
+	{
+		for (size_t i = nextTask++; i < count; i = nextTask++)
+		{
+			task(i);
+		}
+	};
+
+	// The calling thread takes part while it waits, so one runner fewer is queued
+	TaskGroup group(pool);
+	for (size_t r = 1; r < runnerCount; ++r)
+	{
+		group.run(runner, priority);
+	}
+	std::exception_ptr failure;
+	try
+	{
+		runner();
+	}
+	catch (...)
+	{
+		failure = std::current_exception();
+	}
+	group.wait();
+
+	if (failure)
+	{
+		std::rethrow_exception(failure);
+	}
+}
+
+/// <summary>
+/// Runs count tasks on the shared thread pool, each formatting its output into its own text
+/// buffer, while a writer thread passes the buffers to the output in task order. At most a few
+/// buffers per thread are held at once, so memory stays bounded however many tasks there are.
+/// The formatting tasks run at high priority, since the writer and the output wait on them.
+/// </summary>
+/// <param name="count">Number of tasks.</param>
+/// <param name="task">Function called once with every task index and an empty buffer to fill.</param>
+/// <param name="write">Called from the writer thread with every task index and its buffer, in task order.</param>
+void ParallelOrderedWrite(size_t count, const std::function<void(size_t, std::string&)>& task,
+	const std::function<void(size_t, const std::string&)>& write)
+{
+	ThreadPool& pool = globalThreadPool();
+	size_t threadCount = pool.threadCount();
+	size_t maxInFlight = 2 * threadCount;
+
+	std::vector<std::string> slots(maxInFlight);
+	std::vector<bool> ready(maxInFlight, false);
+	size_t written = 0;    // Buffers handed to the output so far
+	bool failed = false;   // Set when a task or the writer threw
+	std::exception_ptr failure;
+	std::mutex slotMtx;
+	std::condition_variable slotChanged;
+	std::atomic<size_t> nextTask{ 0 };
+
+	auto fail = [&](std::exception_ptr error)
+	{
+		std::lock_guard<std::mutex> lock(slotMtx);
+		if (!failure) failure = error;
+		failed = true;
+		slotChanged.notify_all();
+	};
+
+	// The writer blocks on the output and on the order of the buffers, so it gets its own
+	// thread instead of a pool slot
+	std::thread writer([&]()
+		{
+			try
+			{
+				for (size_t i = 0; i < count; ++i)
+				{
+					std::string buffer;
+					{
+						std::unique_lock<std::mutex> lock(slotMtx);
+						slotChanged.wait(lock, [&]() { return ready[i % maxInFlight] || failed; });
+						if (failed) return;
+						buffer.swap(slots[i % maxInFlight]);
+						ready[i % maxInFlight] = false;
+						written = i + 1;
+					}
+					slotChanged.notify_all();
+					write(i, buffer);
+				}
+			}
+			catch (...)
+			{
+				fail(std::current_exception());
+			}
+		});
+
+	auto runner = [&]()
+	{
+		try
+		{
+			for (size_t i = nextTask++; i < count; i = nextTask++)
+			{
+				{
+					// Do not run further ahead of the writer than the slots allow
+					std::unique_lock<std::mutex> lock(slotMtx);
+					slotChanged.wait(lock, [&]() { return i < written + maxInFlight || failed; });
+					if (failed) return;
+				}
+
+				std::string buffer;
+				task(i, buffer);
+
+				{
+					std::lock_guard<std::mutex> lock(slotMtx);
+					slots[i % maxInFlight].swap(buffer);
+					ready[i % maxInFlight] = true;
+				}
+				slotChanged.notify_all();
+			}
+		}
+		catch (...)
+		{
+			fail(std::current_exception());
+		}
+	};
+
+	{
+		TaskGroup group(pool);
+		for (size_t r = 1; r < std::min(threadCount, count); ++r)
+		{
+			group.run(runner, TaskPriority::High);
+		}
+		if (count > 0)
+		{
+			runner();
+		}
+		group.wait();
+	}
+	writer.join();
+
+	if (failure)
+	{
+		std::rethrow_exception(failure);
+	}
+}
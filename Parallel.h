@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include "ThreadPool.h"
+
+/// <summary>
+/// Runs count independent tasks on the shared thread pool. Tasks are handed out one at a time,
+/// so uneven task sizes still keep every thread busy.
+/// </summary>
+/// <param name="count">Number of tasks.</param>
+/// <param name="task">Function called once with every task index in [0, count).</param>
+/// <param name="priority">Pool priority of the tasks.</param>
+void ParallelFor(size_t count, const std::function<void(size_t)>& task, TaskPriority priority = TaskPriority::Normal);
+
+/// <summary>
+/// Runs count tasks on the shared thread pool, each formatting its output into its own text
+/// buffer, while a writer thread passes the buffers to the output in task order. At most a few
+/// buffers per thread are held at once, so memory stays bounded however many tasks there are.
+/// The formatting tasks run at high priority, since the writer and the output wait on them.
+/// </summary>
+/// <param name="count">Number of tasks.</param>
+/// <param name="task">Function called once with every task index and an empty buffer to fill.</param>
+/// <param name="write">Called from the writer thread with every task index and its buffer, in task order.</param>
+void ParallelOrderedWrite(size_t count, const std::function<void(size_t, std::string&)>& task,
+	const std::function<void(size_t, const std::string&)>& write);
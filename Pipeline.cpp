@@ -0,0 +1,136 @@
+#include "Pipeline.h"
+#include "Trace.h"
+#include <exception>
+#include <string_view>
+#include <thread>
+
+/// <summary>
+/// Segments the contigs, merges similar neighbouring segments and adds their GC content as one
+/// pipeline: the merge and GC stages run on their own threads and take every segment from a
+/// bounded queue as soon as the segmenter has finalized it, instead of waiting for the whole
+/// segmentation. The results equal SegmentContigs, MergeSimilarSegments and
+/// mergeSegmentsWithGCContent run in sequence.
+/// </summary>
+/// <param name="sequence">The full DNA sequence.</param>
+/// <param name="contigs">Contigs to segment, in sequence order.</param>
+/// <param name="settings">Segmentation engine and its parameters.</param>
+/// <param name="planes">Bitplanes of the sequence, or nullptr to count GC on the characters.</param>
+/// <param name="index">GC rank index of the sequence, or nullptr; takes precedence over planes.</param>
+/// <returns>The segments of every stage.</returns>
+SegmentPipelineResult runSegmentPipeline(
+	std::string_view sequence,
+	const std::vector<SequenceInterval>& contigs,
+	const SegmentationSettings& settings,
+	const BitPlaneSequence* planes,
+	const GcRankIndex* index)
+{
+	using Segment = std::tuple<uint64_t, uint64_t, double, std::string>;
+
+	SegmentPipelineResult result;
+	SpscQueue<Segment> segmentQueue(PIPELINE_QUEUE_CAPACITY);
+	SpscQueue<Segment> mergedQueue(PIPELINE_QUEUE_CAPACITY);
+	std::exception_ptr mergeError;
+	std::exception_ptr gcError;
+
+	// The consumers block on their queues, so they get their own threads rather than pool tasks
+	std::thread mergeThread([&]()
+		{
+			TRACE_SCOPE("pipelined merge");
+			try
+			{
+				// A run of adjacent segments whose words are rotations of each other becomes one
+				// segment; rotation is an equivalence, so growing runs left to right gives the
+				// same runs as MergeSimilarSegments
+				Segment segment;
+				bool hasRun = false;
+				uint64_t runStart = 0;
+				uint64_t runEnd = 0;
+				std::string runWord;
+
+				auto finishRun = [&]()
+				{
+					std::string_view runSequence(sequence.data() + runStart, runEnd - runStart);
+					auto [cost, word] = CalculatePercentageSumAndWord(GenerateOccurrenceMatrix(runSequence, settings.wordSize));
+					result.merged.emplace_back(runStart, runEnd, cost, word);
+					mergedQueue.push(result.merged.back());
+				};
+
+				while (segmentQueue.pop(segment))
+				{
+					const auto& [start, end, cost, word] = segment;
+					if (hasRun && start == runEnd && MergeCondition(word, runWord))
+					{
+						runEnd = end;
+					}
+					else
+					{
+						if (hasRun)
+						{
+							finishRun();
+						}
+						hasRun = true;
+						runStart = start;
+						runEnd = end;
+						runWord = word;
+					}
+					result.segments.push_back(std::move(segment));
+				}
+				if (hasRun)
+				{
+					finishRun();
+				}
+			}
+			catch (...)
+			{
+				mergeError = std::current_exception();
+				segmentQueue.close();
+			}
+			mergedQueue.close();
+		});
+
+	std::thread gcThread([&]()
+		{
+			TRACE_SCOPE("pipelined GC annotation");
+			try
+			{
+				Segment segment;
+				while (mergedQueue.pop(segment))
+				{
+					result.withGc.push_back(segmentWithGCContent(sequence, segment, planes, index));
+				}
+			}
+			catch (...)
+			{
+				gcError = std::current_exception();
+				mergedQueue.close();
+			}
+		});
+
+	std::exception_ptr segmentError;
+	try
+	{
+		SegmentContigsStreaming(sequence, contigs, settings,
+			[&](Segment&& segment)
+			{
+				segmentQueue.push(std::move(segment));
+			},
+			&result.stats);
+	}
+	catch (...)
+	{
+		segmentError = std::current_exception();
+	}
+	segmentQueue.close();
+
+	mergeThread.join();
+	gcThread.join();
+
+	for (const auto& error : { segmentError, mergeError, gcError })
+	{
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+	return result;
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "Segment.h"
+#include "Isochore.h"
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+// Segments held between two stages of the pipeline before the producer waits
+const size_t PIPELINE_QUEUE_CAPACITY = 4096;
+
+/// <summary>
+/// Bounded lock-free queue between exactly one producer and one consumer thread. Both ends only
+/// advance their own counter, and a thread that finds the ring full or empty sleeps on the other
+/// counter with an atomic wait instead of a mutex. Closing the queue sets a flag bit in both
+/// counters, so it wakes a waiting consumer (which still drains what is left) as well as a
+/// producer (whose push then fails).
+/// </summary>
+template <typename T>
+class SpscQueue
+{
+public:
+	/// <summary>
+	/// Creates an empty queue holding up to capacity items, rounded up to a power of two.
+	/// </summary>
+	explicit SpscQueue(size_t capacity)
+	{
+		size_t size = 1;
+		while (size < capacity)
+		{
+			size <<= 1;
+		}
+		slots.resize(size);
+		mask = size - 1;
+	}
+
+	/// <summary>
+	/// Appends an item, waiting while the queue is full. Called from the producer thread only.
+	/// </summary>
+	/// <returns>False when the queue was closed and the item was dropped.</returns>
+	bool push(T value)
+	{
+		size_t t = tail.load(std::memory_order_relaxed) & INDEX_MASK;
+		while (true)
+		{
+			size_t h = head.load(std::memory_order_acquire);
+			if (h & CLOSED_BIT)
+			{
+				return false;
+			}
+			if (t - h < slots.size())
+			{
+				break;
+			}
+			head.wait(h, std::memory_order_acquire);
+		}
+
+		slots[t & mask] = std::move(value);
+		tail.fetch_add(1, std::memory_order_release);
+		tail.notify_one();
+		return true;
+	}
+
+	/// <summary>
+	/// Takes the oldest item, waiting while the queue is empty and open. Called from the consumer thread only.
+	/// </summary>
+	/// <returns>False when the queue is closed and every item has been taken.</returns>
+	bool pop(T& value)
+	{
+		size_t h = head.load(std::memory_order_relaxed) & INDEX_MASK;
+		while (true)
+		{
+			size_t t = tail.load(std::memory_order_acquire);
+			if ((t & INDEX_MASK) != h)
+			{
+				break;
+			}
+			if (t & CLOSED_BIT)
+			{
+				return false;
+			}
+			tail.wait(t, std::memory_order_acquire);
+		}
+
+		value = std::move(slots[h & mask]);
+		head.fetch_add(1, std::memory_order_release);
+		head.notify_one();
+		return true;
+	}
+
+	/// <summary>
+	/// Marks the end of the stream, or aborts it when called by the consumer. Either side may call it.
+	/// </summary>
+	void close()
+	{
+		head.fetch_or(CLOSED_BIT, std::memory_order_acq_rel);
+		tail.fetch_or(CLOSED_BIT, std::memory_order_acq_rel);
+		head.notify_all();
+		tail.notify_all();
+	}
+
+private:
+	static constexpr size_t CLOSED_BIT = ~(~size_t(0) >> 1);
+	static constexpr size_t INDEX_MASK = ~CLOSED_BIT;
+
+	std::vector<T> slots;
+	size_t mask = 0;
+	alignas(64) std::atomic<size_t> head{ 0 }; // Items taken by the consumer
+	alignas(64) std::atomic<size_t> tail{ 0 }; // Items added by the producer
+};
+
+// Outputs of the segmentation pipeline, identical to running its stages one after another
+struct SegmentPipelineResult
+{
+	std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> segments;                 // Segments before merging
+	std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> merged;                   // Merged segments
+	std::vector<std::tuple<uint64_t, uint64_t, double, std::string, double, double>> withGc;   // Merged segments with GC and GA content
+	LookaheadStats stats;                                                                      // Lookahead counters of the greedy engine
+};
+
+/// <summary>
+/// Segments the contigs, merges similar neighbouring segments and adds their GC content as one
+/// pipeline: the merge and GC stages run on their own threads and take every segment from a
+/// bounded queue as soon as the segmenter has finalized it, instead of waiting for the whole
+/// segmentation. The results equal SegmentContigs, MergeSimilarSegments and
+/// mergeSegmentsWithGCContent run in sequence.
+/// </summary>
+/// <param name="sequence">The full DNA sequence.</param>
+/// <param name="contigs">Contigs to segment, in sequence order.</param>
+/// <param name="settings">Segmentation engine and its parameters.</param>
+/// <param name="planes">Bitplanes of the sequence, or nullptr to count GC on the characters.</param>
+/// <param name="index">GC rank index of the sequence, or nullptr; takes precedence over planes.</param>
+/// <returns>The segments of every stage.</returns>
+SegmentPipelineResult runSegmentPipeline(
+	std::string_view sequence,
+	const std::vector<SequenceInterval>& contigs,
+	const SegmentationSettings& settings,
+	const BitPlaneSequence* planes = nullptr,
+	const GcRankIndex* index = nullptr);
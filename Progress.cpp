@@ -0,0 +1,173 @@
+#include "Progress.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <streambuf>
+
+static std::atomic<bool> progressReporting{ true };
+
+// Buffer that std::cout output of this thread goes to, or null to write it to the console
+static thread_local std::string* consoleCapture = nullptr;
+
+/// <summary>
+/// Stream buffer put in front of the console buffer of std::cout. Output of a thread with a
+/// capture buffer is appended to it; everything else is passed on under a lock.
+/// </summary>
+class ConsoleRouter : public std::streambuf
+{
+public:
+	explicit ConsoleRouter(std::streambuf* console) : console(console) {}
+
+	// Writes text that was held back, in one piece
+	void write(const std::string& text)
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		console->sputn(text.data(), static_cast<std::streamsize>(text.size()));
+		console->pubsync();
+	}
+
+protected:
+	int_type overflow(int_type c) override
+	{
+		if (traits_type::eq_int_type(c, traits_type::eof()))
+		{
+			return traits_type::not_eof(c);
+		}
+		char character = traits_type::to_char_type(c);
+		return xsputn(&character, 1) == 1 ? c : traits_type::eof();
+	}
+
+	std::streamsize xsputn(const char* text, std::streamsize count) override
+	{
+		if (consoleCapture != nullptr)
+		{
+			consoleCapture->append(text, static_cast<size_t>(count));
+			return count;
+		}
+		std::lock_guard<std::mutex> lock(mtx);
+		return console->sputn(text, count);
+	}
+
+	int sync() override
+	{
+		if (consoleCapture != nullptr)
+		{
+			return 0;
+		}
+		std::lock_guard<std::mutex> lock(mtx);
+		return console->pubsync();
+	}
+
+private:
+	std::streambuf* console;
+	std::mutex mtx;
+};
+
+// Installed in front of std::cout on first use and kept for the life of the process, since
+// std::cout is still flushed after static objects are destroyed
+static ConsoleRouter& consoleRouter()
+{
+	static ConsoleRouter* router = []()
+	{
+		auto* installed = new ConsoleRouter(std::cout.rdbuf());
+		std::cout.rdbuf(installed);
+		return installed;
+	}();
+	return *router;
+}
+
+void routeConsoleOutput()
+{
+	consoleRouter();
+}
+
+BufferedConsoleOutput::BufferedConsoleOutput()
+	: previous(consoleCapture)
+{
+	consoleRouter();
+	consoleCapture = &text;
+}
+
+BufferedConsoleOutput::~BufferedConsoleOutput()
+{
+	consoleCapture = previous;
+	if (previous != nullptr)
+	{
+		*previous += text;
+	}
+	else if (!text.empty())
+	{
+		consoleRouter().write(text);
+	}
+}
+
+void setProgressReporting(bool enabled)
+{
+	progressReporting.store(enabled);
+}
+
+bool progressReportingEnabled()
+{
+	return progressReporting.load();
+}
+
+ProgressReporter::ProgressReporter(uint64_t total)
+	: total(total)
+{
+	if (progressReportingEnabled() && consoleCapture == nullptr)
+	{
+		thread = std::thread(&ProgressReporter::report, this);
+	}
+}
+
+void ProgressReporter::stop()
+{
+	running.store(false);
+	if (thread.joinable())
+	{
+		thread.join();
+	}
+}
+
+/// <summary>
+/// Prints the progress and elapsed time every second until the reporter is destroyed.
+/// </summary>
+void ProgressReporter::report()
+{
+	auto startTime = std::chrono::high_resolution_clock::now(); // Start time
+
+	while (running.load())
+	{
+		// Update every second, but notice the end of the call within a few milliseconds so
+		// joining this thread does not add up to a second to every call
+		for (int slice = 0; slice < 1000 && running.load(); ++slice)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		if (!running.load())
+		{
+			break;
+		}
+
+		double percentage = (static_cast<double>(done.load(std::memory_order_relaxed))
+			/ std::max<uint64_t>(1, total)) * 100;
+
+		// Calculate elapsed time
+		auto currentTime = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double> elapsed = currentTime - startTime;
+
+		// Convert elapsed time to hours, minutes, and seconds
+		int totalSeconds = static_cast<int>(elapsed.count());
+		int hours = totalSeconds / 3600;
+		int minutes = (totalSeconds % 3600) / 60;
+		int seconds = totalSeconds % 60;
+
+		// Output the current progress and elapsed time
+		std::cout << "\rProgress: " << std::fixed << std::setprecision(4)
+			<< percentage << "% completed. Elapsed time: "
+			<< hours << "h:" << minutes << "m:" << seconds << "s." << std::flush;
+	}
+}
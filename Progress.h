@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+/// <summary>
+/// Turns the progress lines printed by every ProgressReporter on or off; on by default. The
+/// server turns them off, so concurrent jobs do not write to its standard output.
+/// </summary>
+void setProgressReporting(bool enabled);
+
+/// <summary>
+/// True when new ProgressReporters print their progress.
+/// </summary>
+bool progressReportingEnabled();
+
+/// <summary>
+/// Puts the buffer that BufferedConsoleOutput relies on in front of std::cout, once per process.
+/// </summary>
+void routeConsoleOutput();
+
+/// <summary>
+/// Holds back everything the constructing thread writes to std::cout and writes it in one piece
+/// when destroyed, so a stage running beside another does not interleave its lines with the other
+/// stage's. Progress reporters created on the thread meanwhile stay silent. Call
+/// routeConsoleOutput before starting the threads that buffer their output.
+/// </summary>
+class BufferedConsoleOutput
+{
+public:
+	BufferedConsoleOutput();
+	~BufferedConsoleOutput();
+
+	BufferedConsoleOutput(const BufferedConsoleOutput&) = delete;
+	BufferedConsoleOutput& operator=(const BufferedConsoleOutput&) = delete;
+
+private:
+	std::string text;
+	std::string* previous; // Buffer of an enclosing BufferedConsoleOutput on this thread, or null
+};
+
+/// <summary>
+/// Progress of one call. Workers add the work they finished; while reporting is on, a thread
+/// prints the percentage and elapsed time every second until the reporter is destroyed.
+/// Concurrent calls each own a reporter, so they never reset or stop each other's progress.
+/// </summary>
+class ProgressReporter
+{
+public:
+	/// <param name="total">Amount of work of the whole call, e.g. bases to segment.</param>
+	explicit ProgressReporter(uint64_t total);
+
+	/// <summary>
+	/// Stops the printing thread.
+	/// </summary>
+	~ProgressReporter() { stop(); }
+
+	ProgressReporter(const ProgressReporter&) = delete;
+	ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+	/// <summary>
+	/// Adds finished work; safe to call from any thread.
+	/// </summary>
+	void add(uint64_t amount) { done.fetch_add(amount, std::memory_order_relaxed); }
+
+	/// <summary>
+	/// Sets the finished work, for calls that measure progress as a position.
+	/// </summary>
+	void set(uint64_t amount) { done.store(amount, std::memory_order_relaxed); }
+
+	/// <summary>
+	/// Stops printing before the call reports its own results.
+	/// </summary>
+	void stop();
+
+private:
+	void report();
+
+	std::atomic<uint64_t> done{ 0 };
+	const uint64_t total;
+	std::atomic<bool> running{ true };
+	std::thread thread; // Not started while reporting is off
+};
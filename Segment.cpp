@@ -1,82 +1,103 @@
 #include "Segment.h"
-
-std::mutex mtx; // Mutex for thread safety
-uint64_t progress = static_cast<uint64_t>(0.0); // Shared progress variable
-bool running = true; // Control variable for the progress thread
-uint64_t totalsize = 100;
+#include "CsvWriter.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "Progress.h"
 
 /// <summary>
-/// Function to update and display progress at regular intervals.
+/// Collects the per-column maximum and total counts of an occurrence matrix.
 /// </summary>
-static void updateProgress()
+/// <param name="matrix">The occurrence matrix.</param>
+/// <param name="maxValues">Receives the highest count of every column.</param>
+/// <param name="totals">Receives the total count of every column.</param>
+static void CollectColumnCounts(const std::vector<std::vector<int>>& matrix, std::vector<int>& maxValues, std::vector<int>& totals)
 {
-	auto startTime = std::chrono::high_resolution_clock::now(); // Start time
+	size_t numColumns = matrix[0].size();
+	maxValues.assign(numColumns, 0);
+	totals.assign(numColumns, 0);
+	for (size_t col = 0; col < numColumns; ++col)
+	{
+		for (int row = 0; row < 4; ++row)
+		{
+			totals[col] += matrix[row][col];
+			maxValues[col] = std::max(maxValues[col], matrix[row][col]);
+		}
+	}
+}
 
-	while (running)
+/// <summary>
+/// Upper bound of the left + right score after moving the boundary a number of words further.
+/// Every step adds one word to the left segment, so a left column can reach at most
+/// (max + d) / (total + d); the right segment drops and gains one word, so a right column can
+/// reach at most (max + d) / (total - d).
+/// </summary>
+/// <param name="leftMax">Per-column maximum counts of the left matrix.</param>
+/// <param name="leftTotal">Per-column total counts of the left matrix.</param>
+/// <param name="rightMax">Per-column maximum counts of the right matrix.</param>
+/// <param name="rightTotal">Per-column total counts of the right matrix.</param>
+/// <param name="steps">Number of words the boundary moves.</param>
+/// <returns>An upper bound of the total score reachable after the given number of steps.</returns>
+static double LookaheadUpperBound(const std::vector<int>& leftMax, const std::vector<int>& leftTotal,
+	const std::vector<int>& rightMax, const std::vector<int>& rightTotal, uint64_t steps)
+{
+	double bound = 0.0;
+	double d = static_cast<double>(steps);
+	for (size_t col = 0; col < leftMax.size(); ++col)
 	{
-		std::this_thread::sleep_for(std::chrono::seconds(1)); // Update every 10 seconds
-
-		// Lock the mutex to safely access the progress variable
-		std::lock_guard<std::mutex> lock(mtx);// Ensure thread safety while accessing shared variables
-		double percentage = (static_cast<double>(progress) / totalsize) * 100;
-
-		// Calculate elapsed time
-		auto currentTime = std::chrono::high_resolution_clock::now();
-		std::chrono::duration<double> elapsed = currentTime - startTime;
-
-		// Convert elapsed time to hours, minutes, and seconds
-		int totalSeconds = static_cast<int>(elapsed.count());
-		int hours = totalSeconds / 3600;
-		int minutes = (totalSeconds % 3600) / 60;
-		int seconds = totalSeconds % 60;
-
-		// Output the current progress and elapsed time
-		std::cout << "\rProgress: " << std::fixed << std::setprecision(4)
-			<< percentage << "% completed. Elapsed time: "
-			<< hours << "h:" << minutes << "m:" << seconds << "s." << std::flush;
+		bound += (leftTotal[col] + d > 0) ? std::min(1.0, (leftMax[col] + d) / (leftTotal[col] + d)) : 0.0;
+		bound += (rightTotal[col] - d > 0) ? std::min(1.0, (rightMax[col] + d) / (rightTotal[col] - d)) : 1.0;
 	}
+	return bound;
 }
 
 /// <summary>
-/// Segments a DNA sequence based on calculated costs and best words.
+/// Greedy segmentation of one range of the sequence; the caller owns the progress reporter.
 /// </summary>
-/// <param name="sequence">The DNA sequence to segment.</param>
+/// <param name="sequence">The part of the DNA sequence to segment.</param>
+/// <param name="offset">Position of the range in the full sequence, added to every segment.</param>
 /// <param name="minSegmentSize">Minimum size of each segment (in words).</param>
 /// <param name="wordSize">Size of each word in nucleotides.</param>
 /// <param name="lookaheadSize">Number of steps to look ahead when searching for optimal segments.</param>
+/// <param name="pruneByBound">Skip lookahead candidates whose score upper bound cannot beat the best score.</param>
+/// <param name="stats">Counters of evaluated and pruned lookahead candidates.</param>
+/// <param name="progress">Receives the bases segmented.</param>
+/// <param name="onSegment">Optional callback receiving every segment as soon as it is final.</param>
+/// <param name="cancelled">Optional flag; once set, segmentation stops and returns the segments found so far.</param>
 /// <returns>A vector of tuples containing start, end, cost, and best word for each segment.</returns>
-std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> SegmentDNACostAndWord(
-	const std::string& sequence,
+static std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> SegmentGreedyRange(
+	std::string_view sequence,
+	uint64_t offset,
 	int minSegmentSize,
 	int wordSize,
-	int lookaheadSize)
+	int lookaheadSize,
+	bool pruneByBound,
+	LookaheadStats& stats,
+	ProgressReporter& progress,
+	const std::function<void(const std::tuple<uint64_t, uint64_t, double, std::string>&)>* onSegment = nullptr,
+	const std::atomic<bool>* cancelled = nullptr)
 {
-	std::thread progressThread(updateProgress);
-
-
-	if (sequence.size() < static_cast<size_t>(minSegmentSize * wordSize))
-	{
-		throw std::invalid_argument("Sequence length must be at least the minimum segment size in words.");
-	}
-
+	TRACE_SCOPE_VALUE("segment chunk", offset);
 	std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> segments;
 	uint64_t currentStart = 0; // Starting position of the current segment
 	uint64_t n = sequence.size();
 	std::vector<std::vector<int>> leftMatrix, rightMatrix, bestRightMatrix;
+	std::vector<int> leftMax, leftTotal, rightMax, rightTotal; // Column counts for the pruning bound
+	uint64_t reportedStart = 0; // Part of this range already added to the shared progress
 
 	while (currentStart < n)
 	{
-		// Lock the mutex to safely update the progress variable
+		if (cancelled != nullptr && cancelled->load(std::memory_order_relaxed))
 		{
-			std::lock_guard<std::mutex> lock(mtx);
-			progress = currentStart; // Update progress
-			totalsize = n;
+			break;
 		}
+		progress.add(currentStart - reportedStart); // Update progress
+		reportedStart = currentStart;
 
 		double bestScore = -1.0; // Track the best score in the current lookahead window
 		uint64_t bestEnd = 0;        // Track the ending position of the best segment
 		std::pair<double, std::string> bestSegment;
 		int bestLookaheadStep = 0; // Track how far into the lookahead the max was found
+		int skipUntil = 0;         // Candidates up to this step cannot beat bestScore
 
 		// Initialize the left and right segment sizes
 		int leftSegmentSizeTemp = minSegmentSize * wordSize;
@@ -105,24 +126,26 @@ std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> SegmentDNACostA
 			{
 				//Left Matrix Calculation
 				uint64_t startOfSegmentToAdd = (currentStart + leftSegmentSize) - wordSize;
-				std::string_view leftSegmentToAdd(sequence.data() + startOfSegmentToAdd, wordSize);
-				auto leftMatrixToAdd = GenerateOccurrenceMatrix(leftSegmentToAdd, wordSize);
-				leftMatrix = sumMatrices(leftMatrix, leftMatrixToAdd);
+				AddWordToOccurrenceMatrix(leftMatrix, std::string_view(sequence.data() + startOfSegmentToAdd, wordSize));
 				//COST FUNC HERE
 				uint64_t startOfSegmentToRemove = (currentEnd - wordSize);
 
 				//Right Matrix Calculation
-				std::string_view leftSegmentToRemove(sequence.data() + startOfSegmentToRemove, wordSize);
-				auto leftMatrixToRemove = GenerateOccurrenceMatrix(leftSegmentToRemove, wordSize);
-				rightMatrix = subtractMatrices(rightMatrix, leftMatrixToRemove);
+				RemoveWordFromOccurrenceMatrix(rightMatrix, std::string_view(sequence.data() + startOfSegmentToRemove, wordSize));
 
 				uint64_t startOfSegmentToAddFromRight = (currentEnd + rightSegmentSize) - wordSize;
-				std::string_view rightSegmentToAdd(sequence.data() + startOfSegmentToAddFromRight, wordSize);
-				auto rightMatrixToAdd = GenerateOccurrenceMatrix(rightSegmentToAdd, wordSize);
-				rightMatrix = sumMatrices(rightMatrix, rightMatrixToAdd);
+				AddWordToOccurrenceMatrix(rightMatrix, std::string_view(sequence.data() + startOfSegmentToAddFromRight, wordSize));
 				//Cost Function HERE
 			}
 
+			if (i <= skipUntil && i != 0)
+			{
+				// The bound proved this candidate cannot beat bestScore; only the matrices move on
+				stats.pruned++;
+				leftSegmentSize += wordSize;
+				continue;
+			}
+			stats.evaluated++;
 
 			// Calculate costs for the left and right segments
 			auto left = CalculatePercentageSumAndWord(leftMatrix);
@@ -141,6 +164,34 @@ std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> SegmentDNACostA
 				bestRightMatrix = rightMatrix;
 			}
 
+			if (pruneByBound && i + 1 < lookaheadSize)
+			{
+				// Steps that are still inside the sequence
+				uint64_t remaining = static_cast<uint64_t>(lookaheadSize - 1 - i);
+				remaining = std::min(remaining, (n - currentEnd - rightSegmentSize) / wordSize);
+
+				CollectColumnCounts(leftMatrix, leftMax, leftTotal);
+				CollectColumnCounts(rightMatrix, rightMax, rightTotal);
+				const double margin = 1e-9; // Keep rounding from ever pruning a tie or a winner
+
+				if (LookaheadUpperBound(leftMax, leftTotal, rightMax, rightTotal, remaining) < bestScore - margin)
+				{
+					// No later candidate can win: stop the lookahead here
+					stats.pruned += remaining;
+					break;
+				}
+
+				// The bound grows with the distance, so find the furthest step it still rules out
+				uint64_t low = 0, high = remaining;
+				while (low + 1 < high)
+				{
+					uint64_t mid = (low + high) / 2;
+					if (LookaheadUpperBound(leftMax, leftTotal, rightMax, rightTotal, mid) < bestScore - margin) low = mid;
+					else high = mid;
+				}
+				skipUntil = i + static_cast<int>(low);
+			}
+
 			// Adjust the left and right segment sizes for the next iteration
 			leftSegmentSize += wordSize; // Add one word to the left segment
 			currentEnd += wordSize;      // Move the right segment one word forward
@@ -156,7 +207,11 @@ std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> SegmentDNACostA
 		// Add the best left segment to the results and move the current start position
 		if (bestEnd != 0)
 		{
-			segments.emplace_back(currentStart, bestEnd, bestSegment.first, bestSegment.second);
+			segments.emplace_back(offset + currentStart, offset + bestEnd, bestSegment.first, bestSegment.second);
+			if (onSegment)
+			{
+				(*onSegment)(segments.back());
+			}
 			currentStart = bestEnd; // Move the start position to the end of the best segment
 			leftMatrix = bestRightMatrix;
 			rightMatrix.clear();
@@ -167,13 +222,403 @@ std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> SegmentDNACostA
 		}
 	}
 
-	// Stop the progress thread
-	running = false;
-	progressThread.join(); // Wait for the progress thread to finish
+	return segments;
+}
+
+/// <summary>
+/// Segments a DNA sequence based on calculated costs and best words.
+/// </summary>
+/// <param name="sequence">The DNA sequence to segment.</param>
+/// <param name="minSegmentSize">Minimum size of each segment (in words).</param>
+/// <param name="wordSize">Size of each word in nucleotides.</param>
+/// <param name="lookaheadSize">Number of steps to look ahead when searching for optimal segments.</param>
+/// <param name="pruneByBound">Skip lookahead candidates whose score upper bound cannot beat the best score; the result is unchanged.</param>
+/// <param name="stats">Optional counters of evaluated and pruned lookahead candidates.</param>
+/// <returns>A vector of tuples containing start, end, cost, and best word for each segment.</returns>
+std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> SegmentDNACostAndWord(
+	std::string_view sequence,
+	int minSegmentSize,
+	int wordSize,
+	int lookaheadSize,
+	bool pruneByBound,
+	LookaheadStats* stats)
+{
+	if (sequence.size() < static_cast<size_t>(minSegmentSize * wordSize))
+	{
+		throw std::invalid_argument("Sequence length must be at least the minimum segment size in words.");
+	}
+
+	LookaheadStats localStats;
+	std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> segments;
+	{
+		ProgressReporter progress(sequence.size());
+		segments = SegmentGreedyRange(sequence, 0, minSegmentSize, wordSize, lookaheadSize, pruneByBound, localStats, progress);
+	}
+
+	if (stats != nullptr)
+	{
+		*stats = localStats;
+	}
+
+	return segments;
+}
+
+/// <summary>
+/// Optimal segmentation of one range of the sequence; the caller owns the progress reporter.
+/// </summary>
+/// <param name="sequence">The part of the DNA sequence to segment (at least minSegmentSize words).</param>
+/// <param name="offset">Position of the range in the full sequence, added to every segment.</param>
+/// <param name="minSegmentSize">Minimum size of each segment (in words).</param>
+/// <param name="wordSize">Size of each word in nucleotides.</param>
+/// <param name="penalty">Cost subtracted for every segment.</param>
+/// <param name="progress">Receives the bases segmented.</param>
+/// <param name="cancelled">Optional flag; once set, segmentation stops and returns no segments.</param>
+/// <returns>A vector of tuples containing start, end, cost, and best word for each segment.</returns>
+static std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> SegmentOptimalRange(
+	std::string_view sequence,
+	uint64_t offset,
+	int minSegmentSize,
+	int wordSize,
+	double penalty,
+	ProgressReporter& progress,
+	const std::atomic<bool>* cancelled = nullptr)
+{
+	TRACE_SCOPE_VALUE("segment chunk", offset);
+
+	// Boundaries are placed on word positions, the same grid the greedy engine uses
+	uint64_t n = sequence.size();
+	uint64_t totalWords = n / wordSize;
+	if (totalWords > std::numeric_limits<uint32_t>::max())
+	{
+		throw std::invalid_argument("Sequence is too long for the optimal engine; segment it per chromosome.");
+	}
+
+	// A candidate is a possible start of the last segment, together with the occurrence
+	// matrix of everything between it and the current position.
+	struct Candidate
+	{
+		uint64_t word;                         // Boundary position in words
+		double score;                          // Best objective of the sequence up to this boundary
+		uint64_t expiresAt;                    // First position at which it can no longer be optimal
+		std::vector<std::vector<int>> matrix;  // Occurrences from the boundary to the current position
+	};
+
+	const double minusInfinity = -std::numeric_limits<double>::infinity();
+	ScratchScope scratch; // Per-word traceback from the thread's arena, reused by the next contig
+	uint32_t* previousBoundary = scratch.allocate<uint32_t>(totalWords + 1);
+	std::fill(previousBoundary, previousBoundary + totalWords + 1, 0);
+	std::vector<Candidate> candidates;
+	candidates.push_back({ 0, 0.0, std::numeric_limits<uint64_t>::max(), std::vector<std::vector<int>>(4, std::vector<int>(wordSize, 0)) });
+	std::vector<double> candidateCosts;
+	double bestFinalScore = minusInfinity;
+	const uint64_t progressInterval = 10000; // Words between progress updates
+
+	for (uint64_t t = 1; t <= totalWords; ++t)
+	{
+		if (t % progressInterval == 0)
+		{
+			progress.add(progressInterval * wordSize);
+			if (cancelled != nullptr && cancelled->load(std::memory_order_relaxed))
+			{
+				return {};
+			}
+		}
+
+		// Drop candidates that a later boundary has dominated for every reachable end
+		candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+			[t](const Candidate& c) { return c.expiresAt <= t; }), candidates.end());
+
+		// Extend every open segment by the next word
+		std::string_view word(sequence.data() + (t - 1) * wordSize, wordSize);
+		for (auto& candidate : candidates)
+		{
+			AddWordToOccurrenceMatrix(candidate.matrix, word);
+		}
+
+		// Best objective for a segmentation ending exactly at t
+		double bestScore = minusInfinity;
+		uint64_t bestCandidate = 0;
+		candidateCosts.resize(candidates.size());
+		for (size_t c = 0; c < candidates.size(); ++c)
+		{
+			candidateCosts[c] = CalculatePercentageSum(candidates[c].matrix);
+			if (t - candidates[c].word < static_cast<uint64_t>(minSegmentSize))
+			{
+				continue;
+			}
+			double score = candidates[c].score + candidateCosts[c] - penalty;
+			if (score > bestScore)
+			{
+				bestScore = score;
+				bestCandidate = candidates[c].word;
+			}
+		}
+
+		if (t == totalWords)
+		{
+			previousBoundary[t] = static_cast<uint32_t>(bestCandidate);
+			bestFinalScore = bestScore;
+			break;
+		}
+
+		if (bestScore == minusInfinity)
+		{
+			continue; // t is too close to the start to end a segment
+		}
+		previousBoundary[t] = static_cast<uint32_t>(bestCandidate);
+
+		// PELT pruning. The cost is subadditive (a column's max fraction over a union never exceeds
+		// the sum of the parts), so a candidate that cannot beat t now never beats t later. It stays
+		// usable until t itself becomes a legal start, minSegmentSize words from now.
+		for (size_t c = 0; c < candidates.size(); ++c)
+		{
+			if (candidates[c].score + candidateCosts[c] <= bestScore)
+			{
+				candidates[c].expiresAt = std::min(candidates[c].expiresAt, t + minSegmentSize);
+			}
+		}
+
+		candidates.push_back({ t, bestScore, std::numeric_limits<uint64_t>::max(), std::vector<std::vector<int>>(4, std::vector<int>(wordSize, 0)) });
+	}
+
+	std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> segments;
+	if (bestFinalScore == minusInfinity)
+	{
+		return segments;
+	}
+
+	// Trace the boundaries back; the last segment absorbs any trailing partial word
+	std::vector<uint64_t> boundaries;
+	for (uint64_t t = totalWords; t > 0; t = previousBoundary[t])
+	{
+		boundaries.push_back(t);
+	}
+	boundaries.push_back(0);
+	std::reverse(boundaries.begin(), boundaries.end());
+
+	for (size_t i = 0; i + 1 < boundaries.size(); ++i)
+	{
+		uint64_t start = boundaries[i] * wordSize;
+		uint64_t end = (i + 2 == boundaries.size()) ? n : boundaries[i + 1] * wordSize;
+		std::string_view segment(sequence.data() + start, end - start);
+		auto [cost, bestWord] = CalculatePercentageSumAndWord(GenerateOccurrenceMatrix(segment, wordSize));
+		segments.emplace_back(offset + start, offset + end, cost, bestWord);
+	}
 
 	return segments;
 }
 
+/// <summary>
+/// Segments a DNA sequence into the globally optimal set of segments, maximizing the sum of
+/// segment costs minus a fixed penalty per segment. Uses PELT-style pruning of candidate
+/// boundaries so the expected run time stays close to linear.
+/// </summary>
+/// <param name="sequence">The DNA sequence to segment.</param>
+/// <param name="minSegmentSize">Minimum size of each segment (in words).</param>
+/// <param name="wordSize">Size of each word in nucleotides.</param>
+/// <param name="penalty">Cost subtracted for every segment; must exceed wordSize / 4 to avoid minimum-length segmentations.</param>
+/// <returns>A vector of tuples containing start, end, cost, and best word for each segment.</returns>
+std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> SegmentDNAOptimal(
+	std::string_view sequence,
+	int minSegmentSize,
+	int wordSize,
+	double penalty)
+{
+	if (sequence.size() < static_cast<size_t>(minSegmentSize * wordSize))
+	{
+		throw std::invalid_argument("Sequence length must be at least the minimum segment size in words.");
+	}
+
+	ProgressReporter progress(sequence.size());
+	return SegmentOptimalRange(sequence, 0, minSegmentSize, wordSize, penalty, progress);
+}
+
+/// <summary>
+/// Segments every contig of a sequence as an independent parallel task, skipping the
+/// assembly gaps between them. Contigs shorter than the minimum segment size are skipped.
+/// </summary>
+/// <param name="sequence">The full DNA sequence.</param>
+/// <param name="contigs">Contigs to segment, in sequence order.</param>
+/// <param name="settings">Segmentation engine and its parameters.</param>
+/// <param name="stats">Optional counters of evaluated and pruned lookahead candidates (greedy engine).</param>
+/// <returns>The segments of all contigs in sequence order.</returns>
+std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> SegmentContigs(
+	std::string_view sequence,
+	const std::vector<SequenceInterval>& contigs,
+	const SegmentationSettings& settings,
+	LookaheadStats* stats)
+{
+	std::vector<std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>> contigSegments(contigs.size());
+	std::vector<LookaheadStats> contigStats(contigs.size());
+	uint64_t minLength = static_cast<uint64_t>(settings.minSegmentSize) * settings.wordSize;
+
+	uint64_t totalLength = 0;
+	for (const auto& contig : contigs)
+	{
+		totalLength += contig.end - contig.start;
+	}
+	ProgressReporter progress(totalLength);
+
+	ParallelFor(contigs.size(), [&](size_t i)
+		{
+			uint64_t length = contigs[i].end - contigs[i].start;
+			if (length < minLength)
+			{
+				return;
+			}
+
+			std::string_view contig(sequence.data() + contigs[i].start, length);
+			if (settings.optimal)
+			{
+				contigSegments[i] = SegmentOptimalRange(contig, contigs[i].start, settings.minSegmentSize, settings.wordSize, settings.penalty, progress);
+			}
+			else
+			{
+				contigSegments[i] = SegmentGreedyRange(contig, contigs[i].start, settings.minSegmentSize, settings.wordSize,
+					settings.lookaheadSize, settings.pruneByBound, contigStats[i], progress);
+			}
+		});
+
+	std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> segments;
+	LookaheadStats totalStats;
+	for (size_t i = 0; i < contigs.size(); ++i)
+	{
+		segments.insert(segments.end(), std::make_move_iterator(contigSegments[i].begin()), std::make_move_iterator(contigSegments[i].end()));
+		totalStats.evaluated += contigStats[i].evaluated;
+		totalStats.pruned += contigStats[i].pruned;
+	}
+
+	if (stats != nullptr)
+	{
+		*stats = totalStats;
+	}
+
+	return segments;
+}
+
+/// <summary>
+/// Segments the contigs like SegmentContigs, but hands every segment to emit as soon as all
+/// segments before it in sequence order are final. The greedy engine releases segments while
+/// its contig is still being segmented; the optimal engine releases a contig when it is done.
+/// </summary>
+/// <param name="sequence">The full DNA sequence.</param>
+/// <param name="contigs">Contigs to segment, in sequence order.</param>
+/// <param name="settings">Segmentation engine and its parameters.</param>
+/// <param name="emit">Called with every segment in sequence order, from one thread at a time.</param>
+/// <param name="stats">Optional counters of evaluated and pruned lookahead candidates (greedy engine).</param>
+/// <param name="cancelled">Optional flag; once set, contigs not yet started are skipped, running ones
+/// stop early and no further segments are emitted.</param>
+void SegmentContigsStreaming(
+	std::string_view sequence,
+	const std::vector<SequenceInterval>& contigs,
+	const SegmentationSettings& settings,
+	const std::function<void(std::tuple<uint64_t, uint64_t, double, std::string>&&)>& emit,
+	LookaheadStats* stats,
+	const std::atomic<bool>* cancelled)
+{
+	// Segments of a contig wait here until every contig before it has been released
+	struct ContigOutput
+	{
+		std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> pending;
+		bool done = false;
+	};
+	std::vector<ContigOutput> outputs(contigs.size());
+	std::vector<LookaheadStats> contigStats(contigs.size());
+	std::mutex releaseMtx;
+	size_t releaseNext = 0; // First contig not completely released
+	uint64_t minLength = static_cast<uint64_t>(settings.minSegmentSize) * settings.wordSize;
+
+	auto isCancelled = [cancelled]() { return cancelled != nullptr && cancelled->load(std::memory_order_relaxed); };
+
+	// Releases everything that is now in order; called with releaseMtx held
+	auto release = [&]()
+	{
+		while (releaseNext < contigs.size() && !isCancelled())
+		{
+			ContigOutput& output = outputs[releaseNext];
+			for (auto& segment : output.pending)
+			{
+				emit(std::move(segment));
+			}
+			output.pending.clear();
+			if (!output.done)
+			{
+				break;
+			}
+			output.pending.shrink_to_fit();
+			++releaseNext;
+		}
+	};
+
+	uint64_t totalLength = 0;
+	for (const auto& contig : contigs)
+	{
+		totalLength += contig.end - contig.start;
+	}
+	ProgressReporter progress(totalLength);
+
+	ParallelFor(contigs.size(), [&](size_t i)
+		{
+			uint64_t length = contigs[i].end - contigs[i].start;
+			std::string_view contig(sequence.data() + contigs[i].start, length);
+			if (length < minLength || isCancelled())
+			{
+				// Nothing to segment
+			}
+			else if (settings.optimal)
+			{
+				auto segments = SegmentOptimalRange(contig, contigs[i].start, settings.minSegmentSize, settings.wordSize, settings.penalty, progress, cancelled);
+				std::lock_guard<std::mutex> lock(releaseMtx);
+				outputs[i].pending = std::move(segments);
+			}
+			else
+			{
+				std::function<void(const std::tuple<uint64_t, uint64_t, double, std::string>&)> onSegment =
+					[&](const std::tuple<uint64_t, uint64_t, double, std::string>& segment)
+					{
+						std::lock_guard<std::mutex> lock(releaseMtx);
+						outputs[i].pending.push_back(segment);
+						if (releaseNext == i)
+						{
+							release();
+						}
+					};
+				SegmentGreedyRange(contig, contigs[i].start, settings.minSegmentSize, settings.wordSize,
+					settings.lookaheadSize, settings.pruneByBound, contigStats[i], progress, &onSegment, cancelled);
+			}
+
+			std::lock_guard<std::mutex> lock(releaseMtx);
+			outputs[i].done = true;
+			release();
+		});
+
+	if (stats != nullptr)
+	{
+		*stats = LookaheadStats();
+		for (const auto& contigStat : contigStats)
+		{
+			stats->evaluated += contigStat.evaluated;
+			stats->pruned += contigStat.pruned;
+		}
+	}
+}
+
+/// <summary>
+/// Calculates the penalized objective of a segmentation (sum of costs minus penalty per segment).
+/// </summary>
+/// <param name="segments">Vector of tuples containing segment data.</param>
+/// <param name="penalty">Penalty charged per segment.</param>
+/// <returns>The total penalized score.</returns>
+double TotalSegmentationScore(const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments, double penalty)
+{
+	double total = 0.0;
+	for (const auto& segment : segments)
+	{
+		total += std::get<2>(segment) - penalty;
+	}
+	return total;
+}
+
 /// <summary>
 /// Saves segmented DNA data to a CSV file.
 /// </summary>
@@ -181,7 +626,8 @@ std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> SegmentDNACostA
 /// <param name="filename">Path to the output CSV file.</param>
 void saveSegmentsToCSV(const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments, const std::string& filename)
 {
-	std::ofstream csvFile(filename);
+	TRACE_SCOPE("save segments");
+	CsvWriter csvFile(filename);
 
 	if (!csvFile.is_open()) {
 		std::cerr << "Error: Could not open the file " << filename << std::endl;
@@ -206,7 +652,8 @@ void saveSegmentsToCSV(const std::vector<std::tuple<uint64_t, uint64_t, double,
 
 void saveSegmentsGcContentToCsv(const std::vector<std::tuple<uint64_t, uint64_t, double, std::string, double, double>>& result, const std::string& outputfile)
 {
-	std::ofstream csvFile(outputfile);
+	TRACE_SCOPE("save GC content");
+	CsvWriter csvFile(outputfile);
 
 	if (!csvFile.is_open()) 
 	{
@@ -233,6 +680,44 @@ void saveSegmentsGcContentToCsv(const std::vector<std::tuple<uint64_t, uint64_t,
 	std::cout << "Segments saved to " << outputfile << std::endl;
 }
 
+/// <summary>
+/// Saves segmented DNA data with GC Content and the soft-masked fraction of every segment to a CSV file.
+/// </summary>
+/// <param name="result">Vector of tuples containing segment data with GC Content</param>
+/// <param name="maskedFractions">Soft-masked fraction of each segment, in the same order.</param>
+/// <param name="outputfile">Path to the output CSV file.</param>
+void saveSegmentsGcContentToCsv(const std::vector<std::tuple<uint64_t, uint64_t, double, std::string, double, double>>& result, const std::vector<double>& maskedFractions, const std::string& outputfile)
+{
+	TRACE_SCOPE("save GC content");
+	CsvWriter csvFile(outputfile);
+
+	if (!csvFile.is_open())
+	{
+		std::cerr << "Error: Could not open the file " << outputfile << std::endl;
+		return;
+	}
+
+	// Write the header row
+	csvFile << "Start,End,Length,Cost,Best Word,GC_Content,GA_content,Masked_Fraction\n";
+
+	// Write each segment to the CSV file
+	for (size_t i = 0; i < result.size(); ++i)
+	{
+		const auto& [start, end, cost, bestWord, gc_content, ga_content] = result[i];
+		csvFile << start << ","
+			<< end << ","
+			<< (end - start) << ","
+			<< cost << ","
+			<< bestWord << ","
+			<< gc_content << ","
+			<< ga_content << ","
+			<< maskedFractions[i] << "\n";
+	}
+
+	csvFile.close();
+	std::cout << "Segments saved to " << outputfile << std::endl;
+}
+
 /// <summary>
 /// Loads segmented DNA data from a CSV file.
 /// </summary>
@@ -303,59 +788,55 @@ bool MergeCondition(std::string a, std::string b) {
 /// <returns>Vector of merged segments with recalculated costs and best words.</returns>
 std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> MergeSimilarSegments(
 	const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments,
-	const std::string& sequence,
+	std::string_view sequence,
 	int wordSize)
 {
+	TRACE_SCOPE("merge");
 
 	if (segments.empty()) {
 		return {};
 	}
-	std::thread progressThread(updateProgress);
-
-
-	std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> mergedSegments;
-	size_t  n = segments.size();
-	int   i = n - 1;
-
-	while (i >= 0)
+	// The runs of segments to merge are found in one backward pass; every run is compared with the
+	// best word of its last segment, so the runs do not depend on each other
+	size_t n = segments.size();
+	std::vector<std::pair<size_t, size_t>> runs; // First and last segment of every run
+	for (size_t i = n; i > 0;)
 	{
-		// Lock the mutex to safely update the progress variable
-		if (i % 10 == 0) 
-		{
-			std::lock_guard<std::mutex> lock(mtx);
-			totalsize = n - 1;
-			progress = totalsize - i; // Update progress
-		}
-		uint64_t start = std::get<0>(segments[i]);
-		uint64_t end = std::get<1>(segments[i]);
-		std::string bestWord = std::get<3>(segments[i]);
-		int count = 1; // Count how many segments were merged
+		size_t last = i - 1;
+		size_t first = last;
+		const std::string& bestWord = std::get<3>(segments[last]);
 
 		// Merge segments that are consecutive and have the same best word
-		while (i > 0 && MergeCondition(std::get<3>(segments[i - 1]), bestWord) && std::get<1>(segments[i - 1]) == start) {
-			--i;
-			start = std::get<0>(segments[i]);
-			++count;
+		while (first > 0 && MergeCondition(std::get<3>(segments[first - 1]), bestWord)
+			&& std::get<1>(segments[first - 1]) == std::get<0>(segments[first]))
+		{
+			--first;
 		}
+		runs.emplace_back(first, last);
+		i = first;
+	}
+	std::reverse(runs.begin(), runs.end());
 
-		// Extract the merged sequence from the original DNA sequence
-		std::string_view mergedSequence(sequence.data() + start, end - start);
-
-		// Generate the new occurrence matrix
-		std::vector<std::vector<int>> newMatrix = GenerateOccurrenceMatrix(mergedSequence, wordSize);
-
-		// Recalculate the new cost and word
-		auto [newCost, newBestWord] = CalculatePercentageSumAndWord(newMatrix);
+	// The new cost and best word of every run are computed as pool tasks
+	std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> mergedSegments(runs.size());
+	ProgressReporter progress(n);
+	const size_t runsPerTask = 1024;
+	ParallelFor((runs.size() + runsPerTask - 1) / runsPerTask, [&](size_t task)
+		{
+			size_t firstRun = task * runsPerTask;
+			size_t lastRun = std::min(runs.size(), firstRun + runsPerTask);
+			for (size_t r = firstRun; r < lastRun; ++r)
+			{
+				uint64_t start = std::get<0>(segments[runs[r].first]);
+				uint64_t end = std::get<1>(segments[runs[r].second]);
 
-		// Store the merged segment with the new cost and best word
-		mergedSegments.emplace_back(start, end, newCost, newBestWord);
-		--i;
-	}
-	// Stop the progress thread
-	running = false;
-	progressThread.join(); // Wait for the progress thread to finish
-	// Reverse the vector because we merged from the end
-	std::reverse(mergedSegments.begin(), mergedSegments.end());
+				// Extract the merged sequence from the original DNA sequence and recalculate its cost and word
+				std::string_view mergedSequence(sequence.data() + start, end - start);
+				auto [newCost, newBestWord] = CalculatePercentageSumAndWord(GenerateOccurrenceMatrix(mergedSequence, wordSize));
+				mergedSegments[r] = { start, end, newCost, std::move(newBestWord) };
+			}
+			progress.add(runs[lastRun - 1].second + 1 - runs[firstRun].first);
+		});
 
 	return mergedSegments;
 }
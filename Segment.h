@@ -1,9 +1,11 @@
 #pragma once
+#include <atomic>
 #include <limits>
 #include <chrono>
 #include <iostream>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <functional>
 #include <thread>
 #include <mutex>
@@ -17,12 +19,21 @@
 #include <iomanip> // For std::setprecision and std::fixed
 #include <algorithm>
 #include "OccurrenceMatrix.h"
+#include "File_DNA.h"
+#include "Parallel.h"
 
 #ifdef _MSC_VER
 #pragma warning(disable : 4244) // Disable int-to-char conversion warning
 #pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
 #endif
 
+// Counters of the lookahead loop in SegmentDNACostAndWord
+struct LookaheadStats
+{
+	uint64_t evaluated = 0; // Candidates whose score was calculated
+	uint64_t pruned = 0;    // Candidates skipped because their upper bound could not beat the best score
+};
+
 /// <summary>
 /// Segments a DNA sequence based on calculated costs and best words.
 /// </summary>
@@ -30,15 +41,89 @@
 /// <param name="minSegmentSize">Minimum size of each segment (in words).</param>
 /// <param name="wordSize">Size of each word in nucleotides.</param>
 /// <param name="lookaheadSize">Number of steps to look ahead when searching for optimal segments.</param>
+/// <param name="pruneByBound">Skip lookahead candidates whose score upper bound cannot beat the best score; the result is unchanged.</param>
+/// <param name="stats">Optional counters of evaluated and pruned lookahead candidates.</param>
 /// <returns>A vector of tuples containing start, end, cost, and best word for each segment.</returns>
 std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> SegmentDNACostAndWord(
-	const std::string& sequence,
+	std::string_view sequence,
 	int minSegmentSize,
 	int wordSize,
-	int lookaheadSize/*,
+	int lookaheadSize,
+	bool pruneByBound = false,
+	LookaheadStats* stats = nullptr/*,
 	const std::function<std::pair<double, std::string>(std::string_view, int)>& costFunction*/
 );
 
+/// <summary>
+/// Segments a DNA sequence into the globally optimal set of segments, maximizing the sum of
+/// segment costs minus a fixed penalty per segment. Uses PELT-style pruning of candidate
+/// boundaries so the expected run time stays close to linear.
+/// </summary>
+/// <param name="sequence">The DNA sequence to segment.</param>
+/// <param name="minSegmentSize">Minimum size of each segment (in words).</param>
+/// <param name="wordSize">Size of each word in nucleotides.</param>
+/// <param name="penalty">Cost subtracted for every segment; must exceed wordSize / 4 to avoid minimum-length segmentations.</param>
+/// <returns>A vector of tuples containing start, end, cost, and best word for each segment.</returns>
+std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> SegmentDNAOptimal(
+	std::string_view sequence,
+	int minSegmentSize,
+	int wordSize,
+	double penalty);
+
+// Segmentation engine and its parameters, used when several contigs are segmented at once
+struct SegmentationSettings
+{
+	int minSegmentSize = 0;     // Minimum size of each segment (in words)
+	int wordSize = 0;           // Size of each word in nucleotides
+	int lookaheadSize = 0;      // Lookahead steps of the greedy engine
+	bool optimal = false;       // Use SegmentDNAOptimal instead of the greedy engine
+	double penalty = 0.0;       // Per-segment penalty of the optimal engine
+	bool pruneByBound = false;  // Bound-and-prune the greedy lookahead loop
+};
+
+/// <summary>
+/// Segments every contig of a sequence as an independent parallel task, skipping the
+/// assembly gaps between them. Contigs shorter than the minimum segment size are skipped.
+/// </summary>
+/// <param name="sequence">The full DNA sequence.</param>
+/// <param name="contigs">Contigs to segment, in sequence order.</param>
+/// <param name="settings">Segmentation engine and its parameters.</param>
+/// <param name="stats">Optional counters of evaluated and pruned lookahead candidates (greedy engine).</param>
+/// <returns>The segments of all contigs in sequence order.</returns>
+std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> SegmentContigs(
+	std::string_view sequence,
+	const std::vector<SequenceInterval>& contigs,
+	const SegmentationSettings& settings,
+	LookaheadStats* stats = nullptr);
+
+/// <summary>
+/// Segments the contigs like SegmentContigs, but hands every segment to emit as soon as all
+/// segments before it in sequence order are final. The greedy engine releases segments while
+/// its contig is still being segmented; the optimal engine releases a contig when it is done.
+/// </summary>
+/// <param name="sequence">The full DNA sequence.</param>
+/// <param name="contigs">Contigs to segment, in sequence order.</param>
+/// <param name="settings">Segmentation engine and its parameters.</param>
+/// <param name="emit">Called with every segment in sequence order, from one thread at a time.</param>
+/// <param name="stats">Optional counters of evaluated and pruned lookahead candidates (greedy engine).</param>
+/// <param name="cancelled">Optional flag; once set, contigs not yet started are skipped, running ones
+/// stop early and no further segments are emitted.</param>
+void SegmentContigsStreaming(
+	std::string_view sequence,
+	const std::vector<SequenceInterval>& contigs,
+	const SegmentationSettings& settings,
+	const std::function<void(std::tuple<uint64_t, uint64_t, double, std::string>&&)>& emit,
+	LookaheadStats* stats = nullptr,
+	const std::atomic<bool>* cancelled = nullptr);
+
+/// <summary>
+/// Calculates the penalized objective of a segmentation (sum of costs minus penalty per segment).
+/// </summary>
+/// <param name="segments">Vector of tuples containing segment data.</param>
+/// <param name="penalty">Penalty charged per segment.</param>
+/// <returns>The total penalized score.</returns>
+double TotalSegmentationScore(const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments, double penalty);
+
 /// <summary>
 /// Saves segmented DNA data to a CSV file.
 /// </summary>
@@ -53,6 +138,14 @@ void saveSegmentsToCSV(const std::vector<std::tuple<uint64_t, uint64_t, double,
 /// <param name="outputfile">Path to the output CSV file.</param>
 void saveSegmentsGcContentToCsv(const std::vector<std::tuple<uint64_t, uint64_t, double, std::string, double, double>>& result, const std::string& outputfile);
 
+/// <summary>
+/// Saves segmented DNA data with GC Content and the soft-masked fraction of every segment to a CSV file.
+/// </summary>
+/// <param name="result">Vector of tuples containing segment data with GC Content</param>
+/// <param name="maskedFractions">Soft-masked fraction of each segment, in the same order.</param>
+/// <param name="outputfile">Path to the output CSV file.</param>
+void saveSegmentsGcContentToCsv(const std::vector<std::tuple<uint64_t, uint64_t, double, std::string, double, double>>& result, const std::vector<double>& maskedFractions, const std::string& outputfile);
+
 /// <summary>
 /// Loads segmented DNA data from a CSV file.
 /// </summary>
@@ -66,7 +159,16 @@ std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> loadSegmentsFro
 /// <param name="a">First DNA sequence.</param>
 /// <param name="b">Second DNA sequence.</param>
 /// <returns>True if b is a cyclic rotation of a; otherwise, false.</returns>
+bool MergeCondition(std::string a, std::string b);
+
+/// <summary>
+/// Merges consecutive similar DNA segments based on cyclic rotation and similarity.
+/// </summary>
+/// <param name="segments">Vector of segments (start, end, cost, best word).</param>
+/// <param name="sequence">Original DNA sequence.</param>
+/// <param name="wordSize">Size of each word in nucleotides.</param>
+/// <returns>Vector of merged segments with recalculated costs and best words.</returns>
 std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> MergeSimilarSegments(
 	const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments,
-	const std::string& sequence,
+	std::string_view sequence,
 	int wordSize);
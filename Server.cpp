@@ -0,0 +1,931 @@
+#include "Server.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <limits>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include "CsvWriter.h"
+#include "Isochore.h"
+#include "IsochoreBoundaries.h"
+#include "Pipeline.h"
+#include "Progress.h"
+#include "Segment.h"
+
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // A client that hangs up must not raise SIGPIPE where the flag exists
+#endif
+
+namespace fs = std::filesystem;
+
+/// <summary>
+/// Parses a request line of the form "COMMAND key=value key=value". The command is upper-cased.
+/// </summary>
+/// <param name="line">Request line without its newline.</param>
+/// <returns>The command and its arguments.</returns>
+ServerRequest parseServerRequest(const std::string& line)
+{
+	ServerRequest request;
+	std::istringstream stream(line);
+	stream >> request.command;
+	std::transform(request.command.begin(), request.command.end(), request.command.begin(),
+		[](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+
+	std::string token;
+	while (stream >> token)
+	{
+		size_t separator = token.find('=');
+		if (separator == std::string::npos)
+		{
+			throw std::invalid_argument("Argument is not key=value: " + token);
+		}
+		request.arguments[token.substr(0, separator)] = token.substr(separator + 1);
+	}
+	return request;
+}
+
+/// <summary>
+/// Loads a FASTA genome with its contigs, bitplanes and GC rank index. The index is read from,
+/// or saved to, "path.gcidx", so later loads of the same genome skip building it.
+/// </summary>
+/// <param name="name">Name requests use for the genome.</param>
+/// <param name="path">FASTA file of the genome.</param>
+/// <returns>The loaded genome.</returns>
+std::shared_ptr<const ServerGenome> loadServerGenome(const std::string& name, const std::string& path)
+{
+	auto genome = std::make_shared<ServerGenome>();
+	genome->name = name;
+	genome->path = path;
+
+	std::vector<SequenceInterval> nRuns;
+	genome->sequence = load_fasta_file(path, nRuns);
+	if (genome->sequence.empty())
+	{
+		throw std::runtime_error("No sequence loaded from " + path);
+	}
+	genome->contigs = find_acgt_contigs(nRuns, genome->sequence.size(), DEFAULT_MIN_GAP_LENGTH);
+	genome->planes = buildBitPlanes(genome->sequence);
+	genome->gcIndex = loadOrBuildGcRankIndex(genome->sequence, path + ".gcidx", path);
+	return genome;
+}
+
+// Parses a numeric argument, naming the argument when it is not a number
+template <typename T, typename Parse>
+static T parseArgument(const std::string& key, const std::string& value, Parse parse)
+{
+	try
+	{
+		size_t used = 0;
+		T result = parse(value, &used);
+		if (used == value.size() && (value.empty() || value[0] != '-'))
+		{
+			return result;
+		}
+	}
+	catch (const std::exception&)
+	{
+	}
+	throw std::invalid_argument("Invalid value for " + key + ": " + value);
+}
+
+// Reads a required unsigned argument
+static uint64_t requiredUInt(const ServerRequest& request, const std::string& key)
+{
+	auto it = request.arguments.find(key);
+	if (it == request.arguments.end())
+	{
+		throw std::invalid_argument("Missing argument: " + key);
+	}
+	return parseArgument<uint64_t>(key, it->second, [](const std::string& v, size_t* used) { return std::stoull(v, used); });
+}
+
+// Reads an optional unsigned argument
+static uint64_t optionalUInt(const ServerRequest& request, const std::string& key, uint64_t defaultValue)
+{
+	auto it = request.arguments.find(key);
+	return it == request.arguments.end() ? defaultValue
+		: parseArgument<uint64_t>(key, it->second, [](const std::string& v, size_t* used) { return std::stoull(v, used); });
+}
+
+// Reads an unsigned argument that the engines take as an int
+static int intArgument(const std::string& key, uint64_t value)
+{
+	if (value > static_cast<uint64_t>(std::numeric_limits<int>::max()))
+	{
+		throw std::invalid_argument("Value of " + key + " is too large: " + std::to_string(value));
+	}
+	return static_cast<int>(value);
+}
+
+// Reads an optional decimal argument
+static double optionalDouble(const ServerRequest& request, const std::string& key, double defaultValue)
+{
+	auto it = request.arguments.find(key);
+	return it == request.arguments.end() ? defaultValue
+		: parseArgument<double>(key, it->second, [](const std::string& v, size_t* used) { return std::stod(v, used); });
+}
+
+// Reads an optional 0/1 flag
+static bool optionalFlag(const ServerRequest& request, const std::string& key)
+{
+	return optionalUInt(request, key, 0) != 0;
+}
+
+// Contigs of the genome clipped to the requested [start, end) region
+static std::vector<SequenceInterval> requestContigs(const ServerGenome& genome, const ServerRequest& request)
+{
+	uint64_t start = optionalUInt(request, "start", 0);
+	uint64_t end = std::min<uint64_t>(optionalUInt(request, "end", genome.sequence.size()), genome.sequence.size());
+
+	std::vector<SequenceInterval> contigs;
+	for (const auto& contig : genome.contigs)
+	{
+		uint64_t clippedStart = std::max(contig.start, start);
+		uint64_t clippedEnd = std::min(contig.end, end);
+		if (clippedStart < clippedEnd)
+		{
+			contigs.push_back({ clippedStart, clippedEnd });
+		}
+	}
+	return contigs;
+}
+
+// Segmentation engine and parameters of a request
+static SegmentationSettings requestSegmentation(const ServerRequest& request)
+{
+	SegmentationSettings settings;
+	settings.wordSize = intArgument("word", requiredUInt(request, "word"));
+	settings.minSegmentSize = intArgument("min", requiredUInt(request, "min"));
+	settings.optimal = (request.arguments.count("engine") && request.arguments.at("engine") == "optimal");
+	settings.lookaheadSize = intArgument("lookahead", settings.optimal ? optionalUInt(request, "lookahead", 0) : requiredUInt(request, "lookahead"));
+	settings.penalty = optionalDouble(request, "penalty", settings.wordSize / 2.0);
+	settings.pruneByBound = optionalFlag(request, "prune");
+	if (settings.wordSize <= 0 || settings.minSegmentSize <= 0)
+	{
+		throw std::invalid_argument("Word size and minimum segment size must be positive.");
+	}
+	if (settings.penalty <= settings.wordSize / 4.0)
+	{
+		throw std::invalid_argument("Penalty must be greater than word size / 4.");
+	}
+	// The engines measure segments and their lookahead in bases as an int
+	if (static_cast<uint64_t>(settings.minSegmentSize) * settings.wordSize > static_cast<uint64_t>(std::numeric_limits<int>::max())
+		|| static_cast<uint64_t>(settings.lookaheadSize) * settings.wordSize > static_cast<uint64_t>(std::numeric_limits<int>::max()))
+	{
+		throw std::invalid_argument("Word size times minimum segment size or lookahead is too large.");
+	}
+	return settings;
+}
+
+// Isochores of the requested region, from the GC rank index of the genome
+static std::vector<Isochore> requestIsochores(const ServerGenome& genome, const ServerRequest& request, const std::vector<SequenceInterval>& contigs)
+{
+	uint64_t windowSize = requiredUInt(request, "window");
+	uint64_t stepSize = requiredUInt(request, "step");
+	if (windowSize == 0 || stepSize == 0)
+	{
+		throw std::invalid_argument("Window and step sizes must be positive.");
+	}
+
+	IsochoreBoundaryDetector boundaries(stepSize, optionalUInt(request, "minlen", DEFAULT_MIN_ISOCHORE_LENGTH),
+		optionalDouble(request, "hysteresis", DEFAULT_ISOCHORE_HYSTERESIS));
+	for (const auto& contig : contigs)
+	{
+		for (uint64_t pos = contig.start; pos + windowSize <= contig.end; pos += stepSize)
+		{
+			uint64_t unknown = genome.gcIndex.unknown(pos, pos + windowSize);
+			double gcPercentage = (unknown < windowSize)
+				? (genome.gcIndex.gc(pos, pos + windowSize) / static_cast<double>(windowSize - unknown)) * 100.0
+				: 0.0;
+			boundaries.addWindow(pos, pos + windowSize, gcPercentage, unknown < windowSize);
+		}
+	}
+	return boundaries.finish();
+}
+
+/// <summary>
+/// Reply of one request: rows are collected in a buffer and sent whenever it fills, so a client
+/// reads the first rows of a long job while the rest are still being computed.
+/// </summary>
+class AnalysisServer::Reply
+{
+public:
+	explicit Reply(int fd) : fd(fd) {}
+
+	// Text of the row being written; call endRow when it is complete
+	std::string& text() { return buffer; }
+
+	void endRow()
+	{
+		++rows;
+		if (buffer.size() >= SERVER_REPLY_FLUSH_SIZE)
+		{
+			flush();
+		}
+	}
+
+	// Appends complete rows formatted elsewhere
+	void addRows(const std::string& rowsText, uint64_t count)
+	{
+		buffer += rowsText;
+		rows += count;
+		if (buffer.size() >= SERVER_REPLY_FLUSH_SIZE)
+		{
+			flush();
+		}
+	}
+
+	void ok()
+	{
+		buffer += "OK ";
+		appendCsvInteger(buffer, rows);
+		buffer += '\n';
+		flush();
+	}
+
+	void error(const std::string& message)
+	{
+		// Rows already sent stay sent; the client sees the error in place of the OK line
+		buffer.clear();
+		buffer += "ERR ";
+		for (char c : message)
+		{
+			buffer += (c == '\n' || c == '\r') ? ' ' : c;
+		}
+		buffer += '\n';
+		flush();
+	}
+
+	bool failed() const { return sendFailed; }
+
+	void flush()
+	{
+#ifndef _WIN32
+		size_t sent = 0;
+		while (!sendFailed && sent < buffer.size())
+		{
+			ssize_t written = send(fd, buffer.data() + sent, buffer.size() - sent, MSG_NOSIGNAL);
+			if (written <= 0)
+			{
+				sendFailed = true; // The client went away; the job finishes without an audience
+				break;
+			}
+			sent += static_cast<size_t>(written);
+		}
+#endif
+		buffer.clear();
+	}
+
+private:
+	int fd;
+	std::string buffer;
+	uint64_t rows = 0;
+	bool sendFailed = false;
+};
+
+#ifndef _WIN32
+/// <summary>
+/// Removes the socket file an earlier server left at the path. Anything else at the path is
+/// left alone, so a mistyped --serve path never deletes a user's file.
+/// </summary>
+/// <param name="path">Socket path.</param>
+/// <returns>True when nothing is left at the path, false (with an error) when it is not a socket.</returns>
+static bool removeStaleSocket(const std::string& path)
+{
+	struct stat status;
+	if (lstat(path.c_str(), &status) != 0)
+	{
+		if (errno == ENOENT)
+		{
+			return true;
+		}
+		std::cerr << "Error: Unable to inspect socket path " << path << std::endl;
+		return false;
+	}
+	if (!S_ISSOCK(status.st_mode))
+	{
+		std::cerr << "Error: " << path << " exists and is not a socket; refusing to replace it." << std::endl;
+		return false;
+	}
+	unlink(path.c_str());
+	return true;
+}
+#endif
+
+/// <summary>
+/// Batches of reply rows handed from a streaming job to its connection thread. The job only
+/// formats rows; the connection thread sends them, so a slow client holds up its own job (once
+/// the queue is full) and never a pool worker in the middle of send. Cancelling the queue wakes
+/// the job and sets the flag that stops its segmentation.
+/// </summary>
+class ReplyRowQueue
+{
+public:
+	// Waits while the queue is full; false once the queue was cancelled
+	bool push(std::string&& rowsText, uint64_t count)
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		notFull.wait(lock, [this] { return batches.size() < SERVER_ROW_QUEUE_BATCHES || cancelled.load(); });
+		if (cancelled.load())
+		{
+			return false;
+		}
+		batches.push_back({ std::move(rowsText), count });
+		notEmpty.notify_one();
+		return true;
+	}
+
+	// Waits for the next batch; false once the queue is closed and empty
+	bool pop(std::string& rowsText, uint64_t& count)
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		notEmpty.wait(lock, [this] { return !batches.empty() || closed; });
+		if (batches.empty())
+		{
+			return false;
+		}
+		rowsText = std::move(batches.front().first);
+		count = batches.front().second;
+		batches.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+
+	// No more batches will be pushed
+	void close()
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		closed = true;
+		notEmpty.notify_all();
+	}
+
+	// The rows are no longer wanted
+	void cancel()
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		cancelled.store(true);
+		batches.clear();
+		notFull.notify_all();
+	}
+
+	const std::atomic<bool>& cancelledFlag() const { return cancelled; }
+
+private:
+	std::mutex mtx;
+	std::condition_variable notFull;
+	std::condition_variable notEmpty;
+	std::deque<std::pair<std::string, uint64_t>> batches;
+	bool closed = false;
+	std::atomic<bool> cancelled{ false };
+};
+
+AnalysisServer::AnalysisServer(const std::string& socketPath)
+	: socketPath(socketPath)
+{
+}
+
+AnalysisServer::~AnalysisServer()
+{
+	stop();
+
+	// Connection threads take the lock when they end, so they are joined outside it
+	while (true)
+	{
+		std::vector<std::thread> threads;
+		{
+			std::lock_guard<std::mutex> lock(connectionsMtx);
+			for (auto& [fd, thread] : connections)
+			{
+				threads.push_back(std::move(thread));
+			}
+			connections.clear();
+			for (auto& thread : finished)
+			{
+				threads.push_back(std::move(thread));
+			}
+			finished.clear();
+		}
+		if (threads.empty())
+		{
+			break;
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+	}
+}
+
+/// <summary>
+/// Loads a genome and makes it available to requests, replacing a genome of the same name.
+/// Requests already running on the old genome finish on it.
+/// </summary>
+void AnalysisServer::addGenome(const std::string& name, const std::string& path)
+{
+	auto genome = loadServerGenome(name, path);
+	std::unique_lock<std::shared_mutex> lock(genomesMtx);
+	genomes[name] = genome;
+}
+
+std::shared_ptr<const ServerGenome> AnalysisServer::findGenome(const ServerRequest& request)
+{
+	auto name = request.arguments.find("genome");
+	std::shared_lock<std::shared_mutex> lock(genomesMtx);
+	if (name == request.arguments.end())
+	{
+		if (genomes.size() == 1)
+		{
+			return genomes.begin()->second;
+		}
+		throw std::invalid_argument("Missing argument: genome");
+	}
+
+	auto it = genomes.find(name->second);
+	if (it == genomes.end())
+	{
+		throw std::invalid_argument("Unknown genome: " + name->second);
+	}
+	return it->second;
+}
+
+/// <summary>
+/// Makes run() return after closing every connection. Safe to call from any thread.
+/// </summary>
+void AnalysisServer::stop()
+{
+	stopping = true;
+#ifndef _WIN32
+	// Wake every connection blocked in recv; their threads then close their sockets
+	std::lock_guard<std::mutex> lock(connectionsMtx);
+	for (auto& [fd, thread] : connections)
+	{
+		shutdown(fd, SHUT_RDWR);
+	}
+#endif
+}
+
+/// <summary>
+/// Listens on the socket and serves clients until a SHUTDOWN request or stop().
+/// </summary>
+/// <returns>True when the server ran, false when the socket could not be opened.</returns>
+bool AnalysisServer::run()
+{
+#ifdef _WIN32
+	std::cerr << "Error: The analysis server needs Unix-domain sockets, which this build does not support." << std::endl;
+	return false;
+#else
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (socketPath.size() >= sizeof(address.sun_path))
+	{
+		std::cerr << "Error: Socket path is too long: " << socketPath << std::endl;
+		return false;
+	}
+	std::copy(socketPath.begin(), socketPath.end(), address.sun_path);
+
+	listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenFd < 0)
+	{
+		std::cerr << "Error: Unable to create socket " << socketPath << std::endl;
+		return false;
+	}
+	if (!removeStaleSocket(socketPath))
+	{
+		close(listenFd);
+		listenFd = -1;
+		return false;
+	}
+	if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listenFd, 16) != 0)
+	{
+		std::cerr << "Error: Unable to listen on socket " << socketPath << std::endl;
+		close(listenFd);
+		listenFd = -1;
+		return false;
+	}
+	std::cout << "Analysis server listening on " << socketPath << std::endl;
+
+	while (!stopping)
+	{
+		// Poll with a timeout so stop() is noticed without a connection arriving
+		pollfd listener{ listenFd, POLLIN, 0 };
+		int ready = poll(&listener, 1, 200);
+
+		std::vector<std::thread> closed;
+		{
+			std::lock_guard<std::mutex> lock(connectionsMtx);
+			closed.swap(finished);
+		}
+		for (auto& thread : closed)
+		{
+			thread.join();
+		}
+
+		if (ready <= 0 || stopping)
+		{
+			continue;
+		}
+
+		int fd = accept(listenFd, nullptr, nullptr);
+		if (fd < 0)
+		{
+			continue;
+		}
+
+		// The connection thread removes itself under this lock, so it cannot finish before it is registered
+		std::lock_guard<std::mutex> lock(connectionsMtx);
+		connections[fd] = std::thread(&AnalysisServer::serveConnection, this, fd);
+	}
+
+	close(listenFd);
+	listenFd = -1;
+	removeStaleSocket(socketPath);
+	stop();
+	std::cout << "Analysis server stopped" << std::endl;
+	return true;
+#endif
+}
+
+void AnalysisServer::serveConnection(int fd)
+{
+#ifndef _WIN32
+	std::string pending;
+	char chunk[4096];
+	bool open = true;
+	while (open && !stopping)
+	{
+		ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+		if (received <= 0)
+		{
+			break;
+		}
+		pending.append(chunk, static_cast<size_t>(received));
+
+		size_t lineEnd;
+		while (open && (lineEnd = pending.find('\n')) != std::string::npos)
+		{
+			std::string line = pending.substr(0, lineEnd);
+			pending.erase(0, lineEnd + 1);
+			if (!line.empty() && line.back() == '\r')
+			{
+				line.pop_back();
+			}
+			if (line.empty())
+			{
+				continue;
+			}
+
+			Reply reply(fd);
+			try
+			{
+				open = handleRequest(parseServerRequest(line), reply);
+			}
+			catch (const std::exception& e)
+			{
+				reply.error(e.what());
+			}
+			open = open && !reply.failed();
+		}
+
+		if (pending.size() > SERVER_MAX_REQUEST_LENGTH)
+		{
+			Reply reply(fd);
+			reply.error("Request line too long");
+			break;
+		}
+	}
+
+	close(fd);
+	std::lock_guard<std::mutex> lock(connectionsMtx);
+	auto it = connections.find(fd);
+	if (it != connections.end())
+	{
+		finished.push_back(std::move(it->second));
+		connections.erase(it);
+	}
+#else
+	(void)fd;
+#endif
+}
+
+// Answers one request; returns false when the connection should close
+bool AnalysisServer::handleRequest(const ServerRequest& request, Reply& reply)
+{
+	const std::string& command = request.command;
+	if (command == "PING")
+	{
+		reply.ok();
+	}
+	else if (command == "LIST")
+	{
+		replyList(reply);
+	}
+	else if (command == "LOAD")
+	{
+		auto name = request.arguments.find("name");
+		auto path = request.arguments.find("path");
+		if (name == request.arguments.end() || path == request.arguments.end())
+		{
+			throw std::invalid_argument("LOAD needs name and path");
+		}
+		addGenome(name->second, path->second);
+		reply.ok();
+	}
+	else if (command == "SEGMENT")
+	{
+		replySegments(request, reply);
+	}
+	else if (command == "GC")
+	{
+		replyGcWindows(request, reply);
+	}
+	else if (command == "ISOCHORES")
+	{
+		replyIsochores(request, reply);
+	}
+	else if (command == "OVERLAP")
+	{
+		replyOverlaps(request, reply);
+	}
+	else if (command == "QUIT")
+	{
+		reply.ok();
+		return false;
+	}
+	else if (command == "SHUTDOWN")
+	{
+		reply.ok();
+		stopping = true;
+		return false;
+	}
+	else
+	{
+		throw std::invalid_argument("Unknown command: " + command);
+	}
+	return true;
+}
+
+void AnalysisServer::replyList(Reply& reply)
+{
+	std::string& out = reply.text();
+	out += "Name,Length,Contigs\n";
+	std::shared_lock<std::shared_mutex> lock(genomesMtx);
+	for (const auto& [name, genome] : genomes)
+	{
+		out += name;
+		out += ',';
+		appendCsvInteger(out, genome->sequence.size());
+		out += ',';
+		appendCsvInteger(out, genome->contigs.size());
+		out += '\n';
+		reply.endRow();
+	}
+	reply.ok();
+}
+
+// Appends a segment row in the column order of saveSegmentsToCSV
+static void appendSegmentRow(std::string& out, const std::tuple<uint64_t, uint64_t, double, std::string>& segment, int precision)
+{
+	const auto& [start, end, cost, word] = segment;
+	appendCsvInteger(out, start);
+	out += ',';
+	appendCsvInteger(out, end);
+	out += ',';
+	appendCsvInteger(out, end - start);
+	out += ',';
+	appendCsvDouble(out, cost, precision);
+	out += ',';
+	out += word;
+}
+
+// Appends the GC and GA columns of saveSegmentsGcContentToCsv
+static void appendGcColumns(std::string& out, double gc, double ga, int precision)
+{
+	out += ',';
+	appendCsvDouble(out, gc, precision);
+	out += ',';
+	appendCsvDouble(out, ga, precision);
+}
+
+void AnalysisServer::replySegments(const ServerRequest& request, Reply& reply)
+{
+	auto genome = findGenome(request);
+	auto contigs = requestContigs(*genome, request);
+	SegmentationSettings settings = requestSegmentation(request);
+	bool merge = optionalFlag(request, "merge");
+	bool gc = optionalFlag(request, "gc");
+	int precision = defaultCsvPrecision();
+
+	std::string& out = reply.text();
+	out += gc ? "Start,End,Length,Cost,Best Word,GC_Content,GA_content\n" : "Start,End,Length,Cost,Best Word\n";
+
+	if (!merge)
+	{
+		// Segments stream back while the later contigs are still being segmented. The job formats
+		// rows into batches for this thread to send, and stops once the client has gone away.
+		ReplyRowQueue queue;
+		std::exception_ptr jobError;
+		std::thread job([&]()
+			{
+				try
+				{
+					std::string batch;
+					uint64_t batchRows = 0;
+					SegmentContigsStreaming(genome->sequence, contigs, settings,
+						[&](std::tuple<uint64_t, uint64_t, double, std::string>&& segment)
+						{
+							appendSegmentRow(batch, segment, precision);
+							if (gc)
+							{
+								auto withGc = segmentWithGCContent(genome->sequence, segment, &genome->planes, &genome->gcIndex);
+								appendGcColumns(batch, std::get<4>(withGc), std::get<5>(withGc), precision);
+							}
+							batch += '\n';
+							++batchRows;
+							if (batch.size() >= SERVER_REPLY_FLUSH_SIZE)
+							{
+								queue.push(std::move(batch), batchRows);
+								batch.clear();
+								batchRows = 0;
+							}
+						}, nullptr, &queue.cancelledFlag());
+					if (batchRows > 0)
+					{
+						queue.push(std::move(batch), batchRows);
+					}
+				}
+				catch (...)
+				{
+					jobError = std::current_exception();
+				}
+				queue.close();
+			});
+
+		std::string batch;
+		uint64_t batchRows = 0;
+		while (queue.pop(batch, batchRows))
+		{
+			reply.addRows(batch, batchRows);
+			if (reply.failed())
+			{
+				queue.cancel();
+			}
+		}
+		job.join();
+		if (jobError)
+		{
+			std::rethrow_exception(jobError);
+		}
+		reply.ok();
+		return;
+	}
+
+	auto stages = runSegmentPipeline(genome->sequence, contigs, settings, &genome->planes, &genome->gcIndex);
+	for (size_t i = 0; i < stages.merged.size() && !reply.failed(); ++i)
+	{
+		appendSegmentRow(out, stages.merged[i], precision);
+		if (gc)
+		{
+			appendGcColumns(out, std::get<4>(stages.withGc[i]), std::get<5>(stages.withGc[i]), precision);
+		}
+		out += '\n';
+		reply.endRow();
+	}
+	reply.ok();
+}
+
+void AnalysisServer::replyGcWindows(const ServerRequest& request, Reply& reply)
+{
+	auto genome = findGenome(request);
+	auto contigs = requestContigs(*genome, request);
+	uint64_t windowSize = requiredUInt(request, "window");
+	uint64_t stepSize = requiredUInt(request, "step");
+	if (windowSize == 0 || stepSize == 0)
+	{
+		throw std::invalid_argument("Window and step sizes must be positive.");
+	}
+	int precision = defaultCsvPrecision();
+
+	// The same windows and values as the isochore scan with skipped gaps
+	std::string& out = reply.text();
+	out += "Start,End,GC_Content\n";
+	for (const auto& contig : contigs)
+	{
+		for (uint64_t pos = contig.start; pos + windowSize <= contig.end && !reply.failed(); pos += stepSize)
+		{
+			uint64_t unknown = genome->gcIndex.unknown(pos, pos + windowSize);
+			double gcPercentage = (unknown < windowSize)
+				? (genome->gcIndex.gc(pos, pos + windowSize) / static_cast<double>(windowSize - unknown)) * 100.0
+				: 0.0;
+			appendCsvInteger(out, pos);
+			out += ',';
+			appendCsvInteger(out, pos + windowSize);
+			out += ',';
+			appendCsvDouble(out, gcPercentage, precision);
+			out += '\n';
+			reply.endRow();
+		}
+	}
+	reply.ok();
+}
+
+void AnalysisServer::replyIsochores(const ServerRequest& request, Reply& reply)
+{
+	auto genome = findGenome(request);
+	auto isochores = requestIsochores(*genome, request, requestContigs(*genome, request));
+	int precision = defaultCsvPrecision();
+
+	std::string& out = reply.text();
+	out += "Start,End,GC_Content,Family\n";
+	for (const auto& isochore : isochores)
+	{
+		appendCsvInteger(out, isochore.start);
+		out += ',';
+		appendCsvInteger(out, isochore.end);
+		out += ',';
+		appendCsvDouble(out, isochore.gc_content, precision);
+		out += ',';
+		out += isochoreFamilyName(isochore.family);
+		out += '\n';
+		reply.endRow();
+	}
+	reply.ok();
+}
+
+void AnalysisServer::replyOverlaps(const ServerRequest& request, Reply& reply)
+{
+	auto genome = findGenome(request);
+	auto contigs = requestContigs(*genome, request);
+	SegmentationSettings settings = requestSegmentation(request);
+	auto isochores = requestIsochores(*genome, request, contigs);
+	auto stages = runSegmentPipeline(genome->sequence, contigs, settings, &genome->planes, &genome->gcIndex);
+
+	OverlapStatistics statistics;
+	auto overlaps = findIsochoreSegmentOverlap(isochores, stages.merged, statistics);
+	int precision = defaultCsvPrecision();
+
+	std::string& out = reply.text();
+	out += "Isochore Start,Isochore End,Isochore GC,Segment Start,Segment End,Segment Cost,Best Word,Overlap Length\n";
+	for (const auto& o : overlaps)
+	{
+		appendCsvInteger(out, o.isochore_start);
+		out += ',';
+		appendCsvInteger(out, o.isochore_end);
+		out += ',';
+		appendCsvDouble(out, o.isochore_gc, precision);
+		out += ',';
+		appendCsvInteger(out, o.segment_start);
+		out += ',';
+		appendCsvInteger(out, o.segment_end);
+		out += ',';
+		appendCsvDouble(out, o.segment_cost, precision);
+		out += ',';
+		out += o.best_word;
+		out += ',';
+		appendCsvInteger(out, o.overlap_length);
+		out += '\n';
+		reply.endRow();
+	}
+	reply.ok();
+}
+
+/// <summary>
+/// Loads the genomes and serves them on the socket until the server is shut down.
+/// </summary>
+/// <param name="socketPath">Path of the Unix-domain socket to create.</param>
+/// <param name="genomeFiles">FASTA files to load; each is named after its file name without extension.</param>
+/// <returns>The process exit code.</returns>
+int runAnalysisServer(const std::string& socketPath, const std::vector<std::string>& genomeFiles)
+{
+	// Jobs of different clients run at the same time; their progress lines would only interleave on stdout
+	setProgressReporting(false);
+
+	AnalysisServer server(socketPath);
+	for (const auto& file : genomeFiles)
+	{
+		std::string name = fs::path(file).stem().string();
+		std::cout << "Loading genome " << name << " from " << file << std::endl;
+		try
+		{
+			server.addGenome(name, file);
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "Error: " << e.what() << std::endl;
+			return 1;
+		}
+	}
+	return server.run() ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "File_DNA.h"
+#include "BitPlane.h"
+#include "GcRankIndex.h"
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+// Longest request line a client may send
+const size_t SERVER_MAX_REQUEST_LENGTH = 64 * 1024;
+
+// Reply text collected before it is sent, so rows stream back while a job is still running
+const size_t SERVER_REPLY_FLUSH_SIZE = 64 * 1024;
+
+// Batches of streamed segment rows a job may hold while its client is slow to read them
+const size_t SERVER_ROW_QUEUE_BATCHES = 16;
+
+// A genome held in memory by the server, with the indexes its requests are answered from
+struct ServerGenome
+{
+	std::string name;
+	std::string path;
+	std::string sequence;
+	std::vector<SequenceInterval> contigs; // Stretches between assembly gaps; every job works on these
+	BitPlaneSequence planes;               // Packed copy of the sequence for segment composition
+	GcRankIndex gcIndex;                   // Constant-time GC and GA counts of any range
+};
+
+// One parsed request line: a command followed by key=value arguments
+struct ServerRequest
+{
+	std::string command;
+	std::map<std::string, std::string> arguments;
+};
+
+/// <summary>
+/// Parses a request line of the form "COMMAND key=value key=value". The command is upper-cased.
+/// </summary>
+/// <param name="line">Request line without its newline.</param>
+/// <returns>The command and its arguments.</returns>
+ServerRequest parseServerRequest(const std::string& line);
+
+/// <summary>
+/// Loads a FASTA genome with its contigs, bitplanes and GC rank index. The index is read from,
+/// or saved to, "path.gcidx", so later loads of the same genome skip building it.
+/// </summary>
+/// <param name="name">Name requests use for the genome.</param>
+/// <param name="path">FASTA file of the genome.</param>
+/// <returns>The loaded genome.</returns>
+std::shared_ptr<const ServerGenome> loadServerGenome(const std::string& name, const std::string& path);
+
+/// <summary>
+/// Resident analysis daemon. It keeps genomes in memory and answers requests on a Unix-domain
+/// socket, one line per request. Each connection is served on its own thread and its jobs run
+/// on the shared thread pool, so several clients are answered concurrently.
+///
+/// A reply is a CSV header and rows, which stream back as the job produces them, ended by a
+/// line "OK rows"; a failed request is answered with one line "ERR message". Requests:
+///   PING
+///   LIST                                   - Name,Length,Contigs of every loaded genome
+///   LOAD name=N path=FILE                  - load a FASTA genome, or replace the one named N
+///   SEGMENT genome=N word=W min=M lookahead=L [engine=greedy|optimal] [penalty=P] [prune=1]
+///           [start=S] [end=E] [merge=1] [gc=1]
+///   GC genome=N window=W step=S [start=S] [end=E]
+///   ISOCHORES genome=N window=W step=S [minlen=L] [hysteresis=H] [start=S] [end=E]
+///   OVERLAP genome=N word=W min=M lookahead=L window=W step=S [minlen=L] [hysteresis=H] ...
+///   QUIT                                   - close this connection
+///   SHUTDOWN                               - stop the server
+/// Jobs work on the contigs between assembly gaps, clipped to [start, end).
+/// </summary>
+class AnalysisServer
+{
+public:
+	explicit AnalysisServer(const std::string& socketPath);
+	~AnalysisServer();
+
+	AnalysisServer(const AnalysisServer&) = delete;
+	AnalysisServer& operator=(const AnalysisServer&) = delete;
+
+	/// <summary>
+	/// Loads a genome and makes it available to requests, replacing a genome of the same name.
+	/// Requests already running on the old genome finish on it.
+	/// </summary>
+	void addGenome(const std::string& name, const std::string& path);
+
+	/// <summary>
+	/// Listens on the socket and serves clients until a SHUTDOWN request or stop().
+	/// </summary>
+	/// <returns>True when the server ran, false when the socket could not be opened.</returns>
+	bool run();
+
+	/// <summary>
+	/// Makes run() return after closing every connection. Safe to call from any thread.
+	/// </summary>
+	void stop();
+
+private:
+	class Reply;
+
+	void serveConnection(int fd);
+	bool handleRequest(const ServerRequest& request, Reply& reply);
+	std::shared_ptr<const ServerGenome> findGenome(const ServerRequest& request);
+
+	void replyList(Reply& reply);
+	void replySegments(const ServerRequest& request, Reply& reply);
+	void replyGcWindows(const ServerRequest& request, Reply& reply);
+	void replyIsochores(const ServerRequest& request, Reply& reply);
+	void replyOverlaps(const ServerRequest& request, Reply& reply);
+
+	std::string socketPath;
+	int listenFd = -1;
+	std::atomic<bool> stopping{ false };
+
+	std::shared_mutex genomesMtx;
+	std::map<std::string, std::shared_ptr<const ServerGenome>> genomes;
+
+	std::mutex connectionsMtx;
+	std::map<int, std::thread> connections; // Open connections by socket
+	std::vector<std::thread> finished;      // Threads of closed connections, joined by the accept loop
+};
+
+/// <summary>
+/// Loads the genomes and serves them on the socket until the server is shut down.
+/// </summary>
+/// <param name="socketPath">Path of the Unix-domain socket to create.</param>
+/// <param name="genomeFiles">FASTA files to load; each is named after its file name without extension.</param>
+/// <returns>The process exit code.</returns>
+int runAnalysisServer(const std::string& socketPath, const std::vector<std::string>& genomeFiles);
@@ -0,0 +1,432 @@
+#include "Shard.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+// Identify the binary shard files; bump the digit when a layout changes
+static const char ShardSegmentsMagic[8] = { 'S', 'H', 'S', 'E', 'G', 'S', '1', '\0' };
+static const char ShardWindowsMagic[8] = { 'S', 'H', 'W', 'I', 'N', 'D', '1', '\0' };
+
+// Window records collected before they are written
+const size_t SHARD_WINDOW_BUFFER_SIZE = 1 << 20;
+
+/// <summary>
+/// Splits contigs into contiguous ranges holding about the same number of bases. A contig is never
+/// split, so a contig longer than the share of one shard makes its shard larger.
+/// </summary>
+/// <param name="contigs">Contigs in sequence order.</param>
+/// <param name="shardCount">Number of shards wanted; at most one shard per contig is made.</param>
+/// <returns>The contigs of every shard.</returns>
+std::vector<std::vector<SequenceInterval>> partitionContigs(const std::vector<SequenceInterval>& contigs, size_t shardCount)
+{
+	std::vector<std::vector<SequenceInterval>> shards;
+	shardCount = std::min(shardCount, contigs.size());
+	if (shardCount == 0)
+	{
+		return shards;
+	}
+
+	uint64_t total = 0;
+	for (const auto& contig : contigs)
+	{
+		total += contig.end - contig.start;
+	}
+
+	// Every shard ends at the contig boundary closest to its share of the cumulative bases
+	size_t next = 0;
+	uint64_t covered = 0;
+	for (size_t shard = 0; shard < shardCount; ++shard)
+	{
+		size_t shardsAfter = shardCount - shard - 1;
+		double target = static_cast<double>(total) * (shard + 1) / shardCount;
+		std::vector<SequenceInterval> current;
+		do
+		{
+			covered += contigs[next].end - contigs[next].start;
+			current.push_back(contigs[next++]);
+		} while (next + shardsAfter < contigs.size()
+			&& (shardsAfter == 0 || covered + (contigs[next].end - contigs[next].start) / 2.0 < target));
+		shards.push_back(std::move(current));
+	}
+	return shards;
+}
+
+/// <summary>
+/// Saves a shard manifest as a tab-separated text file.
+/// </summary>
+/// <returns>True when the manifest was written.</returns>
+bool saveShardManifest(const ShardManifest& manifest, const std::string& filename)
+{
+	std::ofstream file(filename);
+	if (!file)
+	{
+		std::cerr << "Error: Unable to create file " << filename << std::endl;
+		return false;
+	}
+
+	file << "# Shard manifest: run every shard with --run-shard=" << filename << ":INDEX, then --merge-shards=" << filename << "\n";
+	for (const auto& argument : manifest.arguments)
+	{
+		file << "argument\t" << argument << "\n";
+	}
+	for (size_t shard = 0; shard < manifest.shards.size(); ++shard)
+	{
+		for (const auto& contig : manifest.shards[shard])
+		{
+			file << "contig\t" << shard << "\t" << contig.start << "\t" << contig.end << "\n";
+		}
+	}
+	return static_cast<bool>(file);
+}
+
+/// <summary>
+/// Loads a manifest written by saveShardManifest.
+/// </summary>
+/// <param name="filename">Path of the manifest.</param>
+/// <param name="manifest">Receives the manifest.</param>
+/// <returns>True when the manifest was read and has at least one shard.</returns>
+bool loadShardManifest(const std::string& filename, ShardManifest& manifest)
+{
+	std::ifstream file(filename);
+	if (!file)
+	{
+		std::cerr << "Error: Could not open the file " << filename << std::endl;
+		return false;
+	}
+
+	ShardManifest loaded;
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (line.empty() || line[0] == '#')
+		{
+			continue;
+		}
+
+		size_t tab = line.find('\t');
+		std::string kind = line.substr(0, tab);
+		std::string rest = (tab == std::string::npos) ? "" : line.substr(tab + 1);
+		if (kind == "argument")
+		{
+			loaded.arguments.push_back(rest);
+			continue;
+		}
+
+		std::istringstream fields(rest);
+		size_t shard = 0;
+		SequenceInterval contig{};
+		if (kind != "contig" || !(fields >> shard >> contig.start >> contig.end) || shard > loaded.shards.size())
+		{
+			std::cerr << "Error: Invalid line in shard manifest " << filename << ": " << line << std::endl;
+			return false;
+		}
+		if (shard == loaded.shards.size())
+		{
+			loaded.shards.emplace_back();
+		}
+		loaded.shards[shard].push_back(contig);
+	}
+
+	if (loaded.shards.empty())
+	{
+		std::cerr << "Error: Shard manifest " << filename << " has no shards" << std::endl;
+		return false;
+	}
+	manifest = std::move(loaded);
+	return true;
+}
+
+/// <summary>
+/// Directory of one shard's outputs, next to the manifest. The path ends with a separator.
+/// </summary>
+std::string shardDirectory(const std::string& manifestPath, size_t shard)
+{
+	return ((fs::path(manifestPath).parent_path() / ("shard_" + std::to_string(shard))) / "").string();
+}
+
+/// <summary>
+/// Removes the shard directories next to the manifest, so outputs of an earlier plan are never
+/// mistaken for shards of a new one.
+/// </summary>
+/// <param name="manifestPath">Path of the manifest.</param>
+/// <returns>Number of shard directories removed.</returns>
+size_t removeShardDirectories(const std::string& manifestPath)
+{
+	fs::path directory = fs::path(manifestPath).parent_path();
+	if (!fs::is_directory(directory))
+	{
+		return 0;
+	}
+
+	std::vector<fs::path> stale;
+	for (const auto& entry : fs::directory_iterator(directory))
+	{
+		std::string name = entry.path().filename().string();
+		if (entry.is_directory() && name.rfind("shard_", 0) == 0
+			&& name.size() > 6 && std::all_of(name.begin() + 6, name.end(), [](unsigned char c) { return std::isdigit(c); }))
+		{
+			stale.push_back(entry.path());
+		}
+	}
+	for (const auto& path : stale)
+	{
+		fs::remove_all(path);
+	}
+	return stale.size();
+}
+
+/// <summary>
+/// Fingerprint of one shard of a manifest: a hash of the run's arguments and the shard's contigs.
+/// </summary>
+std::string shardFingerprint(const ShardManifest& manifest, size_t shard)
+{
+	// 64-bit FNV-1a over the manifest lines the shard depends on
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](const std::string& text)
+	{
+		for (unsigned char c : text)
+		{
+			hash = (hash ^ c) * 1099511628211ull;
+		}
+		hash = (hash ^ '\n') * 1099511628211ull;
+	};
+	for (const auto& argument : manifest.arguments)
+	{
+		add(argument);
+	}
+	add(std::to_string(shard) + "/" + std::to_string(manifest.shards.size()));
+	for (const auto& contig : manifest.shards[shard])
+	{
+		add(std::to_string(contig.start) + "\t" + std::to_string(contig.end));
+	}
+
+	std::ostringstream text;
+	text << std::hex << std::setw(16) << std::setfill('0') << hash;
+	return text.str();
+}
+
+/// <summary>
+/// Marks a shard as finished by writing SHARD_DONE_FILE with its fingerprint into its directory.
+/// </summary>
+/// <returns>True when the marker was written.</returns>
+bool markShardDone(const std::string& directory, const std::string& fingerprint)
+{
+	std::string filename = (fs::path(directory) / SHARD_DONE_FILE).string();
+	std::ofstream file(filename);
+	file << "done\t" << fingerprint << "\n";
+	if (!file)
+	{
+		std::cerr << "Error: Unable to create file " << filename << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/// <summary>
+/// True when the shard directory holds a done marker written for the fingerprint.
+/// </summary>
+bool isShardDone(const std::string& directory, const std::string& fingerprint)
+{
+	std::ifstream file(fs::path(directory) / SHARD_DONE_FILE);
+	std::string line;
+	return std::getline(file, line) && line == "done\t" + fingerprint;
+}
+
+/// <summary>
+/// Saves segments with their exact costs, so the merge works on the values a single run holds
+/// rather than on their rounded CSV text.
+/// </summary>
+/// <returns>True when the file was written.</returns>
+bool saveShardSegments(const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments, const std::string& filename)
+{
+	std::ofstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Error: Unable to create file " << filename << std::endl;
+		return false;
+	}
+
+	uint64_t count = segments.size();
+	file.write(ShardSegmentsMagic, sizeof(ShardSegmentsMagic));
+	file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+	for (const auto& [start, end, cost, word] : segments)
+	{
+		uint64_t wordLength = word.size();
+		file.write(reinterpret_cast<const char*>(&start), sizeof(start));
+		file.write(reinterpret_cast<const char*>(&end), sizeof(end));
+		file.write(reinterpret_cast<const char*>(&cost), sizeof(cost));
+		file.write(reinterpret_cast<const char*>(&wordLength), sizeof(wordLength));
+		file.write(word.data(), wordLength);
+	}
+	return static_cast<bool>(file);
+}
+
+/// <summary>
+/// Appends the segments saved by saveShardSegments.
+/// </summary>
+/// <param name="filename">Path of the segment file.</param>
+/// <param name="segments">Receives the segments after the ones it holds.</param>
+/// <returns>True when the file was read completely.</returns>
+bool loadShardSegments(const std::string& filename, std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments)
+{
+	std::ifstream file(filename, std::ios::binary);
+	char magic[sizeof(ShardSegmentsMagic)];
+	uint64_t count = 0;
+	if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, ShardSegmentsMagic, sizeof(magic)) != 0
+		|| !file.read(reinterpret_cast<char*>(&count), sizeof(count)))
+	{
+		std::cerr << "Error: Could not read shard segments from " << filename << std::endl;
+		return false;
+	}
+
+	segments.reserve(segments.size() + count);
+	for (uint64_t i = 0; i < count; ++i)
+	{
+		uint64_t start = 0, end = 0, wordLength = 0;
+		double cost = 0.0;
+		file.read(reinterpret_cast<char*>(&start), sizeof(start));
+		file.read(reinterpret_cast<char*>(&end), sizeof(end));
+		file.read(reinterpret_cast<char*>(&cost), sizeof(cost));
+		file.read(reinterpret_cast<char*>(&wordLength), sizeof(wordLength));
+		std::string word(file ? wordLength : 0, '\0');
+		file.read(word.data(), word.size());
+		if (!file)
+		{
+			std::cerr << "Error: Shard segments in " << filename << " are incomplete" << std::endl;
+			return false;
+		}
+		segments.emplace_back(start, end, cost, std::move(word));
+	}
+	return true;
+}
+
+ShardWindowWriter::ShardWindowWriter(const std::string& filename)
+	: file(filename, std::ios::binary)
+{
+	if (!file)
+	{
+		std::cerr << "Error: Unable to create file " << filename << std::endl;
+		return;
+	}
+	file.write(ShardWindowsMagic, sizeof(ShardWindowsMagic));
+	buffer.reserve(SHARD_WINDOW_BUFFER_SIZE);
+}
+
+ShardWindowWriter::~ShardWindowWriter()
+{
+	close();
+}
+
+// Every window is its start, end and GC value followed by a validity byte
+void ShardWindowWriter::add(uint64_t start, uint64_t end, double gcContent, bool valid)
+{
+	buffer.append(reinterpret_cast<const char*>(&start), sizeof(start));
+	buffer.append(reinterpret_cast<const char*>(&end), sizeof(end));
+	buffer.append(reinterpret_cast<const char*>(&gcContent), sizeof(gcContent));
+	buffer += static_cast<char>(valid ? 1 : 0);
+	if (buffer.size() >= SHARD_WINDOW_BUFFER_SIZE)
+	{
+		file.write(buffer.data(), buffer.size());
+		buffer.clear();
+	}
+}
+
+bool ShardWindowWriter::close()
+{
+	if (!file.is_open())
+	{
+		return false;
+	}
+	file.write(buffer.data(), buffer.size());
+	buffer.clear();
+	file.close();
+	return static_cast<bool>(file);
+}
+
+/// <summary>
+/// Feeds the windows written by ShardWindowWriter to a boundary detector, in file order.
+/// </summary>
+/// <returns>True when the file was read completely.</returns>
+bool replayShardWindows(const std::string& filename, IsochoreBoundaryDetector& boundaries)
+{
+	std::ifstream file(filename, std::ios::binary);
+	char magic[sizeof(ShardWindowsMagic)];
+	if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, ShardWindowsMagic, sizeof(magic)) != 0)
+	{
+		std::cerr << "Error: Could not read shard windows from " << filename << std::endl;
+		return false;
+	}
+
+	const size_t recordSize = 3 * sizeof(uint64_t) + 1;
+	std::vector<char> records(recordSize * (SHARD_WINDOW_BUFFER_SIZE / recordSize));
+	while (file)
+	{
+		file.read(records.data(), records.size());
+		size_t bytes = static_cast<size_t>(file.gcount());
+		if (bytes % recordSize != 0)
+		{
+			std::cerr << "Error: Shard windows in " << filename << " are incomplete" << std::endl;
+			return false;
+		}
+		for (size_t offset = 0; offset < bytes; offset += recordSize)
+		{
+			uint64_t start = 0, end = 0;
+			double gcContent = 0.0;
+			std::memcpy(&start, records.data() + offset, sizeof(start));
+			std::memcpy(&end, records.data() + offset + 8, sizeof(end));
+			std::memcpy(&gcContent, records.data() + offset + 16, sizeof(gcContent));
+			boundaries.addWindow(start, end, gcContent, records[offset + 24] != 0);
+		}
+	}
+	return true;
+}
+
+/// <summary>
+/// Writes the header and rows of the first CSV file followed by the rows of the others, skipping
+/// their header lines.
+/// </summary>
+/// <param name="inputs">CSV files in order.</param>
+/// <param name="output">Path of the concatenated CSV file.</param>
+/// <returns>True when every input was read and the output was written.</returns>
+bool concatenateShardCsv(const std::vector<std::string>& inputs, const std::string& output)
+{
+	std::ofstream out(output, std::ios::binary);
+	if (!out)
+	{
+		std::cerr << "Error: Unable to create file " << output << std::endl;
+		return false;
+	}
+
+	bool headerWritten = false;
+	std::vector<char> chunk(1 << 20);
+	for (const auto& input : inputs)
+	{
+		std::ifstream in(input, std::ios::binary);
+		if (!in)
+		{
+			// A missing shard output would silently drop its rows from the merged file
+			std::cerr << "Error: Could not open the file " << input << std::endl;
+			return false;
+		}
+
+		std::string header;
+		std::getline(in, header);
+		if (!headerWritten)
+		{
+			out << header << '\n';
+			headerWritten = true;
+		}
+		while (in.read(chunk.data(), chunk.size()) || in.gcount() > 0)
+		{
+			out.write(chunk.data(), in.gcount());
+		}
+	}
+	return headerWritten && static_cast<bool>(out);
+}
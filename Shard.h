@@ -0,0 +1,134 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "File_DNA.h"
+#include "IsochoreBoundaries.h"
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+// Files a shard leaves in its directory next to the usual outputs
+const char SHARD_SEGMENTS_FILE[] = "merged_segments.bin";   // Merged segments with their exact costs
+const char SHARD_WINDOWS_FILE[] = "isochore_windows.bin";   // Every GC window with its exact value, when isochores are detected
+const char SHARD_DONE_FILE[] = "shard.done";                // Written last with the shard's fingerprint, once every output is complete
+
+/// <summary>
+/// Plan of a sharded run. Shards are contiguous ranges of the contigs between assembly gaps, so
+/// every shard segments, merges and scans its contigs exactly as a single --skip-gaps run does,
+/// and the shard outputs concatenated in shard order are that run's outputs. The manifest keeps
+/// the command line of the run, so every shard and the merge use the same parameters.
+/// </summary>
+struct ShardManifest
+{
+	std::vector<std::string> arguments;                 // Parameters and flags of the run, without the shard flags
+	std::vector<std::vector<SequenceInterval>> shards;  // Contigs of every shard, in sequence order
+};
+
+/// <summary>
+/// Splits contigs into contiguous ranges holding about the same number of bases. A contig is never
+/// split, so a contig longer than the share of one shard makes its shard larger.
+/// </summary>
+/// <param name="contigs">Contigs in sequence order.</param>
+/// <param name="shardCount">Number of shards wanted; at most one shard per contig is made.</param>
+/// <returns>The contigs of every shard.</returns>
+std::vector<std::vector<SequenceInterval>> partitionContigs(const std::vector<SequenceInterval>& contigs, size_t shardCount);
+
+/// <summary>
+/// Saves a shard manifest as a tab-separated text file.
+/// </summary>
+/// <returns>True when the manifest was written.</returns>
+bool saveShardManifest(const ShardManifest& manifest, const std::string& filename);
+
+/// <summary>
+/// Loads a manifest written by saveShardManifest.
+/// </summary>
+/// <param name="filename">Path of the manifest.</param>
+/// <param name="manifest">Receives the manifest.</param>
+/// <returns>True when the manifest was read and has at least one shard.</returns>
+bool loadShardManifest(const std::string& filename, ShardManifest& manifest);
+
+/// <summary>
+/// Directory of one shard's outputs, next to the manifest. The path ends with a separator.
+/// </summary>
+std::string shardDirectory(const std::string& manifestPath, size_t shard);
+
+/// <summary>
+/// Removes the shard directories next to the manifest, so outputs of an earlier plan are never
+/// mistaken for shards of a new one.
+/// </summary>
+/// <param name="manifestPath">Path of the manifest.</param>
+/// <returns>Number of shard directories removed.</returns>
+size_t removeShardDirectories(const std::string& manifestPath);
+
+/// <summary>
+/// Fingerprint of one shard of a manifest: a hash of the run's arguments and the shard's contigs.
+/// </summary>
+std::string shardFingerprint(const ShardManifest& manifest, size_t shard);
+
+/// <summary>
+/// Marks a shard as finished by writing SHARD_DONE_FILE with its fingerprint into its directory.
+/// </summary>
+/// <returns>True when the marker was written.</returns>
+bool markShardDone(const std::string& directory, const std::string& fingerprint);
+
+/// <summary>
+/// True when the shard directory holds a done marker written for the fingerprint.
+/// </summary>
+bool isShardDone(const std::string& directory, const std::string& fingerprint);
+
+/// <summary>
+/// Saves segments with their exact costs, so the merge works on the values a single run holds
+/// rather than on their rounded CSV text.
+/// </summary>
+/// <returns>True when the file was written.</returns>
+bool saveShardSegments(const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments, const std::string& filename);
+
+/// <summary>
+/// Appends the segments saved by saveShardSegments.
+/// </summary>
+/// <param name="filename">Path of the segment file.</param>
+/// <param name="segments">Receives the segments after the ones it holds.</param>
+/// <returns>True when the file was read completely.</returns>
+bool loadShardSegments(const std::string& filename, std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments);
+
+/// <summary>
+/// Binary writer of the GC windows of a shard with their exact values. The merge replays them
+/// into one boundary detector, which carries its state across shard boundaries like a single scan.
+/// </summary>
+class ShardWindowWriter
+{
+public:
+	explicit ShardWindowWriter(const std::string& filename);
+	~ShardWindowWriter();
+
+	ShardWindowWriter(const ShardWindowWriter&) = delete;
+	ShardWindowWriter& operator=(const ShardWindowWriter&) = delete;
+
+	bool is_open() const { return file.is_open(); }
+	void add(uint64_t start, uint64_t end, double gcContent, bool valid);
+	bool close();
+
+private:
+	std::ofstream file;
+	std::string buffer;
+};
+
+/// <summary>
+/// Feeds the windows written by ShardWindowWriter to a boundary detector, in file order.
+/// </summary>
+/// <returns>True when the file was read completely.</returns>
+bool replayShardWindows(const std::string& filename, IsochoreBoundaryDetector& boundaries);
+
+/// <summary>
+/// Writes the header and rows of the first CSV file followed by the rows of the others, skipping
+/// their header lines.
+/// </summary>
+/// <param name="inputs">CSV files in order.</param>
+/// <param name="output">Path of the concatenated CSV file.</param>
+/// <returns>True when every input was read and the output was written.</returns>
+bool concatenateShardCsv(const std::vector<std::string>& inputs, const std::string& output);
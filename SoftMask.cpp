@@ -0,0 +1,61 @@
+#include "SoftMask.h"
+
+#include <algorithm>
+#include <bit>
+
+/// <summary>
+/// Counts the masked bases of [start, end) with one popcount per 64 bases.
+/// </summary>
+/// <param name="start">First position (inclusive).</param>
+/// <param name="end">Last position (exclusive).</param>
+/// <returns>Number of masked bases in the range.</returns>
+uint64_t SoftMask::count(uint64_t start, uint64_t end) const
+{
+	end = std::min(end, length);
+	if (start >= end)
+	{
+		return 0;
+	}
+
+	uint64_t firstWord = start >> 6;
+	uint64_t lastWord = (end - 1) >> 6;
+	uint64_t firstBits = ~uint64_t{ 0 } << (start & 63);
+	uint64_t lastBits = ~uint64_t{ 0 } >> (63 - ((end - 1) & 63));
+	const uint64_t* words = bits.data();
+
+	if (firstWord == lastWord)
+	{
+		return std::popcount(words[firstWord] & firstBits & lastBits);
+	}
+
+	uint64_t total = std::popcount(words[firstWord] & firstBits);
+	for (uint64_t word = firstWord + 1; word < lastWord; ++word)
+	{
+		total += std::popcount(words[word]);
+	}
+	total += std::popcount(words[lastWord] & lastBits);
+	return total;
+}
+
+/// <summary>
+/// Calculates the soft-masked fraction of every segment.
+/// </summary>
+/// <param name="mask">Soft-mask of the sequence the segments were taken from.</param>
+/// <param name="segments">Segments with GC content (start, end, cost, best word, GC, GA).</param>
+/// <returns>The masked fraction (0..1) of each segment, in the same order.</returns>
+std::vector<double> calculateMaskedFractions(
+	const SoftMask& mask,
+	const std::vector<std::tuple<uint64_t, uint64_t, double, std::string, double, double>>& segments)
+{
+	std::vector<double> fractions;
+	fractions.reserve(segments.size());
+
+	for (const auto& segment : segments)
+	{
+		uint64_t start = std::get<0>(segment);
+		uint64_t end = std::get<1>(segment);
+		fractions.push_back(end > start ? static_cast<double>(mask.count(start, end)) / (end - start) : 0.0);
+	}
+
+	return fractions;
+}
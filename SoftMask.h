@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "WordArray.h"
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+/// <summary>
+/// One bit per base marking lowercase (soft-masked) positions of a loaded sequence.
+/// Soft-masking is how RepeatMasker annotations are carried in FASTA files; the loaders
+/// record it here before they uppercase the sequence.
+/// </summary>
+struct SoftMask
+{
+	WordArray bits;            // Bit i % 64 of word i / 64 is set when base i was lowercase
+	uint64_t length = 0;        // Number of bases covered by the mask
+
+	/// <summary>
+	/// Appends the mask bit of the next base.
+	/// </summary>
+	/// <param name="masked">True when the base was lowercase.</param>
+	void push_back(bool masked)
+	{
+		if ((length & 63) == 0)
+		{
+			bits.push_back(0);
+		}
+		if (masked)
+		{
+			bits.back() |= uint64_t{ 1 } << (length & 63);
+		}
+		++length;
+	}
+
+	/// <summary>
+	/// Counts the masked bases of [start, end) with one popcount per 64 bases.
+	/// </summary>
+	/// <param name="start">First position (inclusive).</param>
+	/// <param name="end">Last position (exclusive).</param>
+	/// <returns>Number of masked bases in the range.</returns>
+	uint64_t count(uint64_t start, uint64_t end) const;
+};
+
+/// <summary>
+/// Calculates the soft-masked fraction of every segment.
+/// </summary>
+/// <param name="mask">Soft-mask of the sequence the segments were taken from.</param>
+/// <param name="segments">Segments with GC content (start, end, cost, best word, GC, GA).</param>
+/// <returns>The masked fraction (0..1) of each segment, in the same order.</returns>
+std::vector<double> calculateMaskedFractions(
+	const SoftMask& mask,
+	const std::vector<std::tuple<uint64_t, uint64_t, double, std::string, double, double>>& segments);
@@ -0,0 +1,158 @@
+#include "Spectrum.h"
+#include "CsvWriter.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace
+{
+	/// <summary>
+	/// Lookup table from character to nucleotide index (A=0, C=1, G=2, T=3, other=4).
+	/// </summary>
+	std::array<uint8_t, 256> BuildNucleotideTable()
+	{
+		std::array<uint8_t, 256> table{};
+		table.fill(4);
+		table['A'] = 0;
+		table['C'] = 1;
+		table['G'] = 2;
+		table['T'] = 3;
+		return table;
+	}
+
+	const std::array<uint8_t, 256> NucleotideTable = BuildNucleotideTable();
+
+	/// <summary>
+	/// Phase counters of a single word size. Columns are indexed by absolute position modulo the
+	/// period; a window that is a multiple of the period only rotates the columns, which leaves
+	/// the score unchanged.
+	/// </summary>
+	struct PeriodCounter
+	{
+		int period = 1;
+		uint64_t windowLength = 0;  // Largest multiple of the period that fits in the window
+		std::vector<int> counts;    // period x 5 counts (4 nucleotides + unknown)
+
+		void update(std::string_view sequence, uint64_t begin, uint64_t end, int delta)
+		{
+			int phase = static_cast<int>(begin % period);
+			for (uint64_t i = begin; i < end; ++i)
+			{
+				counts[phase * 5 + NucleotideTable[static_cast<uint8_t>(sequence[i])]] += delta;
+				if (++phase == period) phase = 0;
+			}
+		}
+
+		double score() const
+		{
+			double totalSum = 0.0;
+			for (int col = 0; col < period; ++col)
+			{
+				const int* column = &counts[col * 5];
+				int columnTotal = column[0] + column[1] + column[2] + column[3];
+				int maxValue = std::max(std::max(column[0], column[1]), std::max(column[2], column[3]));
+				if (columnTotal > 0)
+				{
+					totalSum += static_cast<double>(maxValue) / columnTotal;
+				}
+			}
+			return totalSum / period;
+		}
+	};
+}
+
+/// <summary>
+/// Computes the periodicity spectrum of a DNA sequence in a single sweep. For every window and
+/// every word size k in 1..maxWordSize it evaluates the CalculatePercentageSumAndWord score of
+/// the window split into words of size k, normalized by k so that periods can be compared.
+/// The window for word size k is trimmed to a multiple of k, exactly as GenerateOccurrenceMatrix
+/// ignores a trailing partial word.
+/// </summary>
+/// <param name="sequence">The DNA sequence to analyze.</param>
+/// <param name="maxWordSize">Largest word size (period) to evaluate.</param>
+/// <param name="windowSize">Size of the sliding window.</param>
+/// <param name="stepSize">Step size to slide the window.</param>
+/// <param name="outputFile">CSV file receiving one row per window and one column per period.</param>
+/// <returns>The mean normalized score of every period over all windows (index 0 = word size 1).</returns>
+std::vector<double> CalculatePeriodicitySpectrum(
+	std::string_view sequence,
+	int maxWordSize,
+	uint64_t windowSize,
+	uint64_t stepSize,
+	const std::string& outputFile)
+{
+	if (maxWordSize < 1 || static_cast<uint64_t>(maxWordSize) > windowSize || stepSize == 0)
+	{
+		throw std::invalid_argument("Spectrum requires 1 <= maxWordSize <= windowSize and a positive step size.");
+	}
+
+	CsvWriter outfile(outputFile);
+	if (!outfile.is_open())
+	{
+		std::cerr << "Error: Could not open the file " << outputFile << std::endl;
+		return {};
+	}
+
+	outfile << "Start,End";
+	for (int k = 1; k <= maxWordSize; ++k)
+	{
+		outfile << ",P" << k;
+	}
+	outfile << "\n";
+
+	std::vector<PeriodCounter> counters(maxWordSize);
+	for (int k = 1; k <= maxWordSize; ++k)
+	{
+		counters[k - 1].period = k;
+		counters[k - 1].windowLength = windowSize - windowSize % k;
+		counters[k - 1].counts.assign(static_cast<size_t>(k) * 5, 0);
+	}
+
+	std::vector<double> scoreSums(maxWordSize, 0.0);
+	uint64_t windowCount = 0;
+	std::string line;
+	const int precision = defaultCsvPrecision();
+
+	for (uint64_t start = 0; start + windowSize <= sequence.size(); start += stepSize)
+	{
+		// All periods consume the same stretch of the sequence, so it is read from memory once
+		for (auto& counter : counters)
+		{
+			if (start == 0 || stepSize >= counter.windowLength)
+			{
+				std::fill(counter.counts.begin(), counter.counts.end(), 0);
+				counter.update(sequence, start, start + counter.windowLength, 1);
+			}
+			else
+			{
+				uint64_t previousStart = start - stepSize;
+				counter.update(sequence, previousStart, start, -1);
+				counter.update(sequence, previousStart + counter.windowLength, start + counter.windowLength, 1);
+			}
+		}
+
+		line.clear();
+		appendCsvInteger(line, start);
+		line += ',';
+		appendCsvInteger(line, start + windowSize);
+		for (int k = 0; k < maxWordSize; ++k)
+		{
+			double score = counters[k].score();
+			scoreSums[k] += score;
+			line += ',';
+			appendCsvDouble(line, score, precision);
+		}
+		line += '\n';
+		outfile << line;
+		++windowCount;
+	}
+
+	outfile.close();
+
+	for (auto& sum : scoreSums)
+	{
+		sum = windowCount > 0 ? sum / windowCount : 0.0;
+	}
+	return scoreSums;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+/// <summary>
+/// Computes the periodicity spectrum of a DNA sequence in a single sweep. For every window and
+/// every word size k in 1..maxWordSize it evaluates the CalculatePercentageSumAndWord score of
+/// the window split into words of size k, normalized by k so that periods can be compared.
+/// The window for word size k is trimmed to a multiple of k, exactly as GenerateOccurrenceMatrix
+/// ignores a trailing partial word.
+/// </summary>
+/// <param name="sequence">The DNA sequence to analyze.</param>
+/// <param name="maxWordSize">Largest word size (period) to evaluate.</param>
+/// <param name="windowSize">Size of the sliding window.</param>
+/// <param name="stepSize">Step size to slide the window.</param>
+/// <param name="outputFile">CSV file receiving one row per window and one column per period.</param>
+/// <returns>The mean normalized score of every period over all windows (index 0 = word size 1).</returns>
+std::vector<double> CalculatePeriodicitySpectrum(
+	std::string_view sequence,
+	int maxWordSize,
+	uint64_t windowSize,
+	uint64_t stepSize,
+	const std::string& outputFile);
@@ -0,0 +1,387 @@
+#include "SyntheticGenome.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include "CsvWriter.h"
+#include "Segment.h"
+
+static const char BASES[] = { 'A', 'C', 'G', 'T' };
+
+// Index of a base in BASES
+static int baseIndex(char base)
+{
+	switch (base)
+	{
+	case 'A': return 0;
+	case 'C': return 1;
+	case 'G': return 2;
+	default: return 3;
+	}
+}
+
+// True when the word repeats with a shorter period, e.g. ATAT, so its length is not its period
+static bool hasShorterPeriod(const std::string& word)
+{
+	for (size_t period = 1; period < word.size(); ++period)
+	{
+		if (word.size() % period != 0)
+		{
+			continue;
+		}
+		bool periodic = true;
+		for (size_t i = period; i < word.size() && periodic; ++i)
+		{
+			periodic = (word[i] == word[i - period]);
+		}
+		if (periodic)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/// <summary>
+/// Writes a synthetic genome as FASTA and its planted repeats as a truth CSV. The sequence is
+/// generated and written in one streaming pass, so memory does not grow with its length.
+/// </summary>
+/// <param name="settings">Background model and planted repeats.</param>
+/// <param name="fastaFile">Path of the FASTA file to write.</param>
+/// <param name="truthFile">Path of the CSV file receiving every planted repeat.</param>
+/// <returns>The planted repeats, or an empty vector when a file could not be written.</returns>
+std::vector<PlantedRepeat> generateSyntheticGenome(const SyntheticGenomeSettings& settings, const std::string& fastaFile, const std::string& truthFile)
+{
+	if (settings.records == 0 || settings.lineWidth == 0)
+	{
+		throw std::invalid_argument("A synthetic genome needs at least one record and one base per line.");
+	}
+	if (settings.minPeriod < 1 || settings.maxPeriod < settings.minPeriod || settings.minRepeatLength > settings.maxRepeatLength)
+	{
+		throw std::invalid_argument("Planted repeat period and length ranges must not be empty.");
+	}
+
+	CsvWriter fasta(fastaFile);
+	if (!fasta.is_open())
+	{
+		std::cerr << "Error opening file: " << fastaFile << std::endl;
+		return {};
+	}
+
+	std::mt19937_64 generator(settings.seed);
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+	std::normal_distribution<double> gcStep(0.0, settings.gcDrift);
+
+	// Draws a length with the given mean, at least one base
+	auto exponentialLength = [&](double mean)
+	{
+		if (mean <= 0.0)
+		{
+			return uint64_t{ 1 };
+		}
+		double length = -std::log(1.0 - unit(generator)) * mean;
+		return length >= 1e18 ? uint64_t{ 1000000000000000000 } : std::max<uint64_t>(1, static_cast<uint64_t>(length));
+	};
+
+	// GC blocks
+	double gc = std::clamp(settings.meanGc, settings.minGc, settings.maxGc);
+	uint64_t blockEnd = 0;
+
+	// Soft-masked runs alternate with unmasked runs whose mean length gives the masked fraction
+	bool masked = false;
+	uint64_t maskRunEnd = 0;
+	double unmaskedRunLength = settings.softMaskFraction > 0.0
+		? settings.softMaskRunLength * (1.0 - settings.softMaskFraction) / settings.softMaskFraction
+		: 0.0;
+
+	uint64_t position = 0; // Bases written over all records
+	size_t column = 0;     // Bases on the current FASTA line
+
+	auto randomBase = [&]()
+	{
+		uint64_t bits = generator();
+		bool strong = static_cast<double>(bits >> 11) * 0x1.0p-53 < gc;
+		return strong ? BASES[1 + (bits & 1)] : BASES[(bits & 1) * 3];
+	};
+
+	auto writeBase = [&](char base)
+	{
+		if (settings.softMaskFraction > 0.0)
+		{
+			if (position >= maskRunEnd)
+			{
+				masked = (position == 0) ? (unit(generator) < settings.softMaskFraction) : !masked;
+				maskRunEnd = position + exponentialLength(masked ? static_cast<double>(settings.softMaskRunLength) : unmaskedRunLength);
+			}
+			if (masked && base != 'N')
+			{
+				base = static_cast<char>(std::tolower(static_cast<unsigned char>(base)));
+			}
+		}
+
+		fasta << base;
+		if (++column == settings.lineWidth)
+		{
+			fasta << '\n';
+			column = 0;
+		}
+		++position;
+	};
+
+	// Moves to the next GC block when the position reaches the end of the current one
+	auto updateBlock = [&]()
+	{
+		if (position >= blockEnd)
+		{
+			if (position > 0)
+			{
+				gc = std::clamp(gc + gcStep(generator), settings.minGc, settings.maxGc);
+			}
+			uint64_t halfLength = std::max<uint64_t>(1, settings.isochoreLength / 2);
+			blockEnd = position + halfLength + generator() % (2 * halfLength);
+		}
+	};
+
+	std::vector<PlantedRepeat> repeats;
+	double eventsPerBase = (settings.repeatsPerMb + settings.gapsPerMb) / 1e6;
+	double repeatShare = eventsPerBase > 0.0 ? settings.repeatsPerMb / 1e6 / eventsPerBase : 0.0;
+	uint64_t periodRange = static_cast<uint64_t>(settings.maxPeriod - settings.minPeriod) + 1;
+	uint64_t lengthRange = settings.maxRepeatLength - settings.minRepeatLength + 1;
+
+	for (size_t record = 0; record < settings.records; ++record)
+	{
+		std::string recordName = "synthetic_" + std::to_string(record + 1);
+		uint64_t recordLength = settings.length / settings.records + (record + 1 == settings.records ? settings.length % settings.records : 0);
+		uint64_t recordEnd = position + recordLength;
+
+		if (column > 0)
+		{
+			fasta << '\n';
+			column = 0;
+		}
+		fasta << '>' << recordName << " seed=" << settings.seed << '\n';
+
+		while (position < recordEnd)
+		{
+			// Background up to the next event
+			uint64_t stretch = eventsPerBase > 0.0 ? exponentialLength(1.0 / eventsPerBase) : recordEnd - position;
+			uint64_t stretchEnd = std::min(recordEnd, position + stretch);
+			while (position < stretchEnd)
+			{
+				updateBlock();
+				writeBase(randomBase());
+			}
+			if (position >= recordEnd)
+			{
+				break;
+			}
+
+			if (unit(generator) >= repeatShare)
+			{
+				uint64_t gapEnd = std::min(recordEnd, position + settings.gapLength);
+				while (position < gapEnd)
+				{
+					updateBlock();
+					writeBase('N');
+				}
+				continue;
+			}
+
+			uint64_t length = std::min(recordEnd - position, settings.minRepeatLength + generator() % lengthRange);
+			if (length < settings.minRepeatLength)
+			{
+				continue; // Too little of the record is left; the loop fills it with background
+			}
+
+			updateBlock();
+			PlantedRepeat repeat;
+			repeat.record = recordName;
+			repeat.start = position;
+			repeat.end = position + length;
+			repeat.mutationRate = settings.minMutationRate + (settings.maxMutationRate - settings.minMutationRate) * unit(generator);
+			int period = settings.minPeriod + static_cast<int>(generator() % periodRange);
+			do
+			{
+				repeat.word.clear();
+				for (int i = 0; i < period; ++i)
+				{
+					repeat.word += randomBase();
+				}
+			} while (hasShorterPeriod(repeat.word));
+
+			for (uint64_t i = 0; i < length; ++i)
+			{
+				updateBlock();
+				char base = repeat.word[i % repeat.word.size()];
+				if (unit(generator) < repeat.mutationRate)
+				{
+					base = BASES[(baseIndex(base) + 1 + generator() % 3) % 4];
+					++repeat.mutations;
+				}
+				writeBase(base);
+			}
+			repeats.push_back(std::move(repeat));
+		}
+	}
+	if (column > 0)
+	{
+		fasta << '\n';
+	}
+	if (!fasta.close())
+	{
+		std::cerr << "Error writing file: " << fastaFile << std::endl;
+		return {};
+	}
+
+	CsvWriter truth(truthFile);
+	if (!truth.is_open())
+	{
+		std::cerr << "Error opening file: " << truthFile << std::endl;
+		return {};
+	}
+	truth << "Record,Start,End,Word,Period,MutationRate,Mutations\n";
+	for (const auto& repeat : repeats)
+	{
+		truth << repeat.record << ','
+			<< repeat.start << ','
+			<< repeat.end << ','
+			<< repeat.word << ','
+			<< repeat.word.size() << ','
+			<< repeat.mutationRate << ','
+			<< repeat.mutations << '\n';
+	}
+	truth.close();
+
+	std::cout << "Synthetic genome saved successfully!: " << fastaFile << " (" << position << " bases, "
+		<< repeats.size() << " planted repeats in " << truthFile << ")" << std::endl;
+	return repeats;
+}
+
+/// <summary>
+/// Loads the planted repeats written by generateSyntheticGenome.
+/// </summary>
+/// <param name="filename">Path of the truth CSV file.</param>
+/// <returns>The planted repeats in file order.</returns>
+std::vector<PlantedRepeat> loadPlantedRepeats(const std::string& filename)
+{
+	std::ifstream file(filename);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("Unable to open file: " + filename);
+	}
+
+	std::vector<PlantedRepeat> repeats;
+	std::string line;
+	std::getline(file, line); // Skip the header line
+	while (std::getline(file, line))
+	{
+		if (line.empty())
+		{
+			continue;
+		}
+
+		std::istringstream lineStream(line);
+		std::string cell;
+		PlantedRepeat repeat;
+		std::getline(lineStream, repeat.record, ',');
+		std::getline(lineStream, cell, ',');
+		repeat.start = std::stoull(cell);
+		std::getline(lineStream, cell, ',');
+		repeat.end = std::stoull(cell);
+		std::getline(lineStream, repeat.word, ',');
+		std::getline(lineStream, cell, ','); // The period is the word length
+		std::getline(lineStream, cell, ',');
+		repeat.mutationRate = std::stod(cell);
+		std::getline(lineStream, cell, ',');
+		repeat.mutations = std::stoull(cell);
+		repeats.push_back(std::move(repeat));
+	}
+	return repeats;
+}
+
+/// <summary>
+/// Checks which planted repeats the segments recovered: a repeat counts as found when segments
+/// whose best word is a rotation of the best word of an exact copy of the repeat cover at least
+/// PLANTED_REPEAT_MIN_COVERAGE of it.
+/// </summary>
+/// <param name="repeats">Planted repeats.</param>
+/// <param name="segments">Segments sorted by start and not overlapping, e.g. the merged segments.</param>
+/// <param name="wordSize">Word size the segments were computed with.</param>
+/// <returns>One match per planted repeat, in the same order.</returns>
+std::vector<PlantedRepeatMatch> matchPlantedRepeats(const std::vector<PlantedRepeat>& repeats,
+	const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments, int wordSize)
+{
+	std::vector<PlantedRepeatMatch> matches(repeats.size());
+	for (size_t r = 0; r < repeats.size(); ++r)
+	{
+		const PlantedRepeat& repeat = repeats[r];
+		PlantedRepeatMatch& match = matches[r];
+		size_t period = repeat.word.size();
+		match.detectable = period > 0 && wordSize > 0 && static_cast<size_t>(wordSize) % period == 0;
+		if (!match.detectable || repeat.end <= repeat.start)
+		{
+			continue;
+		}
+
+		std::string tiled;
+		while (tiled.size() < static_cast<size_t>(wordSize))
+		{
+			tiled += repeat.word;
+		}
+		// Compare with the word the engine reports for an exact copy, so the letters are spelled
+		// the way CalculatePercentageSumAndWord spells them
+		std::string expected = CalculatePercentageSumAndWord(GenerateOccurrenceMatrix(tiled, wordSize)).second;
+
+		// First segment ending after the repeat starts
+		auto it = std::partition_point(segments.begin(), segments.end(),
+			[&](const auto& segment) { return std::get<1>(segment) <= repeat.start; });
+
+		uint64_t covered = 0;
+		for (; it != segments.end() && std::get<0>(*it) < repeat.end; ++it)
+		{
+			if (MergeCondition(std::get<3>(*it), expected))
+			{
+				covered += std::min(std::get<1>(*it), repeat.end) - std::max(std::get<0>(*it), repeat.start);
+			}
+		}
+		match.coverage = static_cast<double>(covered) / (repeat.end - repeat.start);
+		match.found = match.coverage >= PLANTED_REPEAT_MIN_COVERAGE;
+	}
+	return matches;
+}
+
+/// <summary>
+/// Saves every planted repeat with its coverage and whether it was found.
+/// </summary>
+/// <param name="repeats">Planted repeats.</param>
+/// <param name="matches">Matches of the repeats, in the same order.</param>
+/// <param name="filename">Path to the output CSV file.</param>
+void savePlantedRepeatMatchesToCsv(const std::vector<PlantedRepeat>& repeats, const std::vector<PlantedRepeatMatch>& matches, const std::string& filename)
+{
+	CsvWriter file(filename);
+	if (!file.is_open())
+	{
+		std::cerr << "Error opening file: " << filename << std::endl;
+		return;
+	}
+
+	file << "Record,Start,End,Word,MutationRate,Detectable,Coverage,Found\n";
+	for (size_t i = 0; i < repeats.size() && i < matches.size(); ++i)
+	{
+		file << repeats[i].record << ','
+			<< repeats[i].start << ','
+			<< repeats[i].end << ','
+			<< repeats[i].word << ','
+			<< repeats[i].mutationRate << ','
+			<< (matches[i].detectable ? 1 : 0) << ','
+			<< matches[i].coverage << ','
+			<< (matches[i].found ? 1 : 0) << '\n';
+	}
+	file.close();
+	std::cout << "Planted repeat matches saved to " << filename << std::endl;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+// Background model and planted repeats of a generated genome; lengths are in bases
+struct SyntheticGenomeSettings
+{
+	uint64_t length = 1000000;           // Bases over all records
+	uint64_t seed = 1;                   // Equal settings and seeds give byte-identical files
+	size_t records = 1;                  // FASTA records the bases are split into
+	size_t lineWidth = 60;               // Bases per FASTA line
+
+	// GC content follows a bounded random walk between isochore-like blocks
+	double meanGc = 0.41;                // GC fraction of the first block
+	double gcDrift = 0.03;               // Standard deviation of the GC step between blocks
+	double minGc = 0.30;
+	double maxGc = 0.60;
+	uint64_t isochoreLength = 300000;    // Mean length of a block of constant GC
+
+	// Assembly gaps: runs of N
+	double gapsPerMb = 0.5;
+	uint64_t gapLength = 10000;
+
+	// Soft-masking: runs of lowercase bases covering about this fraction of the sequence
+	double softMaskFraction = 0.0;
+	uint64_t softMaskRunLength = 300;    // Mean length of a masked run
+
+	// Planted hidden repeats: tandem copies of a short word with point mutations
+	double repeatsPerMb = 20.0;
+	int minPeriod = 2;
+	int maxPeriod = 8;
+	uint64_t minRepeatLength = 500;
+	uint64_t maxRepeatLength = 5000;
+	double minMutationRate = 0.0;        // Probability that a repeat base is substituted
+	double maxMutationRate = 0.2;
+};
+
+// One planted repeat; coordinates are half-open and count from the first base of the first
+// record, the coordinates the analysis reports for a whole file
+struct PlantedRepeat
+{
+	std::string record;
+	uint64_t start = 0;
+	uint64_t end = 0;
+	std::string word;          // Repeated word; its length is the period
+	double mutationRate = 0.0; // Substitution probability the repeat was generated with
+	uint64_t mutations = 0;    // Bases actually substituted
+};
+
+// How well the segments of a run recover one planted repeat
+struct PlantedRepeatMatch
+{
+	bool detectable = false; // The word size is a multiple of the period, so the word can be found
+	double coverage = 0.0;   // Fraction of the repeat covered by segments with the best word of an exact copy, up to rotation
+	bool found = false;      // Coverage reached the threshold
+};
+
+// Fraction of a planted repeat the segments must cover with its word to count it as found
+const double PLANTED_REPEAT_MIN_COVERAGE = 0.5;
+
+/// <summary>
+/// Writes a synthetic genome as FASTA and its planted repeats as a truth CSV. The sequence is
+/// generated and written in one streaming pass, so memory does not grow with its length.
+/// </summary>
+/// <param name="settings">Background model and planted repeats.</param>
+/// <param name="fastaFile">Path of the FASTA file to write.</param>
+/// <param name="truthFile">Path of the CSV file receiving every planted repeat.</param>
+/// <returns>The planted repeats, or an empty vector when a file could not be written.</returns>
+std::vector<PlantedRepeat> generateSyntheticGenome(const SyntheticGenomeSettings& settings, const std::string& fastaFile, const std::string& truthFile);
+
+/// <summary>
+/// Loads the planted repeats written by generateSyntheticGenome.
+/// </summary>
+/// <param name="filename">Path of the truth CSV file.</param>
+/// <returns>The planted repeats in file order.</returns>
+std::vector<PlantedRepeat> loadPlantedRepeats(const std::string& filename);
+
+/// <summary>
+/// Checks which planted repeats the segments recovered: a repeat counts as found when segments
+/// whose best word is a rotation of the best word of an exact copy of the repeat cover at least
+/// PLANTED_REPEAT_MIN_COVERAGE of it.
+/// </summary>
+/// <param name="repeats">Planted repeats.</param>
+/// <param name="segments">Segments sorted by start and not overlapping, e.g. the merged segments.</param>
+/// <param name="wordSize">Word size the segments were computed with.</param>
+/// <returns>One match per planted repeat, in the same order.</returns>
+std::vector<PlantedRepeatMatch> matchPlantedRepeats(const std::vector<PlantedRepeat>& repeats,
+	const std::vector<std::tuple<uint64_t, uint64_t, double, std::string>>& segments, int wordSize);
+
+/// <summary>
+/// Saves every planted repeat with its coverage and whether it was found.
+/// </summary>
+/// <param name="repeats">Planted repeats.</param>
+/// <param name="matches">Matches of the repeats, in the same order.</param>
+/// <param name="filename">Path to the output CSV file.</param>
+void savePlantedRepeatMatchesToCsv(const std::vector<PlantedRepeat>& repeats, const std::vector<PlantedRepeatMatch>& matches, const std::string& filename);
@@ -2,6 +2,11 @@
 #include "OccurrenceMatrix.h"
 #include "Segment.h"
 #include "Isochore.h"
+#include "Pipeline.h"
+#include "GcPyramid.h"
+#include "CsvWriter.h"
+#include <cstdlib>
+#include <random>
 
 // Function to measure execution time
 template <typename Func>
@@ -327,4 +332,577 @@ void MergeSegmentTest(std::string segmentFilePath, std::string sequanceFilePath,
 
 	saveSegmentsToCSV(merged, fileName);
 
-}
\ No newline at end of file
+}
+
+// ======================== Self Tests ========================
+
+// Prints the result of one check
+static bool Check(const std::string& name, bool passed)
+{
+	std::cout << (passed ? "PASS " : "FAIL ") << name << std::endl;
+	return passed;
+}
+
+// Deterministic test sequence: random bases, tandem repeats of short words and runs of N
+static std::string TestSequence(uint64_t length, uint64_t seed)
+{
+	std::mt19937_64 random(seed);
+	const char bases[] = "ACGT";
+	std::string sequence;
+	sequence.reserve(length + 1000);
+	while (sequence.size() < length)
+	{
+		uint64_t kind = random() % 10;
+		if (kind < 6)
+		{
+			for (int i = 0; i < 200; ++i) sequence += bases[random() & 3];
+		}
+		else if (kind < 9)
+		{
+			std::string word;
+			for (uint64_t i = 0, size = 3 + random() % 4; i < size; ++i) word += bases[random() & 3];
+			for (int copy = 0; copy < 40; ++copy) sequence += word;
+		}
+		else
+		{
+			sequence.append(100 + random() % 400, 'N');
+		}
+	}
+	sequence.resize(length);
+	return sequence;
+}
+
+// Contigs between the runs of N of a test sequence
+static std::vector<SequenceInterval> TestContigs(const std::string& sequence)
+{
+	std::vector<SequenceInterval> nRuns;
+	for (uint64_t i = 0; i < sequence.size(); ++i)
+	{
+		if (sequence[i] != 'N') continue;
+		if (!nRuns.empty() && nRuns.back().end == i) ++nRuns.back().end;
+		else nRuns.push_back({ i, i + 1 });
+	}
+	return find_acgt_contigs(nRuns, sequence.size(), 1);
+}
+
+// The pipelined segment, merge and GC stages give what the stages run one after another give
+static bool PipelineMatchesSequentialStages()
+{
+	std::string sequence = TestSequence(200000, 43);
+	auto contigs = TestContigs(sequence);
+	SegmentationSettings settings;
+	settings.minSegmentSize = 10;
+	settings.wordSize = 5;
+	settings.lookaheadSize = 5;
+
+	auto segments = SegmentContigs(sequence, contigs, settings);
+	auto merged = MergeSimilarSegments(segments, sequence, settings.wordSize);
+	auto withGc = mergeSegmentsWithGCContent(sequence, merged);
+	auto stages = runSegmentPipeline(sequence, contigs, settings);
+	bool passed = Check("pipeline: segments", stages.segments == segments);
+	passed = Check("pipeline: merged segments", stages.merged == merged) && passed;
+	passed = Check("pipeline: GC rows", stages.withGc == withGc) && passed;
+
+	// Without --skip-gaps the pipeline runs on one contig covering the sequence
+	auto whole = runSegmentPipeline(sequence, { { 0, sequence.size() } }, settings);
+	passed = Check("pipeline: single contig equals SegmentDNACostAndWord",
+		whole.segments == SegmentDNACostAndWord(sequence, settings.minSegmentSize, settings.wordSize, settings.lookaheadSize)) && passed;
+	return passed;
+}
+
+// Folder of the files the self-tests write
+static std::string TestFolder()
+{
+	fs::path folder = fs::temp_directory_path() / "dna-hidden-repeat-detector-self-test";
+	fs::create_directories(folder);
+	return folder.string();
+}
+
+// Bins of a pyramid level counted straight from the sequence, tile by tile
+static std::vector<GcPyramidBin> ReferencePyramidBins(const std::string& sequence, uint64_t binSize)
+{
+	std::vector<GcPyramidBin> bins;
+	for (uint64_t start = 0; start < sequence.size(); start += binSize)
+	{
+		GcPyramidAccumulator total;
+		for (uint64_t tile = start; tile < std::min<uint64_t>(sequence.size(), start + binSize); tile += GC_PYRAMID_TILE_SIZE)
+		{
+			uint64_t gc = 0, valid = 0;
+			for (uint64_t i = tile; i < std::min<uint64_t>(sequence.size(), tile + GC_PYRAMID_TILE_SIZE); ++i)
+			{
+				gc += (sequence[i] == 'G' || sequence[i] == 'C');
+				valid += (sequence[i] != 'N');
+			}
+			if (valid > 0)
+			{
+				float value = static_cast<float>(gc * 100.0 / valid);
+				total.addRange(value, value);
+			}
+			total.gc += gc;
+			total.valid += valid;
+		}
+		bins.push_back(total.bin());
+	}
+	return bins;
+}
+
+static bool SameBins(const std::vector<GcPyramidBin>& a, const std::vector<GcPyramidBin>& b)
+{
+	return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const GcPyramidBin& x, const GcPyramidBin& y)
+		{
+			return x.mean == y.mean && x.min == y.min && x.max == y.max && x.validBases == y.validBases;
+		});
+}
+
+// Every level of a saved pyramid equals the reference bins
+static bool PyramidMatchesReference(const std::string& filename, const std::string& sequence, const std::vector<uint64_t>& binSizes)
+{
+	GcPyramidFile pyramid;
+	if (!openGcPyramid(filename, pyramid) || pyramid.levels.size() != binSizes.size() || pyramid.sequenceLength != sequence.size())
+	{
+		return false;
+	}
+	for (size_t level = 0; level < binSizes.size(); ++level)
+	{
+		if (!SameBins(readGcPyramidRegion(pyramid, level, 0, sequence.size()), ReferencePyramidBins(sequence, binSizes[level])))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// The pyramid counted by the GC window scan, with or without bitplanes and rank index, and the
+// standalone pyramid equal bins counted straight from the sequence; regions read back match
+static bool GcPyramidMatchesReference()
+{
+	std::string sequence = TestSequence(250500, 47);
+	auto contigs = TestContigs(sequence);
+	const std::vector<uint64_t> binSizes = { 1000, 10000, 100000 };
+	std::string folder = TestFolder();
+	std::string filename = (fs::path(folder) / GC_PYRAMID_FILE).string();
+	BitPlaneSequence planes = buildBitPlanes(sequence);
+	GcRankIndex index = buildGcRankIndex(sequence);
+
+	bool passed = Check("GC pyramid: standalone equals reference",
+		writeGcPyramid(sequence, binSizes, filename) && PyramidMatchesReference(filename, sequence, binSizes));
+
+	const std::pair<const char*, IsochoreScanOptions> variants[] = {
+		{ "scalar", {} }, { "bitplanes", { &planes, nullptr } }, { "rank index", { nullptr, &index } } };
+	for (const auto& [name, options] : variants)
+	{
+		for (bool skipGaps : { false, true })
+		{
+			GcPyramidBuilder pyramid(sequence.size(), binSizes);
+			IsochoreScanOptions scan = options;
+			scan.pyramid = &pyramid;
+			detect_isochores_in_contigs(sequence, skipGaps ? contigs : std::vector<SequenceInterval>{ { 0, sequence.size() } },
+				folder, 3000, 700, scan);
+			passed = Check(std::string("GC pyramid: window scan (") + name + (skipGaps ? ", contigs" : "") + ") equals reference",
+				pyramid.write(filename) && PyramidMatchesReference(filename, sequence, binSizes)) && passed;
+		}
+	}
+
+	// A region from the middle of a bin to the middle of another, at the level chosen for the resolution
+	GcPyramidFile opened;
+	openGcPyramid(filename, opened);
+	auto reference = ReferencePyramidBins(sequence, 10000);
+	passed = Check("GC pyramid: level choice", chooseGcPyramidLevel(opened, 1) == 0 && chooseGcPyramidLevel(opened, 25000) == 1
+		&& chooseGcPyramidLevel(opened, 1000000) == 2) && passed;
+	passed = Check("GC pyramid: region read",
+		SameBins(readGcPyramidRegion(opened, 1, 15000, 42000), std::vector<GcPyramidBin>(reference.begin() + 1, reference.begin() + 5))) && passed;
+	return passed;
+}
+
+// Whole content of a file, or an empty string when it cannot be read
+static std::string ReadTestFile(const std::string& filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	std::ostringstream text;
+	text << file.rdbuf();
+	return text.str();
+}
+
+// Best penalized score over every segmentation on the word grid, by exhaustive dynamic programming
+static double ExhaustiveOptimalScore(std::string_view sequence, int minSegmentSize, int wordSize, double penalty)
+{
+	uint64_t words = sequence.size() / wordSize;
+	std::vector<double> best(words + 1, -std::numeric_limits<double>::infinity());
+	best[0] = 0.0;
+	for (uint64_t t = 1; t <= words; ++t)
+	{
+		std::vector<std::vector<int>> matrix(4, std::vector<int>(wordSize, 0));
+		for (uint64_t s = t; s-- > 0;)
+		{
+			AddWordToOccurrenceMatrix(matrix, sequence.substr(s * wordSize, wordSize));
+			if (t - s >= static_cast<uint64_t>(minSegmentSize) && best[s] > -std::numeric_limits<double>::infinity())
+			{
+				best[t] = std::max(best[t], best[s] + CalculatePercentageSum(matrix) - penalty);
+			}
+		}
+	}
+	return best[words];
+}
+
+// The pruned optimal engine reaches the best score of the exhaustive dynamic programming
+static bool OptimalEngineMatchesExhaustiveSearch()
+{
+	bool passed = true;
+	for (int wordSize : { 3, 4 })
+	{
+		std::string sequence = TestSequence(900 * wordSize, 29 + wordSize);
+		std::replace(sequence.begin(), sequence.end(), 'N', 'A');
+		double penalty = wordSize / 2.0;
+		auto segments = SegmentDNAOptimal(sequence, 5, wordSize, penalty);
+		double expected = ExhaustiveOptimalScore(sequence, 5, wordSize, penalty);
+		passed = Check("optimal engine: word size " + std::to_string(wordSize) + " reaches the exhaustive optimum",
+			std::abs(TotalSegmentationScore(segments, penalty) - expected) < 1e-9 * std::max(1.0, std::abs(expected))) && passed;
+	}
+	return passed;
+}
+
+// Bound-and-prune gives the segments of the exhaustive lookahead loop
+static bool PrunedLookaheadMatchesExhaustive()
+{
+	bool passed = true;
+	std::string sequence = TestSequence(150000, 31);
+	for (int lookahead : { 5, 40 })
+	{
+		LookaheadStats stats;
+		auto pruned = SegmentDNACostAndWord(sequence, 10, 4, lookahead, true, &stats);
+		auto exhaustive = SegmentDNACostAndWord(sequence, 10, 4, lookahead, false);
+		passed = Check("pruned lookahead: lookahead " + std::to_string(lookahead) + " gives the same segments",
+			pruned == exhaustive && (lookahead < 40 || stats.pruned > 0)) && passed;
+	}
+	return passed;
+}
+
+// The parallel window scan writes the same CSV with the scalar, bitplane and rank index counts,
+// and every window holds the GC content counted straight from the sequence
+static bool WindowScanMatchesReference()
+{
+	std::string sequence = TestSequence(300000, 37);
+	auto contigs = TestContigs(sequence);
+	BitPlaneSequence planes = buildBitPlanes(sequence);
+	GcRankIndex index = buildGcRankIndex(sequence);
+	std::string folder = TestFolder();
+	const uint64_t windowSize = 2500, stepSize = 300;
+	std::string filename = (fs::path(folder) / ("isochores_output_" + std::to_string(windowSize) + "_" + std::to_string(stepSize) + ".csv")).string();
+
+	bool passed = true;
+	for (bool skipGaps : { false, true })
+	{
+		auto scanned = skipGaps ? contigs : std::vector<SequenceInterval>{ { 0, sequence.size() } };
+		std::string expected;
+		bool windowsMatch = true;
+		const std::pair<const char*, IsochoreScanOptions> variants[] = {
+			{ "scalar", {} }, { "bitplanes", { &planes, nullptr } }, { "rank index", { nullptr, &index } } };
+		for (const auto& [name, options] : variants)
+		{
+			IsochoreScanOptions scan = options;
+			scan.onWindow = [&](uint64_t start, uint64_t end, double gcContent, bool valid)
+				{
+					uint64_t gc = 0, known = 0;
+					for (uint64_t i = start; i < end; ++i)
+					{
+						gc += (sequence[i] == 'G' || sequence[i] == 'C');
+						known += (sequence[i] != 'N');
+					}
+					windowsMatch = windowsMatch && valid == (known > 0)
+						&& gcContent == (known > 0 ? (gc / static_cast<double>(known)) * 100.0 : 0.0);
+				};
+			detect_isochores_in_contigs(sequence, scanned, folder, windowSize, stepSize, scan);
+			std::string written = ReadTestFile(filename);
+			if (expected.empty())
+			{
+				expected = written;
+			}
+			passed = Check(std::string("window scan: ") + name + (skipGaps ? " (contigs)" : "") + " writes the scalar CSV",
+				!written.empty() && written == expected) && passed;
+		}
+		passed = Check(std::string("window scan: GC of every window") + (skipGaps ? " (contigs)" : ""), windowsMatch) && passed;
+	}
+	return passed;
+}
+
+// CsvWriter writes exactly what the same std::ofstream insertions write
+static bool CsvWriterMatchesOfstream()
+{
+	std::string folder = TestFolder();
+	std::string csvName = (fs::path(folder) / "csv_writer.csv").string();
+	std::string streamName = (fs::path(folder) / "csv_stream.csv").string();
+	std::mt19937_64 random(41);
+	std::uniform_real_distribution<double> fraction(0.0, 1.0);
+	const double fixedValues[] = { 0.0, -0.0, 1.0, -2.5, 1.0 / 3.0, 1e-7, 123456789.123, 1e21, 99.99995, 0.1 };
+
+	bool passed = true;
+	for (int precision : { 6, 3, 12 })
+	{
+		{
+			CsvWriter csv(csvName, precision);
+			std::ofstream stream(streamName);
+			stream << std::setprecision(precision);
+			// Enough rows to fill several writer buffers
+			for (int row = 0; row < 120000; ++row)
+			{
+				uint64_t position = random() >> 20;
+				double value = (row % 3 == 0) ? fixedValues[row % 10] : (fraction(random) - 0.5) * std::pow(10.0, static_cast<int>(random() % 24) - 12);
+				csv << position << ',' << -row << ',' << value << ",word" << (row % 7) << "\n";
+				stream << position << ',' << -row << ',' << value << ",word" << (row % 7) << "\n";
+			}
+			passed = Check("CSV writer: close succeeds", csv.close()) && passed;
+		}
+		std::string written = ReadTestFile(csvName);
+		passed = Check("CSV writer: precision " + std::to_string(precision) + " is byte-identical to std::ofstream",
+			!written.empty() && written == ReadTestFile(streamName)) && passed;
+	}
+
+	CsvWriter unopened((fs::path(folder) / "missing" / "csv_writer.csv").string());
+	unopened << "text\n";
+	passed = Check("CSV writer: close fails when the file did not open", !unopened.close()) && passed;
+	return passed;
+}
+
+static bool SameOverlaps(const std::vector<Overlap>& a, const std::vector<Overlap>& b)
+{
+	return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const Overlap& x, const Overlap& y)
+		{
+			return x.isochore_start == y.isochore_start && x.isochore_end == y.isochore_end && x.isochore_gc == y.isochore_gc
+				&& x.segment_start == y.segment_start && x.segment_end == y.segment_end && x.segment_cost == y.segment_cost
+				&& x.best_word == y.best_word && x.overlap_length == y.overlap_length;
+		});
+}
+
+// The sweep-line join gives the records and statistics of comparing every isochore with every
+// segment, for sorted and shuffled inputs
+static bool SweepJoinMatchesNestedLoops()
+{
+	std::string sequence = TestSequence(200000, 53);
+	SegmentationSettings settings;
+	settings.minSegmentSize = 10;
+	settings.wordSize = 3;
+	settings.lookaheadSize = 5;
+	auto segments = SegmentContigs(sequence, TestContigs(sequence), settings);
+
+	std::mt19937_64 random(59);
+	std::vector<Isochore> isochores;
+	for (uint64_t start = 0; start < sequence.size(); start += 500 + random() % 3000)
+	{
+		isochores.push_back({ start, start + 300 + random() % 8000, 30.0 + random() % 300 / 10.0 });
+	}
+
+	bool passed = true;
+	for (bool shuffled : { false, true })
+	{
+		if (shuffled)
+		{
+			std::shuffle(isochores.begin(), isochores.end(), random);
+			std::shuffle(segments.begin(), segments.end(), random);
+		}
+
+		// Nested loops over the inputs in their order
+		OverlapStatistics expected;
+		expected.totalIsochores = static_cast<int>(isochores.size());
+		std::vector<Overlap> expectedOverlaps;
+		for (const auto& iso : isochores)
+		{
+			int count = 0;
+			for (const auto& [start, end, cost, word] : segments)
+			{
+				if (start < iso.end && end > iso.start)
+				{
+					expectedOverlaps.push_back({ iso.start, iso.end, iso.gc_content, start, end, cost, word,
+						std::min<uint64_t>(iso.end, end) - std::max<uint64_t>(iso.start, start) });
+					expected.addOverlap(cost, word);
+					++count;
+				}
+			}
+			if (count == 1)
+			{
+				expected.singleSegmentIsochores++;
+				expected.singleSegmentGCSum += iso.gc_content;
+			}
+		}
+
+		OverlapStatistics statistics;
+		auto overlaps = findIsochoreSegmentOverlap(isochores, segments, statistics);
+		std::string inputs = shuffled ? " (shuffled inputs)" : "";
+		passed = Check("sweep join: records equal the nested loops" + inputs, !overlaps.empty() && SameOverlaps(overlaps, expectedOverlaps)) && passed;
+		passed = Check("sweep join: statistics equal the nested loops" + inputs,
+			statistics.totalIsochores == expected.totalIsochores && statistics.overlapCount == expected.overlapCount
+			&& statistics.singleSegmentIsochores == expected.singleSegmentIsochores && statistics.singleSegmentGCSum == expected.singleSegmentGCSum
+			&& statistics.totalCostSum == expected.totalCostSum && statistics.minCost == expected.minCost && statistics.maxCost == expected.maxCost
+			&& statistics.topWords(OVERLAP_TOP_WORDS) == expected.topWords(OVERLAP_TOP_WORDS)) && passed;
+	}
+	return passed;
+}
+
+// detect_isochores returns nothing for windows longer than the sequence instead of reading past it
+static bool DetectIsochoresHandlesShortSequences()
+{
+	std::string sequence = TestSequence(1000, 59);
+	bool passed = Check("isochores: window longer than the sequence gives no isochores",
+		detect_isochores(sequence, sequence.size() + 1, 0.0).empty());
+	passed = Check("isochores: empty sequence gives no isochores", detect_isochores(std::string(), 100, 0.0).empty()) && passed;
+	passed = Check("isochores: window of the whole sequence is scored",
+		detect_isochores(sequence, sequence.size(), 0.0).size() == 1) && passed;
+	return passed;
+}
+
+// Runs the program with the arguments, its output discarded; true when it exits with 0
+static bool RunProgram(const std::string& program, const std::string& arguments)
+{
+#ifdef _WIN32
+	std::string command = "\"\"" + program + "\" " + arguments + " > NUL 2>&1\"";
+#else
+	std::string command = "\"" + program + "\" " + arguments + " > /dev/null 2>&1 < /dev/null";
+#endif
+	return std::system(command.c_str()) == 0;
+}
+
+// Planning three shards, running them as separate processes and merging them writes the files
+// of a single --skip-gaps run
+static bool ShardMergeMatchesSingleRun(const std::string& program)
+{
+	fs::path folder = fs::path(TestFolder()) / "shards";
+	fs::remove_all(folder);
+	fs::create_directories(folder / "single");
+	fs::create_directories(folder / "sharded");
+
+	std::string genome = (folder / "genome.fa").string();
+	{
+		std::string sequence = TestSequence(400000, 61);
+		std::ofstream file(genome);
+		file << ">test\n";
+		for (size_t line = 0; line < sequence.size(); line += 80)
+		{
+			file << sequence.substr(line, 80) << '\n';
+		}
+	}
+
+	auto quoted = [](const fs::path& path)
+		{
+			std::string text = "\"";
+			text += path.string();
+			text += '"';
+			return text;
+		};
+	std::string run = quoted(genome) + " chromosome 10 3 5 2000 500 ";
+	std::string flags = " --skip-gaps --min-gap=100 --isochores=5000 --no-progress";
+	std::string manifest = quoted(folder / "sharded" / "shards" / "manifest.tsv");
+	bool ran = RunProgram(program, run + quoted(folder / "single" / "") + flags)
+		&& RunProgram(program, run + quoted(folder / "sharded" / "") + flags + " --shards=3 --trace=" + quoted(folder / "plan_trace.json"));
+	for (int shard = 0; ran && shard < 3; ++shard)
+	{
+		ran = RunProgram(program, "--run-shard=" + manifest + ":" + std::to_string(shard) + " --no-progress");
+	}
+	ran = ran && RunProgram(program, "--merge-shards=" + manifest + " --no-progress");
+	bool passed = Check("shards: plan, run and merge succeed", ran);
+	passed = Check("shards: the planning trace is not passed on to the shards",
+		ReadTestFile((folder / "sharded" / "shards" / "manifest.tsv").string()).find("--trace") == std::string::npos) && passed;
+
+	const char* outputs[] = { "segments_output_10_3_5.csv", "merged_segments_output_10_3_5.csv", "segments_GcContent_output_10_3_5.csv",
+		"isochores_output_2000_500.csv", "isochore_intervals_2000_500.csv", "isochore_overlaps_10_3_5.csv", "gaps_output.csv" };
+	for (const char* output : outputs)
+	{
+		std::string single = ReadTestFile((folder / "single" / output).string());
+		passed = Check(std::string("shards: merged ") + output + " equals a single run",
+			!single.empty() && single == ReadTestFile((folder / "sharded" / output).string())) && passed;
+	}
+	return passed;
+}
+
+// The k-mer tables, direct and open addressing, hold the counts of a map keyed by the words
+static bool KmerCountsMatchReference()
+{
+	std::string sequence = TestSequence(200000, 67);
+	auto contigs = TestContigs(sequence);
+	bool passed = true;
+	for (int k : { 6, 13, 32 })
+	{
+		std::map<std::string, uint64_t> expected;
+		for (const auto& contig : contigs)
+		{
+			for (uint64_t i = contig.start; i + k <= contig.end; ++i)
+			{
+				++expected[sequence.substr(i, k)];
+			}
+		}
+		std::vector<std::pair<uint64_t, uint64_t>> expectedEntries;
+		for (const auto& [word, count] : expected)
+		{
+			uint64_t code = 0;
+			KmerCounter::encode(word, code);
+			expectedEntries.emplace_back(code, count);
+		}
+		passed = Check("k-mers: k = " + std::to_string(k) + " counts equal a map of the words",
+			countKmers(sequence, contigs, k).entries() == expectedEntries) && passed;
+	}
+	return passed;
+}
+
+// The streamed GC windows of a soft-masked FASTA file with stray characters equal those of the
+// clean uppercase file, whose bases are what load_fasta_file reads from the soft-masked one
+static bool StreamedWindowsMatchLoader()
+{
+	fs::path folder = TestFolder();
+	std::mt19937_64 random(71);
+	std::string messy, clean;
+	for (int record = 0; record < 2; ++record)
+	{
+		std::string sequence = TestSequence(30000 + record * 7000, 73 + record);
+		std::string header = ">record" + std::to_string(record) + " test sequence\n";
+		messy += header;
+		clean += header;
+		for (size_t i = 0; i < sequence.size(); ++i)
+		{
+			bool masked = (i / 700) % 3 == 0;
+			messy += masked ? static_cast<char>(std::tolower(static_cast<unsigned char>(sequence[i]))) : sequence[i];
+			if (random() % 500 == 0) messy += "-*1 \t"[random() % 5];
+			if (i % 60 == 59) messy += "\r\n";
+		}
+		messy += '\n';
+		clean += sequence + '\n';
+	}
+	std::string messyName = (folder / "stream_messy.fa").string();
+	std::string cleanName = (folder / "stream_clean.fa").string();
+	std::ofstream(messyName, std::ios::binary) << messy;
+	std::ofstream(cleanName, std::ios::binary) << clean;
+
+	std::string firstRecord = (folder / "stream_record.fa").string();
+	std::ofstream(firstRecord, std::ios::binary) << messy.substr(0, messy.find(">record1"));
+	bool passed = Check("GC stream: load_fasta_file reads the clean bases",
+		load_fasta_file(firstRecord) == clean.substr(clean.find('\n') + 1, TestSequence(30000, 73).size()));
+
+	std::string messyWindows = (folder / "stream_messy.csv").string();
+	std::string cleanWindows = (folder / "stream_clean.csv").string();
+	uint64_t count = streamGcWindows(messyName, 2000, 300, messyWindows);
+	passed = Check("GC stream: soft-masked file with stray characters gives the clean file's windows",
+		count > 0 && count == streamGcWindows(cleanName, 2000, 300, cleanWindows)
+		&& ReadTestFile(messyWindows) == ReadTestFile(cleanWindows)) && passed;
+	return passed;
+}
+
+/// <summary>
+/// Runs the self-tests: every fast path is compared with its reference implementation on small
+/// generated sequences. Prints PASS or FAIL per check.
+/// </summary>
+/// <param name="program">Path of this program, run as separate processes by the shard test.</param>
+/// <returns>True when every check passed.</returns>
+bool RunSelfTests(const std::string& program)
+{
+	bool passed = true;
+	passed = OptimalEngineMatchesExhaustiveSearch() && passed;
+	passed = PrunedLookaheadMatchesExhaustive() && passed;
+	passed = WindowScanMatchesReference() && passed;
+	passed = CsvWriterMatchesOfstream() && passed;
+	passed = SweepJoinMatchesNestedLoops() && passed;
+	passed = DetectIsochoresHandlesShortSequences() && passed;
+	passed = KmerCountsMatchReference() && passed;
+	passed = StreamedWindowsMatchLoader() && passed;
+	passed = ShardMergeMatchesSingleRun(program) && passed;
+	passed = PipelineMatchesSequentialStages() && passed;
+	passed = GcPyramidMatchesReference() && passed;
+	std::cout << (passed ? "All self-tests passed" : "Some self-tests failed") << std::endl;
+	return passed;
+}
@@ -16,5 +16,13 @@ void DetectIsochoresInChromosome(std::string chromosomeFile, std::string outputP
 void DetectIsochoresInChromosome2(std::string chromosomeFile, std::string outputPath);
 void DetectIsochoresInChromosome3(std::string chromosomeFile, std::string outputPath);
 
+/// <summary>
+/// Runs the self-tests: every fast path is compared with its reference implementation on small
+/// generated sequences. Prints PASS or FAIL per check.
+/// </summary>
+/// <param name="program">Path of this program, run as separate processes by the shard test.</param>
+/// <returns>True when every check passed.</returns>
+bool RunSelfTests(const std::string& program);
+
 
 
@@ -0,0 +1,303 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstdint>
+
+// Pool and queue of the current thread, when it is a pool worker
+static thread_local ThreadPool* currentPool = nullptr;
+static thread_local size_t currentQueue = 0;
+
+static std::atomic<size_t> configuredThreadCount{ 0 };
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (size_t q = 0; q < threadCount; ++q)
+	{
+		queues.push_back(std::make_unique<TaskQueue>());
+	}
+	for (size_t w = 0; w + 1 < threadCount; ++w)
+	{
+		workers.emplace_back(&ThreadPool::workerLoop, this, w);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMtx);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	while (runPendingTask())
+	{
+	}
+}
+
+void ThreadPool::submit(std::function<void()> task, TaskPriority priority)
+{
+	// Workers keep their own tasks; every other thread shares the last queue
+	size_t q = (currentPool == this) ? currentQueue : queues.size() - 1;
+	{
+		std::lock_guard<std::mutex> lock(queues[q]->mtx);
+		queues[q]->tasks[static_cast<size_t>(priority)].push_back(std::move(task));
+	}
+	bool anyWaiter = false;
+	{
+		std::lock_guard<std::mutex> lock(sleepMtx);
+		++queued;
+		anyWaiter = waiterCount > 0;
+	}
+	wake.notify_one();
+	if (anyWaiter)
+	{
+		waiters.notify_all();
+	}
+}
+
+void ThreadPool::waitForTask(const std::function<bool()>& done)
+{
+	std::unique_lock<std::mutex> lock(sleepMtx);
+	++waiterCount;
+	waiters.wait(lock, [&]() { return queued > 0 || done(); });
+	--waiterCount;
+}
+
+void ThreadPool::notifyWaiters()
+{
+	// Taking the lock orders the notification after a waiter that saw the old state went to sleep
+	{
+		std::lock_guard<std::mutex> lock(sleepMtx);
+	}
+	waiters.notify_all();
+}
+
+bool ThreadPool::takeTask(std::function<void()>& task)
+{
+	if (queued == 0)
+	{
+		return false;
+	}
+
+	size_t self = (currentPool == this) ? currentQueue : queues.size() - 1;
+	for (size_t priority = 0; priority < PRIORITY_COUNT; ++priority)
+	{
+		// Own queue newest first (its data is still in cache), then steal the oldest task elsewhere
+		for (size_t k = 0; k < queues.size(); ++k)
+		{
+			size_t q = (self + k) % queues.size();
+			std::lock_guard<std::mutex> lock(queues[q]->mtx);
+			auto& tasks = queues[q]->tasks[priority];
+			if (tasks.empty())
+			{
+				continue;
+			}
+			if (k == 0)
+			{
+				task = std::move(tasks.back());
+				tasks.pop_back();
+			}
+			else
+			{
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+			--queued;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ThreadPool::runPendingTask()
+{
+	std::function<void()> task;
+	if (!takeTask(task))
+	{
+		return false;
+	}
+	task();
+	return true;
+}
+
+void ThreadPool::workerLoop(size_t index)
+{
+	currentPool = this;
+	currentQueue = index;
+
+	while (true)
+	{
+		if (runPendingTask())
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMtx);
+		wake.wait(lock, [this]() { return stopping || queued > 0; });
+		if (stopping && queued == 0)
+		{
+			return;
+		}
+	}
+}
+
+/// <summary>
+/// Sets the number of threads of the shared pool. Only effective before the pool is first used.
+/// </summary>
+/// <param name="threadCount">Threads taking part, including the waiting caller (0 = hardware threads).</param>
+void setThreadPoolSize(size_t threadCount)
+{
+	configuredThreadCount = threadCount;
+}
+
+/// <summary>
+/// The pool shared by all stages, created on first use.
+/// </summary>
+ThreadPool& globalThreadPool()
+{
+	static ThreadPool pool(configuredThreadCount);
+	return pool;
+}
+
+TaskGroup::~TaskGroup()
+{
+	try
+	{
+		wait();
+	}
+	catch (...)
+	{
+		// The failure was only reported to a wait that never came
+	}
+}
+
+void TaskGroup::run(std::function<void()> task, TaskPriority priority)
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		++pending;
+	}
+	pool.submit([this, owner = &pool, task = std::move(task)]()
+		{
+			std::exception_ptr error;
+			try
+			{
+				task();
+			}
+			catch (...)
+			{
+				error = std::current_exception();
+			}
+
+			bool last = false;
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				if (error && !failure) failure = error;
+				last = (--pending == 0);
+			}
+			// Once wait sees zero the group may be destroyed, so only the pool is used from here
+			if (last)
+			{
+				owner->notifyWaiters();
+			}
+		}, priority);
+}
+
+void TaskGroup::wait()
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mtx);
+			if (pending == 0)
+			{
+				break;
+			}
+		}
+		if (!pool.runPendingTask())
+		{
+			// Nothing to help with: sleep until the group is done or a task arrives to help with
+			pool.waitForTask([this]()
+				{
+					std::lock_guard<std::mutex> lock(mtx);
+					return pending == 0;
+				});
+		}
+	}
+
+	std::exception_ptr error;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		std::swap(error, failure);
+	}
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+}
+
+void* ScratchArena::allocate(size_t bytes, size_t alignment)
+{
+	while (true)
+	{
+		if (current < blocks.size())
+		{
+			Block& block = blocks[current];
+			uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+			size_t offset = static_cast<size_t>(((base + used + alignment - 1) & ~(uintptr_t(alignment) - 1)) - base);
+			if (offset + bytes <= block.size)
+			{
+				used = offset + bytes;
+				return block.data.get() + offset;
+			}
+			if (current + 1 < blocks.size() && blocks[current + 1].size >= bytes + alignment)
+			{
+				++current;
+				used = 0;
+				continue;
+			}
+		}
+
+		// A new block after the current one; blocks after it are unused and can be replaced
+		size_t size = std::max(BLOCK_SIZE, bytes + alignment);
+		size_t next = (current < blocks.size()) ? current + 1 : blocks.size();
+		blocks.resize(std::max(blocks.size(), next + 1));
+		blocks[next] = { std::make_unique<char[]>(size), size };
+		current = next;
+		used = 0;
+	}
+}
+
+void ScratchArena::release(Mark mark)
+{
+	current = mark.block;
+	used = mark.used;
+
+	// Keep the regular blocks for the next task, give oversized ones back. The block of the mark
+	// only holds live data when the mark is inside it.
+	for (size_t b = (used == 0) ? current : current + 1; b < blocks.size(); ++b)
+	{
+		if (blocks[b].size > BLOCK_SIZE)
+		{
+			blocks.resize(b);
+			break;
+		}
+	}
+}
+
+/// <summary>
+/// The scratch arena of the calling thread.
+/// </summary>
+ScratchArena& threadScratchArena()
+{
+	static thread_local ScratchArena arena;
+	return arena;
+}
@@ -0,0 +1,205 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+/// <summary>
+/// Priority of a pool task. Higher priority tasks are taken first from every queue, so latency
+/// sensitive work (output formatting a writer waits on) overtakes background stages.
+/// </summary>
+enum class TaskPriority
+{
+	High = 0,
+	Normal = 1,
+	Low = 2
+};
+
+/// <summary>
+/// Work-stealing task scheduler shared by every stage. Each worker owns a queue per priority;
+/// tasks submitted from a worker go to its own queue and are taken back newest first, while idle
+/// workers steal the oldest tasks of the others. Threads that wait for tasks help run them, so
+/// nested parallel loops do not deadlock and a pool of one thread runs everything on the caller.
+/// </summary>
+class ThreadPool
+{
+public:
+	/// <summary>
+	/// Starts threadCount - 1 workers; the thread waiting on a TaskGroup is the last one.
+	/// </summary>
+	/// <param name="threadCount">Threads taking part, including the waiting caller (0 = hardware threads).</param>
+	explicit ThreadPool(size_t threadCount);
+
+	/// <summary>
+	/// Runs the remaining tasks and stops the workers.
+	/// </summary>
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/// <summary>
+	/// Number of threads taking part, including the waiting caller.
+	/// </summary>
+	size_t threadCount() const { return workers.size() + 1; }
+
+	/// <summary>
+	/// Queues a task. Exceptions must not escape it; use TaskGroup to collect them.
+	/// </summary>
+	void submit(std::function<void()> task, TaskPriority priority = TaskPriority::Normal);
+
+	/// <summary>
+	/// Runs one queued task on the calling thread, highest priority first.
+	/// </summary>
+	/// <returns>False when no task was queued.</returns>
+	bool runPendingTask();
+
+	/// <summary>
+	/// Sleeps until a task is queued or done returns true. done is called with the pool's sleep
+	/// lock held, so it must not submit tasks; whatever makes it true calls notifyWaiters afterwards.
+	/// </summary>
+	void waitForTask(const std::function<bool()>& done);
+
+	/// <summary>
+	/// Wakes the threads sleeping in waitForTask, so they check their condition again.
+	/// </summary>
+	void notifyWaiters();
+
+private:
+	static const size_t PRIORITY_COUNT = 3;
+
+	struct TaskQueue
+	{
+		std::mutex mtx;
+		std::deque<std::function<void()>> tasks[PRIORITY_COUNT];
+	};
+
+	bool takeTask(std::function<void()>& task);
+	void workerLoop(size_t index);
+
+	std::vector<std::unique_ptr<TaskQueue>> queues; // One per worker, then one for other threads
+	std::vector<std::thread> workers;
+	std::atomic<size_t> queued{ 0 };
+	std::mutex sleepMtx;
+	std::condition_variable wake;
+	std::condition_variable waiters; // Threads waiting on a TaskGroup; woken by new tasks and finished groups
+	size_t waiterCount = 0;
+	bool stopping = false;
+};
+
+/// <summary>
+/// Sets the number of threads of the shared pool. Only effective before the pool is first used.
+/// </summary>
+/// <param name="threadCount">Threads taking part, including the waiting caller (0 = hardware threads).</param>
+void setThreadPoolSize(size_t threadCount);
+
+/// <summary>
+/// The pool shared by all stages, created on first use.
+/// </summary>
+ThreadPool& globalThreadPool();
+
+/// <summary>
+/// A set of tasks that can be waited for together. The first exception thrown by a task is
+/// rethrown by wait. The destructor waits as well, so tasks never outlive what they reference.
+/// </summary>
+class TaskGroup
+{
+public:
+	explicit TaskGroup(ThreadPool& pool = globalThreadPool()) : pool(pool) {}
+	~TaskGroup();
+
+	TaskGroup(const TaskGroup&) = delete;
+	TaskGroup& operator=(const TaskGroup&) = delete;
+
+	void run(std::function<void()> task, TaskPriority priority = TaskPriority::Normal);
+
+	/// <summary>
+	/// Runs pool tasks on the calling thread until every task of the group has finished.
+	/// </summary>
+	void wait();
+
+private:
+	ThreadPool& pool;
+	size_t pending = 0;
+	std::exception_ptr failure;
+	std::mutex mtx;
+};
+
+/// <summary>
+/// Per-thread bump allocator for scratch arrays of a task. Memory is handed out from blocks that
+/// stay with the thread, so repeated tasks do not go back to the heap; a ScratchScope gives back
+/// everything allocated inside it. Arrays larger than a block get a block of their own, which is
+/// freed again when released so one huge task does not pin memory on every thread.
+/// </summary>
+class ScratchArena
+{
+public:
+	static const size_t BLOCK_SIZE = size_t{ 1 } << 20;
+
+	struct Mark
+	{
+		size_t block;
+		size_t used;
+	};
+
+	/// <summary>
+	/// Allocates uninitialized memory, valid until the enclosing scope releases it.
+	/// </summary>
+	void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+	template <typename T>
+	T* allocate(size_t count)
+	{
+		return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+	}
+
+	Mark mark() const { return { current, used }; }
+	void release(Mark mark);
+
+private:
+	struct Block
+	{
+		std::unique_ptr<char[]> data;
+		size_t size;
+	};
+
+	std::vector<Block> blocks;
+	size_t current = 0; // Block being filled
+	size_t used = 0;    // Bytes used in that block
+};
+
+/// <summary>
+/// The scratch arena of the calling thread.
+/// </summary>
+ScratchArena& threadScratchArena();
+
+/// <summary>
+/// Releases everything allocated from the thread's scratch arena during its lifetime.
+/// </summary>
+class ScratchScope
+{
+public:
+	ScratchScope() : arena(threadScratchArena()), saved(arena.mark()) {}
+	~ScratchScope() { arena.release(saved); }
+
+	ScratchScope(const ScratchScope&) = delete;
+	ScratchScope& operator=(const ScratchScope&) = delete;
+
+	template <typename T>
+	T* allocate(size_t count) { return arena.allocate<T>(count); }
+
+private:
+	ScratchArena& arena;
+	ScratchArena::Mark saved;
+};
@@ -0,0 +1,228 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// One timed scope
+struct TraceEvent
+{
+	const char* name;
+	int64_t value;    // Value shown with the event (-1 = none)
+	int64_t start;    // Nanoseconds since startTrace
+	int64_t duration; // Nanoseconds
+};
+
+// Events and counters of one thread; only that thread adds to them
+struct ThreadTrace
+{
+	size_t id = 0;
+	std::mutex mtx; // Taken by the thread for every event and by the export
+	std::vector<TraceEvent> events;
+	std::atomic<uint64_t> counters[static_cast<size_t>(TraceCounter::Count)] = {};
+};
+
+static const char* const TraceCounterNames[] = { "Matrix updates", "Score evaluations", "Bytes written" };
+
+// Every thread that recorded something; kept until exit, so threads that ended still show up
+static std::mutex threadsMtx;
+static std::vector<std::unique_ptr<ThreadTrace>> threads;
+static thread_local ThreadTrace* currentThread = nullptr;
+
+static std::chrono::steady_clock::time_point traceStart;
+
+static ThreadTrace& threadTrace()
+{
+	if (currentThread == nullptr)
+	{
+		std::lock_guard<std::mutex> lock(threadsMtx);
+		threads.push_back(std::make_unique<ThreadTrace>());
+		threads.back()->id = threads.size() - 1;
+		currentThread = threads.back().get();
+	}
+	return *currentThread;
+}
+
+/// <summary>
+/// Starts recording scopes and counters. Without DNA_TRACING the macros compile to nothing and
+/// nothing is recorded.
+/// </summary>
+void startTrace()
+{
+#ifdef DNA_TRACING
+	traceStart = std::chrono::steady_clock::now();
+	threadTrace(); // The starting thread is listed first
+	traceRecording.store(true);
+#else
+	std::cerr << "Warning: Tracing is compiled out (DNA_TRACING is not defined); the trace stays empty" << std::endl;
+#endif
+}
+
+#ifdef DNA_TRACING
+
+int64_t TraceScope::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceStart).count();
+}
+
+TraceScope::~TraceScope()
+{
+	if (name == nullptr)
+	{
+		return;
+	}
+	int64_t end = now();
+	ThreadTrace& thread = threadTrace();
+	std::lock_guard<std::mutex> lock(thread.mtx);
+	thread.events.push_back({ name, value, start, end - start });
+}
+
+/// <summary>
+/// Adds to a counter of the calling thread.
+/// </summary>
+void addTraceCount(TraceCounter counter, uint64_t amount)
+{
+	// Only this thread writes the counter, so a plain add is enough
+	auto& total = threadTrace().counters[static_cast<size_t>(counter)];
+	total.store(total.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+#endif
+
+// Totals of the counters over every thread
+static std::vector<uint64_t> counterTotals()
+{
+	std::vector<uint64_t> totals(static_cast<size_t>(TraceCounter::Count), 0);
+	std::lock_guard<std::mutex> lock(threadsMtx);
+	for (const auto& thread : threads)
+	{
+		for (size_t c = 0; c < totals.size(); ++c)
+		{
+			totals[c] += thread->counters[c].load(std::memory_order_relaxed);
+		}
+	}
+	return totals;
+}
+
+/// <summary>
+/// Saves every recorded scope as a complete event and every counter in the Chrome trace event
+/// format, which chrome://tracing and ui.perfetto.dev open.
+/// </summary>
+/// <param name="filename">Path of the JSON file.</param>
+/// <returns>True when the file was written.</returns>
+bool saveTrace(const std::string& filename)
+{
+	std::ofstream file(filename);
+	if (!file)
+	{
+		std::cerr << "Error: Unable to create file " << filename << std::endl;
+		return false;
+	}
+
+	// Times are in microseconds
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"dna-hidden-repeat-detector\"}}";
+
+	int64_t traceEnd = 0;
+	{
+		std::lock_guard<std::mutex> lock(threadsMtx);
+		for (const auto& thread : threads)
+		{
+			std::lock_guard<std::mutex> threadLock(thread->mtx);
+			file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id
+				<< ",\"args\":{\"name\":\"" << (thread->id == 0 ? std::string("main") : "thread " + std::to_string(thread->id)) << "\"}}";
+			for (const auto& event : thread->events)
+			{
+				file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->id
+					<< ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << event.duration / 1000.0;
+				if (event.value >= 0)
+				{
+					file << ",\"args\":{\"value\":" << event.value << "}";
+				}
+				file << "}";
+				traceEnd = std::max(traceEnd, event.start + event.duration);
+			}
+		}
+	}
+
+	// Counters are shown as tracks rising from zero to their totals over the run
+	auto totals = counterTotals();
+	for (size_t c = 0; c < totals.size(); ++c)
+	{
+		for (int64_t ts : { int64_t{ 0 }, traceEnd })
+		{
+			file << ",\n{\"name\":\"" << TraceCounterNames[c] << "\",\"ph\":\"C\",\"pid\":1,\"ts\":" << ts / 1000.0
+				<< ",\"args\":{\"value\":" << (ts == 0 ? 0 : totals[c]) << "}}";
+		}
+	}
+	file << "\n]}\n";
+
+	if (!file)
+	{
+		std::cerr << "Error: Unable to write file " << filename << std::endl;
+		return false;
+	}
+	std::cout << "Trace saved successfully!: " << filename << std::endl;
+	return true;
+}
+
+/// <summary>
+/// Prints the calls, total, mean and longest time of every scope name, and the counter totals.
+/// Scopes on worker threads overlap, so their totals can exceed the wall time.
+/// </summary>
+void printTraceSummary(std::ostream& out)
+{
+	struct ScopeSummary
+	{
+		int64_t firstStart = INT64_MAX;
+		uint64_t calls = 0;
+		int64_t total = 0;
+		int64_t longest = 0;
+	};
+	std::map<std::string, ScopeSummary> scopes;
+	{
+		std::lock_guard<std::mutex> lock(threadsMtx);
+		for (const auto& thread : threads)
+		{
+			std::lock_guard<std::mutex> threadLock(thread->mtx);
+			for (const auto& event : thread->events)
+			{
+				ScopeSummary& scope = scopes[event.name];
+				scope.firstStart = std::min(scope.firstStart, event.start);
+				++scope.calls;
+				scope.total += event.duration;
+				scope.longest = std::max(scope.longest, event.duration);
+			}
+		}
+	}
+
+	// Stages are listed in the order they started
+	std::vector<std::pair<std::string, ScopeSummary>> ordered(scopes.begin(), scopes.end());
+	std::sort(ordered.begin(), ordered.end(), [](const auto& a, const auto& b) { return a.second.firstStart < b.second.firstStart; });
+
+	out << "\n=== Trace Summary ===\n";
+	out << std::left << std::setw(28) << "Scope" << std::right << std::setw(10) << "Calls"
+		<< std::setw(14) << "Total ms" << std::setw(12) << "Mean ms" << std::setw(12) << "Max ms" << "\n";
+	out << std::fixed << std::setprecision(3);
+	for (const auto& [name, scope] : ordered)
+	{
+		out << std::left << std::setw(28) << name << std::right << std::setw(10) << scope.calls
+			<< std::setw(14) << scope.total / 1e6 << std::setw(12) << scope.total / 1e6 / scope.calls
+			<< std::setw(12) << scope.longest / 1e6 << "\n";
+	}
+	out.unsetf(std::ios::floatfield);
+	out << std::setprecision(6);
+
+	auto totals = counterTotals();
+	for (size_t c = 0; c < totals.size(); ++c)
+	{
+		out << TraceCounterNames[c] << " : " << totals[c] << "\n";
+	}
+	out << std::flush;
+}
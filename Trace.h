@@ -0,0 +1,95 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+// Counters of the hot paths
+enum class TraceCounter
+{
+	MatrixUpdates,    // Words added to or removed from occurrence matrices
+	ScoreEvaluations, // Occurrence matrices scored
+	BytesWritten,     // Bytes written by the CSV savers
+	Count
+};
+
+/// <summary>
+/// Starts recording scopes and counters. Without DNA_TRACING the macros compile to nothing and
+/// nothing is recorded.
+/// </summary>
+void startTrace();
+
+/// <summary>
+/// True once startTrace was called.
+/// </summary>
+inline std::atomic<bool> traceRecording{ false };
+
+/// <summary>
+/// Saves every recorded scope as a complete event and every counter in the Chrome trace event
+/// format, which chrome://tracing and ui.perfetto.dev open.
+/// </summary>
+/// <param name="filename">Path of the JSON file.</param>
+/// <returns>True when the file was written.</returns>
+bool saveTrace(const std::string& filename);
+
+/// <summary>
+/// Prints the calls, total, mean and longest time of every scope name, and the counter totals.
+/// Scopes on worker threads overlap, so their totals can exceed the wall time.
+/// </summary>
+void printTraceSummary(std::ostream& out = std::cout);
+
+#ifdef DNA_TRACING
+
+/// <summary>
+/// Records the time from its construction to its destruction as one event of the calling thread.
+/// </summary>
+class TraceScope
+{
+public:
+	/// <param name="scopeName">Name of the scope; must outlive the trace, e.g. a string literal.</param>
+	/// <param name="scopeValue">Value shown with the event, e.g. the position of a chunk (-1 = none).</param>
+	explicit TraceScope(const char* scopeName, int64_t scopeValue = -1)
+		: name(traceRecording.load(std::memory_order_relaxed) ? scopeName : nullptr), value(scopeValue), start(name != nullptr ? now() : 0)
+	{
+	}
+	~TraceScope();
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+	static int64_t now();
+
+	const char* name; // Null when the trace was not recording at construction
+	int64_t value;
+	int64_t start;
+};
+
+/// <summary>
+/// Adds to a counter of the calling thread.
+/// </summary>
+void addTraceCount(TraceCounter counter, uint64_t amount);
+
+#define TRACE_NAME_CONCAT_INNER(a, b) a##b
+#define TRACE_NAME_CONCAT(a, b) TRACE_NAME_CONCAT_INNER(a, b)
+
+// Times the rest of the enclosing block
+#define TRACE_SCOPE(name) TraceScope TRACE_NAME_CONCAT(traceScope, __LINE__)(name)
+// Times the rest of the enclosing block, showing a value such as the chunk position with the event
+#define TRACE_SCOPE_VALUE(name, value) TraceScope TRACE_NAME_CONCAT(traceScope, __LINE__)(name, static_cast<int64_t>(value))
+// Adds to one of the TraceCounter counters
+#define TRACE_COUNT(counter, amount) \
+	do { if (traceRecording.load(std::memory_order_relaxed)) addTraceCount(TraceCounter::counter, (amount)); } while (false)
+
+#else
+
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_SCOPE_VALUE(name, value) ((void)0)
+#define TRACE_COUNT(counter, amount) ((void)0)
+
+#endif
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MemoryPlacement.h"
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+/// <summary>
+/// Array of 64-bit words behind the bit vectors of the indexes. It owns its words when an index
+/// is built in this process, or borrows read-only words from a mapped genome image, so every
+/// process attached to the image shares one copy. A borrowed array must not be modified.
+/// Owned words of large arrays come from placed memory when huge pages or NUMA placement are on.
+/// </summary>
+class WordArray
+{
+public:
+	WordArray() = default;
+
+	/// <summary>
+	/// Makes an array that reads words owned by someone else, e.g. a mapped file that outlives it.
+	/// </summary>
+	/// <param name="words">First word.</param>
+	/// <param name="count">Number of words.</param>
+	/// <returns>The borrowing array.</returns>
+	static WordArray borrow(const uint64_t* words, size_t count)
+	{
+		WordArray array;
+		array.borrowed = words;
+		array.borrowedSize = count;
+		return array;
+	}
+
+	bool isBorrowed() const { return borrowed != nullptr; }
+
+	size_t size() const { return borrowed ? borrowedSize : owned.size(); }
+	bool empty() const { return size() == 0; }
+
+	const uint64_t* data() const { return borrowed ? borrowed : owned.data(); }
+	uint64_t* data() { return owned.data(); }
+
+	const uint64_t& operator[](size_t i) const { return data()[i]; }
+	uint64_t& operator[](size_t i) { return owned[i]; }
+
+	const uint64_t* begin() const { return data(); }
+	const uint64_t* end() const { return data() + size(); }
+
+	// Changing the size drops a borrowed view and starts owned words. Words added by resize are
+	// left uninitialized for the caller to write; assignZeros zeroes them in parallel chunks, so
+	// the pages of a large array are not all first touched by the calling thread.
+	void assign(size_t count, uint64_t value) { borrowed = nullptr; owned.assign(count, value); }
+	void resize(size_t count) { borrowed = nullptr; owned.resize(count); }
+	void assignZeros(size_t count)
+	{
+		borrowed = nullptr;
+		owned.clear();
+		owned.resize(count);
+		zeroInParallel(owned.data(), count * sizeof(uint64_t));
+	}
+	void push_back(uint64_t word) { owned.push_back(word); }
+	uint64_t& back() { return owned.back(); }
+
+private:
+	std::vector<uint64_t, PlacedAllocator<uint64_t>> owned;
+	const uint64_t* borrowed = nullptr;
+	size_t borrowedSize = 0;
+};
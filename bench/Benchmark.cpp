@@ -0,0 +1,253 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include "ThreadPool.h"
+
+/// <summary>
+/// Returns the p-th percentile of sorted samples, interpolating linearly between neighbours.
+/// </summary>
+/// <param name="sorted">Samples in ascending order.</param>
+/// <param name="p">Percentile in [0, 100].</param>
+/// <returns>The percentile, or 0 for no samples.</returns>
+double percentile(const std::vector<double>& sorted, double p)
+{
+	if (sorted.empty())
+	{
+		return 0.0;
+	}
+
+	double rank = (p / 100.0) * (sorted.size() - 1);
+	size_t lower = static_cast<size_t>(std::floor(rank));
+	size_t upper = std::min(lower + 1, sorted.size() - 1);
+	double fraction = rank - lower;
+	return sorted[lower] + (sorted[upper] - sorted[lower]) * fraction;
+}
+
+/// <summary>
+/// Times body config.repetitions times after config.warmup untimed runs. Standard output of the
+/// kernels is discarded while they run, so their progress reports do not mix with the results.
+/// </summary>
+/// <param name="kernel">Function that is measured.</param>
+/// <param name="wordSize">Word size of the case, or 0.</param>
+/// <param name="length">Length of the input sequence.</param>
+/// <param name="items">Operations or bases processed by one call of body, for the throughput.</param>
+/// <param name="config">Warmup and repetition counts.</param>
+/// <param name="body">One repetition of the case.</param>
+/// <returns>The samples and their statistics.</returns>
+BenchmarkResult runBenchmark(const std::string& kernel, int wordSize, uint64_t length, uint64_t items,
+	const BenchmarkConfig& config, const std::function<void()>& body)
+{
+	BenchmarkResult result;
+	result.name = kernel + "/w" + std::to_string(wordSize) + "/n" + std::to_string(length);
+	result.kernel = kernel;
+	result.wordSize = wordSize;
+	result.length = length;
+	result.items = items;
+
+	std::ostringstream discarded;
+	std::streambuf* console = std::cout.rdbuf(discarded.rdbuf());
+	try
+	{
+		for (size_t i = 0; i < config.warmup; ++i)
+		{
+			body();
+			discarded.str("");
+		}
+		for (size_t i = 0; i < config.repetitions; ++i)
+		{
+			auto start = std::chrono::steady_clock::now();
+			body();
+			auto end = std::chrono::steady_clock::now();
+			result.samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+			discarded.str("");
+		}
+	}
+	catch (...)
+	{
+		std::cout.rdbuf(console);
+		throw;
+	}
+	std::cout.rdbuf(console);
+
+	std::vector<double> sorted = result.samples;
+	std::sort(sorted.begin(), sorted.end());
+	if (!sorted.empty())
+	{
+		double sum = 0.0;
+		for (double sample : sorted)
+		{
+			sum += sample;
+		}
+		result.mean = sum / sorted.size();
+
+		double squares = 0.0;
+		for (double sample : sorted)
+		{
+			squares += (sample - result.mean) * (sample - result.mean);
+		}
+		result.stddev = sorted.size() > 1 ? std::sqrt(squares / (sorted.size() - 1)) : 0.0;
+		result.min = sorted.front();
+		result.max = sorted.back();
+		result.p50 = percentile(sorted, 50.0);
+		result.p90 = percentile(sorted, 90.0);
+		result.p99 = percentile(sorted, 99.0);
+	}
+	return result;
+}
+
+/// <summary>
+/// Prints one line per case with its percentiles and throughput.
+/// </summary>
+void printBenchmarkTable(const std::vector<BenchmarkResult>& results, std::ostream& out)
+{
+	out << std::left << std::setw(52) << "Case"
+		<< std::right << std::setw(12) << "p50 ms"
+		<< std::setw(12) << "p90 ms"
+		<< std::setw(12) << "p99 ms"
+		<< std::setw(12) << "min ms"
+		<< std::setw(16) << "items/s" << "\n";
+
+	out << std::fixed << std::setprecision(4);
+	for (const auto& result : results)
+	{
+		double throughput = result.p50 > 0.0 ? result.items / (result.p50 / 1000.0) : 0.0;
+		out << std::left << std::setw(52) << result.name
+			<< std::right << std::setw(12) << result.p50
+			<< std::setw(12) << result.p90
+			<< std::setw(12) << result.p99
+			<< std::setw(12) << result.min
+			<< std::setw(16) << std::setprecision(0) << throughput << std::setprecision(4) << "\n";
+	}
+	out << std::defaultfloat << std::flush;
+}
+
+// Writes a string as a JSON string literal; case names only hold plain ASCII
+static void writeJsonString(std::ostream& out, const std::string& value)
+{
+	out << '"';
+	for (char c : value)
+	{
+		if (c == '"' || c == '\\')
+		{
+			out << '\\';
+		}
+		out << c;
+	}
+	out << '"';
+}
+
+/// <summary>
+/// Writes the configuration, statistics and raw samples of every case as JSON.
+/// </summary>
+/// <returns>True when the report was written.</returns>
+bool saveBenchmarkJson(const std::vector<BenchmarkResult>& results, const BenchmarkConfig& config, const std::string& filename)
+{
+	std::ofstream file(filename);
+	if (!file)
+	{
+		std::cerr << "Error opening file: " << filename << std::endl;
+		return false;
+	}
+
+	file << std::setprecision(17);
+	file << "{\n";
+	file << "  \"context\": {\n";
+	file << "    \"threads\": " << globalThreadPool().threadCount() << ",\n";
+	file << "    \"warmup\": " << config.warmup << ",\n";
+	file << "    \"repetitions\": " << config.repetitions << ",\n";
+	file << "    \"seed\": " << config.seed << "\n";
+	file << "  },\n";
+	file << "  \"benchmarks\": [";
+
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const auto& result = results[i];
+		file << (i == 0 ? "\n" : ",\n") << "    {\n";
+		file << "      \"name\": ";
+		writeJsonString(file, result.name);
+		file << ",\n      \"kernel\": ";
+		writeJsonString(file, result.kernel);
+		file << ",\n";
+		file << "      \"word_size\": " << result.wordSize << ",\n";
+		file << "      \"length\": " << result.length << ",\n";
+		file << "      \"items\": " << result.items << ",\n";
+		file << "      \"time_unit\": \"ms\",\n";
+		file << "      \"min\": " << result.min << ",\n";
+		file << "      \"mean\": " << result.mean << ",\n";
+		file << "      \"stddev\": " << result.stddev << ",\n";
+		file << "      \"p50\": " << result.p50 << ",\n";
+		file << "      \"p90\": " << result.p90 << ",\n";
+		file << "      \"p99\": " << result.p99 << ",\n";
+		file << "      \"max\": " << result.max << ",\n";
+		file << "      \"items_per_second\": " << (result.p50 > 0.0 ? result.items / (result.p50 / 1000.0) : 0.0) << ",\n";
+		file << "      \"samples\": [";
+		for (size_t j = 0; j < result.samples.size(); ++j)
+		{
+			file << (j == 0 ? "" : ", ") << result.samples[j];
+		}
+		file << "]\n    }";
+	}
+	file << "\n  ]\n}\n";
+	return static_cast<bool>(file);
+}
+
+/// <summary>
+/// Generates a DNA sequence that alternates random stretches, whose GC content drifts, with
+/// tandem repeats of short random words, so segmentation and merging have work to do.
+/// </summary>
+/// <param name="length">Length of the sequence.</param>
+/// <param name="seed">Seed of the generator; equal seeds give equal sequences.</param>
+/// <returns>An uppercase ACGT sequence.</returns>
+std::string generateBenchmarkSequence(uint64_t length, uint64_t seed)
+{
+	static const char AT[] = { 'A', 'T' };
+	static const char GC[] = { 'G', 'C' };
+
+	std::mt19937_64 generator(seed);
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+	std::uniform_int_distribution<int> pick(0, 1);
+	std::uniform_int_distribution<uint64_t> stretchLength(500, 3000);
+	std::uniform_int_distribution<int> period(2, 8);
+
+	std::string sequence;
+	sequence.reserve(length);
+	double gc = 0.4;
+	bool repeat = false;
+	auto randomBase = [&]()
+	{
+		return unit(generator) < gc ? GC[pick(generator)] : AT[pick(generator)];
+	};
+
+	while (sequence.size() < length)
+	{
+		uint64_t stretch = std::min(stretchLength(generator), length - sequence.size());
+		if (repeat)
+		{
+			std::string word;
+			for (int i = period(generator); i > 0; --i)
+			{
+				word += randomBase();
+			}
+			for (uint64_t i = 0; i < stretch; ++i)
+			{
+				// A few point mutations keep the repeat hidden rather than exact
+				sequence += unit(generator) < 0.05 ? randomBase() : word[i % word.size()];
+			}
+		}
+		else
+		{
+			for (uint64_t i = 0; i < stretch; ++i)
+			{
+				sequence += randomBase();
+			}
+		}
+		repeat = !repeat;
+		gc = std::clamp(gc + (unit(generator) - 0.5) * 0.1, 0.3, 0.6);
+	}
+	return sequence;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4244) // Disable int-to-char conversion warning
+#pragma warning(disable : 4267) // Disable size_t-to-int conversion warning
+#endif
+
+// Settings of a benchmark run, passed as --name=value flags
+struct BenchmarkConfig
+{
+	size_t warmup = 1;                                           // Untimed runs before the measured ones
+	size_t repetitions = 10;                                     // Timed runs of every case
+	std::string filter;                                          // Only cases whose name contains this text (empty = all)
+	std::vector<uint64_t> lengths = { 10000, 100000, 1000000 };  // Generated sequence lengths
+	std::vector<int> wordSizes = { 2, 3, 5, 8 };                 // Word sizes of the kernels that take one
+	uint64_t seed = 20240601;                                    // Seed of the generated sequences
+	std::string jsonPath;                                        // JSON report file (empty = no report)
+};
+
+// Timings of one benchmark case
+struct BenchmarkResult
+{
+	std::string name;            // Unique case name: kernel/w<wordSize>/n<length>
+	std::string kernel;          // Function that was measured
+	int wordSize = 0;            // Word size of the case, or 0 when the kernel takes none
+	uint64_t length = 0;         // Length of the input sequence
+	uint64_t items = 0;          // Operations or bases processed by one repetition
+	std::vector<double> samples; // Milliseconds of every timed repetition, in run order
+	double min = 0.0;
+	double mean = 0.0;
+	double stddev = 0.0;
+	double p50 = 0.0;
+	double p90 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
+
+/// <summary>
+/// Returns the p-th percentile of sorted samples, interpolating linearly between neighbours.
+/// </summary>
+/// <param name="sorted">Samples in ascending order.</param>
+/// <param name="p">Percentile in [0, 100].</param>
+/// <returns>The percentile, or 0 for no samples.</returns>
+double percentile(const std::vector<double>& sorted, double p);
+
+/// <summary>
+/// Times body config.repetitions times after config.warmup untimed runs. Standard output of the
+/// kernels is discarded while they run, so their progress reports do not mix with the results.
+/// </summary>
+/// <param name="kernel">Function that is measured.</param>
+/// <param name="wordSize">Word size of the case, or 0.</param>
+/// <param name="length">Length of the input sequence.</param>
+/// <param name="items">Operations or bases processed by one call of body, for the throughput.</param>
+/// <param name="config">Warmup and repetition counts.</param>
+/// <param name="body">One repetition of the case.</param>
+/// <returns>The samples and their statistics.</returns>
+BenchmarkResult runBenchmark(const std::string& kernel, int wordSize, uint64_t length, uint64_t items,
+	const BenchmarkConfig& config, const std::function<void()>& body);
+
+/// <summary>
+/// Prints one line per case with its percentiles and throughput.
+/// </summary>
+void printBenchmarkTable(const std::vector<BenchmarkResult>& results, std::ostream& out);
+
+/// <summary>
+/// Writes the configuration, statistics and raw samples of every case as JSON.
+/// </summary>
+/// <returns>True when the report was written.</returns>
+bool saveBenchmarkJson(const std::vector<BenchmarkResult>& results, const BenchmarkConfig& config, const std::string& filename);
+
+/// <summary>
+/// Generates a DNA sequence that alternates random stretches, whose GC content drifts, with
+/// tandem repeats of short random words, so segmentation and merging have work to do.
+/// </summary>
+/// <param name="length">Length of the sequence.</param>
+/// <param name="seed">Seed of the generator; equal seeds give equal sequences.</param>
+/// <returns>An uppercase ACGT sequence.</returns>
+std::string generateBenchmarkSequence(uint64_t length, uint64_t seed);
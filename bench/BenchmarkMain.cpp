@@ -0,0 +1,263 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "Benchmark.h"
+#include "OccurrenceMatrix.h"
+#include "Segment.h"
+#include "Isochore.h"
+#include "File_DNA.h"
+#include "ThreadPool.h"
+
+// Calls of the matrix kernels timed together, since a single call takes well under a microsecond
+const uint64_t MATRIX_CALLS_PER_REPETITION = 10000;
+
+// Segmentation parameters of the segment and merge cases, in words
+const int BENCHMARK_MIN_SEGMENT_SIZE = 10;
+const int BENCHMARK_LOOKAHEAD_SIZE = 5;
+
+// Window and step of the isochore scan case
+const uint64_t BENCHMARK_WINDOW_SIZE = 1000;
+const uint64_t BENCHMARK_STEP_SIZE = 100;
+
+// Results of the kernels are folded in here so the compiler cannot drop the calls
+static volatile uint64_t benchmarkSink = 0;
+
+void printBenchmarkHelp(const std::string& programName)
+{
+	std::cout << "\nUsage: " << programName << " [--options]\n"
+		<< "\nOptions:\n"
+		<< "  -h, --help        - Display this help message\n"
+		<< "  --filter=TEXT     - Only run cases whose name contains TEXT (e.g. SegmentDNACostAndWord/w3)\n"
+		<< "  --repetitions=N   - Timed runs of every case (default = 10)\n"
+		<< "  --warmup=N        - Untimed runs before the timed ones (default = 1)\n"
+		<< "  --lengths=N,...   - Generated sequence lengths (default = 10000,100000,1000000)\n"
+		<< "  --word-sizes=N,...- Word sizes of the kernels that take one (default = 2,3,5,8)\n"
+		<< "  --seed=N          - Seed of the generated sequences\n"
+		<< "  --threads=N       - Threads shared by all parallel stages (default = all hardware threads)\n"
+		<< "  --json=FILE       - Also write statistics and raw samples of every case as JSON\n"
+		<< std::endl;
+}
+
+// Splits a comma separated list of numbers
+template <typename T>
+static std::vector<T> parseList(const std::string& value)
+{
+	std::vector<T> values;
+	std::stringstream stream(value);
+	std::string item;
+	while (std::getline(stream, item, ','))
+	{
+		if (!item.empty())
+		{
+			values.push_back(static_cast<T>(std::stoull(item)));
+		}
+	}
+	return values;
+}
+
+// Runs a case unless the filter excludes it
+static void addCase(std::vector<BenchmarkResult>& results, const BenchmarkConfig& config,
+	const std::string& kernel, int wordSize, uint64_t length, uint64_t items, const std::function<void()>& body)
+{
+	std::string name = kernel + "/w" + std::to_string(wordSize) + "/n" + std::to_string(length);
+	if (!config.filter.empty() && name.find(config.filter) == std::string::npos)
+	{
+		return;
+	}
+
+	std::cerr << "Running " << name << std::endl;
+	results.push_back(runBenchmark(kernel, wordSize, length, items, config, body));
+}
+
+// Writes a sequence as a single-record FASTA file with 60 bases per line
+static void writeFasta(const std::string& filename, const std::string& sequence)
+{
+	std::ofstream file(filename);
+	file << ">benchmark generated sequence\n";
+	for (size_t i = 0; i < sequence.size(); i += 60)
+	{
+		file << sequence.substr(i, 60) << "\n";
+	}
+}
+
+// Cases of the word-size dependent kernels on one sequence
+static void runWordSizeCases(std::vector<BenchmarkResult>& results, const BenchmarkConfig& config, const std::string& sequence, int wordSize)
+{
+	uint64_t length = sequence.size();
+
+	addCase(results, config, "GenerateOccurrenceMatrix", wordSize, length, length, [&]()
+		{
+			auto matrix = GenerateOccurrenceMatrix(sequence, wordSize);
+			benchmarkSink = benchmarkSink + matrix[0][0];
+		});
+
+	// The matrix kernels work on the matrices of two halves of the sequence
+	std::string_view view(sequence);
+	auto left = GenerateOccurrenceMatrix(view.substr(0, length / 2), wordSize);
+	auto right = GenerateOccurrenceMatrix(view.substr(length / 2), wordSize);
+
+	addCase(results, config, "CalculatePercentageSumAndWord", wordSize, length, MATRIX_CALLS_PER_REPETITION, [&]()
+		{
+			for (uint64_t i = 0; i < MATRIX_CALLS_PER_REPETITION; ++i)
+			{
+				auto [cost, word] = CalculatePercentageSumAndWord(left);
+				benchmarkSink = benchmarkSink + word.size() + static_cast<uint64_t>(cost);
+			}
+		});
+
+	addCase(results, config, "sumMatrices", wordSize, length, MATRIX_CALLS_PER_REPETITION, [&]()
+		{
+			for (uint64_t i = 0; i < MATRIX_CALLS_PER_REPETITION; ++i)
+			{
+				auto sum = sumMatrices(left, right);
+				benchmarkSink = benchmarkSink + sum[0][0];
+			}
+		});
+
+	addCase(results, config, "subtractMatrices", wordSize, length, MATRIX_CALLS_PER_REPETITION, [&]()
+		{
+			for (uint64_t i = 0; i < MATRIX_CALLS_PER_REPETITION; ++i)
+			{
+				auto difference = subtractMatrices(left, right);
+				benchmarkSink = benchmarkSink + difference[0][0];
+			}
+		});
+
+	if (length < static_cast<uint64_t>(BENCHMARK_MIN_SEGMENT_SIZE) * wordSize)
+	{
+		return;
+	}
+
+	std::vector<std::tuple<uint64_t, uint64_t, double, std::string>> segments;
+	addCase(results, config, "SegmentDNACostAndWord", wordSize, length, length, [&]()
+		{
+			segments = SegmentDNACostAndWord(sequence, BENCHMARK_MIN_SEGMENT_SIZE, wordSize, BENCHMARK_LOOKAHEAD_SIZE);
+			benchmarkSink = benchmarkSink + segments.size();
+		});
+
+	// The merge case needs the segments even when the filter skipped the segmentation case
+	if (segments.empty())
+	{
+		std::ostringstream discarded;
+		std::streambuf* console = std::cout.rdbuf(discarded.rdbuf());
+		segments = SegmentDNACostAndWord(sequence, BENCHMARK_MIN_SEGMENT_SIZE, wordSize, BENCHMARK_LOOKAHEAD_SIZE);
+		std::cout.rdbuf(console);
+	}
+
+	addCase(results, config, "MergeSimilarSegments", wordSize, length, segments.size(), [&]()
+		{
+			auto merged = MergeSimilarSegments(segments, sequence, wordSize);
+			benchmarkSink = benchmarkSink + merged.size();
+		});
+}
+
+// Cases of the isochore scan and the loaders on one sequence
+static void runSequenceCases(std::vector<BenchmarkResult>& results, const BenchmarkConfig& config, const std::string& sequence, const fs::path& workFolder)
+{
+	uint64_t length = sequence.size();
+
+	std::string outputFolder = workFolder.string() + "/";
+	addCase(results, config, "detect_isochores_optimized", 0, length, length, [&]()
+		{
+			detect_isochores_optimized(sequence, outputFolder, BENCHMARK_WINDOW_SIZE, BENCHMARK_STEP_SIZE);
+		});
+
+	std::string fastaFile = (workFolder / ("benchmark_" + std::to_string(length) + ".fa")).string();
+	std::string savedFile = (workFolder / ("benchmark_" + std::to_string(length) + ".txt")).string();
+	std::ostringstream discarded;
+	std::streambuf* console = std::cout.rdbuf(discarded.rdbuf());
+	writeFasta(fastaFile, sequence);
+	save_loaded_data_as_file(savedFile, sequence);
+	std::cout.rdbuf(console);
+
+	addCase(results, config, "load_fasta_file", 0, length, length, [&]()
+		{
+			benchmarkSink = benchmarkSink + load_fasta_file(fastaFile).size();
+		});
+
+	addCase(results, config, "read_chromosome_file", 0, length, length, [&]()
+		{
+			benchmarkSink = benchmarkSink + read_chromosome_file(fastaFile).size();
+		});
+
+	addCase(results, config, "load_previously_saved_data", 0, length, length, [&]()
+		{
+			benchmarkSink = benchmarkSink + load_previously_saved_data(savedFile).size();
+		});
+
+	addCase(results, config, "load_previously_saved_data_binary_mode", 0, length, length, [&]()
+		{
+			benchmarkSink = benchmarkSink + load_previously_saved_data_binary_mode(savedFile).size();
+		});
+}
+
+// ======================== Main Function ========================
+int main(int argc, char** argv)
+{
+	BenchmarkConfig config;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		size_t separator = arg.find('=');
+		std::string name = arg.substr(0, separator);
+		std::string value = (separator == std::string::npos) ? "" : arg.substr(separator + 1);
+
+		if (name == "-h" || name == "--help")
+		{
+			printBenchmarkHelp(argv[0]);
+			return 0;
+		}
+		else if (name == "--filter") config.filter = value;
+		else if (name == "--repetitions") config.repetitions = std::stoull(value);
+		else if (name == "--warmup") config.warmup = std::stoull(value);
+		else if (name == "--lengths") config.lengths = parseList<uint64_t>(value);
+		else if (name == "--word-sizes") config.wordSizes = parseList<int>(value);
+		else if (name == "--seed") config.seed = std::stoull(value);
+		else if (name == "--threads") setThreadPoolSize(std::stoull(value));
+		else if (name == "--json") config.jsonPath = value;
+		else
+		{
+			std::cerr << "Unknown option: " << arg << std::endl;
+			printBenchmarkHelp(argv[0]);
+			return 1;
+		}
+	}
+	if (config.repetitions == 0)
+	{
+		std::cerr << "At least one repetition is required." << std::endl;
+		return 1;
+	}
+
+	fs::path workFolder = fs::temp_directory_path() / ("dna_benchmark_" + std::to_string(config.seed));
+	fs::create_directories(workFolder);
+
+	std::vector<BenchmarkResult> results;
+	for (uint64_t length : config.lengths)
+	{
+		std::string sequence = generateBenchmarkSequence(length, config.seed + length);
+		for (int wordSize : config.wordSizes)
+		{
+			runWordSizeCases(results, config, sequence, wordSize);
+		}
+		runSequenceCases(results, config, sequence, workFolder);
+	}
+
+	std::error_code error;
+	fs::remove_all(workFolder, error);
+
+	std::cout << "\n";
+	printBenchmarkTable(results, std::cout);
+
+	if (!config.jsonPath.empty())
+	{
+		if (!saveBenchmarkJson(results, config, config.jsonPath))
+		{
+			return 1;
+		}
+		std::cout << "\nBenchmark report saved successfully!: " << config.jsonPath << std::endl;
+	}
+	return 0;
+}